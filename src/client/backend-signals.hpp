@@ -27,6 +27,8 @@
 #ifndef OPENVPN3_DBUS_CLIENT_BACKENDSIGNALS_HPP
 #define OPENVPN3_DBUS_CLIENT_BACKENDSIGNALS_HPP
 
+#include "statistics-rates.hpp"
+
 class BackendSignals : public LogSender
 {
 public:
@@ -34,8 +36,44 @@ public:
         : LogSender(conn, lgroup, OpenVPN3DBus_interf_backends, object_path)
     {
         SetLogLevel(default_log_level);
+        // The backend client produces dozens of log lines within a few
+        // milliseconds during connection setup; batch them into single
+        // LogBatch signals instead of one bus wakeup per line
+        SetLogBatching(true);
+        // A misbehaving peer can trigger thousands of identical error
+        // lines per second; keep the sustained rate bounded so one
+        // session cannot drown the logger
+        SetLogRateLimit(default_rate_limit, default_rate_burst);
+        // Once a consumer has attached through RegisterLogWatch, send
+        // Log and StatusChange signals directly to the registered
+        // consumers instead of broadcasting them; until then emission
+        // falls back to broadcast
+        SetUnicastDelivery(true);
+    }
+
+    /**
+     *  Registers the session token of this backend process, carried
+     *  as the session identifier by the USDT tracepoints
+     *
+     * @param token  Session token assigned by the backend starter
+     */
+    void SetSessionToken(std::string token)
+    {
+        session_token = token;
+    }
+
+    /**
+     *  Attaches the derived statistics tracker, which gets the
+     *  reconnect timing events observed on the StatusChange path
+     *
+     * @param tracker  ConnectionStatsRates object owned by the caller
+     */
+    void SetRatesTracker(ConnectionStatsRates *tracker)
+    {
+        rates = tracker;
     }
 
+
     /**
      * Sends a FATAL log messages and kills itself
      *
@@ -57,13 +95,30 @@ public:
      */
     void StatusChange(const StatusMajor major, const StatusMinor minor, std::string msg)
     {
+        OPENVPN3_PROBE3(backend_statuschange,
+                        (unsigned int) major, (unsigned int) minor,
+                        session_token.c_str());
+        if (rates && StatusMajor::CONNECTION == major)
+        {
+            // Every status transition passes through here, which makes
+            // this the single spot to time reconnect durations from,
+            // regardless of whether the reconnect was requested over
+            // D-Bus or initiated by the VPN core itself
+            if (StatusMinor::CONN_RECONNECTING == minor)
+            {
+                rates->ReconnectStarted();
+            }
+            else if (StatusMinor::CONN_CONNECTED == minor)
+            {
+                rates->ReconnectCompleted();
+            }
+        }
         last_major = (guint) major;
         last_minor = (guint) minor;
         last_msg = msg;
-        GVariant *params = g_variant_new("(uus)",
-                                         last_major, last_minor,
-                                         last_msg.c_str());
-        Send("StatusChange", params);
+        GVariant *params = GVariantTyped::Tuple(last_major, last_minor,
+                                                last_msg);
+        SendToConsumers("StatusChange", params);
     }
 
     /**
@@ -89,7 +144,8 @@ public:
                       const ClientAttentionGroup att_group,
                       std::string msg)
     {
-        GVariant *params = g_variant_new("(uus)", (guint) att_type, (guint) att_group, msg.c_str());
+        GVariant *params = GVariantTyped::Tuple((guint) att_type,
+                                                (guint) att_group, msg);
         Send("AttentionRequired", params);
     }
 
@@ -106,19 +162,25 @@ public:
             return NULL;  // Nothing have been logged, nothing to report
         }
 
-        GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+        GVariantBuilder *b = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a{sv}"));
         g_variant_builder_add (b, "{sv}", "major", g_variant_new_uint32(last_major));
         g_variant_builder_add (b, "{sv}", "minor", g_variant_new_uint32(last_minor));
         g_variant_builder_add (b, "{sv}", "status_message", g_variant_new_string(last_msg.c_str()));
-        return g_variant_builder_end(b);
+        GVariant *ret = g_variant_builder_end(b);
+        GVariantBuilderPool::Release(b);
+        return ret;
     }
 
 
 private:
     const unsigned int default_log_level = 6; // LogCategory::DEBUG
+    const unsigned int default_rate_limit = 50;  // events/second, sustained
+    const unsigned int default_rate_burst = 200; // bucket size
     guint32 last_major;
     guint32 last_minor;
+    ConnectionStatsRates *rates = nullptr;
     std::string last_msg;
+    std::string session_token;
 };
 
 #endif  // OPENVPN3_DBUS_CLIENT_BACKENDSIGNALS_HPP
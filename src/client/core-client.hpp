@@ -29,9 +29,17 @@
 #ifndef OPENVPN3_CORE_CLIENT
 #define OPENVPN3_CORE_CLIENT
 
+#include <ctime>
+#include <fstream>
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
 
 #include <openvpn/common/platform.hpp>
 
@@ -51,11 +59,30 @@
 
 #include "common/core-extensions.hpp"
 #include "backend-signals.hpp"
+#include "core-event-ring.hpp"
 #include "statistics.hpp"
 
 using namespace openvpn;
 
 
+/**
+ *  Transport socket tuning parameters which are applied directly on
+ *  the VPN transport socket before the connection is established.
+ *  Values which are zero (or negative where noted) leave the
+ *  corresponding kernel default untouched.
+ */
+struct TransportTuning
+{
+    int sndbuf = 0;           ///< SO_SNDBUF size in bytes, 0 == kernel default
+    int rcvbuf = 0;           ///< SO_RCVBUF size in bytes, 0 == kernel default
+    bool tcp_nodelay = false; ///< Enable TCP_NODELAY on TCP transports
+    int mtu_discover = -1;    ///< IP_MTU_DISCOVER policy (IP_PMTUDISC_*),
+                              ///< -1 == kernel default
+    int udp_gso_segsize = 0;  ///< UDP_SEGMENT GSO segment size in bytes,
+                              ///< 0 == disabled
+};
+
+
 /**
  *  Core VPN Client implementation of ClientAPI::OpenVPNClient
  */
@@ -80,6 +107,7 @@ public:
             : OpenVPNClient::OpenVPNClient(),
               signal(signal),
               userinputq(userinputq),
+              evring(signal),
               failed_signal_sent(false),
               run_status(StatusMinor::CONN_INIT)
     {
@@ -122,6 +150,168 @@ public:
     }
 
 
+    /**
+     *  Checks if this client object carries cached session state from
+     *  a recent established connection.  The state is recorded on each
+     *  CONNECTED event and invalidated when the connection fails
+     *  permanently, so it indicates that a transport-only reconnect
+     *  can reuse the negotiated session instead of starting from
+     *  scratch.
+     *
+     * @param ttl  Maximum age of the cached state, in seconds
+     *
+     * @return Returns true if cached session state is available and
+     *         younger than the given ttl
+     */
+    bool HasCachedSession(unsigned int ttl)
+    {
+        return (cached_session_time > 0)
+               && (std::time(nullptr) - cached_session_time
+                   <= (std::time_t) ttl);
+    }
+
+
+    /**
+     *  Retrieves a short description of the cached session state, for
+     *  logging purposes
+     *
+     * @return Returns a string describing the connection the cached
+     *         state was negotiated with
+     */
+    std::string GetCachedSessionInfo()
+    {
+        return cached_session_info;
+    }
+
+
+    /**
+     *  Provides the interned table of statistics key names.  The key
+     *  set is static for the lifetime of the process, so the strings
+     *  are built once and shared by every statistics poll, indexed by
+     *  the same dense index the core library uses for the counters.
+     *
+     * @return Returns a const reference to the key name table
+     */
+    static const std::vector<std::string>& StatsKeys()
+    {
+        static std::vector<std::string> keys = []()
+        {
+            std::vector<std::string> k;
+            const int n = stats_n();
+            k.reserve(n);
+            for (int i = 0; i < n; ++i)
+            {
+                k.push_back(stats_name(i));
+            }
+            return k;
+        }();
+        return keys;
+    }
+
+
+    /**
+     *  Fills a preallocated snapshot with the current statistics
+     *  counters.  The snapshot is a plain array of int64 values
+     *  indexed like StatsKeys(); reusing the same snapshot between
+     *  polls avoids any per-poll allocation.
+     *
+     * @param snapshot  std::vector<long long> to fill.  It is resized
+     *                  to the number of counters on the first use.
+     */
+    void GetStatsSnapshot(std::vector<long long>& snapshot)
+    {
+        const size_t n = (size_t) stats_n();
+        if (snapshot.size() != n)
+        {
+            snapshot.resize(n);
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            snapshot[i] = stats_value((int) i);
+        }
+#ifdef ENABLE_OVPNDCO
+        if (dco_offload)
+        {
+            overlay_kernel_byte_counters(snapshot);
+        }
+#endif
+    }
+
+
+#ifdef ENABLE_OVPNDCO
+    /**
+     *  Enables or disables the kernel data channel offload mode for
+     *  this client object.  With offload active the tunnel payload
+     *  never passes through this process, so the userspace byte
+     *  counters stay at zero and the statistics are sourced from the
+     *  kernel interface instead.
+     *
+     * @param mode  Boolean flag enabling kernel data channel offload
+     */
+    void SetDataChannelOffload(bool mode)
+    {
+        dco_offload = mode;
+    }
+
+
+    /**
+     *  Checks if kernel data channel offload is active for this
+     *  client object
+     *
+     * @return Returns true if the data channel runs in the kernel
+     */
+    bool GetDataChannelOffload() const
+    {
+        return dco_offload;
+    }
+#endif
+
+
+    /**
+     *  Sets the transport socket tuning parameters.  These are
+     *  applied on the transport socket via socket_protect(), which
+     *  the core library calls with the raw socket descriptor before
+     *  connecting, so the call must happen before connect() to take
+     *  effect for the initial connection.  Values set later are
+     *  picked up on the next (re)connect.
+     *
+     * @param tune  TransportTuning struct with the parameters to apply
+     */
+    void SetTransportTuning(const TransportTuning& tune)
+    {
+        tuning = tune;
+    }
+
+
+    /**
+     *  Retrieves the currently configured transport socket tuning
+     *  parameters
+     *
+     * @return Returns a copy of the active TransportTuning settings
+     */
+    TransportTuning GetTransportTuning() const
+    {
+        return tuning;
+    }
+
+
+    /**
+     *  Hands over an already-open tun device descriptor to this
+     *  client object.  The descriptor is created by the privileged
+     *  backend starter before this process drops its privileges, and
+     *  is adopted via the tun builder instead of the core library
+     *  opening and configuring a device itself inside the connect
+     *  path.
+     *
+     * @param fd  Open tun device descriptor, as created by the
+     *            backend starter
+     */
+    void SetPreopenedTunFD(int fd)
+    {
+        preopened_tun_fd = fd;
+    }
+
+
     /**
      *  Retrieves the connection statistics of a running tunnel
      *
@@ -151,14 +341,238 @@ private:
     unsigned long evntcount = 0;
     BackendSignals *signal;
     RequiresQueue *userinputq;
+
+    //  All D-Bus signal emission triggered from the core library
+    //  thread is routed through this ring and performed by the main
+    //  loop; see core-event-ring.hpp.  Methods called on the main
+    //  thread keep using the signal pointer directly.
+    CoreEventRing evring;
     std::mutex event_mutex;
     bool failed_signal_sent;
     StatusMinor run_status;
+    std::time_t cached_session_time = 0;
+    std::string cached_session_info;
+    TransportTuning tuning;
+    int preopened_tun_fd = -1;
 
 
+    /**
+     *  Called by the core library's tun builder when the tun device
+     *  is to be established.  When the backend starter passed in a
+     *  pre-created device, its descriptor is handed over here; the
+     *  device creation cost and the privileges it requires then stay
+     *  out of this process entirely.  The descriptor is consumed on
+     *  first use, so a later re-establish creates a fresh device
+     *  through the normal path.
+     *
+     * @return Returns the tun device descriptor to use, or the result
+     *         of the default implementation when no pre-created
+     *         device is available
+     */
+    virtual int tun_builder_establish() override
+    {
+        if (preopened_tun_fd >= 0)
+        {
+            int fd = preopened_tun_fd;
+            preopened_tun_fd = -1;
+            evring.Log(LogCategory::DEBUG,
+                       "Adopting pre-created tun device (fd "
+                       + std::to_string(fd) + ")");
+            return fd;
+        }
+        return ClientAPI::OpenVPNClient::tun_builder_establish();
+    }
+#ifdef ENABLE_OVPNDCO
+    bool dco_offload = false;
+#endif
+
+
+#ifdef ENABLE_OVPNDCO
+    /**
+     *  Replaces the userspace data channel byte counters in a
+     *  statistics snapshot with the counters of the kernel tun
+     *  interface.  With the data channel offloaded, the tunnel
+     *  payload is handled entirely by the ovpn-dco kernel module;
+     *  only the kernel interface counters reflect the real traffic.
+     *
+     * @param snapshot  Statistics snapshot indexed like StatsKeys()
+     */
+    void overlay_kernel_byte_counters(std::vector<long long>& snapshot)
+    {
+        const ClientAPI::ConnectionInfo ci = connection_info();
+        if (!ci.defined || ci.tunName.empty())
+        {
+            return;
+        }
+
+        // On a tun interface, rx_bytes counts the payload delivered
+        // by the tunnel into the local network stack and tx_bytes
+        // the payload leaving through the tunnel
+        long long rx = read_netdev_counter(ci.tunName, "rx_bytes");
+        long long tx = read_netdev_counter(ci.tunName, "tx_bytes");
+        if (rx < 0 || tx < 0)
+        {
+            return;
+        }
+
+        const std::vector<std::string>& keys = StatsKeys();
+        for (size_t i = 0; i < keys.size() && i < snapshot.size(); ++i)
+        {
+            if ("BYTES_IN" == keys[i] || "bytes_in" == keys[i])
+            {
+                snapshot[i] = rx;
+            }
+            else if ("BYTES_OUT" == keys[i] || "bytes_out" == keys[i])
+            {
+                snapshot[i] = tx;
+            }
+        }
+    }
+
+
+    /**
+     *  Reads a single network device statistics counter from sysfs
+     *
+     * @param dev      Name of the network interface
+     * @param counter  Counter file name, such as "rx_bytes"
+     *
+     * @return Returns the counter value, or -1 if the counter could
+     *         not be read
+     */
+    static long long read_netdev_counter(const std::string& dev,
+                                         const char *counter)
+    {
+        std::ifstream statfile("/sys/class/net/" + dev
+                               + "/statistics/" + counter);
+        long long value = -1;
+        if (!(statfile >> value))
+        {
+            return -1;
+        }
+        return value;
+    }
+#endif
+
+
+    /**
+     *  Called by the core library with the raw transport socket
+     *  descriptor before the socket connects.  This is where the
+     *  configured transport tuning is applied; a failing socket
+     *  option is logged as a warning but never aborts the
+     *  connection attempt.
+     *
+     * @param socket  File descriptor of the transport socket
+     *
+     * @return Always returns true, as no socket protection is needed
+     *         on this platform
+     */
     virtual bool socket_protect(int socket)
     {
-            return true;
+        apply_transport_tuning(socket);
+        return true;
+    }
+
+
+    /**
+     *  Applies the configured TransportTuning values on a transport
+     *  socket.  Options which do not match the socket type (such as
+     *  TCP_NODELAY on a UDP socket) are silently skipped.
+     *
+     * @param socket  File descriptor of the transport socket
+     */
+    void apply_transport_tuning(int socket)
+    {
+        int sotype = 0;
+        socklen_t solen = sizeof(sotype);
+        (void) getsockopt(socket, SOL_SOCKET, SO_TYPE, &sotype, &solen);
+
+        if (tuning.sndbuf > 0)
+        {
+            set_sockopt_int(socket, SOL_SOCKET, SO_SNDBUF,
+                            "sndbuf", tuning.sndbuf);
+            log_effective_bufsize(socket, SO_SNDBUF, "sndbuf");
+        }
+        if (tuning.rcvbuf > 0)
+        {
+            set_sockopt_int(socket, SOL_SOCKET, SO_RCVBUF,
+                            "rcvbuf", tuning.rcvbuf);
+            log_effective_bufsize(socket, SO_RCVBUF, "rcvbuf");
+        }
+        if (tuning.tcp_nodelay && SOCK_STREAM == sotype)
+        {
+            set_sockopt_int(socket, IPPROTO_TCP, TCP_NODELAY,
+                            "tcp-nodelay", 1);
+        }
+        if (tuning.mtu_discover >= 0)
+        {
+            set_sockopt_int(socket, IPPROTO_IP, IP_MTU_DISCOVER,
+                            "mtu-discover", tuning.mtu_discover);
+        }
+        if (tuning.udp_gso_segsize > 0 && SOCK_DGRAM == sotype)
+        {
+#ifdef UDP_SEGMENT
+            set_sockopt_int(socket, IPPROTO_UDP, UDP_SEGMENT,
+                            "udp-gso-segsize", tuning.udp_gso_segsize);
+#else
+            evring.Log(LogCategory::WARN,
+                       "UDP GSO segment size configured, but "
+                       "UDP_SEGMENT is not supported by this build");
+#endif
+        }
+    }
+
+
+    /**
+     *  Sets a single integer socket option, logging a warning if the
+     *  kernel rejects it
+     *
+     * @param socket   File descriptor of the transport socket
+     * @param level    Socket option level (SOL_SOCKET, IPPROTO_TCP, ...)
+     * @param optname  Socket option to set
+     * @param label    Human readable option label used in log messages
+     * @param value    Integer value to set
+     */
+    void set_sockopt_int(int socket, int level, int optname,
+                         const char *label, int value)
+    {
+        if (setsockopt(socket, level, optname, &value, sizeof(value)) < 0)
+        {
+            evring.Log(LogCategory::WARN,
+                       "Failed setting " + std::string(label)
+                       + "=" + std::to_string(value)
+                       + " on transport socket: "
+                       + std::string(strerror(errno)));
+        }
+        else
+        {
+            evring.Log(LogCategory::DEBUG,
+                       "Transport socket tuning: " + std::string(label)
+                       + "=" + std::to_string(value));
+        }
+    }
+
+
+    /**
+     *  Reads back the effective socket buffer size after tuning and
+     *  logs it.  The kernel doubles the requested value for
+     *  bookkeeping overhead and clamps it against net.core.[rw]mem_max,
+     *  so the effective size is what matters for verification.
+     *
+     * @param socket   File descriptor of the transport socket
+     * @param optname  SO_SNDBUF or SO_RCVBUF
+     * @param label    Human readable option label used in log messages
+     */
+    void log_effective_bufsize(int socket, int optname, const char *label)
+    {
+        int effective = 0;
+        socklen_t len = sizeof(effective);
+        if (0 == getsockopt(socket, SOL_SOCKET, optname, &effective, &len))
+        {
+            evring.Log(LogCategory::DEBUG,
+                       "Transport socket tuning: effective "
+                       + std::string(label) + "="
+                       + std::to_string(effective));
+        }
     }
 
 
@@ -168,6 +582,10 @@ private:
      *  evaluated and sent further as D-Bus signals to the session manager
      *  whenever appropriate.
      *
+     *  This callback runs on the core library thread, so the D-Bus
+     *  signals are not emitted here but queued on the event ring and
+     *  emitted by the main loop, in order.
+     *
      * @param ev  A ClientAPI::Event object with the current event.
      */
     virtual void event(const ClientAPI::Event& ev) override
@@ -177,17 +595,21 @@ private:
 #ifdef DEBUG_CORE_EVENTS
         std::stringstream entry;
         entry << " EVENT [" << evntcount << "][name=" << ev.name << "]: " << ev.info;
-        signal->Debug(entry.str());
+        evring.Log(LogCategory::DEBUG, entry.str());
 #endif
 
         if ("DYNAMIC_CHALLENGE" == ev.name)
         {
             dc_cookie = ev.info;
-            signal->Debug("DYNAMIC_CHALLENGE: |" + dc_cookie + "|");
+            evring.Log(LogCategory::DEBUG, "DYNAMIC_CHALLENGE: |" + dc_cookie + "|");
 
             ClientAPI::DynamicChallenge dc;
             if (ClientAPI::OpenVPNClient::parse_dynamic_challenge(dc_cookie, dc))
             {
+                // Retire any slots from a previous challenge round, so the
+                // slot storage gets recycled instead of growing per round
+                userinputq->RequireReset(ClientAttentionType::CREDENTIALS,
+                                         ClientAttentionGroup::CHALLENGE_DYNAMIC);
                 userinputq->RequireAdd(
                                 ClientAttentionType::CREDENTIALS,
                                 ClientAttentionGroup::CHALLENGE_DYNAMIC,
@@ -205,146 +627,161 @@ private:
                 userinputq->UpdateEntry(ClientAttentionType::CREDENTIALS,
                                         ClientAttentionGroup::CHALLENGE_DYNAMIC,
                                         dcrid, dc_cookie);
-                signal->AttentionReq(ClientAttentionType::CREDENTIALS,
-                                     ClientAttentionGroup::CHALLENGE_DYNAMIC,
-                                     dc.challenge);
-                signal->StatusChange(StatusMajor::CONNECTION,
-                                     StatusMinor::CFG_REQUIRE_USER,
-                                     "Dynamic Challenge");
+                evring.Attention(ClientAttentionType::CREDENTIALS,
+                                 ClientAttentionGroup::CHALLENGE_DYNAMIC,
+                                 dc.challenge);
+                evring.StatusChange(StatusMajor::CONNECTION,
+                                    StatusMinor::CFG_REQUIRE_USER,
+                                    "Dynamic Challenge");
                 run_status = StatusMinor::CFG_REQUIRE_USER;
             }
         }
         else if ("WARN" == ev.name)
         {
-            signal->LogWarn(ev.info);
+            evring.Log(LogCategory::WARN, ev.info);
         }
         else if ("INFO" == ev.name)
         {
-            signal->LogInfo(ev.info);
+            evring.Log(LogCategory::INFO, ev.info);
         }
         else if ("GET_CONFIG" == ev.name)
         {
-            signal->LogVerb2("Retrieving configuration from server");
+            evring.Log(LogCategory::VERB2, "Retrieving configuration from server");
         }
         else if ("TUN_SETUP_FAILED" == ev.name
                  && "TUN_IFACE_CREATE" == ev.name
                  && "TUN_IFACE_DISABLED" == ev.name)
         {
             failed_signal_sent = true;
-            signal->StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_FAILED);
+            evring.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_FAILED);
             run_status = StatusMinor::CONN_FAILED;
-            signal->LogCritical("Failed configuring TUN device (" + ev.name + ")");
+            evring.Log(LogCategory::CRIT, "Failed configuring TUN device (" + ev.name + ")");
         }
         else if ("CONNECTING" == ev.name)
         {
             // Don't log "Connecting" if we're in reconnect mode
             if (StatusMinor::CONN_RECONNECTING != run_status)
             {
-                signal->LogInfo("Connecting");
-                signal->StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_CONNECTING);
+                evring.Log(LogCategory::INFO, "Connecting");
+                evring.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_CONNECTING);
                 run_status = StatusMinor::CONN_CONNECTING;
             }
         }
         else if ("WAIT" == ev.name)
         {
-            signal->LogVerb1("Waiting for server response");
+            evring.Log(LogCategory::VERB1, "Waiting for server response");
         }
         else if ("WAIT_PROXY" == ev.name)
         {
-            signal->LogVerb1("Waiting for proxy server response");
+            evring.Log(LogCategory::VERB1, "Waiting for proxy server response");
         }
         else if ("CONNECTED" == ev.name)
         {
-            signal->LogInfo("Connected: " + ev.info);
-            signal->StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_CONNECTED);
+            evring.Log(LogCategory::INFO, "Connected: " + ev.info);
+            evring.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_CONNECTED);
             run_status = StatusMinor::CONN_CONNECTED;
+
+            // Record the negotiated session state.  As long as this
+            // client object stays alive, a transport-only reconnect
+            // can pick the session up from here instead of redoing
+            // the full handshake and option processing
+            cached_session_time = std::time(nullptr);
+            cached_session_info = ev.info;
         }
         else if ("RECONNECTING" == ev.name)
         {
-            signal->LogInfo("Reconnecting");
-            signal->StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_RECONNECTING);
+            evring.Log(LogCategory::INFO, "Reconnecting");
+            evring.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_RECONNECTING);
             run_status = StatusMinor::CONN_RECONNECTING;
         }
         else if ("RESOLVE" == ev.name)
         {
-            signal->LogVerb2("Resolving");
+            evring.Log(LogCategory::VERB2, "Resolving");
         }
         else if ("AUTH_FAILED" == ev.name)
         {
-            signal->LogVerb1("Authentication failed");
-            signal->StatusChange(StatusMajor::CONNECTION,
-                                 StatusMinor::CONN_AUTH_FAILED,
-                                 "Authentication failed");
+            // The server side state is gone; a reconnect must redo the
+            // full negotiation
+            cached_session_time = 0;
+            evring.Log(LogCategory::VERB1, "Authentication failed");
+            evring.StatusChange(StatusMajor::CONNECTION,
+                                StatusMinor::CONN_AUTH_FAILED,
+                                "Authentication failed");
             run_status = StatusMinor::CONN_AUTH_FAILED;
             failed_signal_sent = true;
         }
         else if ("CERT_VERIFY_FAIL" == ev.name)
         {
-            signal->LogCritical("Certificate verification failed:" + ev.info);
-            signal->StatusChange(StatusMajor::CONNECTION,
-                                 StatusMinor::CONN_FAILED,
-                                 "Certificate verification failed");
+            evring.Log(LogCategory::CRIT,
+                       "Certificate verification failed:" + ev.info);
+            evring.StatusChange(StatusMajor::CONNECTION,
+                                StatusMinor::CONN_FAILED,
+                                "Certificate verification failed");
             run_status = StatusMinor::CONN_FAILED;
             failed_signal_sent = true;
         }
         else if ("TLS_VERSION_MIN" == ev.name)
         {
-            signal->LogCritical("TLS version is requested by server is too low:" + ev.info);
-            signal->StatusChange(StatusMajor::CONNECTION,
-                                 StatusMinor::CONN_FAILED,
-                                 "TLS version too low");
+            evring.Log(LogCategory::CRIT,
+                       "TLS version is requested by server is too low:" + ev.info);
+            evring.StatusChange(StatusMajor::CONNECTION,
+                                StatusMinor::CONN_FAILED,
+                                "TLS version too low");
             run_status = StatusMinor::CONN_FAILED;
             failed_signal_sent = true;
         }
         else if ("CONNECTION_TIMEOUT" == ev.name)
         {
-            signal->LogInfo("Connection timeout");
-            signal->StatusChange(StatusMajor::CONNECTION,
-                                 StatusMinor::CONN_DISCONNECTING,
-                                 "Connection timeout");
+            evring.Log(LogCategory::INFO, "Connection timeout");
+            evring.StatusChange(StatusMajor::CONNECTION,
+                                StatusMinor::CONN_DISCONNECTING,
+                                "Connection timeout");
             run_status = StatusMinor::CONN_DISCONNECTING;
         }
         else if ("INACTIVE_TIMEOUT" == ev.name)
         {
-            signal->LogInfo("Connection closing due to inactivity");
-            signal->StatusChange(StatusMajor::CONNECTION,
-                                 StatusMinor::CONN_DISCONNECTING,
-                                 "Connection inactivity");
+            evring.Log(LogCategory::INFO, "Connection closing due to inactivity");
+            evring.StatusChange(StatusMajor::CONNECTION,
+                                StatusMinor::CONN_DISCONNECTING,
+                                "Connection inactivity");
             run_status = StatusMinor::CONN_DISCONNECTING;
         }
         else if ("PROXY_ERROR" == ev.name)
         {
-            signal->LogCritical("Proxy connection error:" + ev.info);
-            signal->StatusChange(StatusMajor::CONNECTION,
-                                 StatusMinor::CONN_FAILED,
-                                 "Proxy connection error");
+            evring.Log(LogCategory::CRIT, "Proxy connection error:" + ev.info);
+            evring.StatusChange(StatusMajor::CONNECTION,
+                                StatusMinor::CONN_FAILED,
+                                "Proxy connection error");
             run_status = StatusMinor::CONN_FAILED;
             failed_signal_sent = true;
         }
         else if ("PROXY_NEED_CREDS" == ev.name)
         {
-            signal->StatusChange(StatusMajor::CONNECTION,
-                                 StatusMinor::CONN_FAILED,
-                                 "Proxy connection error");
+            evring.StatusChange(StatusMajor::CONNECTION,
+                                StatusMinor::CONN_FAILED,
+                                "Proxy connection error");
             run_status = StatusMinor::CONN_FAILED;
             failed_signal_sent = true;
-            signal->LogCritical("Proxy " + ev.info);
+            evring.Log(LogCategory::CRIT, "Proxy " + ev.info);
         }
         else if (!failed_signal_sent && "DISCONNECTED" == ev.name)
         {
             if (StatusMinor::CONN_AUTH_FAILED != run_status
                 && StatusMinor::CFG_REQUIRE_USER != run_status)
             {
-                signal->StatusChange(StatusMajor::CONNECTION,
-                                     StatusMinor::CONN_DISCONNECTED);
+                evring.StatusChange(StatusMajor::CONNECTION,
+                                    StatusMinor::CONN_DISCONNECTED);
                 run_status = StatusMinor::CONN_DISCONNECTED;
-                signal->LogInfo("Disconnected");
+                evring.Log(LogCategory::INFO, "Disconnected");
             }
         }
         else if (ev.fatal)
         {
             std::string msgtag = "[" + ev.name + "] ";
-            signal->LogFATAL(msgtag + ev.info);
+            // The FATAL handling (signal emission plus process
+            // shutdown) happens on the main thread when the ring is
+            // drained, not on the core thread
+            evring.Log(LogCategory::FATAL, msgtag + ev.info);
         }
     }
 
@@ -359,7 +796,7 @@ private:
     virtual void log(const ClientAPI::LogInfo& log) override
     {
         // Log events going via log() are to be considered debug information
-        signal->Debug(log.text);
+        evring.Log(LogCategory::DEBUG, log.text);
     }
 
 
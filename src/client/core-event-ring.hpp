@@ -0,0 +1,364 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   core-event-ring.hpp
+ *
+ * @brief  Bounded lock-free handoff of core library events to the
+ *         GLib main loop.
+ *
+ *         The OpenVPN core invokes the event() and log() callbacks on
+ *         its own worker thread.  Emitting D-Bus signals straight
+ *         from there serializes the core thread against the GDBus
+ *         connection locks, which during connect storms is the top
+ *         contention point inside the backend process.  This ring
+ *         decouples the two: the core thread writes fixed-size
+ *         records into a single-producer/single-consumer ring and a
+ *         persistent GSource drains everything pending in one batch
+ *         per main-loop iteration, performing the actual signal
+ *         emission on the main thread.
+ *
+ *         Messages longer than one record payload are carried by
+ *         continuation records, so the producer never allocates.  If
+ *         the ring stays full (main loop stalled), the event is
+ *         dropped and counted, like AsyncLogWriter does on overrun;
+ *         emitting past the ring would reorder events and touch
+ *         main-loop-confined BackendSignals state from the wrong
+ *         thread.
+ */
+
+#ifndef OPENVPN3_DBUS_CLIENT_CORE_EVENT_RING_HPP
+#define OPENVPN3_DBUS_CLIENT_CORE_EVENT_RING_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <sched.h>
+
+#include <gio/gio.h>
+
+#include "backend-signals.hpp"
+
+
+class CoreEventRing
+{
+public:
+    /**
+     *  Sets up the ring and attaches its drain source to the default
+     *  main context.  Must be called on the main thread.
+     *
+     * @param signal  BackendSignals object the drained events are
+     *                emitted through, owned by the caller
+     */
+    CoreEventRing(BackendSignals *signal)
+        : signal(signal)
+    {
+        static GSourceFuncs funcs = {
+            ring_prepare,
+            ring_check,
+            ring_dispatch,
+            NULL
+        };
+        context = g_main_context_default();
+        source = g_source_new(&funcs, sizeof(RingSource));
+        ((RingSource *) source)->ring = this;
+        g_source_attach(source, context);
+    }
+
+    ~CoreEventRing()
+    {
+        if (source)
+        {
+            g_source_destroy(source);
+            g_source_unref(source);
+            source = nullptr;
+        }
+    }
+
+    CoreEventRing(const CoreEventRing&) = delete;
+    CoreEventRing& operator=(const CoreEventRing&) = delete;
+
+
+    //
+    //  Producer side - called from the core library thread only
+    //
+
+    /**
+     *  Queues a log event for emission from the main loop
+     *
+     * @param catg  LogCategory of the log event
+     * @param msg   The log message
+     */
+    void Log(LogCategory catg, const std::string& msg)
+    {
+        produce(Record::Type::LOG, (std::uint8_t) catg, 0, msg);
+    }
+
+    /**
+     *  Queues a StatusChange signal for emission from the main loop
+     */
+    void StatusChange(StatusMajor major, StatusMinor minor,
+                      const std::string& msg = "")
+    {
+        produce(Record::Type::STATUS,
+                (std::uint8_t) major, (std::uint8_t) minor, msg);
+    }
+
+    /**
+     *  Queues an AttentionRequired signal for emission from the
+     *  main loop
+     */
+    void Attention(ClientAttentionType att_type,
+                   ClientAttentionGroup att_group,
+                   const std::string& msg)
+    {
+        produce(Record::Type::ATTENTION,
+                (std::uint8_t) att_type, (std::uint8_t) att_group, msg);
+    }
+
+
+private:
+    struct Record
+    {
+        enum class Type : std::uint8_t
+        {
+            LOG = 1,
+            STATUS,
+            ATTENTION
+        };
+        std::uint8_t type;
+        std::uint8_t arg1;         ///< LogCategory, StatusMajor or
+                                   ///< ClientAttentionType
+        std::uint8_t arg2;         ///< StatusMinor or ClientAttentionGroup
+        std::uint8_t more;         ///< Non-zero: message continues in the
+                                   ///< next record
+        std::uint16_t length;      ///< Payload bytes used in text
+        char text[250];
+    };
+
+    //  Must be a power of two; 256 records of 256 bytes keeps the
+    //  whole ring within a handful of pages
+    static const std::size_t ring_size = 256;
+
+    struct RingSource
+    {
+        GSource source;
+        CoreEventRing *ring;
+    };
+
+    BackendSignals *signal = nullptr;
+    GMainContext *context = nullptr;
+    GSource *source = nullptr;
+
+    Record slots[ring_size];
+
+    //  Producer and consumer indexes on separate cache lines, so the
+    //  two threads do not false-share
+    alignas(64) std::atomic<std::size_t> head{0};  ///< Next write slot
+    alignas(64) std::atomic<std::size_t> tail{0};  ///< Next read slot
+
+    //  Events dropped because the ring stayed full; reported by the
+    //  consumer when the ring drains
+    std::atomic<std::size_t> dropped{0};
+
+    //  Consumer-side reassembly state for messages spanning several
+    //  records; only touched from the main thread
+    std::string pending_msg;
+
+
+    /**
+     *  Writes one event as a chain of fixed-size records and wakes
+     *  the main loop.  When the ring cannot take the whole chain
+     *  after a short wait, the event is dropped and counted; the
+     *  consumer reports the drops once the ring drains.  Bypassing
+     *  the ring is not an option - it would deliver this event ahead
+     *  of the older ones still queued, and the BackendSignals
+     *  batching and rate limiting state may only be touched from the
+     *  main thread.
+     */
+    void produce(Record::Type type, std::uint8_t arg1, std::uint8_t arg2,
+                 const std::string& msg)
+    {
+        std::size_t needed = 1 + msg.size() / sizeof(slots[0].text);
+
+        // Reserve space for the full chain up front, so a chain is
+        // never left half-written when the ring runs full
+        unsigned int spins = 0;
+        while (ring_size - (head.load(std::memory_order_relaxed)
+                            - tail.load(std::memory_order_acquire)) < needed)
+        {
+            if (++spins > overflow_spins)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            sched_yield();
+        }
+
+        std::size_t pos = head.load(std::memory_order_relaxed);
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < needed; i++, pos++)
+        {
+            Record& rec = slots[pos & (ring_size - 1)];
+            rec.type = (std::uint8_t) type;
+            rec.arg1 = arg1;
+            rec.arg2 = arg2;
+            rec.more = (i + 1 < needed) ? 1 : 0;
+            std::size_t chunk = msg.size() - offset;
+            if (chunk > sizeof(rec.text))
+            {
+                chunk = sizeof(rec.text);
+            }
+            rec.length = (std::uint16_t) chunk;
+            if (chunk > 0)
+            {
+                std::memcpy(rec.text, msg.data() + offset, chunk);
+            }
+            offset += chunk;
+        }
+        head.store(pos, std::memory_order_release);
+        g_main_context_wakeup(context);
+    }
+
+
+    /**
+     *  Drains every pending record and emits the events.  Runs on
+     *  the main thread from the dispatch of the ring GSource.
+     */
+    void drain()
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        std::size_t h = head.load(std::memory_order_acquire);
+        while (t != h)
+        {
+            Record& rec = slots[t & (ring_size - 1)];
+            pending_msg.append(rec.text, rec.length);
+            if (!rec.more)
+            {
+                dispatch_event(rec.type, rec.arg1, rec.arg2, pending_msg);
+                pending_msg.clear();
+            }
+            ++t;
+            // Publish consumption record by record, so a spinning
+            // producer sees space as soon as it appears
+            tail.store(t, std::memory_order_release);
+        }
+
+        // Report overflow drops once the ring has room again, so the
+        // warning itself is ordered after the events which did fit
+        std::size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0)
+        {
+            signal->LogWarn("Event ring overflow: "
+                            + std::to_string(lost)
+                            + " core event(s) dropped");
+        }
+    }
+
+
+    /**
+     *  Emits a single reassembled event through the signal object
+     */
+    void dispatch_event(std::uint8_t type, std::uint8_t arg1,
+                        std::uint8_t arg2, const std::string& msg)
+    {
+        switch ((Record::Type) type)
+        {
+        case Record::Type::LOG:
+            dispatch_log((LogCategory) arg1, msg);
+            break;
+
+        case Record::Type::STATUS:
+            signal->StatusChange((StatusMajor) arg1, (StatusMinor) arg2,
+                                 msg);
+            break;
+
+        case Record::Type::ATTENTION:
+            signal->AttentionReq((ClientAttentionType) arg1,
+                                 (ClientAttentionGroup) arg2, msg);
+            break;
+        }
+    }
+
+    void dispatch_log(LogCategory catg, const std::string& msg)
+    {
+        switch (catg)
+        {
+        case LogCategory::DEBUG:
+            signal->Debug(msg);
+            break;
+        case LogCategory::VERB2:
+            signal->LogVerb2(msg);
+            break;
+        case LogCategory::VERB1:
+            signal->LogVerb1(msg);
+            break;
+        case LogCategory::INFO:
+            signal->LogInfo(msg);
+            break;
+        case LogCategory::WARN:
+            signal->LogWarn(msg);
+            break;
+        case LogCategory::ERROR:
+            signal->LogError(msg);
+            break;
+        case LogCategory::CRIT:
+            signal->LogCritical(msg);
+            break;
+        case LogCategory::FATAL:
+            signal->LogFATAL(msg);
+            break;
+        default:
+            signal->Debug(msg);
+            break;
+        }
+    }
+
+    bool is_empty()
+    {
+        return tail.load(std::memory_order_relaxed)
+               == head.load(std::memory_order_acquire);
+    }
+
+    //  Roughly a millisecond of yielding before the overflow
+    //  fallback kicks in
+    static const unsigned int overflow_spins = 1000;
+
+
+    static gboolean ring_prepare(GSource *src, gint *timeout)
+    {
+        *timeout = -1;
+        return !((RingSource *) src)->ring->is_empty();
+    }
+
+    static gboolean ring_check(GSource *src)
+    {
+        return !((RingSource *) src)->ring->is_empty();
+    }
+
+    static gboolean ring_dispatch(GSource *src, GSourceFunc, gpointer)
+    {
+        ((RingSource *) src)->ring->drain();
+        return G_SOURCE_CONTINUE;
+    }
+};
+
+#endif  // OPENVPN3_DBUS_CLIENT_CORE_EVENT_RING_HPP
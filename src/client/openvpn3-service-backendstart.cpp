@@ -32,10 +32,17 @@
 
 
 #include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
 
 #include "config.h"
 #include "dbus/core.hpp"
 #include "log/dbus-log.hpp"
+#include "common/fdpass.hpp"
 #include "common/utils.hpp"
 
 using namespace openvpn;
@@ -129,14 +136,26 @@ public:
      *  Constructor initializing the Backend Starter to be registered on
      *  the D-Bus.
      *
-     * @param dbuscon  D-Bus this object is tied to
-     * @param busname  D-Bus bus name this service is registered on
-     * @param objpath  D-Bus object path to this object
+     * @param dbuscon   D-Bus this object is tied to
+     * @param busname   D-Bus bus name this service is registered on
+     * @param objpath   D-Bus object path to this object
+     * @param pool_size Number of pre-forked client processes to keep warm.
+     *                  If 0, every StartClient call fork()+execve()s a
+     *                  fresh process as before.
+     * @param multi_tunnel  If true, all sessions are hosted by a single
+     *                  persistent openvpn3-service-client process instead
+     *                  of one process per tunnel.  This cuts the per-tunnel
+     *                  memory cost to a fraction on hosts running many
+     *                  parallel tunnels.
      */
-    BackendStarterObject(GDBusConnection *dbuscon, const std::string busname, const std::string objpath)
+    BackendStarterObject(GDBusConnection *dbuscon, const std::string busname,
+                         const std::string objpath, unsigned int pool_size,
+                         bool multi_tunnel)
         : DBusObject(objpath),
           BackendStarterSignals(dbuscon, objpath),
-          dbuscon(dbuscon)
+          dbuscon(dbuscon),
+          pool_size(pool_size),
+          multi_tunnel(multi_tunnel)
     {
         std::stringstream introspection_xml;
         introspection_xml << "<node name='" << objpath << "'>"
@@ -150,12 +169,38 @@ public:
                           << "</node>";
         ParseIntrospectionXML(introspection_xml);
 
+        // Warm up the client process pool before the first StartClient
+        // call arrives
+        for (unsigned int i = 0; i < pool_size; i++)
+        {
+            spawn_pool_client();
+        }
+
         Debug(busname, objpath, "BackendStarterObject registered");
     }
 
     ~BackendStarterObject()
     {
         LogInfo("Shutting down");
+
+        // Drain the warm pool; closing the token socket without sending
+        // any token makes the pool client exit
+        for (auto& pc : client_pool)
+        {
+            close(pc.sockfd);
+            waitpid(pc.pid, NULL, 0);
+        }
+        client_pool.clear();
+
+        // Closing the multi-tunnel hand-over socket stops the hosting
+        // process from accepting new sessions; already running sessions
+        // keep going until they are shut down individually
+        if (mt_sockfd >= 0)
+        {
+            close(mt_sockfd);
+            mt_sockfd = -1;
+        }
+
         RemoveObject(dbuscon);
     }
 
@@ -171,6 +216,19 @@ public:
     }
 
 
+    /**
+     *  Number of pre-forked client processes currently waiting in the
+     *  pool.  Published via the debug memory object's object_counts
+     *  property.
+     *
+     * @return Returns the number of idle pool client processes
+     */
+    std::uint64_t GetPoolClientCount()
+    {
+        return client_pool.size();
+    }
+
+
     /**
      *  Callback method called each time a method in the Backend Starter
      *  service is called over the D-Bus.
@@ -288,12 +346,33 @@ public:
 
 
 private:
+    /**
+     * A single pre-forked, pre-initialized openvpn3-service-client
+     * process waiting for a session registration token
+     */
+    struct PoolClient
+    {
+        pid_t pid;   ///< Process ID of the pool client process
+        int sockfd;  ///< Our end of the socketpair used for token hand-over
+    };
+
     GDBusConnection *dbuscon;
+    unsigned int pool_size;
+    bool multi_tunnel;
+    std::vector<struct PoolClient> client_pool;
+    pid_t mt_pid = -1;   ///< pid the multi-tunnel client was started with
+    int mt_sockfd = -1;  ///< Token hand-over socket to the multi-tunnel client
 
 
     /**
-     * Forks out a child thread which starts the openvpn3-service-client
-     * process with the provided backend start token.
+     * Starts the openvpn3-service-client process which will handle the
+     * session identified by the provided backend start token.
+     *
+     * If a warm pool client is available, the token is handed over to it
+     * via its socketpair and a replacement pool client is forked.  This
+     * avoids paying the fork()+execve() and library load cost on the
+     * StartClient critical path.  Without pool clients, a new process is
+     * forked and exec'ed directly.
      *
      * @param token  String containing the start token identifying the session
      *               object this process is tied to.
@@ -301,6 +380,62 @@ private:
      */
     pid_t start_backend_process(char * token)
     {
+        if (multi_tunnel)
+        {
+            return multi_tunnel_attach(token);
+        }
+
+        if (!client_pool.empty())
+        {
+            struct PoolClient pc = client_pool.front();
+            client_pool.erase(client_pool.begin());
+
+            // Hand the session token over to the waiting pool client,
+            // together with a pre-created tun device descriptor.  The
+            // newline terminates the token on the receiving side.
+            int tunfd = preopen_tun_device();
+            ssize_t w = fdpass_send_token(pc.sockfd, token, tunfd);
+            if (tunfd >= 0)
+            {
+                close(tunfd);
+            }
+            close(pc.sockfd);
+
+            // Top up the pool before waiting for the hand-over to settle
+            spawn_pool_client();
+
+            if (w != (ssize_t) (strlen(token) + 1))
+            {
+                std::stringstream msg;
+                msg << "Pool client (pid " << pc.pid
+                    << ") failed to receive start token";
+                LogError(msg.str());
+                waitpid(pc.pid, NULL, 0);
+                return -1;
+            }
+
+            // As with the direct start below, the client process forks
+            // again once it has the token; wait for the first process
+            // to exit.
+            int rc = -1;
+            if (-1 == waitpid(pc.pid, &rc, 0))
+            {
+                std::stringstream msg;
+                msg << "Pool client process (" << token
+                    << ") - pid " << pc.pid
+                    << " failed to start as expected (exit code: "
+                    << std::to_string(rc) << ")";
+                LogError(msg.str());
+                return -1;
+            }
+            return pc.pid;
+        }
+
+        // Pre-create the tun device while still privileged; the
+        // descriptor is inherited across the fork()+execve() below
+        int tunfd = preopen_tun_device();
+        std::string tunfdstr = std::to_string(tunfd);
+
         pid_t backend_pid = fork();
         if (0 == backend_pid)
         {
@@ -311,6 +446,8 @@ private:
                 (char *) "--log-file=/tmp/valgrind.log",
 #endif
                 (char *) LIBEXEC_PATH "/openvpn3-service-client",
+                (char *) "--tun-fd",
+                (char *) tunfdstr.c_str(),
                 token,
                 NULL };
             execve(client_args[0], client_args, NULL);
@@ -322,6 +459,10 @@ private:
         else if( backend_pid > 0)
         {
             // Parent
+            if (tunfd >= 0)
+            {
+                close(tunfd);
+            }
 
             std::stringstream msg;
             // Wait for the child process to exit, as the client process will fork again
@@ -338,8 +479,219 @@ private:
             }
             return backend_pid;
         }
+        if (tunfd >= 0)
+        {
+            close(tunfd);
+        }
         throw std::runtime_error("Failed to fork() backend client process");
     }
+
+
+    /**
+     * Pre-creates a tun device while this service still holds the
+     * needed privileges (CAP_NET_ADMIN).  The open descriptor is
+     * handed over to the openvpn3-service-client process, which can
+     * then run fully unprivileged and skip the device creation
+     * round trip inside its connect path.
+     *
+     * @return Returns the open tun device descriptor, or -1 if the
+     *         device could not be created.  Without a descriptor the
+     *         client process creates its own device as before.
+     */
+    int preopen_tun_device()
+    {
+        int fd = open("/dev/net/tun", O_RDWR);
+        if (fd < 0)
+        {
+            Debug("", "", "Could not open /dev/net/tun: "
+                  + std::string(strerror(errno)));
+            return -1;
+        }
+
+        struct ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+        // Leaving the name empty makes the kernel assign the next
+        // free tunN name
+        if (ioctl(fd, TUNSETIFF, &ifr) < 0)
+        {
+            Debug("", "", "Could not create tun device: "
+                  + std::string(strerror(errno)));
+            close(fd);
+            return -1;
+        }
+
+        Debug("", "", "Pre-created tun device "
+              + std::string(ifr.ifr_name));
+        return fd;
+    }
+
+
+    /**
+     * Forks and execs a single openvpn3-service-client process in pool
+     * mode.  The process initializes itself completely (connects to the
+     * D-Bus, loads the core library) and then blocks on its end of a
+     * socketpair, waiting for a session registration token from
+     * @start_backend_process().
+     */
+    void spawn_pool_client()
+    {
+        int fds[2];
+        if (-1 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+        {
+            LogError("Failed creating socketpair for pool client: "
+                     + std::string(strerror(errno)));
+            return;
+        }
+
+        pid_t pool_pid = fork();
+        if (0 == pool_pid)
+        {
+            // Child
+            close(fds[0]);
+            std::string fdstr = std::to_string(fds[1]);
+            char * const client_args[] = {
+#ifdef DEBUG_VALGRIND
+                (char *) "/usr/bin/valgrind",
+                (char *) "--log-file=/tmp/valgrind.log",
+#endif
+                (char *) LIBEXEC_PATH "/openvpn3-service-client",
+                (char *) "--pool-client",
+                (char *) fdstr.c_str(),
+                NULL };
+            execve(client_args[0], client_args, NULL);
+
+            // If execve() succeedes, the line below will not be executed at all.
+            // So if we come here, there must be an error.
+            std::cerr << "** Error starting " << client_args[0] << ": " << strerror(errno) << std::endl;
+            _exit(3);
+        }
+        else if (pool_pid > 0)
+        {
+            // Parent
+            close(fds[1]);
+            struct PoolClient pc;
+            pc.pid = pool_pid;
+            pc.sockfd = fds[0];
+            client_pool.push_back(pc);
+            return;
+        }
+        LogError("Failed to fork() pool client process");
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+
+    /**
+     * Hands a session registration token over to the multi-tunnel
+     * client process, starting that process first if it is not running.
+     * If the hand-over fails (the hosting process died), a fresh
+     * process is started and the hand-over is retried once.
+     *
+     * @param token  String containing the start token identifying the
+     *               session this process will host
+     *
+     * @return Returns the pid the multi-tunnel client process was
+     *         started with, or -1 on error.
+     */
+    pid_t multi_tunnel_attach(char * token)
+    {
+        for (unsigned int attempt = 0; attempt < 2; attempt++)
+        {
+            if (mt_sockfd < 0 && !spawn_multi_tunnel_client())
+            {
+                return -1;
+            }
+
+            // Each session gets its own pre-created tun device,
+            // passed along with the token hand-over
+            int tunfd = preopen_tun_device();
+            ssize_t w = fdpass_send_token(mt_sockfd, token, tunfd);
+            if (tunfd >= 0)
+            {
+                close(tunfd);
+            }
+            if (w == (ssize_t) (strlen(token) + 1))
+            {
+                return mt_pid;
+            }
+
+            LogError("Multi-tunnel client process disappeared; "
+                     "restarting it");
+            close(mt_sockfd);
+            mt_sockfd = -1;
+        }
+        return -1;
+    }
+
+
+    /**
+     * Forks and execs the single openvpn3-service-client process which
+     * hosts all sessions in multi-tunnel mode.  Session registration
+     * tokens are handed over continuously on a socketpair, one
+     * newline terminated token per session.
+     *
+     * @return Returns true if the process was started, otherwise false
+     */
+    bool spawn_multi_tunnel_client()
+    {
+        int fds[2];
+        if (-1 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+        {
+            LogError("Failed creating socketpair for multi-tunnel client: "
+                     + std::string(strerror(errno)));
+            return false;
+        }
+
+        pid_t mtproc = fork();
+        if (0 == mtproc)
+        {
+            // Child
+            close(fds[0]);
+            std::string fdstr = std::to_string(fds[1]);
+            char * const client_args[] = {
+#ifdef DEBUG_VALGRIND
+                (char *) "/usr/bin/valgrind",
+                (char *) "--log-file=/tmp/valgrind.log",
+#endif
+                (char *) LIBEXEC_PATH "/openvpn3-service-client",
+                (char *) "--multi-tunnel",
+                (char *) fdstr.c_str(),
+                NULL };
+            execve(client_args[0], client_args, NULL);
+
+            // If execve() succeedes, the line below will not be executed at all.
+            // So if we come here, there must be an error.
+            std::cerr << "** Error starting " << client_args[0] << ": " << strerror(errno) << std::endl;
+            _exit(3);
+        }
+        else if (mtproc > 0)
+        {
+            // Parent.  The client re-initiates itself with a double
+            // fork; wait for the first process to exit.  The hosting
+            // process keeps the socketpair fd it inherited.
+            close(fds[1]);
+            int rc = -1;
+            if (-1 == waitpid(mtproc, &rc, 0))
+            {
+                LogError("Multi-tunnel client process - pid "
+                         + std::to_string(mtproc)
+                         + " failed to start as expected (exit code: "
+                         + std::to_string(rc) + ")");
+                close(fds[0]);
+                return false;
+            }
+            mt_pid = mtproc;
+            mt_sockfd = fds[0];
+            LogInfo("Multi-tunnel client process started (pid "
+                    + std::to_string(mtproc) + ")");
+            return true;
+        }
+        LogError("Failed to fork() multi-tunnel client process");
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
 };
 
 
@@ -356,14 +708,17 @@ public:
      *                  registered on the system or session bus.
      */
 
-    BackendStarterDBus(GBusType bus_type)
+    BackendStarterDBus(GBusType bus_type, unsigned int pool_size = 0,
+                       bool multi_tunnel = false)
         : DBus(bus_type,
                OpenVPN3DBus_name_backends,
                OpenVPN3DBus_rootp_backends,
                OpenVPN3DBus_interf_backends),
           mainobj(nullptr),
           procsig(nullptr),
-          logfile("")
+          logfile(""),
+          pool_size(pool_size),
+          multi_tunnel(multi_tunnel)
     {
     };
 
@@ -396,7 +751,8 @@ public:
     void callback_bus_acquired()
     {
         mainobj = new BackendStarterObject(GetConnection(), GetBusName(),
-                                            GetRootPath());
+                                            GetRootPath(), pool_size,
+                                            multi_tunnel);
         if (!logfile.empty())
         {
             mainobj->OpenLogFile(logfile);
@@ -408,6 +764,15 @@ public:
                                             "BackendStarter");
         procsig->ProcessChange(StatusMinor::PROC_STARTED);
 
+        // Heap and object count introspection
+        memdebug.reset(new DebugMemoryObject());
+        memdebug->AddObjectCounter("pool_clients",
+                                   [this]()
+                                   {
+                                       return mainobj->GetPoolClientCount();
+                                   });
+        memdebug->RegisterObject(GetConnection());
+
         if (idle_checker)
         {
             mainobj->IdleCheck_Register(idle_checker);
@@ -447,8 +812,11 @@ public:
 
 private:
     BackendStarterObject * mainobj;
+    DebugMemoryObject::Ptr memdebug;
     ProcessSignalProducer * procsig;
     std::string logfile;
+    unsigned int pool_size;
+    bool multi_tunnel;
 };
 
 
@@ -457,15 +825,31 @@ int main(int argc, char **argv)
 {
     std::cout << get_version(argv[0]) << std::endl;
 
+    // Optional warm-pool of pre-forked client processes.  With a pool,
+    // StartClient only needs to hand a session token over to an already
+    // initialized process, which speeds up mass session starts
+    // considerably.
+    unsigned int pool_size = 0;
+    bool multi_tunnel = false;
+    if (3 == argc && "--client-pool" == std::string(argv[1]))
+    {
+        pool_size = ::atoi(argv[2]);
+    }
+    else if (2 == argc && "--multi-tunnel" == std::string(argv[1]))
+    {
+        // Opt-in mode hosting all VPN sessions in one persistent
+        // client process, instead of one process per tunnel
+        multi_tunnel = true;
+    }
+
     GMainLoop *main_loop = g_main_loop_new(NULL, FALSE);
     g_unix_signal_add(SIGINT, stop_handler, main_loop);
     g_unix_signal_add(SIGTERM, stop_handler, main_loop);
 
     IdleCheck::Ptr idle_exit = new IdleCheck(main_loop,
                                              std::chrono::minutes(1));
-    idle_exit->SetPollTime(std::chrono::seconds(10));
 
-    BackendStarterDBus backstart(G_BUS_TYPE_SYSTEM);
+    BackendStarterDBus backstart(G_BUS_TYPE_SYSTEM, pool_size, multi_tunnel);
     backstart.EnableIdleCheck(idle_exit);
     backstart.Setup();
 
@@ -473,7 +857,6 @@ int main(int argc, char **argv)
     g_main_loop_run(main_loop);
     g_main_loop_unref(main_loop);
     idle_exit->Disable();
-    idle_exit->Join();
 
     return 0;
 }
@@ -33,9 +33,13 @@
  *         connection.
  */
 
+#include <deque>
+#include <functional>
+#include <map>
 #include <sstream>
 
 #define SHUTDOWN_NOTIF_PROCESS_NAME "openvpn3-service-client"
+#include "common/fdpass.hpp"
 #include "common/requiresqueue.hpp"
 #include "common/utils.hpp"
 #include "configmgr/proxy-configmgr.hpp"
@@ -44,6 +48,7 @@
 #include "log/dbus-log.hpp"
 #include "backend-signals.hpp"
 #include "core-client.hpp"
+#include "statistics-shm.hpp"
 
 using namespace openvpn;
 
@@ -70,23 +75,49 @@ public:
      *                       itself with the session manager.  This token
      *                       is provided on the command line when starting
      *                       this openvpn3-service-client process.
+     * @param tun_fd         Descriptor of a tun device pre-created by
+     *                       the backend starter, or -1 when this
+     *                       process creates the device itself
      */
     BackendClientObject(GDBusConnection *conn, std::string bus_name,
-                         std::string objpath, std::string session_token)
+                         std::string objpath, std::string session_token,
+                         int tun_fd = -1)
         : DBusObject(objpath),
           dbusconn(conn),
           mainloop(nullptr),
           signal(conn, LogGroup::CLIENT, objpath),
           session_token(session_token),
+          preopened_tun_fd(tun_fd),
           registered(false),
           paused(false),
           vpnclient(nullptr),
-          client_thread(nullptr)
+          client_thread(nullptr),
+          stats_shm(nullptr),
+          stats_shm_timer(0)
     {
-        // Initialize the VPN Core
-        CoreVPNClient::init_process();
+        // Initialize the VPN Core.  In multi-tunnel mode several
+        // BackendClientObject instances live in the same process, so
+        // the process-wide core initialization is reference counted
+        if (0 == init_process_refs++)
+        {
+            CoreVPNClient::init_process();
+        }
+
+        // Publish connection statistics in a shared memory segment,
+        // which the session manager and monitoring tools can read
+        // without any D-Bus round trips.  If the segment cannot be
+        // created, the D-Bus statistics property is still available.
+        stats_shm = ConnectionStatsShm::CreateWriter(session_token);
+
+        // The periodic tick feeds both the shared memory segment and
+        // the derived rate tracker, so it runs even without the shm
+        // segment available
+        stats_shm_timer = g_timeout_add_seconds(5, update_stats_shm,
+                                                this);
 
         signal.SetLogLevel(default_log_level);
+        signal.SetSessionToken(session_token);
+        signal.SetRatesTracker(&stats_rates);
 
         std::stringstream introspection_xml;
         introspection_xml << "<node name='" << objpath << "'>"
@@ -110,11 +141,14 @@ public:
                           << "        <method name='ForceShutdown'/>"
                           << userinputq.IntrospectionMethods("UserInputQueueGetTypeGroup",
                                                              "UserInputQueueFetch",
+                                                             "UserInputQueueFetchAll",
                                                              "UserInputQueueCheck",
-                                                             "UserInputProvide")
+                                                             "UserInputProvide",
+                                                             "UserInputProvideAll")
                           << "        <property name='log_level' type='u' access='readwrite'/>"
                           << signal.GetStatusChangeIntrospection()
                           << signal.GetLogIntrospection()
+                          << signal.GetLogWatchIntrospection()
                           << "        <signal name='AttentionRequired'>"
                           << "            <arg type='u' name='type' direction='out'/>"
                           << "            <arg type='u' name='group' direction='out'/>"
@@ -125,7 +159,10 @@ public:
                           << "            <arg type='s' name='token' direction='out'/>"
                           << "        </signal>"
                           << "        <property type='a{sx}' name='statistics' access='read'/>"
+                          << "        <property type='a{sv}' name='statistics_rates' access='read'/>"
                           << "        <property type='a{sv}' name='status' access='read'/>"
+                          << "        <property type='a{sv}' name='transport_tuning' access='readwrite'/>"
+                          << "        <property type='u' name='crypto_workers' access='readwrite'/>"
                           <<  "    </interface>"
                           <<  "</node>";
         ParseIntrospectionXML(introspection_xml);
@@ -144,7 +181,18 @@ public:
 
     ~BackendClientObject()
     {
-        CoreVPNClient::uninit_process();
+        if (stats_shm_timer > 0)
+        {
+            g_source_remove(stats_shm_timer);
+        }
+        if (stats_shm)
+        {
+            delete stats_shm;
+        }
+        if (0 == --init_process_refs)
+        {
+            CoreVPNClient::uninit_process();
+        }
     }
 
 
@@ -161,6 +209,21 @@ public:
     }
 
 
+    /**
+     *  Registers a callback used when this session shuts down.  When
+     *  set, the session object hands its own removal over to the
+     *  callback instead of quitting the main loop.  This is used in
+     *  multi-tunnel mode, where the process hosts several session
+     *  objects and must only exit when the last one is gone.
+     *
+     * @param cb  Callback function handling the removal of this object
+     */
+    void SetRemoveCallback(std::function<void()> cb)
+    {
+        remove_callback = cb;
+    }
+
+
     /**
      *  Callback method which is called each time a D-Bus method call occurs
      *  on this BackendClientObject.
@@ -328,7 +391,11 @@ public:
 
                 // Shutting down our selves.
                 RemoveObject(dbusconn);
-                if (mainloop)
+                if (remove_callback)
+                {
+                    remove_callback();
+                }
+                else if (mainloop)
                 {
                     g_main_loop_quit(mainloop);
                 }
@@ -369,6 +436,22 @@ public:
                 }
                 return; // QueueFetch() have fed invoc with a result already
             }
+            else if ("UserInputQueueFetchAll" == method_name)
+            {
+                // Retrieves every unresolved RequiresQueue item in a
+                // single response, saving the front-end one round trip
+                // per slot.
+
+                try
+                {
+                    userinputq.QueueFetchAll(invoc);
+                }
+                catch (RequiresQueueException& excp)
+                {
+                    excp.GenerateDBusError(invoc);
+                }
+                return; // QueueFetchAll() have fed invoc with a result already
+            }
             else if ("UserInputQueueCheck" == method_name)
             {
                 // Retrieve the RequiresSlot IDs for a specific
@@ -378,6 +461,26 @@ public:
                 userinputq.QueueCheck(invoc, params);
                 return; // QueueCheck() have fed invoc with a result already
             }
+            else if ("UserInputProvideAll" == method_name)
+            {
+                // Batched variant of UserInputProvide, carrying all the
+                // front-end responses in one call.
+
+                if (!registered)
+                {
+                    THROW_DBUSEXCEPTION("BackendServiceObject", "Backend service is not initialized");
+                }
+
+                try
+                {
+                    userinputq.QueueProvideAll(invoc, params);
+                }
+                catch (RequiresQueueException& excp)
+                {
+                    excp.GenerateDBusError(invoc);
+                }
+                return; // QueueProvideAll() have fed invoc with a result already
+            }
             else if ("UserInputProvide" == method_name)
             {
                 // This is called each time a RequiresSlot gets an update
@@ -431,7 +534,14 @@ public:
             }
             else if ("Resume" == method_name)
             {
-                // Resumes an already paused VPN session
+                // Resumes an already paused VPN session.  When the
+                // session is not paused, the connection is down and
+                // the client carries recent cached session state from
+                // an established connection, this performs a
+                // transport-only reconnect instead.  The negotiated
+                // session is kept alive in the client object, so a
+                // network flap does not pay for a full renegotiation
+                // from scratch.
 
                 if( !registered || !vpnclient )
                 {
@@ -440,17 +550,36 @@ public:
 
                 if (!paused)
                 {
-                    GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.error.backend",
-                                                                  "Connection is not paused");
-                    g_dbus_method_invocation_return_gerror(invoc, err);
-                    g_error_free(err);
-                    return;
+                    // The fast-reconnect path must only trigger when
+                    // the connection is actually down.  A duplicate or
+                    // defensive Resume against a healthy tunnel keeps
+                    // getting the error reply instead of having its
+                    // live connection bounced; a fresh session cache
+                    // alone is no evidence a reconnect is wanted.
+                    if (StatusMinor::CONN_CONNECTED == vpnclient->GetRunStatus()
+                        || !vpnclient->HasCachedSession(session_cache_ttl))
+                    {
+                        GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.error.backend",
+                                                                      "Connection is not paused");
+                        g_dbus_method_invocation_return_gerror(invoc, err);
+                        g_error_free(err);
+                        return;
+                    }
+
+                    signal.LogInfo("Transport-only reconnect using cached "
+                                   "session state: "
+                                   + vpnclient->GetCachedSessionInfo());
+                    signal.StatusChange(StatusMajor::CONNECTION,
+                                        StatusMinor::CONN_RECONNECTING);
+                    vpnclient->reconnect(0);
+                }
+                else
+                {
+                    signal.LogInfo("Resuming connection: " + to_string(obj_path));
+                    signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_RESUMING);
+                    vpnclient->resume();
+                    paused = false;
                 }
-
-                signal.LogInfo("Resuming connection: " + to_string(obj_path));
-                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_RESUMING);
-                vpnclient->resume();
-                paused = false;
             }
             else if ("Restart" == method_name)
             {
@@ -466,6 +595,20 @@ public:
                 signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_RECONNECTING);
                 vpnclient->reconnect(0);
             }
+            else if ("RegisterLogWatch" == method_name)
+            {
+                // A log consumer announces which verbosity it will
+                // actually process.  Log events below what any
+                // registered consumer wants are then never emitted
+                // on the bus.
+                guint loglev = 0;
+                g_variant_get(params, "(u)", &loglev);
+                signal.RegisterLogConsumerLevel(sender, loglev);
+            }
+            else if ("UnregisterLogWatch" == method_name)
+            {
+                signal.UnregisterLogConsumerLevel(sender);
+            }
             else if ("ForceShutdown" == method_name)
             {
                 // This is an emergency break for this process.  This
@@ -479,7 +622,11 @@ public:
 
                 // Shutting down our selves.
                 RemoveObject(dbusconn);
-                if (mainloop)
+                if (remove_callback)
+                {
+                    remove_callback();
+                }
+                else if (mainloop)
                 {
                     g_main_loop_quit(mainloop);
                 }
@@ -542,22 +689,47 @@ public:
             // Returns the current statistics for a running and connected
             // VPN session
 
+            // The key set is static, so the counters are read into a
+            // preallocated snapshot and serialized straight from it
+            // with the interned key table - no per-poll allocations
+            const std::vector<std::string>& keys = CoreVPNClient::StatsKeys();
+            vpnclient->GetStatsSnapshot(stats_snapshot);
+
+            // Refresh the shared memory segment at the same time, so
+            // both channels provide the same view
+            if (stats_shm)
+            {
+                stats_shm->Update(keys, stats_snapshot);
+            }
+
             // Returns an array of a string (description) and an int64
             // containing the statistics value.
-            GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE("a{sx}"));
-            for (auto& sd : vpnclient->GetStats())
+            GVariantTyped::DictInt64 b;
+            for (size_t i = 0; i < stats_snapshot.size(); ++i)
             {
-                g_variant_builder_add (b, "{sx}",
-                                       sd.key.c_str(), sd.value);
+                if (stats_snapshot[i])
+                {
+                    b.Add(keys[i], (gint64) stats_snapshot[i]);
+                }
             }
-            GVariant *ret = g_variant_builder_end(b);
-            g_variant_builder_unref(b);
-            return ret;
+            return b.End();
+        }
+        else if ("statistics_rates" == property_name)
+        {
+            return stats_rates.Serialize();
         }
         else if ("status" == property_name)
         {
             return signal.GetLastStatusChange();
         }
+        else if ("transport_tuning" == property_name)
+        {
+            return build_transport_tuning_value();
+        }
+        else if ("crypto_workers" == property_name)
+        {
+            return g_variant_new_uint32(crypto_workers);
+        }
         g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Unknown property");
         return NULL;
     }
@@ -566,8 +738,8 @@ public:
      *  Callback method which is used each time a BackendClientObject
      *  property is being modified over the D-Bus.
      *
-     *  This will always fail with an exception, as there exists no properties
-     *  which can be modified in a BackendClientObject object.
+     *  Only the transport_tuning property can be modified; all other
+     *  properties will fail with an exception.
      *
      * @param conn           D-Bus connection this event occurred on
      * @param sender         D-Bus bus name of the requester
@@ -577,8 +749,8 @@ public:
      * @param value          GVariant object containing the value to be stored
      * @param error          A GLib2 GError object if an error occurs
      *
-     * @return Will always throw an exception as there are no properties to
-     *         modify.
+     * @return Returns a GVariantBuilder object which will be used by the
+     *         D-Bus library to issue the required PropertiesChanged signal.
      */
     GVariantBuilder * callback_set_property(GDBusConnection *conn,
                                             const std::string sender,
@@ -588,28 +760,204 @@ public:
                                             GVariant *value,
                                             GError **error)
     {
+        if ("transport_tuning" == property_name)
+        {
+            parse_transport_tuning(value);
+            if (vpnclient)
+            {
+                vpnclient->SetTransportTuning(transport_tuning);
+            }
+            GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
+            g_variant_builder_add(builder, "{sv}",
+                                  property_name.c_str(),
+                                  build_transport_tuning_value());
+            return builder;
+        }
+        else if ("crypto_workers" == property_name)
+        {
+            // Requested number of data channel crypto worker threads.
+            // The bundled core library runs the data channel on a
+            // single thread and offers no fan-out hook, so the value
+            // is stored and surfaced but cannot take effect yet; it
+            // is applied once a core with a worker pool API is
+            // vendored.
+            crypto_workers = g_variant_get_uint32(value);
+            if (crypto_workers > 0)
+            {
+                signal.LogWarn("crypto_workers="
+                               + std::to_string(crypto_workers)
+                               + " requested, but the current core library"
+                               + " processes the data channel single-threaded;"
+                               + " setting stored without effect");
+            }
+            GVariantBuilder *builder = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
+            g_variant_builder_add(builder, "{sv}",
+                                  property_name.c_str(),
+                                  g_variant_new_uint32(crypto_workers));
+            return builder;
+        }
         THROW_DBUSEXCEPTION("BackendServiceObject", "set property not implemented");
     }
 
 
 private:
     const unsigned int default_log_level = 6; // LogCategory::DEBUG messages
+    const unsigned int session_cache_ttl = 300;  ///< Max age (seconds) of
+                                                 ///< cached session state used
+                                                 ///< for transport reconnects
+    static unsigned int init_process_refs;  ///< Sessions sharing the core init
     GDBusConnection *dbusconn;
     GMainLoop *mainloop;
+    std::function<void()> remove_callback;
     BackendSignals signal;
     std::string session_token;
+    int preopened_tun_fd;  ///< Tun device passed in by the backend starter
     bool registered;
     bool paused;
     std::string configpath;
     CoreVPNClient::Ptr vpnclient;
+    ConnectionStatsShm *stats_shm;
+    guint stats_shm_timer;
+    std::vector<long long> stats_snapshot;  ///< Reused statistics poll buffer
+    ConnectionStatsRates stats_rates;       ///< Derived rates and histograms
     std::thread * client_thread;
+
+
+    /**
+     *  GLib2 timer callback which refreshes the shared memory statistics
+     *  segment with the current counters from the VPN client object
+     *
+     * @param user_data  Pointer to the BackendClientObject owning the timer
+     *
+     * @return Always returns G_SOURCE_CONTINUE, to keep the timer running
+     */
+    static gboolean update_stats_shm(gpointer user_data)
+    {
+        BackendClientObject *self = (BackendClientObject *) user_data;
+        if (self->vpnclient && !self->paused)
+        {
+            self->vpnclient->GetStatsSnapshot(self->stats_snapshot);
+            self->stats_rates.Update(CoreVPNClient::StatsKeys(),
+                                     self->stats_snapshot);
+            if (self->stats_shm)
+            {
+                self->stats_shm->Update(CoreVPNClient::StatsKeys(),
+                                        self->stats_snapshot);
+            }
+        }
+        return G_SOURCE_CONTINUE;
+    }
     ClientAPI::Config vpnconfig;
     ClientAPI::EvalConfig cfgeval;
     ClientAPI::ProvideCreds creds;
+    TransportTuning transport_tuning;
+    unsigned int crypto_workers = 0;  ///< Requested data channel worker
+                                      ///< threads; see callback_set_property()
     RequiresQueue userinputq;
     std::mutex guard;
 
 
+    /**
+     *  Serializes the current transport tuning settings into an
+     *  a{sv} dictionary.  When a client object exists, the settings
+     *  are read back from it, so the reply reflects what will
+     *  actually be applied on the transport socket.
+     *
+     * @return Returns a floating GVariant a{sv} dictionary
+     */
+    GVariant * build_transport_tuning_value()
+    {
+        TransportTuning tune = (vpnclient
+                                ? vpnclient->GetTransportTuning()
+                                : transport_tuning);
+        GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+        g_variant_builder_add(b, "{sv}", "sndbuf",
+                              g_variant_new_int32(tune.sndbuf));
+        g_variant_builder_add(b, "{sv}", "rcvbuf",
+                              g_variant_new_int32(tune.rcvbuf));
+        g_variant_builder_add(b, "{sv}", "tcp_nodelay",
+                              g_variant_new_boolean(tune.tcp_nodelay));
+        g_variant_builder_add(b, "{sv}", "mtu_discover",
+                              g_variant_new_int32(tune.mtu_discover));
+        g_variant_builder_add(b, "{sv}", "udp_gso_segsize",
+                              g_variant_new_int32(tune.udp_gso_segsize));
+        GVariant *ret = g_variant_builder_end(b);
+        g_variant_builder_unref(b);
+        return ret;
+    }
+
+
+    /**
+     *  Parses an a{sv} dictionary with transport tuning settings into
+     *  the local TransportTuning copy.  Keys which are not provided
+     *  keep their current value, so partial updates are possible.
+     *  Unknown keys and keys with an unexpected value type are logged
+     *  and skipped.
+     *
+     * @param value  GVariant a{sv} dictionary with the settings
+     */
+    void parse_transport_tuning(GVariant *value)
+    {
+        GVariantIter iter;
+        g_variant_iter_init(&iter, value);
+
+        gchar *key = NULL;
+        GVariant *val = NULL;
+        while (g_variant_iter_loop(&iter, "{sv}", &key, &val))
+        {
+            if (0 == g_strcmp0(key, "tcp_nodelay"))
+            {
+                if (!g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
+                {
+                    signal.LogWarn("transport_tuning: tcp_nodelay must be "
+                                   "a boolean, ignored");
+                    continue;
+                }
+                transport_tuning.tcp_nodelay = g_variant_get_boolean(val);
+                continue;
+            }
+
+            if (!g_variant_is_of_type(val, G_VARIANT_TYPE_INT32))
+            {
+                signal.LogWarn("transport_tuning: " + std::string(key)
+                               + " must be an int32, ignored");
+                continue;
+            }
+
+            if (0 == g_strcmp0(key, "sndbuf"))
+            {
+                transport_tuning.sndbuf = g_variant_get_int32(val);
+            }
+            else if (0 == g_strcmp0(key, "rcvbuf"))
+            {
+                transport_tuning.rcvbuf = g_variant_get_int32(val);
+            }
+            else if (0 == g_strcmp0(key, "mtu_discover"))
+            {
+                transport_tuning.mtu_discover = g_variant_get_int32(val);
+            }
+            else if (0 == g_strcmp0(key, "udp_gso_segsize"))
+            {
+                transport_tuning.udp_gso_segsize = g_variant_get_int32(val);
+            }
+            else
+            {
+                signal.LogWarn("transport_tuning: unknown key '"
+                               + std::string(key) + "' ignored");
+            }
+        }
+        signal.LogVerb2("Transport tuning updated: "
+                        "sndbuf=" + std::to_string(transport_tuning.sndbuf)
+                        + ", rcvbuf=" + std::to_string(transport_tuning.rcvbuf)
+                        + ", tcp_nodelay="
+                        + (transport_tuning.tcp_nodelay ? "yes" : "no")
+                        + ", mtu_discover="
+                        + std::to_string(transport_tuning.mtu_discover)
+                        + ", udp_gso_segsize="
+                        + std::to_string(transport_tuning.udp_gso_segsize));
+    }
+
+
     /**
      *  This implements the POSIX thread running the CoreVPNClient session
      */
@@ -750,6 +1098,34 @@ private:
         // tunnel itself.
         vpnclient.reset(new CoreVPNClient(&signal, &userinputq));
 
+        // Hand over the transport tuning settings before the
+        // connection is started; they are applied on the transport
+        // socket via the socket_protect() hook
+        vpnclient->SetTransportTuning(transport_tuning);
+
+        // Hand over a tun device pre-created by the backend starter,
+        // if one was passed in.  The device is adopted through the
+        // tun builder, which keeps device creation and the
+        // privileges it needs out of this process
+        if (preopened_tun_fd >= 0)
+        {
+            vpnclient->SetPreopenedTunFD(preopened_tun_fd);
+            preopened_tun_fd = -1;
+        }
+
+#ifdef ENABLE_OVPNDCO
+        // Install the data channel into the ovpn-dco kernel module.
+        // Key negotiation and the control channel stay in this
+        // process; the tunnel payload no longer crosses the
+        // user/kernel boundary per packet.  The core library falls
+        // back to the userspace data channel if the kernel module
+        // is unavailable or the negotiated options cannot be
+        // offloaded.
+        vpnconfig.dco = true;
+        vpnclient->SetDataChannelOffload(true);
+        signal.LogInfo("Kernel data channel offload (ovpn-dco) requested");
+#endif
+
         // We need to provide a copy of the vpnconfig object, as vpnclient
         // seems to take ownership
         cfgeval = vpnclient->eval_config(ClientAPI::Config(vpnconfig));
@@ -838,6 +1214,8 @@ private:
     }
 };
 
+unsigned int BackendClientObject::init_process_refs = 0;
+
 
 
 /**
@@ -856,14 +1234,21 @@ public:
      * @param sesstoken  String containing the session token provided via the
      *                   command line.  This is used when signalling back
      *                   to the session manager.
+     * @param multi_tunnel  If true, this process hosts several sessions
+     * @param tun_fd     Descriptor of a tun device pre-created by the
+     *                   backend starter, or -1 when this process
+     *                   creates the device itself
      */
-    BackendClientDBus(pid_t start_pid, GBusType bus_type, std::string sesstoken)
+    BackendClientDBus(pid_t start_pid, GBusType bus_type, std::string sesstoken,
+                      bool multi_tunnel = false, int tun_fd = -1)
         : DBus(bus_type,
                OpenVPN3DBus_name_backends_be + to_string(getpid()),
                OpenVPN3DBus_rootp_sessions,
                OpenVPN3DBus_interf_sessions),
           start_pid(start_pid),
           session_token(sesstoken),
+          session_tun_fd(tun_fd),
+          multi_tunnel(multi_tunnel),
           procsig(nullptr),
           be_obj(nullptr),
           signal(nullptr)
@@ -887,10 +1272,68 @@ public:
      */
     void SetMainLoop(GMainLoop *ml)
     {
+        mainloop = ml;
         if (be_obj)
         {
             be_obj->SetMainLoop(ml);
         }
+        for (auto& session : sessions)
+        {
+            session.second->SetMainLoop(ml);
+        }
+    }
+
+
+    /**
+     *  Attaches an additional VPN session to this backend process.  The
+     *  session gets its own D-Bus object with its own session token and
+     *  registers itself with the session manager just like a session in
+     *  a dedicated process, but shares the process image, core library
+     *  state and main loop with the other sessions hosted here.
+     *
+     *  Tokens arriving before the D-Bus connection is ready are queued
+     *  up and attached from callback_bus_acquired().
+     *
+     * @param token   Session registration token for the new session
+     * @param tun_fd  Descriptor of a tun device pre-created for this
+     *                session by the backend starter, or -1
+     */
+    void AttachSession(const std::string token, int tun_fd = -1)
+    {
+        if (!signal)
+        {
+            // The bus is not acquired yet; postpone the attach
+            pending_tokens.push_back(std::make_pair(token, tun_fd));
+            return;
+        }
+
+        std::string sesspath = generate_path_uuid(OpenVPN3DBus_rootp_backends_sessions, 'z');
+        BackendClientObject::Ptr sessobj;
+        sessobj.reset(new BackendClientObject(GetConnection(), GetBusName(),
+                                              sesspath, token, tun_fd));
+        sessobj->SetMainLoop(mainloop);
+        sessobj->SetRemoveCallback([this, sesspath]()
+                                   {
+                                       remove_session(sesspath);
+                                   });
+        sessobj->RegisterObject(GetConnection());
+        sessions[sesspath] = sessobj;
+        signal->LogVerb2("Attached session " + sesspath
+                         + " (" + std::to_string(sessions.size())
+                         + " sessions hosted)");
+    }
+
+
+    /**
+     *  Checks if this backend process hosts or is about to host any
+     *  VPN sessions
+     *
+     * @return Returns true if at least one session object or queued
+     *         session token exists
+     */
+    bool HasSessions()
+    {
+        return !sessions.empty() || !pending_tokens.empty() || be_obj;
     }
 
 
@@ -912,10 +1355,15 @@ public:
      */
     void callback_bus_acquired()
     {
-        // Create a new OpenVPN3 client session object
         object_path = generate_path_uuid(OpenVPN3DBus_rootp_backends_sessions, 'z');
-        be_obj.reset(new BackendClientObject(GetConnection(), GetBusName(), object_path, session_token));
-        be_obj->RegisterObject(GetConnection());
+        if (!session_token.empty())
+        {
+            // Create a new OpenVPN3 client session object
+            be_obj.reset(new BackendClientObject(GetConnection(), GetBusName(),
+                                                 object_path, session_token,
+                                                 session_tun_fd));
+            be_obj->RegisterObject(GetConnection());
+        }
 
         // Setup a signal object of the backend
         signal = new BackendSignals(GetConnection(), LogGroup::BACKENDPROC, object_path);
@@ -928,6 +1376,14 @@ public:
         procsig = new ProcessSignalProducer(GetConnection(), OpenVPN3DBus_interf_backends,
                                             object_path, "VPN-Client");
         procsig->ProcessChange(StatusMinor::PROC_STARTED);
+
+        // Attach sessions whose tokens arrived before the bus was ready
+        while (!pending_tokens.empty())
+        {
+            std::pair<std::string, int> pending = pending_tokens.front();
+            pending_tokens.pop_front();
+            AttachSession(pending.first, pending.second);
+        }
     }
 
 
@@ -966,16 +1422,179 @@ private:
     const unsigned int default_log_level = 6; // LogCategory::DEBUG messages
     pid_t start_pid;
     std::string session_token;
+    int session_tun_fd;  ///< Tun device passed in by the backend starter
+    bool multi_tunnel;
     std::string object_path;
+    GMainLoop *mainloop = nullptr;
     ProcessSignalProducer * procsig;
     BackendClientObject::Ptr be_obj;
     BackendSignals *signal;
+    std::map<std::string, BackendClientObject::Ptr> sessions;
+    std::deque<std::pair<std::string, int>> pending_tokens;
+    std::deque<std::string> remove_queue;
+
+
+    /**
+     *  Queues a hosted session object for removal.  The session object
+     *  calls this from within one of its own D-Bus method handlers, so
+     *  the actual destruction is deferred to an idle callback running
+     *  after the method call has completed.  When the last session is
+     *  gone, the process shuts down.
+     *
+     * @param sesspath  D-Bus object path of the session to remove
+     */
+    void remove_session(const std::string sesspath)
+    {
+        remove_queue.push_back(sesspath);
+        g_idle_add(remove_session_cb, this);
+    }
+
+
+    /**
+     *  GLib2 idle callback completing queued session removals outside
+     *  of the removed session's own method call stack
+     *
+     * @param user_data  Pointer to the BackendClientDBus object
+     *
+     * @return Always returns G_SOURCE_REMOVE, as a one-shot callback
+     */
+    static gboolean remove_session_cb(gpointer user_data)
+    {
+        BackendClientDBus *self = (BackendClientDBus *) user_data;
+        while (!self->remove_queue.empty())
+        {
+            self->sessions.erase(self->remove_queue.front());
+            self->remove_queue.pop_front();
+        }
+        if (self->sessions.empty() && !self->be_obj && self->mainloop)
+        {
+            self->signal->LogVerb2("Last hosted session removed, "
+                                   "shutting down");
+            g_main_loop_quit(self->mainloop);
+        }
+        return G_SOURCE_REMOVE;
+    }
+};
+
+
+/**
+ *  Used when running as a pre-forked pool client, started by the
+ *  openvpn3-service-backendstart warm-pool.  This blocks until the
+ *  backend starter hands over a session registration token on the
+ *  provided socket.  At this point the process is already exec'ed,
+ *  with the core library loaded and ready to go, so the per-session
+ *  start cost is reduced to the token hand-over.
+ *
+ * @param fd      File descriptor of the socketpair connected to the
+ *                backend starter process
+ * @param tun_fd  Set to the descriptor of a tun device pre-created by
+ *                the backend starter, or -1 if none was passed along
+ *
+ * @return Returns a string with the received token.  An empty string
+ *         indicates the backend starter closed the socket without
+ *         providing any token; the process is then expected to exit.
+ */
+static std::string wait_for_pool_token(int fd, int& tun_fd)
+{
+    std::string token = fdpass_recv_token(fd, tun_fd);
+    close(fd);
+    return token;
+}
+
+
+/**
+ *  Watch data for the multi-tunnel token socket, passed to
+ *  @multi_tunnel_token_cb()
+ */
+struct MultiTunnelWatch
+{
+    BackendClientDBus *service;  ///< Backend service hosting the sessions
+    GMainLoop *mainloop;         ///< Main loop, for shutdown on hang-up
+    int fd;                      ///< Socketpair fd to the backend starter
 };
 
 
+/**
+ *  GLib2 IO callback invoked when the backend starter writes a new
+ *  session registration token on the multi-tunnel hand-over socket.
+ *  Each received token attaches one more VPN session to this process.
+ *
+ * @param source     GIOChannel of the hand-over socket
+ * @param cond       GIOCondition describing the event
+ * @param user_data  Pointer to the MultiTunnelWatch data
+ *
+ * @return Returns TRUE to keep watching for more tokens, or FALSE when
+ *         the backend starter has closed its end of the socket
+ */
+static gboolean multi_tunnel_token_cb(GIOChannel *source,
+                                      GIOCondition cond,
+                                      gpointer user_data)
+{
+    struct MultiTunnelWatch *watch = (struct MultiTunnelWatch *) user_data;
+    if (cond & G_IO_IN)
+    {
+        int tun_fd = -1;
+        std::string token = fdpass_recv_token(watch->fd, tun_fd);
+        if (!token.empty())
+        {
+            watch->service->AttachSession(token, tun_fd);
+            return TRUE;
+        }
+        if (tun_fd >= 0)
+        {
+            close(tun_fd);
+        }
+    }
+
+    // The backend starter closed its end; no more sessions will arrive.
+    // Sessions already hosted keep running and the process exits when
+    // the last one of them shuts down.  If no session was ever
+    // attached, exit right away.
+    close(watch->fd);
+    if (!watch->service->HasSessions())
+    {
+        g_main_loop_quit(watch->mainloop);
+    }
+    return FALSE;
+}
+
+
 int main(int argc, char **argv)
 {
-    if (argc !=2)
+    std::string token_arg;
+    int multi_tunnel_fd = -1;
+    int tun_fd = -1;
+    if (3 == argc && "--pool-client" == std::string(argv[1]))
+    {
+        // Pre-forked pool mode; block until the backend starter
+        // provides the session registration token and, when
+        // available, a pre-created tun device descriptor
+        token_arg = wait_for_pool_token(::atoi(argv[2]), tun_fd);
+        if (token_arg.empty())
+        {
+            // Pool is being drained; exit silently
+            return 0;
+        }
+    }
+    else if (3 == argc && "--multi-tunnel" == std::string(argv[1]))
+    {
+        // Multi-tunnel mode; this process hosts several VPN sessions,
+        // with registration tokens arriving continuously on the
+        // provided socket
+        multi_tunnel_fd = ::atoi(argv[2]);
+    }
+    else if (4 == argc && "--tun-fd" == std::string(argv[1]))
+    {
+        // Direct start with a tun device pre-created by the backend
+        // starter, inherited across the execve()
+        tun_fd = ::atoi(argv[2]);
+        token_arg = std::string(argv[3]);
+    }
+    else if (2 == argc)
+    {
+        token_arg = std::string(argv[1]);
+    }
+    else
     {
         std::cout << "** ERROR ** Invalid usage: " << argv[0] << " <session registration token>" << std::endl;
         std::cout << std::endl;
@@ -996,7 +1615,10 @@ int main(int argc, char **argv)
     {
         std::cout << get_version(argv[0]) << std::endl;
 
-        BackendClientDBus backend_service(start_pid, G_BUS_TYPE_SYSTEM, std::string(argv[1]));
+        BackendClientDBus backend_service(start_pid, G_BUS_TYPE_SYSTEM,
+                                          token_arg,
+                                          (multi_tunnel_fd >= 0),
+                                          tun_fd);
         backend_service.Setup();
 
         // Main loop
@@ -1005,8 +1627,26 @@ int main(int argc, char **argv)
         g_unix_signal_add(SIGTERM, stop_handler, main_loop);
         g_unix_signal_add(SIGHUP, stop_handler, main_loop);
         backend_service.SetMainLoop(main_loop);
+
+        // In multi-tunnel mode, watch the hand-over socket for
+        // session registration tokens from the backend starter
+        struct MultiTunnelWatch mtwatch = {&backend_service, main_loop,
+                                           multi_tunnel_fd};
+        GIOChannel *mtchannel = nullptr;
+        if (multi_tunnel_fd >= 0)
+        {
+            mtchannel = g_io_channel_unix_new(multi_tunnel_fd);
+            g_io_add_watch(mtchannel,
+                           (GIOCondition) (G_IO_IN | G_IO_HUP | G_IO_ERR),
+                           multi_tunnel_token_cb, &mtwatch);
+        }
+
         g_main_loop_run(main_loop);
         usleep(500);
+        if (mtchannel)
+        {
+            g_io_channel_unref(mtchannel);
+        }
         g_main_loop_unref(main_loop);
         return 0;
     }
@@ -0,0 +1,257 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   statistics-rates.hpp
+ *
+ * @brief  Derived connection statistics maintained by the backend
+ *         client next to the raw counters.
+ *
+ *         The raw statistics are monotonic counters, which forces
+ *         every consumer interested in rates to poll frequently just
+ *         to compute deltas itself.  This tracker is fed from the
+ *         existing periodic statistics tick and keeps exponentially
+ *         weighted moving averages of the byte and packet rates, plus
+ *         a log2 histogram of reconnect durations.  Consumers read
+ *         the result through the statistics_rates D-Bus property and
+ *         can poll an order of magnitude less often for better data.
+ */
+
+#ifndef OPENVPN3_DBUS_CLIENT_STATISTICS_RATES_HPP
+#define OPENVPN3_DBUS_CLIENT_STATISTICS_RATES_HPP
+
+#include <string>
+#include <vector>
+
+#include <gio/gio.h>
+
+#include "dbus/builder-pool.hpp"
+
+
+class ConnectionStatsRates
+{
+public:
+    ConnectionStatsRates()
+    {
+        for (unsigned int i = 0; i < tracked_count; i++)
+        {
+            last_value[i] = -1;
+            rate_ewma[i] = 0.0;
+        }
+        for (unsigned int i = 0; i < histogram_buckets; i++)
+        {
+            reconnect_histogram[i] = 0;
+        }
+    }
+
+
+    /**
+     *  Feeds a fresh counter snapshot into the rate tracker.  Called
+     *  from the periodic statistics tick; the elapsed time since the
+     *  previous call is measured here, so irregular tick spacing does
+     *  not skew the rates.
+     *
+     * @param keys      Statistics key names, indexed like the snapshot
+     * @param snapshot  Counter values from the VPN client object
+     */
+    void Update(const std::vector<std::string>& keys,
+                const std::vector<long long>& snapshot)
+    {
+        gint64 now = g_get_monotonic_time();
+        if (0 == last_tick)
+        {
+            last_tick = now;
+            capture(keys, snapshot);
+            return;
+        }
+        double dt = (now - last_tick) / (double) G_USEC_PER_SEC;
+        if (dt <= 0.0)
+        {
+            return;
+        }
+        last_tick = now;
+
+        for (size_t i = 0; i < keys.size() && i < snapshot.size(); i++)
+        {
+            int slot = tracked_slot(keys[i]);
+            if (slot < 0)
+            {
+                continue;
+            }
+            if (last_value[slot] >= 0 && snapshot[i] >= last_value[slot])
+            {
+                double rate = (snapshot[i] - last_value[slot]) / dt;
+                if (rate_primed)
+                {
+                    rate_ewma[slot] += ewma_alpha * (rate - rate_ewma[slot]);
+                }
+                else
+                {
+                    rate_ewma[slot] = rate;
+                }
+            }
+            last_value[slot] = snapshot[i];
+        }
+        rate_primed = true;
+    }
+
+
+    /**
+     *  Marks the start of a reconnect; the duration until
+     *  ReconnectCompleted() lands in the histogram
+     */
+    void ReconnectStarted()
+    {
+        reconnect_start = g_get_monotonic_time();
+    }
+
+
+    /**
+     *  Records a completed reconnect into the log2 duration
+     *  histogram.  No-op unless a reconnect is in flight.
+     */
+    void ReconnectCompleted()
+    {
+        if (0 == reconnect_start)
+        {
+            return;
+        }
+        gint64 duration_ms = (g_get_monotonic_time() - reconnect_start) / 1000;
+        reconnect_start = 0;
+        ++reconnect_count;
+
+        // Bucket b covers durations [2^b, 2^(b+1)) milliseconds,
+        // with bucket 0 holding everything below 1ms
+        unsigned int bucket = 0;
+        while (duration_ms > 1 && bucket < histogram_buckets - 1)
+        {
+            duration_ms >>= 1;
+            ++bucket;
+        }
+        ++reconnect_histogram[bucket];
+    }
+
+
+    /**
+     *  Serializes the derived metrics as the statistics_rates
+     *  property value.  Rates are in units per second; the histogram
+     *  bucket at index b counts reconnects taking [2^b, 2^(b+1)) ms.
+     *
+     * @return Returns a floating GVariant of type a{sv}
+     */
+    GVariant * Serialize()
+    {
+        GVariantBuilder *b = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a{sv}"));
+        for (unsigned int i = 0; i < tracked_count; i++)
+        {
+            g_variant_builder_add(b, "{sv}", rate_names()[i],
+                                  g_variant_new_double(rate_ewma[i]));
+        }
+        g_variant_builder_add(b, "{sv}", "reconnect_count",
+                              g_variant_new_uint32(reconnect_count));
+
+        GVariantBuilder hist;
+        g_variant_builder_init(&hist, G_VARIANT_TYPE("at"));
+        for (unsigned int i = 0; i < histogram_buckets; i++)
+        {
+            g_variant_builder_add(&hist, "t",
+                                  (guint64) reconnect_histogram[i]);
+        }
+        g_variant_builder_add(b, "{sv}", "reconnect_histogram_ms_log2",
+                              g_variant_builder_end(&hist));
+
+        GVariant *ret = g_variant_builder_end(b);
+        GVariantBuilderPool::Release(b);
+        return ret;
+    }
+
+
+private:
+    //  BYTES_IN, BYTES_OUT, PACKETS_IN, PACKETS_OUT
+    static const unsigned int tracked_count = 4;
+    static const unsigned int histogram_buckets = 16;
+
+    //  Smoothing factor per tick; with the 5 second statistics tick
+    //  this weights roughly the last half minute of traffic
+    const double ewma_alpha = 0.3;
+
+    gint64 last_tick = 0;
+    bool rate_primed = false;
+    long long last_value[tracked_count];
+    double rate_ewma[tracked_count];
+    guint32 reconnect_count = 0;
+    guint32 reconnect_histogram[histogram_buckets];
+    gint64 reconnect_start = 0;
+
+
+    static const char * const * rate_names()
+    {
+        static const char * const names[tracked_count] = {
+            "bytes_in_rate",
+            "bytes_out_rate",
+            "packets_in_rate",
+            "packets_out_rate"
+        };
+        return names;
+    }
+
+    /**
+     *  Maps a raw statistics key to its tracked slot, or -1 for
+     *  counters no rate is maintained for
+     */
+    static int tracked_slot(const std::string& key)
+    {
+        if ("BYTES_IN" == key)
+        {
+            return 0;
+        }
+        else if ("BYTES_OUT" == key)
+        {
+            return 1;
+        }
+        else if ("PACKETS_IN" == key)
+        {
+            return 2;
+        }
+        else if ("PACKETS_OUT" == key)
+        {
+            return 3;
+        }
+        return -1;
+    }
+
+    /**
+     *  Stores the first snapshot without producing rates, so the
+     *  first real tick has a baseline to delta against
+     */
+    void capture(const std::vector<std::string>& keys,
+                 const std::vector<long long>& snapshot)
+    {
+        for (size_t i = 0; i < keys.size() && i < snapshot.size(); i++)
+        {
+            int slot = tracked_slot(keys[i]);
+            if (slot >= 0)
+            {
+                last_value[slot] = snapshot[i];
+            }
+        }
+    }
+};
+
+#endif  // OPENVPN3_DBUS_CLIENT_STATISTICS_RATES_HPP
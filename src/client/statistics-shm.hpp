@@ -0,0 +1,333 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2017 - 2018  OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2017 - 2018  David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   statistics-shm.hpp
+ *
+ * @brief  Shared memory based publishing of connection statistics.
+ *
+ *         The VPN backend client process updates a fixed-layout,
+ *         seqlock protected shared memory segment in place.  The
+ *         session manager, or any other privileged consumer knowing the
+ *         session token, can then read fresh statistics without a
+ *         single D-Bus round trip and without any allocations on the
+ *         writer side.
+ */
+
+#ifndef OPENVPN3_DBUS_CLIENT_STATISTICS_SHM
+#define OPENVPN3_DBUS_CLIENT_STATISTICS_SHM
+
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "client/statistics.hpp"
+
+/**
+ *  Maximum number of statistics entries the shared memory segment can
+ *  carry.  The OpenVPN 3 Core library provides far fewer counters than
+ *  this today; the headroom avoids a layout change when new counters
+ *  appear.
+ */
+#define OPENVPN3_SHMSTATS_MAX_ENTRIES 64
+
+/**
+ *  Maximum length of a statistics key, including the NUL terminator
+ */
+#define OPENVPN3_SHMSTATS_KEY_LENGTH 64
+
+
+/**
+ *  A single statistics counter inside the shared memory segment.
+ *  Fixed layout equivalent of ConnectionStatDetails.
+ */
+struct ShmStatsEntry
+{
+    char key[OPENVPN3_SHMSTATS_KEY_LENGTH];
+    long long value;
+};
+
+
+/**
+ *  Complete layout of the shared memory statistics segment.  The
+ *  sequence counter implements a classic seqlock: the writer increments
+ *  it to an odd value before updating, and to an even value when done.
+ *  A reader which observes an odd value, or different values before and
+ *  after copying the entries, must retry.
+ */
+struct ShmStatsSegment
+{
+    unsigned int sequence;
+    unsigned int count;
+    struct ShmStatsEntry entries[OPENVPN3_SHMSTATS_MAX_ENTRIES];
+};
+
+
+/**
+ *  Manages a POSIX shared memory segment carrying connection statistics
+ *  for a single VPN session.  The segment name is derived from the
+ *  session token, which only the session manager and the backend client
+ *  process know.
+ */
+class ConnectionStatsShm
+{
+public:
+    /**
+     *  Creates and maps a statistics segment as the writing side.
+     *  Used by the backend VPN client process.
+     *
+     * @param session_token  Session token string identifying the session
+     *
+     * @return Returns a pointer to a ConnectionStatsShm object, or
+     *         nullptr if the segment could not be created.  Failing to
+     *         create the segment is not fatal; consumers will fall back
+     *         to the D-Bus statistics property.
+     */
+    static ConnectionStatsShm * CreateWriter(const std::string& session_token)
+    {
+        int fd = shm_open(segment_name(session_token).c_str(),
+                          O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        if (-1 == ftruncate(fd, sizeof(struct ShmStatsSegment)))
+        {
+            close(fd);
+            shm_unlink(segment_name(session_token).c_str());
+            return nullptr;
+        }
+        void *m = mmap(NULL, sizeof(struct ShmStatsSegment),
+                       PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == m)
+        {
+            shm_unlink(segment_name(session_token).c_str());
+            return nullptr;
+        }
+        memset(m, 0, sizeof(struct ShmStatsSegment));
+        return new ConnectionStatsShm((struct ShmStatsSegment *) m,
+                                      session_token, true);
+    }
+
+
+    /**
+     *  Maps an existing statistics segment read-only.  Used by the
+     *  session manager and monitoring consumers.
+     *
+     * @param session_token  Session token string identifying the session
+     *
+     * @return Returns a pointer to a ConnectionStatsShm object, or
+     *         nullptr if no segment exists for this session.
+     */
+    static ConnectionStatsShm * AttachReader(const std::string& session_token)
+    {
+        int fd = shm_open(segment_name(session_token).c_str(),
+                          O_RDONLY, 0);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        void *m = mmap(NULL, sizeof(struct ShmStatsSegment),
+                       PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == m)
+        {
+            return nullptr;
+        }
+        return new ConnectionStatsShm((struct ShmStatsSegment *) m,
+                                      session_token, false);
+    }
+
+
+    ~ConnectionStatsShm()
+    {
+        munmap(segment, sizeof(struct ShmStatsSegment));
+        if (writer)
+        {
+            shm_unlink(segment_name(token).c_str());
+        }
+    }
+
+
+    /**
+     *  Updates the shared memory segment in place from a statistics
+     *  snapshot, using the interned key table.  Zero-valued counters
+     *  are skipped, matching the ConnectionStats based variant, and
+     *  no allocations are done at all.
+     *
+     * @param keys      Interned statistics key names
+     * @param snapshot  Counter values, indexed like the key table
+     */
+    void Update(const std::vector<std::string>& keys,
+                const std::vector<long long>& snapshot)
+    {
+        if (!writer)
+        {
+            return;
+        }
+
+        // Seqlock write side: odd sequence while the update is in
+        // progress.  The release fence after the store keeps the data
+        // writes below from being reordered ahead of the odd marker.
+        __atomic_store_n(&segment->sequence, segment->sequence + 1,
+                         __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        unsigned int i = 0;
+        for (size_t n = 0; n < snapshot.size() && n < keys.size(); ++n)
+        {
+            if (!snapshot[n] || i >= OPENVPN3_SHMSTATS_MAX_ENTRIES)
+            {
+                continue;
+            }
+            strncpy(segment->entries[i].key, keys[n].c_str(),
+                    OPENVPN3_SHMSTATS_KEY_LENGTH - 1);
+            segment->entries[i].key[OPENVPN3_SHMSTATS_KEY_LENGTH - 1] = 0;
+            segment->entries[i].value = snapshot[n];
+            i++;
+        }
+        segment->count = i;
+
+        // Release fence before the closing even store, so all data
+        // writes are visible before the sequence turns even again
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&segment->sequence, segment->sequence + 1,
+                         __ATOMIC_RELAXED);
+    }
+
+
+    /**
+     *  Updates the shared memory segment in place with a fresh set of
+     *  statistics.  Only valid on the writing side.  No allocations are
+     *  done beyond what the provided ConnectionStats already carries.
+     *
+     * @param stats  ConnectionStats array to publish
+     */
+    void Update(const ConnectionStats& stats)
+    {
+        if (!writer)
+        {
+            return;
+        }
+
+        // Seqlock write side: odd sequence while the update is in
+        // progress.  The release fence after the store keeps the data
+        // writes below from being reordered ahead of the odd marker.
+        __atomic_store_n(&segment->sequence, segment->sequence + 1,
+                         __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        unsigned int i = 0;
+        for (const auto& sd : stats)
+        {
+            if (i >= OPENVPN3_SHMSTATS_MAX_ENTRIES)
+            {
+                break;
+            }
+            strncpy(segment->entries[i].key, sd.key.c_str(),
+                    OPENVPN3_SHMSTATS_KEY_LENGTH - 1);
+            segment->entries[i].key[OPENVPN3_SHMSTATS_KEY_LENGTH - 1] = 0;
+            segment->entries[i].value = sd.value;
+            i++;
+        }
+        segment->count = i;
+
+        // Release fence before the closing even store, so all data
+        // writes are visible before the sequence turns even again
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&segment->sequence, segment->sequence + 1,
+                         __ATOMIC_RELAXED);
+    }
+
+
+    /**
+     *  Takes a consistent snapshot of the statistics in the segment.
+     *
+     * @return Returns a ConnectionStats array with the current counters.
+     */
+    ConnectionStats Read()
+    {
+        ConnectionStats ret;
+        struct ShmStatsSegment snapshot;
+
+        unsigned int seq_before;
+        unsigned int seq_after;
+        do
+        {
+            do
+            {
+                seq_before = __atomic_load_n(&segment->sequence,
+                                             __ATOMIC_ACQUIRE);
+            } while (seq_before & 1);  // writer is mid-update
+
+            memcpy(&snapshot, segment, sizeof(struct ShmStatsSegment));
+
+            // Acquire fence so the memcpy reads above cannot be
+            // reordered past the seq_after check below
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            seq_after = __atomic_load_n(&segment->sequence,
+                                        __ATOMIC_RELAXED);
+        } while (seq_before != seq_after);
+
+        for (unsigned int i = 0;
+             i < snapshot.count && i < OPENVPN3_SHMSTATS_MAX_ENTRIES;
+             i++)
+        {
+            ret.push_back(ConnectionStatDetails(
+                              std::string(snapshot.entries[i].key),
+                              snapshot.entries[i].value));
+        }
+        return ret;
+    }
+
+
+private:
+    struct ShmStatsSegment *segment;
+    std::string token;
+    bool writer;
+
+
+    ConnectionStatsShm(struct ShmStatsSegment *segment,
+                       const std::string& session_token,
+                       bool writer)
+        : segment(segment),
+          token(session_token),
+          writer(writer)
+    {
+    }
+
+
+    /**
+     *  Derives the shared memory segment name from a session token
+     *
+     * @param session_token  Session token string identifying the session
+     *
+     * @return Returns the name to be used with shm_open()
+     */
+    static std::string segment_name(const std::string& session_token)
+    {
+        return "/net.openvpn.v3.stats_" + session_token;
+    }
+};
+
+#endif // OPENVPN3_DBUS_CLIENT_STATISTICS_SHM
@@ -1217,6 +1217,47 @@ public:
     }
 
 
+    /**
+     *  Function signature for the deferred option setup of a lazily
+     *  registered command.  It receives the SingleCommand object the
+     *  moment it is materialized and is expected to register all the
+     *  command's options on it.
+     */
+    typedef void (*optionSetupFunc)(SingleCommand& cmd);
+
+
+    /**
+     *  Register a new command from a static declaration, without
+     *  building any option objects.  Only the name and description
+     *  string literals are kept; the SingleCommand object and all its
+     *  options are materialized the first time the command is actually
+     *  needed - when it is named on the command line or queried by the
+     *  shell completion helper.  Short-lived invocations which never
+     *  touch the command thereby skip its entire option setup.
+     *
+     * @param cmdnam        Command line name of the command, as a string
+     *                      literal which must outlive this object
+     * @param descr         A short description of the command's purpose,
+     *                      same lifetime requirement as cmdnam
+     * @param cmdfunc       commandPtr (function pointer) to the callback
+     *                      function
+     * @param option_setup  Optional function registering the command's
+     *                      options once the command is materialized
+     */
+    void AddCommandLazy(const char *cmdnam,
+                        const char *descr,
+                        const commandPtr cmdfunc,
+                        const optionSetupFunc option_setup = nullptr)
+    {
+        LazyCommand entry;
+        entry.name = cmdnam;
+        entry.description = descr;
+        entry.func = cmdfunc;
+        entry.option_setup = option_setup;
+        lazy_commands.push_back(entry);
+    }
+
+
     /**
      *  Starts the command line processing, which will on success run
      *  the proper callback function according to the command being called.
@@ -1258,49 +1299,18 @@ public:
             // If we found our command ...
             if (c->CheckCommandName(cmd))
             {
-                // Copy over the arguments, skip argv[0] and build another one
-                // instead.  Ideally, this should not be needed - but
-                // getopt_long() needs it for its error reporting.  And
-                // removing the error reporting, things gets much more
-                // complicated and limited.
-                //
-                // Also ensure we have one extra element as a NULL terminator
-                //
-                char **cmdargv = (char **) calloc(sizeof(char *), argc + 1);
-                if (NULL == cmdargv)
-                {
-                    throw CommandException(baseprog, "Could not allocate memory for argument parsing");
-                }
-
-                // Build up the new argv[0] to be used instead
-                const std::string cmdarg0_str = baseprog + "/" + cmd;
-                cmdargv[0] = strdup(cmdarg0_str.c_str());
-                int cmdargc = 1;
-
-                // copy over the arguments, ignoring the initial argv[0]
-                for (int i = 1; i < argc; i++)
-                {
-                    cmdargv[cmdargc++] = argv[i];
-                }
+                return run_command(c, baseprog, cmd, argc, argv);
+            }
+        }
 
-                // Run the command's callback function
-                int ec = 1;
-                try
-                {
-                    ec = c->RunCommand(argv[0], 1, cmdargc, cmdargv);
-                }
-                catch (...)
-                {
-                    // If something happened when running the
-                    // callback function, clean-up and pass the same
-                    // exception further.
-                    free(cmdargv[0]);
-                    free(cmdargv);
-                    throw;
-                }
-                free(cmdargv[0]);
-                free(cmdargv);
-                return ec;
+        // Then check the lazily registered commands; only the one
+        // being called gets its option objects materialized
+        for (auto& entry : lazy_commands)
+        {
+            if (cmd == entry.name)
+            {
+                return run_command(materialize_command(entry),
+                                   baseprog, cmd, argc, argv);
             }
         }
 
@@ -1320,7 +1330,14 @@ public:
      */
     std::vector<SingleCommand::Ptr> GetAllCommandObjects()
     {
-        return commands;
+        // The shell completion helper inspects options across all
+        // commands, so the lazily registered ones are materialized here
+        std::vector<SingleCommand::Ptr> ret = commands;
+        for (auto& entry : lazy_commands)
+        {
+            ret.push_back(materialize_command(entry));
+        }
+        return ret;
     }
 
 
@@ -1546,6 +1563,17 @@ private:
         {
             std::cout << "    " << cmd->GetCommandHelp(width);
         }
+
+        // The lazily registered commands carry their name and
+        // description in the declaration itself, so the help screen
+        // does not materialize any of them
+        for (auto &entry : lazy_commands)
+        {
+            std::string name(entry.name);
+            std::cout << "    " << name
+                      << std::setw(width - name.size())
+                      << " - " << entry.description << std::endl;
+        }
         std::cout << std::endl;
 
         std::cout << "For more information, run: "
@@ -1555,9 +1583,111 @@ private:
     }
 
 
+    /**
+     *  Static declaration of a lazily registered command.  The name and
+     *  description point at string literals provided by the caller; the
+     *  object member stays empty until the command is materialized.
+     */
+    struct LazyCommand
+    {
+        const char *name;
+        const char *description;
+        commandPtr func;
+        optionSetupFunc option_setup;
+        SingleCommand::Ptr object;
+    };
+
+
+    /**
+     *  Materializes a lazily registered command, creating the
+     *  SingleCommand object and running its option setup function.
+     *  Subsequent calls return the already materialized object.
+     *
+     * @param entry  The LazyCommand declaration to materialize
+     *
+     * @return Returns an RC-smart pointer to the SingleCommand object
+     */
+    SingleCommand::Ptr materialize_command(LazyCommand& entry)
+    {
+        if (!entry.object)
+        {
+            entry.object = new SingleCommand(entry.name, entry.description,
+                                             entry.func);
+            if (entry.option_setup)
+            {
+                entry.option_setup(*entry.object);
+            }
+        }
+        return entry.object;
+    }
+
+
+    /**
+     *  Runs a resolved command, handing it a rewritten argv where
+     *  argv[0] carries the "binary/command" notation getopt_long()
+     *  needs for its error reporting.
+     *
+     * @param c         SingleCommand object to run
+     * @param baseprog  Base name of the binary being run
+     * @param cmd       The command name from the command line
+     * @param argc      int value containing number of arguments in argv
+     * @param argv      char ** string array with all provided arguments
+     *
+     * @return Returns the exit code from the command's callback function
+     */
+    int run_command(SingleCommand::Ptr c, const std::string& baseprog,
+                    const std::string& cmd, int argc, char **argv)
+    {
+        // Copy over the arguments, skip argv[0] and build another one
+        // instead.  Ideally, this should not be needed - but
+        // getopt_long() needs it for its error reporting.  And
+        // removing the error reporting, things gets much more
+        // complicated and limited.
+        //
+        // Also ensure we have one extra element as a NULL terminator
+        //
+        char **cmdargv = (char **) calloc(sizeof(char *), argc + 1);
+        if (NULL == cmdargv)
+        {
+            throw CommandException(baseprog, "Could not allocate memory for argument parsing");
+        }
+
+        // Build up the new argv[0] to be used instead
+        const std::string cmdarg0_str = baseprog + "/" + cmd;
+        cmdargv[0] = strdup(cmdarg0_str.c_str());
+        int cmdargc = 1;
+
+        // copy over the arguments, ignoring the initial argv[0]
+        for (int i = 1; i < argc; i++)
+        {
+            cmdargv[cmdargc++] = argv[i];
+        }
+
+        // Run the command's callback function
+        int ec = 1;
+        try
+        {
+            ec = c->RunCommand(argv[0], 1, cmdargc, cmdargv);
+        }
+        catch (...)
+        {
+            // If something happened when running the
+            // callback function, clean-up and pass the same
+            // exception further.
+            free(cmdargv[0]);
+            free(cmdargv);
+            throw;
+        }
+        free(cmdargv[0]);
+        free(cmdargv);
+        return ec;
+    }
+
+
     const std::string progname;
     const std::string description;
     std::vector<SingleCommand::Ptr> commands;
+    std::vector<LazyCommand> lazy_commands;
     ShellCompletion::Ptr shellcompl;
 };
 
@@ -21,6 +21,7 @@
 #define OPENVPN3_CORE_EXTENSIONS
 
 #include <iostream>
+#include <stdexcept>
 #include <json/json.h>
 #include <openvpn/client/cliconstants.hpp>
 #include <openvpn/common/options.hpp>
@@ -40,25 +41,336 @@ namespace openvpn {
                 || (optname == "tls-crypt")) ? true : false;
     }
 
+    /**
+     *  Appends a single rendered configuration line to a caller
+     *  provided buffer, without any temporary string objects.
+     *
+     * @param buffer    Destination std::string the line is appended to
+     * @param optname   Name of the option to render
+     * @param optvalue  The option value(s), already joined to a string
+     */
+    inline void optparser_appendline(std::string& buffer,
+                                     const std::string& optname,
+                                     const std::string& optvalue)
+    {
+        if (optparser_inline_file(optname))
+        {
+            buffer += "<";
+            buffer += optname;
+            buffer += ">\n";
+            buffer += optvalue;
+            buffer += "</";
+            buffer += optname;
+            buffer += ">\n";
+        }
+        else
+        {
+            buffer += optname;
+            buffer += " ";
+            buffer += optvalue;
+            buffer += "\n";
+        }
+    }
+
     std::string optparser_mkline(std::string optname, std::string optvalue)
     {
-        bool inlined_file = optparser_inline_file(optname);
-        std::stringstream ret;
+        std::string ret;
+        optparser_appendline(ret, optname, optvalue);
+        return ret;
+    }
 
-        if (inlined_file)
+    /**
+     *  Checks if a configuration profile is JSON formatted, as
+     *  produced by OptionListJSON::json_export().  A plain text
+     *  OpenVPN configuration profile can never start with a '{'
+     *  character, so inspecting the first non-whitespace character
+     *  is sufficient.
+     *
+     * @param profile  std::string containing the profile to inspect
+     *
+     * @return Returns true if the profile is JSON formatted
+     */
+    inline bool optparser_profile_is_json(const std::string& profile)
+    {
+        for (char c : profile)
         {
+            if (' ' == c || '\t' == c || '\n' == c || '\r' == c)
+            {
+                continue;
+            }
+            return '{' == c;
+        }
+        return false;
+    }
+
 
-            ret << "<" << optname << ">" << std::endl
-                << optvalue
-                << "</" << optname << ">"
-                << std::endl;
+    /**
+     *  Minimal streaming tokenizer for JSON formatted configuration
+     *  profiles, as produced by OptionListJSON::json_export().  The
+     *  expected document shape is a single flat JSON object mapping
+     *  option names to string values.  Each Next() call scans one
+     *  name/value pair directly out of the input buffer, so no
+     *  intermediate document tree is ever built and the two caller
+     *  provided destination buffers are reused between calls.  Peak
+     *  memory usage is thus bounded by the largest single option
+     *  value instead of the complete document.
+     */
+    class JsonOptionTokenizer
+    {
+    public:
+        /**
+         *  Prepares tokenizing of a JSON formatted profile
+         *
+         * @param json_str  JSON document to tokenize.  The referenced
+         *                  string must stay alive for the lifetime of
+         *                  the tokenizer object.
+         */
+        JsonOptionTokenizer(const std::string& json_str)
+            : input(json_str), pos(0), started(false), finished(false)
+        {
         }
-        else
+
+        /**
+         *  Extracts the next name/value pair from the JSON document
+         *
+         * @param name   std::string receiving the option name.  Any
+         *               previous content is replaced.
+         * @param value  std::string receiving the option value.  Any
+         *               previous content is replaced.
+         *
+         * @return Returns true if a pair was extracted, false when
+         *         the end of the document was reached.  Throws
+         *         std::runtime_error on malformed input.
+         */
+        bool Next(std::string& name, std::string& value)
+        {
+            if (finished)
+            {
+                return false;
+            }
+            if (!started)
+            {
+                if ('{' != next_token())
+                {
+                    parse_error("expected '{'");
+                }
+                started = true;
+                if ('}' == peek_token())
+                {
+                    ++pos;
+                    finished = true;
+                    return false;
+                }
+            }
+            else
+            {
+                char c = next_token();
+                if ('}' == c)
+                {
+                    finished = true;
+                    return false;
+                }
+                if (',' != c)
+                {
+                    parse_error("expected ',' or '}'");
+                }
+            }
+            parse_string(name);
+            if (':' != next_token())
+            {
+                parse_error("expected ':'");
+            }
+            if ('"' == peek_token())
+            {
+                parse_string(value);
+            }
+            else
+            {
+                parse_scalar(value);
+            }
+            return true;
+        }
+
+    private:
+        const std::string& input;
+        std::string::size_type pos;
+        bool started;
+        bool finished;
+
+        void parse_error(const std::string& msg)
         {
-            ret << optname << " " << optvalue << std::endl;
+            throw std::runtime_error("JSON profile parse error at offset "
+                                     + std::to_string(pos) + ": " + msg);
         }
-        return ret.str();
-    }
+
+        /**
+         *  Skips any whitespace and returns the next significant
+         *  character without consuming it
+         */
+        char peek_token()
+        {
+            while (pos < input.size()
+                   && (' ' == input[pos] || '\t' == input[pos]
+                       || '\n' == input[pos] || '\r' == input[pos]))
+            {
+                ++pos;
+            }
+            if (pos >= input.size())
+            {
+                parse_error("unexpected end of input");
+            }
+            return input[pos];
+        }
+
+        /**
+         *  Skips any whitespace and consumes the next significant
+         *  character
+         */
+        char next_token()
+        {
+            char c = peek_token();
+            ++pos;
+            return c;
+        }
+
+        /**
+         *  Parses a JSON string token into the destination buffer,
+         *  resolving escape sequences on the fly
+         */
+        void parse_string(std::string& dest)
+        {
+            if ('"' != next_token())
+            {
+                parse_error("expected string");
+            }
+            dest.clear();
+            while (true)
+            {
+                if (pos >= input.size())
+                {
+                    parse_error("unterminated string");
+                }
+                char c = input[pos++];
+                if ('"' == c)
+                {
+                    return;
+                }
+                if ('\\' != c)
+                {
+                    dest += c;
+                    continue;
+                }
+                if (pos >= input.size())
+                {
+                    parse_error("unterminated escape sequence");
+                }
+                char esc = input[pos++];
+                switch (esc)
+                {
+                case '"':
+                case '\\':
+                case '/':
+                    dest += esc;
+                    break;
+                case 'b':
+                    dest += '\b';
+                    break;
+                case 'f':
+                    dest += '\f';
+                    break;
+                case 'n':
+                    dest += '\n';
+                    break;
+                case 'r':
+                    dest += '\r';
+                    break;
+                case 't':
+                    dest += '\t';
+                    break;
+                case 'u':
+                    append_unicode_escape(dest);
+                    break;
+                default:
+                    parse_error("invalid escape sequence");
+                }
+            }
+        }
+
+        /**
+         *  Decodes a \\uXXXX escape sequence and appends it UTF-8
+         *  encoded.  Surrogate pairs are not combined; configuration
+         *  profiles are expected to stay within the basic
+         *  multilingual plane.
+         */
+        void append_unicode_escape(std::string& dest)
+        {
+            if (pos + 4 > input.size())
+            {
+                parse_error("truncated \\u escape sequence");
+            }
+            unsigned int cp = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                char c = input[pos++];
+                cp <<= 4;
+                if (c >= '0' && c <= '9')
+                {
+                    cp += c - '0';
+                }
+                else if (c >= 'a' && c <= 'f')
+                {
+                    cp += c - 'a' + 10;
+                }
+                else if (c >= 'A' && c <= 'F')
+                {
+                    cp += c - 'A' + 10;
+                }
+                else
+                {
+                    parse_error("invalid \\u escape sequence");
+                }
+            }
+            if (cp < 0x80)
+            {
+                dest += (char) cp;
+            }
+            else if (cp < 0x800)
+            {
+                dest += (char) (0xc0 | (cp >> 6));
+                dest += (char) (0x80 | (cp & 0x3f));
+            }
+            else
+            {
+                dest += (char) (0xe0 | (cp >> 12));
+                dest += (char) (0x80 | ((cp >> 6) & 0x3f));
+                dest += (char) (0x80 | (cp & 0x3f));
+            }
+        }
+
+        /**
+         *  Copies an unquoted JSON scalar (number, true/false/null)
+         *  verbatim into the destination buffer
+         */
+        void parse_scalar(std::string& dest)
+        {
+            dest.clear();
+            while (pos < input.size())
+            {
+                char c = input[pos];
+                if (',' == c || '}' == c || ' ' == c || '\t' == c
+                    || '\n' == c || '\r' == c)
+                {
+                    break;
+                }
+                dest += c;
+                ++pos;
+            }
+            if (dest.empty())
+            {
+                parse_error("expected value");
+            }
+        }
+    };
 
     class OptionListJSON : public openvpn::OptionList
     {
@@ -77,14 +389,98 @@ namespace openvpn {
             return output.str();
         }
 
-        std::string string_export()
+        /**
+         *  Streaming counterpart to @json_export().  Feeds each
+         *  name/value pair straight from the JSON tokenizer into the
+         *  option list, without materializing an intermediate
+         *  document tree or a plain text rendering of the profile.
+         *  Peak import memory is bounded by the largest single
+         *  option value (typically an inlined certificate) instead
+         *  of the complete profile.
+         *
+         * @param json_str  JSON formatted configuration profile, as
+         *                  produced by @json_export()
+         */
+        void json_import(const std::string& json_str)
         {
-            std::stringstream cfgstr;
+            JsonOptionTokenizer tokenizer(json_str);
+            std::string name;
+            std::string value;
+            while (tokenizer.Next(name, value))
+            {
+                Option opt;
+                opt.push_back(name);
+                if (optparser_inline_file(name))
+                {
+                    // Inlined file payloads are a single argument
+                    opt.push_back(value);
+                }
+                else
+                {
+                    // Split ordinary option values on spaces, matching
+                    // the line rendering done by optparser_appendline()
+                    std::string::size_type start = 0;
+                    while (start < value.size())
+                    {
+                        std::string::size_type end = value.find(' ', start);
+                        if (std::string::npos == end)
+                        {
+                            end = value.size();
+                        }
+                        if (end > start)
+                        {
+                            opt.push_back(value.substr(start, end - start));
+                        }
+                        start = end + 1;
+                    }
+                }
+                push_back(std::move(opt));
+            }
+            update_map();
+        }
+
+        /**
+         *  Streaming variant of @string_export().  Renders the complete
+         *  configuration profile into a caller provided buffer.  The
+         *  buffer is reserved up-front based on a size estimate, so
+         *  large profiles with inlined certificate payloads are
+         *  exported with a single allocation instead of one per line.
+         *
+         * @param buffer  Destination std::string the profile is
+         *                rendered into.  Existing content is replaced.
+         * @param include_inline  If false, options carrying inlined
+         *                file payloads (certificates, keys) are left
+         *                out of the rendered profile.  Used by the
+         *                configuration manager to render the profile
+         *                skeleton around the deduplicated payloads.
+         */
+        void string_export(std::string& buffer, bool include_inline = true)
+        {
+            buffer.clear();
+
+            // Estimate the rendered size; per option the overhead on
+            // top of the raw values is the option name (twice for
+            // inlined files), separators, XML-ish tag brackets and
+            // newlines
+            size_t estimate = 0;
+            for (auto element : *this)
+            {
+                for (int i = 0; i < element.size(); i++)
+                {
+                    estimate += element.ref(i).size() + 1;
+                }
+                estimate += element.ref(0).size() + 8;
+            }
+            buffer.reserve(estimate);
 
             // FIXME: Looks very hacky
             for(auto element : *this)
             {
                 std::string optname = element.ref(0);
+                if (!include_inline && optparser_inline_file(optname))
+                {
+                    continue;
+                }
                 std::string params;
                 bool opened = false;
                 for (int i = 1; i < element.size(); i++)
@@ -111,10 +507,16 @@ namespace openvpn {
                         params += " ";
                     }
                 }
-                cfgstr << optparser_mkline(optname, params);
+                optparser_appendline(buffer, optname, params);
              }
+        }
+
 
-            return cfgstr.str();
+        std::string string_export()
+        {
+            std::string cfgstr;
+            string_export(cfgstr);
+            return cfgstr;
         }
     };
 
@@ -123,25 +525,21 @@ namespace openvpn {
     public:
         ProfileMergeJSON(const std::string json_str)
         {
-            // Read the JSON formatted input string
-            // and parse it into a JSON::Value object.
-            // This has to go through a std::stringstream, as
-            // the JSON parser is stream based.
-            std::stringstream json_stream;
-            json_stream << json_str;  // Convert std::string to std::stringstream
-            Json::Value data;
-            json_stream >> data;      // Parse into JSON::Value
-
-
-            // Parse the JSON input into a plain/text config file which
-            // is then parsed/imported into the OpenVPN option storage.
-            std::stringstream config_str;
-            for( Json::ValueIterator it = data.begin();
-                 it != data.end(); ++it) {
-                std::string name = it.name();
-                config_str << optparser_mkline(name, data[name].asString());
-            }
-            expand_profile(config_str.str(), "", openvpn::ProfileMerge::FOLLOW_NONE,
+            // Stream the flat JSON object into a plain/text config
+            // profile, which is then parsed/imported into the OpenVPN
+            // option storage.  The tokenizer scans the JSON input
+            // directly, so no intermediate Json::Value tree is built
+            // and only one name/value pair is held in memory at a
+            // time in addition to the rendered profile itself.
+            std::string config_str;
+            JsonOptionTokenizer tokenizer(json_str);
+            std::string name;
+            std::string value;
+            while (tokenizer.Next(name, value))
+            {
+                optparser_appendline(config_str, name, value);
+            }
+            expand_profile(config_str, "", openvpn::ProfileMerge::FOLLOW_NONE,
                            openvpn::ProfileParseLimits::MAX_LINE_SIZE,
                            openvpn::ProfileParseLimits::MAX_PROFILE_SIZE,
                            profile_content().size());
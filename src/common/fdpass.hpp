@@ -0,0 +1,145 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   fdpass.hpp
+ *
+ * @brief  Hand-over of a session token and an optional file descriptor
+ *         over an AF_UNIX socketpair, used between the backend starter
+ *         and the openvpn3-service-client processes
+ */
+
+#ifndef OPENVPN3_FDPASS_HPP
+#define OPENVPN3_FDPASS_HPP
+
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+/**
+ *  Sends a newline terminated session token over an AF_UNIX socket,
+ *  optionally carrying a file descriptor in an SCM_RIGHTS control
+ *  message on the same send.
+ *
+ * @param sock   Socket to send the token on
+ * @param token  Session token; the terminating newline is added here
+ * @param fd     File descriptor to pass along, or -1 for none
+ *
+ * @return Returns the number of token bytes sent (including the
+ *         newline), or -1 on error - the same semantics as send(2)
+ */
+inline ssize_t fdpass_send_token(int sock, const std::string& token, int fd)
+{
+    std::string tokbuf = token + "\n";
+
+    struct iovec iov;
+    iov.iov_base = (void *) tokbuf.c_str();
+    iov.iov_len = tokbuf.size();
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    char cmsgbuf[CMSG_SPACE(sizeof(int))];
+    if (fd >= 0)
+    {
+        std::memset(cmsgbuf, 0, sizeof(cmsgbuf));
+        msg.msg_control = cmsgbuf;
+        msg.msg_controllen = sizeof(cmsgbuf);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    // A SIGPIPE would kill the sending service if the peer died;
+    // send with MSG_NOSIGNAL and let the caller handle the error
+    return sendmsg(sock, &msg, MSG_NOSIGNAL);
+}
+
+
+/**
+ *  Receives a newline terminated session token from an AF_UNIX socket,
+ *  extracting a file descriptor if one was passed along in an
+ *  SCM_RIGHTS control message.
+ *
+ * @param sock  Socket to receive the token from
+ * @param fd    Set to the received file descriptor, or -1 if the
+ *              sender did not pass one
+ *
+ * @return Returns the received token.  An empty string indicates the
+ *         sender closed the socket without providing a token.
+ */
+inline std::string fdpass_recv_token(int sock, int& fd)
+{
+    fd = -1;
+    std::string token;
+
+    char buf[256];
+    char cmsgbuf[CMSG_SPACE(sizeof(int))];
+    bool complete = false;
+    while (!complete)
+    {
+        struct iovec iov;
+        iov.iov_base = buf;
+        iov.iov_len = sizeof(buf);
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cmsgbuf;
+        msg.msg_controllen = sizeof(cmsgbuf);
+
+        ssize_t r = recvmsg(sock, &msg, 0);
+        if (r <= 0)
+        {
+            break;
+        }
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+             cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (SOL_SOCKET == cmsg->cmsg_level
+                && SCM_RIGHTS == cmsg->cmsg_type)
+            {
+                std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+
+        for (ssize_t i = 0; i < r; i++)
+        {
+            if ('\n' == buf[i] || '\0' == buf[i])
+            {
+                complete = true;
+                break;
+            }
+            token += buf[i];
+        }
+    }
+    return token;
+}
+
+#endif // OPENVPN3_FDPASS_HPP
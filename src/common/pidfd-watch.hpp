@@ -0,0 +1,144 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   pidfd-watch.hpp
+ *
+ * @brief  Event driven supervision of another process via a pidfd.
+ *
+ *         A pidfd (pidfd_open(2), Linux 5.3+) becomes readable when the
+ *         watched process exits, so hooking it into the GLib main loop
+ *         gives immediate exit notification with zero polling cost.  On
+ *         kernels without pidfd support the watch is simply inactive
+ *         and callers fall back to the existing signal/poll based
+ *         detection.
+ */
+
+#ifndef OPENVPN3_COMMON_PIDFD_WATCH_HPP
+#define OPENVPN3_COMMON_PIDFD_WATCH_HPP
+
+#include <functional>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+
+class PidfdWatch
+{
+public:
+    /**
+     *  Creates a watch for a process.  The callback is invoked from
+     *  the GLib main loop as soon as the process exits.
+     *
+     * @param pid      Process ID of the process to watch
+     * @param exit_cb  Callback function invoked on process exit
+     */
+    PidfdWatch(pid_t pid, std::function<void()> exit_cb)
+        : exit_cb(exit_cb)
+    {
+        fd = (int) syscall(__NR_pidfd_open, pid, 0);
+        if (fd < 0)
+        {
+            // Kernel without pidfd_open() or the process is already
+            // gone; the watch stays inactive
+            return;
+        }
+        watch_source = g_unix_fd_add(fd, G_IO_IN, exited_cb, this);
+    }
+
+
+    ~PidfdWatch()
+    {
+        Disarm();
+    }
+
+
+    /**
+     *  Checks if the process exit watch is active
+     *
+     * @return Returns true if the pidfd was opened and the exit
+     *         callback will be delivered
+     */
+    bool Valid()
+    {
+        return fd >= 0;
+    }
+
+
+    /**
+     *  Stops watching the process without waiting for it to exit.
+     *  Used when the process is expected to exit deliberately and the
+     *  exit callback must not fire.
+     */
+    void Disarm()
+    {
+        if (watch_source > 0)
+        {
+            g_source_remove(watch_source);
+            watch_source = 0;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+
+    PidfdWatch(const PidfdWatch&) = delete;
+    PidfdWatch& operator=(const PidfdWatch&) = delete;
+
+
+private:
+    std::function<void()> exit_cb;
+    int fd = -1;
+    guint watch_source = 0;
+
+
+    /**
+     *  GLib2 IO callback invoked when the pidfd becomes readable,
+     *  which happens once the watched process has exited
+     *
+     * @param fd         The pidfd which became readable
+     * @param condition  GIOCondition of the event
+     * @param user_data  Pointer to the PidfdWatch object
+     *
+     * @return Always returns G_SOURCE_REMOVE; a process only exits once
+     */
+    static gboolean exited_cb(gint fd, GIOCondition condition,
+                              gpointer user_data)
+    {
+        PidfdWatch *self = (PidfdWatch *) user_data;
+        self->watch_source = 0;
+        if (self->exit_cb)
+        {
+            self->exit_cb();
+        }
+        return G_SOURCE_REMOVE;
+    }
+};
+
+#endif  // OPENVPN3_COMMON_PIDFD_WATCH_HPP
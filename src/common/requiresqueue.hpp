@@ -26,6 +26,13 @@
  *         in addition to the methods the service needs to prepare the
  *         RequiresQueue and retrieve the user responses sent from a
  *         front-end.
+ *
+ *         The slot storage is sharded per ClientAttentionType/
+ *         ClientAttentionGroup pair, each shard protected by its own
+ *         reader-writer lock, with atomic unresolved counters per
+ *         shard.  Queue scans of one type/group never block responses
+ *         being provided to another, and the queue can be used from
+ *         multiple dispatch threads concurrently.
  */
 
 #ifndef OPENVPN3_DBUS_REQUIRESQUEUE_HPP
@@ -33,7 +40,9 @@
 
 #include <iostream>
 #include <sstream>
+#include <atomic>
 #include <map>
+#include <utility>
 #include <vector>
 #include <algorithm>
 #include <exception>
@@ -45,6 +54,12 @@
 /**
  *   A single slot which keeps a single requirement the a front-end
  *   must provide back.
+ *
+ *   Slots are move-only.  They carry four std::strings, and the
+ *   copies which used to flow through the fetch/provide paths were
+ *   pure allocator churn during automated credential injection.
+ *   Inside the queue the slots live in a per-shard arena which is
+ *   recycled, so the string buffers are reused across rounds.
  */
 struct RequiresSlot
 {
@@ -57,6 +72,12 @@ struct RequiresSlot
     {
     }
 
+    RequiresSlot(RequiresSlot&&) = default;
+    RequiresSlot& operator=(RequiresSlot&&) = default;
+
+    RequiresSlot(const RequiresSlot&) = delete;
+    RequiresSlot& operator=(const RequiresSlot&) = delete;
+
     unsigned int id;               ///< Unique ID per type/group
     ClientAttentionType type;      ///< Type categorization of the requirement
     ClientAttentionGroup group;    ///< Group categorization of the
@@ -149,14 +170,21 @@ public:
     typedef std::tuple<ClientAttentionType, ClientAttentionGroup> ClientAttTypeGroup;
 
     RequiresQueue()
-        : reqids()
     {
+        g_rw_lock_init(&shards_lock);
     };
 
     ~RequiresQueue()
     {
+        g_rw_lock_clear(&shards_lock);
     }
 
+
+    // The shards carry locks tied to this object; copying the queue
+    // is neither meaningful nor safe.
+    RequiresQueue(const RequiresQueue&) = delete;
+    RequiresQueue& operator=(const RequiresQueue&) = delete;
+
     /**
      * Returns a string containing a D-Bus introspection section for the
      * RequiresQueue methods available via D-Bus.  The method names provided
@@ -208,6 +236,49 @@ public:
         return introspection.str();
     }
 
+    /**
+     * Variant of @IntrospectionMethods() which also declares the batched
+     * queue methods.  These allows a front-end to retrieve all unresolved
+     * requirements and provide all responses with a single D-Bus round
+     * trip each, instead of one QueueCheck/QueueFetch call per slot.
+     *
+     * @param meth_qchktypegr    A string with the method name for getting
+     *                           a list of unprocessed requirement type/groups
+     * @param meth_queuefetch    A string with the method name for fetching an
+     *                           unprocessed queued element.
+     * @param meth_queuefetchall A string with the method name for fetching
+     *                           all unprocessed queued elements in one call.
+     * @param meth_queuechk      A string with the method name for getting
+     *                           the number of unprocessed queued elements.
+     * @param meth_provideresp   A string with the method name for providing
+     *                           user responses to the service.
+     * @param meth_provideall    A string with the method name for providing
+     *                           all user responses in one call.
+     *
+     * @return  Returns a string with the various <method/> tags describing
+     *          the required input arguments and what these methods returns.
+     */
+    std::string IntrospectionMethods(const std::string meth_qchktypegr,
+                                     const std::string meth_queuefetch,
+                                     const std::string meth_queuefetchall,
+                                     const std::string meth_queuechk,
+                                     const std::string meth_provideresp,
+                                     const std::string meth_provideall)
+    {
+        std::stringstream introspection;
+        introspection << IntrospectionMethods(meth_qchktypegr,
+                                              meth_queuefetch,
+                                              meth_queuechk,
+                                              meth_provideresp)
+                      << "    <method name='" << meth_queuefetchall << "'>"
+                      << "      <arg type='a(uuussb)' name='slots' direction='out'/>"
+                      << "    </method>"
+                      << "    <method name='" << meth_provideall << "'>"
+                      << "      <arg type='a(uuus)' name='responses' direction='in'/>"
+                      << "    </method>";
+        return introspection.str();
+    }
+
     /**
      * Adds a user request requirement to the queue.
      *
@@ -224,21 +295,71 @@ public:
      */
     unsigned int RequireAdd(ClientAttentionType type,
                     ClientAttentionGroup group,
-                    std::string name,
-                    std::string descr,
+                    const std::string& name,
+                    const std::string& descr,
                     bool hidden_input)
     {
-        struct RequiresSlot elmt;
-        elmt.id = reqids[get_reqid_index(type, group)]++;
-        elmt.type = type;
-        elmt.group = group;
-        elmt.name = name;
-        elmt.user_description = descr;
-        elmt.provided = false;
-        elmt.hidden_input = hidden_input;
-        slots.push_back(elmt);
+        SlotShard& shard = get_shard(type, group);
+
+        g_rw_lock_writer_lock(&shard.lock);
+        // Reuse a recycled arena slot when one is available; its
+        // string buffers keep their capacity from the previous round
+        struct RequiresSlot *elmt;
+        if (shard.active < shard.slots.size())
+        {
+            elmt = &shard.slots[shard.active];
+        }
+        else
+        {
+            shard.slots.push_back(RequiresSlot());
+            elmt = &shard.slots.back();
+        }
+        shard.active++;
+
+        elmt->id = shard.next_id++;
+        elmt->type = type;
+        elmt->group = group;
+        elmt->name.assign(name);
+        elmt->value.clear();
+        elmt->user_description.assign(descr);
+        elmt->provided = false;
+        elmt->hidden_input = hidden_input;
+        unsigned int ret = elmt->id;
+        shard.unresolved++;
+        g_rw_lock_writer_unlock(&shard.lock);
+
+        return ret;
+    }
+
 
-        return elmt.id;
+    /**
+     * Retires all slots of a type/group, recycling their storage.  The
+     * slots themselves stay in the shard arena with their string
+     * buffer capacity intact, so the next round of requirements of the
+     * same type/group is added without any new allocations.
+     *
+     * @param type   ClientAttentionType of the queue to reset
+     * @param group  ClientAttentionGroup of the queue to reset
+     */
+    void RequireReset(ClientAttentionType type, ClientAttentionGroup group)
+    {
+        SlotShard *shard = find_shard(type, group);
+        if (!shard)
+        {
+            return;
+        }
+        g_rw_lock_writer_lock(&shard->lock);
+        unsigned int pending = 0;
+        for (size_t i = 0; i < shard->active; i++)
+        {
+            if (!shard->slots[i].provided)
+            {
+                pending++;
+            }
+        }
+        shard->unresolved -= pending;
+        shard->active = 0;
+        g_rw_lock_writer_unlock(&shard->lock);
     }
 
 
@@ -258,34 +379,152 @@ public:
         unsigned int id;
         g_variant_get(parameters, "(uuu)", &type, &group, &id);
 
-        // Fetch the requested slot id
-        for (auto& e : slots)
+        // Fetch the requested slot id; the response GVariant is built
+        // while holding the reader lock, so no slot copy is needed
+        SlotShard *shard = find_shard((ClientAttentionType) type,
+                                      (ClientAttentionGroup) group);
+        bool found = false;
+        bool already_provided = false;
+        GVariant *elmt = NULL;
+        if (shard)
         {
-            if (id == e.id)
+            g_rw_lock_reader_lock(&shard->lock);
+            for (size_t i = 0; i < shard->active; i++)
             {
-                if (e.type == (ClientAttentionType) type
-                    && e.group == (ClientAttentionGroup) group)
+                struct RequiresSlot& e = shard->slots[i];
+                if (id == e.id)
                 {
-                    if (e.provided)
+                    found = true;
+                    already_provided = e.provided;
+                    if (!already_provided)
                     {
-                        throw RequiresQueueException("net.openvpn.v3.already-provided",
-                                                     "User input already provided");
+                        elmt = g_variant_new("(uuussb)",
+                                             e.type,
+                                             e.group,
+                                             e.id,
+                                             e.name.c_str(),
+                                             e.user_description.c_str(),
+                                             e.hidden_input);
                     }
+                    break;
+                }
+            }
+            g_rw_lock_reader_unlock(&shard->lock);
+        }
+
+        if (found && already_provided)
+        {
+            throw RequiresQueueException("net.openvpn.v3.already-provided",
+                                         "User input already provided");
+        }
+        if (!found)
+        {
+            throw RequiresQueueException("net.openvpn.v3.element-not-found",
+                                         "No requires queue element found");
+        }
+
+        g_dbus_method_invocation_return_value(invocation, elmt);
+    }
+
+
+    /**
+     *  Fetch all unresolved elements of the request queue in a single
+     *  D-Bus response.  Each element is serialized the same way as a
+     *  single @QueueFetch() response, packed into an array.  This
+     *  reduces the credential negotiation to a single round trip
+     *  regardless of the number of slots.
+     *
+     *  @param invocation  Pointer to the current GDBusMethodInvocation
+     *                     object, where the result will be returned
+     **/
+    void QueueFetchAll(GDBusMethodInvocation *invocation)
+    {
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("a(uuussb)"));
+        assert(NULL != bld);
 
-                    GVariant *elmt = g_variant_new("(uuussb)",
-                                                   e.type,
-                                                   e.group,
-                                                   e.id,
-                                                   e.name.c_str(),
-                                                   e.user_description.c_str(),
-                                                   e.hidden_input);
-                    g_dbus_method_invocation_return_value(invocation, elmt);
-                    return;
+        g_rw_lock_reader_lock(&shards_lock);
+        for (auto& s : shards)
+        {
+            SlotShard& shard = s.second;
+            g_rw_lock_reader_lock(&shard.lock);
+            for (size_t i = 0; i < shard.active; i++)
+            {
+                struct RequiresSlot& e = shard.slots[i];
+                if (!e.provided)
+                {
+                    g_variant_builder_add(bld, "(uuussb)",
+                                          e.type,
+                                          e.group,
+                                          e.id,
+                                          e.name.c_str(),
+                                          e.user_description.c_str(),
+                                          e.hidden_input);
                 }
             }
+            g_rw_lock_reader_unlock(&shard.lock);
+        }
+        g_rw_lock_reader_unlock(&shards_lock);
+
+        // Wrap the GVariant array into a tuple which GDBus expects
+        GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+        g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+        g_dbus_method_invocation_return_value(invocation, g_variant_builder_end(ret));
+
+        // Clean-up GVariant builders
+        g_variant_builder_unref(bld);
+        g_variant_builder_unref(ret);
+    }
+
+
+    /**
+     *  Batched counterpart of the D-Bus variant of @UpdateEntry().  Takes
+     *  an array of responses - (a(uuus)) - and updates each referenced
+     *  RequiresSlot, so a front-end can satisfy the complete queue with
+     *  a single D-Bus call.
+     *
+     *  If any single update fails, a RequiresQueueException is thrown and
+     *  the remaining responses are left unprocessed.
+     *
+     *  @params invocation The GDBus invocation object, which will contain
+     *                     the response on success.
+     *  @params indata     A GVariant object containing the input data from
+     *                     the D-Bus call
+     **/
+    void QueueProvideAll(GDBusMethodInvocation *invocation, GVariant *indata)
+    {
+        GVariantIter *responses = NULL;
+        g_variant_get(indata, "(a(uuus))", &responses);
+        if (NULL == responses)
+        {
+            throw RequiresQueueException("net.openvpn.v3.error.invalid-input",
+                                         "No responses provided");
+        }
+
+        unsigned int type;
+        unsigned int group;
+        guint id;
+        gchar *value = NULL;
+        while (g_variant_iter_next(responses, "(uuus)",
+                                   &type, &group, &id, &value))
+        {
+            std::string newvalue(value ? value : "");
+            g_free(value);
+            value = NULL;
+
+            try
+            {
+                UpdateEntry((ClientAttentionType) type,
+                            (ClientAttentionGroup) group,
+                            id, std::move(newvalue));
+            }
+            catch (RequiresQueueException&)
+            {
+                g_variant_iter_free(responses);
+                throw;
+            }
         }
-        throw RequiresQueueException("net.openvpn.v3.element-not-found",
-                                     "No requires queue element found");
+        g_variant_iter_free(responses);
+        g_dbus_method_invocation_return_value(invocation, NULL);
     }
 
 
@@ -309,25 +548,46 @@ public:
     void UpdateEntry(ClientAttentionType type, ClientAttentionGroup group,
                      unsigned int id, std::string newvalue)
     {
-        for (auto& e : slots)
+        SlotShard *shard = find_shard(type, group);
+        bool found = false;
+        bool already_provided = false;
+        if (shard)
         {
-            if (e.type ==  type && e.group == (ClientAttentionGroup) group && e.id == id)
+            g_rw_lock_writer_lock(&shard->lock);
+            for (size_t i = 0; i < shard->active; i++)
             {
-                if (!e.provided)
+                struct RequiresSlot& e = shard->slots[i];
+                if (e.id == id)
                 {
-                    e.provided = true;
-                    e.value = newvalue;
-                    return;
-                }
-                else
-                {
-                    throw RequiresQueueException("net.openvpn.v3.error.input-already-provided",
-                                                 "Request ID " + std::to_string(id) + " has already been provided");
+                    found = true;
+                    if (e.provided)
+                    {
+                        already_provided = true;
+                    }
+                    else
+                    {
+                        e.provided = true;
+                        // The by-value argument is this call's own
+                        // copy; move its buffer into the slot
+                        e.value = std::move(newvalue);
+                        shard->unresolved--;
+                    }
+                    break;
                 }
             }
+            g_rw_lock_writer_unlock(&shard->lock);
+        }
+
+        if (already_provided)
+        {
+            throw RequiresQueueException("net.openvpn.v3.error.input-already-provided",
+                                         "Request ID " + std::to_string(id) + " has already been provided");
+        }
+        if (!found)
+        {
+            throw RequiresQueueException("net.openvpn.v3.invalid-input",
+                                         "No matching entry found in the request queue");
         }
-        throw RequiresQueueException("net.openvpn.v3.invalid-input",
-                                     "No matching entry found in the request queue");
     }
 
 
@@ -389,16 +649,32 @@ public:
      */
     void ResetValue(ClientAttentionType type, ClientAttentionGroup group, unsigned int id)
     {
-        for (auto& e : slots)
+        SlotShard *shard = find_shard(type, group);
+        bool found = false;
+        if (shard)
         {
-            if (e.type == type && e.group == group && e.id == id)
+            g_rw_lock_writer_lock(&shard->lock);
+            for (size_t i = 0; i < shard->active; i++)
             {
-                e.provided = false;
-                e.value = "";
-                return;
+                struct RequiresSlot& e = shard->slots[i];
+                if (e.id == id)
+                {
+                    found = true;
+                    if (e.provided)
+                    {
+                        shard->unresolved++;
+                    }
+                    e.provided = false;
+                    e.value.clear();
+                    break;
+                }
             }
+            g_rw_lock_writer_unlock(&shard->lock);
+        }
+        if (!found)
+        {
+            throw RequiresQueueException("No matching entry found in the request queue");
         }
-        throw RequiresQueueException("No matching entry found in the request queue");
     }
 
     /**
@@ -413,18 +689,36 @@ public:
      */
     std::string GetResponse(ClientAttentionType type, ClientAttentionGroup group, unsigned int id)
     {
-        for (auto& e : slots)
+        SlotShard *shard = find_shard(type, group);
+        bool found = false;
+        bool provided = false;
+        std::string value;
+        if (shard)
         {
-            if (e.type == type && e.group == group && e.id == id)
+            g_rw_lock_reader_lock(&shard->lock);
+            for (size_t i = 0; i < shard->active; i++)
             {
-                if (!e.provided)
+                struct RequiresSlot& e = shard->slots[i];
+                if (e.id == id)
                 {
-                    throw RequiresQueueException("Request never provided by front-end");
+                    found = true;
+                    provided = e.provided;
+                    value = e.value;
+                    break;
                 }
-                return e.value;
             }
+            g_rw_lock_reader_unlock(&shard->lock);
+        }
+
+        if (!found)
+        {
+            throw RequiresQueueException("No matching entry found in the request queue");
         }
-        throw RequiresQueueException("No matching entry found in the request queue");
+        if (!provided)
+        {
+            throw RequiresQueueException("Request never provided by front-end");
+        }
+        return value;
     }
 
     /**
@@ -439,18 +733,36 @@ public:
      */
     std::string GetResponse(ClientAttentionType type, ClientAttentionGroup group, std::string name)
     {
-        for (auto& e : slots)
+        SlotShard *shard = find_shard(type, group);
+        bool found = false;
+        bool provided = false;
+        std::string value;
+        if (shard)
         {
-            if (e.type == type && e.group == group && e.name == name)
+            g_rw_lock_reader_lock(&shard->lock);
+            for (size_t i = 0; i < shard->active; i++)
             {
-                if (!e.provided)
+                struct RequiresSlot& e = shard->slots[i];
+                if (e.name == name)
                 {
-                    throw RequiresQueueException("Request never provided by front-end");
+                    found = true;
+                    provided = e.provided;
+                    value = e.value;
+                    break;
                 }
-                return e.value;
             }
+            g_rw_lock_reader_unlock(&shard->lock);
         }
-        throw RequiresQueueException("No matching entry found in the request queue");
+
+        if (!found)
+        {
+            throw RequiresQueueException("No matching entry found in the request queue");
+        }
+        if (!provided)
+        {
+            throw RequiresQueueException("Request never provided by front-end");
+        }
+        return value;
     }
 
     /**
@@ -463,14 +775,14 @@ public:
      */
     unsigned int QueueCount(ClientAttentionType type, ClientAttentionGroup group)
     {
-        unsigned int ret = 0;
-        for (auto& e : slots)
+        SlotShard *shard = find_shard(type, group);
+        if (!shard)
         {
-            if (type == e.type && group == e.group)
-            {
-                ret++;
-            }
+            return 0;
         }
+        g_rw_lock_reader_lock(&shard->lock);
+        unsigned int ret = shard->active;
+        g_rw_lock_reader_unlock(&shard->lock);
         return ret;
     }
 
@@ -482,6 +794,9 @@ public:
      * IDs not satisfied.  Then in the end @QueueFetch() is used to get
      * details about a specific requirement
      *
+     * This only inspects the atomic unresolved counters, so no slot
+     * shard is locked at all.
+     *
      * @return Returns a std::vector<ClientAttTypeGroup>
      *         of type/groups not yet satisfied.
      */
@@ -489,30 +804,16 @@ public:
     {
         std::vector<ClientAttTypeGroup> ret;
 
-        for (auto& e : slots)
+        g_rw_lock_reader_lock(&shards_lock);
+        for (auto& s : shards)
         {
-            if (!e.provided)
+            if (s.second.unresolved.load() > 0)
             {
-                // Check if we've already spotted this type/group
-                bool found = false;
-                for (auto& r : ret)
-                {
-                    ClientAttentionType t;
-                    ClientAttentionGroup g;
-                    std::tie(t, g) = r;
-                    if (t == e.type && g == e.group)
-                    {
-                        // yes, we have
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found)
-                {
-                    ret.push_back(std::make_tuple(e.type, e.group));
-                }
+                ret.push_back(std::make_tuple(shard_type(s.first),
+                                              shard_group(s.first)));
             }
         }
+        g_rw_lock_reader_unlock(&shards_lock);
         return ret;
     }
 
@@ -562,15 +863,21 @@ public:
     std::vector<unsigned int> QueueCheck(ClientAttentionType type, ClientAttentionGroup group)
     {
         std::vector<unsigned int> ret;
-        for (auto& e : slots)
+        SlotShard *shard = find_shard(type, group);
+        if (!shard)
         {
-            if (type == e.type
-                && group == e.group
-                && !e.provided)
+            return ret;
+        }
+        g_rw_lock_reader_lock(&shard->lock);
+        for (size_t i = 0; i < shard->active; i++)
+        {
+            struct RequiresSlot& e = shard->slots[i];
+            if (!e.provided)
             {
                 ret.push_back(e.id);
             }
         }
+        g_rw_lock_reader_unlock(&shard->lock);
         return ret;
     }
 
@@ -615,20 +922,21 @@ public:
     }
 
     /**
-     * Counts all requires slots which have not received any user input
+     * Counts all requires slots which have not received any user input.
+     *
+     * Reads the atomic per-shard counters only; no slot shard is locked.
      *
      * @return Returns an unsigned integer of slots lacking user responses
      */
     unsigned int QueueCheckAll()
     {
         unsigned int ret = 0;
-        for (auto& e : slots)
+        g_rw_lock_reader_lock(&shards_lock);
+        for (auto& s : shards)
         {
-            if (!e.provided)
-            {
-                ret++;
-            }
+            ret += s.second.unresolved.load();
         }
+        g_rw_lock_reader_unlock(&shards_lock);
         return ret;
     }
 
@@ -654,7 +962,8 @@ public:
      */
     bool QueueDone(ClientAttentionType type, ClientAttentionGroup group)
     {
-        return QueueCheck(type, group).size() == 0;
+        SlotShard *shard = find_shard(type, group);
+        return (nullptr == shard) || (0 == shard->unresolved.load());
     }
 
     /**
@@ -677,7 +986,7 @@ public:
         gchar *value;
         g_variant_get(parameters, "(uuus)", &type, &group, &id, &value);
 
-        return QueueCheck((ClientAttentionType) type, (ClientAttentionGroup) group).size() == 0;
+        return QueueDone((ClientAttentionType) type, (ClientAttentionGroup) group);
     }
 
 #ifdef DEBUG_REQUIRESQUEUE
@@ -698,47 +1007,165 @@ public:
      */
     void _DumpQueue(std::ostream& logdst)
     {
-        for (auto& e : slots)
+        g_rw_lock_reader_lock(&shards_lock);
+        for (auto& s : shards)
         {
-        logdst << "          Id: " << e.id << std::endl
-               << "         Key: " << e.name << std::endl
-               << "        Type: [" << std::to_string((int) e.type) << "] "
-               << ClientAttentionType_str[(int)e.type] << std::endl
-               << "       Group: [" << std::to_string((int) e.group) << "] "
-               << ClientAttentionGroup_str[(int)e.group] << std::endl
-               << "       Value: " << e.value << std::endl
-               << " Description: " << e.user_description << std::endl
-               << "Hidden input: " << (e.hidden_input ? "True": "False")
-               << std::endl
-               << "    Provided: " << (e.provided ? "True": "False")
-               << std::endl
-               << "-----------------------------------------------------"
-               << std::endl;
+            SlotShard& shard = s.second;
+            g_rw_lock_reader_lock(&shard.lock);
+            for (size_t i = 0; i < shard.active; i++)
+            {
+            struct RequiresSlot& e = shard.slots[i];
+            logdst << "          Id: " << e.id << std::endl
+                   << "         Key: " << e.name << std::endl
+                   << "        Type: [" << std::to_string((int) e.type) << "] "
+                   << ClientAttentionType_str[(int)e.type] << std::endl
+                   << "       Group: [" << std::to_string((int) e.group) << "] "
+                   << ClientAttentionGroup_str[(int)e.group] << std::endl
+                   << "       Value: " << e.value << std::endl
+                   << " Description: " << e.user_description << std::endl
+                   << "Hidden input: " << (e.hidden_input ? "True": "False")
+                   << std::endl
+                   << "    Provided: " << (e.provided ? "True": "False")
+                   << std::endl
+                   << "-----------------------------------------------------"
+                   << std::endl;
+            }
+            g_rw_lock_reader_unlock(&shard.lock);
         }
+        g_rw_lock_reader_unlock(&shards_lock);
     }
 #endif
 
 private:
-    std::map<unsigned int, unsigned int> reqids;
-    std::vector<struct RequiresSlot> slots;
+    /**
+     *  Slot storage for a single ClientAttentionType/ClientAttentionGroup
+     *  pair.  Each shard carries its own reader-writer lock, so queue
+     *  scans in one type/group never block responses being provided to
+     *  another.  The unresolved counter is atomic, which lets the done
+     *  checks run without taking the slot lock at all.
+     */
+    struct SlotShard
+    {
+        SlotShard()
+            : next_id(0), active(0), unresolved(0)
+        {
+            g_rw_lock_init(&lock);
+        }
+
+        ~SlotShard()
+        {
+            g_rw_lock_clear(&lock);
+        }
+
+        SlotShard(const SlotShard&) = delete;
+        SlotShard& operator=(const SlotShard&) = delete;
+
+        GRWLock lock;
+        unsigned int next_id;
+        size_t active;       ///< Number of live slots; the rest of the
+                             ///< slots vector is the recycled arena
+        std::atomic<unsigned int> unresolved;
+        std::vector<struct RequiresSlot> slots;
+    };
+
+    GRWLock shards_lock;  ///< Protects the shard map structure itself
+    std::map<unsigned int, struct SlotShard> shards;
 
 
     /**
      * Simple index hashing to be used by a single dimensional integer
      * array/table.  This is used to have a unique single ID per type:group,
-     * used for a table keeping track of slot IDs used within each type:group.
+     * used as the shard key for the sharded slot storage.
      *
      * @param type   ClientAttentionType reference
      * @param group  ClientAttentionGroup reference
      *
      * @return  Returns a unique index based on the two input arguments
      */
-    unsigned int get_reqid_index(ClientAttentionType type, ClientAttentionGroup group)
+    static unsigned int get_reqid_index(ClientAttentionType type, ClientAttentionGroup group)
     {
         return ((unsigned int)type *100) + (unsigned int)group;
 
     }
 
+
+    /**
+     *  Reverses @get_reqid_index() back to the ClientAttentionType part
+     *
+     * @param index  Shard index as returned by @get_reqid_index()
+     *
+     * @return Returns the ClientAttentionType encoded in the index
+     */
+    static ClientAttentionType shard_type(unsigned int index)
+    {
+        return (ClientAttentionType) (index / 100);
+    }
+
+
+    /**
+     *  Reverses @get_reqid_index() back to the ClientAttentionGroup part
+     *
+     * @param index  Shard index as returned by @get_reqid_index()
+     *
+     * @return Returns the ClientAttentionGroup encoded in the index
+     */
+    static ClientAttentionGroup shard_group(unsigned int index)
+    {
+        return (ClientAttentionGroup) (index % 100);
+    }
+
+
+    /**
+     *  Looks up the shard for a type/group pair, creating it if this is
+     *  the first requirement of that pair.  References into the shard
+     *  map stay valid across insertions, so the returned reference can
+     *  be used after the map lock has been dropped.
+     *
+     * @param type   ClientAttentionType of the shard
+     * @param group  ClientAttentionGroup of the shard
+     *
+     * @return Returns a reference to the shard
+     */
+    SlotShard& get_shard(ClientAttentionType type, ClientAttentionGroup group)
+    {
+        unsigned int idx = get_reqid_index(type, group);
+
+        g_rw_lock_reader_lock(&shards_lock);
+        auto it = shards.find(idx);
+        if (it != shards.end())
+        {
+            g_rw_lock_reader_unlock(&shards_lock);
+            return it->second;
+        }
+        g_rw_lock_reader_unlock(&shards_lock);
+
+        g_rw_lock_writer_lock(&shards_lock);
+        SlotShard& shard = shards[idx];
+        g_rw_lock_writer_unlock(&shards_lock);
+        return shard;
+    }
+
+
+    /**
+     *  Looks up the shard for a type/group pair without creating it
+     *
+     * @param type   ClientAttentionType of the shard
+     * @param group  ClientAttentionGroup of the shard
+     *
+     * @return Returns a pointer to the shard, or nullptr if no
+     *         requirement of this type/group has ever been added
+     */
+    SlotShard * find_shard(ClientAttentionType type, ClientAttentionGroup group)
+    {
+        unsigned int idx = get_reqid_index(type, group);
+
+        g_rw_lock_reader_lock(&shards_lock);
+        auto it = shards.find(idx);
+        SlotShard *ret = (it != shards.end() ? &it->second : nullptr);
+        g_rw_lock_reader_unlock(&shards_lock);
+        return ret;
+    }
+
 };
 
 #endif // OPENVPN3_DBUS_REQUIRESQUEUE_HPP
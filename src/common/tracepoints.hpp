@@ -0,0 +1,63 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   tracepoints.hpp
+ *
+ * @brief  USDT static tracepoints (provider "openvpn3") used across
+ *         the session lifecycle and the log pipeline.  The probes are
+ *         compiled in when sys/sdt.h is available and cost a single
+ *         nop instruction while disarmed, so they can stay enabled in
+ *         production builds and be attached to with bpftrace, perf or
+ *         systemtap on live hosts.
+ *
+ *         Without sys/sdt.h at build time the macros expand to
+ *         nothing.
+ */
+
+#ifndef OPENVPN3_COMMON_TRACEPOINTS_HPP
+#define OPENVPN3_COMMON_TRACEPOINTS_HPP
+
+#include "config.h"
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define OPENVPN3_PROBE(probe) \
+    DTRACE_PROBE(openvpn3, probe)
+#define OPENVPN3_PROBE1(probe, arg1) \
+    DTRACE_PROBE1(openvpn3, probe, arg1)
+#define OPENVPN3_PROBE2(probe, arg1, arg2) \
+    DTRACE_PROBE2(openvpn3, probe, arg1, arg2)
+#define OPENVPN3_PROBE3(probe, arg1, arg2, arg3) \
+    DTRACE_PROBE3(openvpn3, probe, arg1, arg2, arg3)
+#define OPENVPN3_PROBE4(probe, arg1, arg2, arg3, arg4) \
+    DTRACE_PROBE4(openvpn3, probe, arg1, arg2, arg3, arg4)
+
+#else
+
+#define OPENVPN3_PROBE(probe)
+#define OPENVPN3_PROBE1(probe, arg1)
+#define OPENVPN3_PROBE2(probe, arg1, arg2)
+#define OPENVPN3_PROBE3(probe, arg1, arg2, arg3)
+#define OPENVPN3_PROBE4(probe, arg1, arg2, arg3, arg4)
+
+#endif  // HAVE_SYS_SDT_H
+
+#endif  // OPENVPN3_COMMON_TRACEPOINTS_HPP
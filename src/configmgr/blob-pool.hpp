@@ -0,0 +1,104 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2017 - 2018  OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2017 - 2018  David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   blob-pool.hpp
+ *
+ * @brief  Content-hash based deduplication of inline profile payloads.
+ *
+ *         Provisioned fleets typically import near-identical profiles
+ *         where the inlined CA bundles, certificates and tls-auth keys
+ *         are byte-for-byte the same and only the connection entries
+ *         differ.  This pool stores each distinct payload once;
+ *         configuration objects share it through reference counted
+ *         pointers, so a thousand profiles with the same CA bundle
+ *         carry a single copy between them.
+ */
+
+#ifndef OPENVPN3_DBUS_CONFIGMGR_BLOBPOOL_HPP
+#define OPENVPN3_DBUS_CONFIGMGR_BLOBPOOL_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ *  Process wide pool of deduplicated inline payload blobs.  Entries are
+ *  tracked with weak references only, so a blob is released as soon as
+ *  the last configuration object referencing it is removed.
+ */
+class InlineBlobPool
+{
+public:
+    /**
+     *  Interns a payload blob in the pool.  If an identical blob is
+     *  already pooled, a reference to the existing copy is returned
+     *  and no new storage is allocated.
+     *
+     * @param blob  The payload content to intern
+     *
+     * @return Returns a shared, immutable reference to the pooled blob
+     */
+    static std::shared_ptr<const std::string> Intern(const std::string& blob)
+    {
+        std::vector<std::weak_ptr<const std::string>>& bucket =
+            pool()[std::hash<std::string>()(blob)];
+
+        for (auto it = bucket.begin(); it != bucket.end();)
+        {
+            std::shared_ptr<const std::string> existing = it->lock();
+            if (!existing)
+            {
+                // The last profile referencing this blob is gone
+                it = bucket.erase(it);
+                continue;
+            }
+            if (*existing == blob)
+            {
+                return existing;
+            }
+            ++it;
+        }
+
+        std::shared_ptr<const std::string> stored =
+            std::make_shared<const std::string>(blob);
+        bucket.push_back(stored);
+        return stored;
+    }
+
+
+private:
+    /**
+     *  Provides the pool storage, keyed by the content hash.  Buckets
+     *  hold more than one entry only on a hash collision, where the
+     *  full content comparison in Intern() disambiguates.
+     *
+     * @return Returns a reference to the pool map
+     */
+    static std::map<size_t, std::vector<std::weak_ptr<const std::string>>>& pool()
+    {
+        static std::map<size_t, std::vector<std::weak_ptr<const std::string>>> blobs;
+        return blobs;
+    }
+};
+
+#endif // OPENVPN3_DBUS_CONFIGMGR_BLOBPOOL_HPP
@@ -20,12 +20,21 @@
 #ifndef OPENVPN3_DBUS_CONFIGMGR_HPP
 #define OPENVPN3_DBUS_CONFIGMGR_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <list>
 #include <map>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <ctime>
 
 #include <openvpn/log/logsimple.hpp>
 #include "common/core-extensions.hpp"
+#include "configmgr/blob-pool.hpp"
+#include "configmgr/profile-store.hpp"
+#include "configmgr/state-persistence.hpp"
 #include "dbus/core.hpp"
 #include "dbus/connection-creds.hpp"
 #include "dbus/exceptions.hpp"
@@ -35,6 +44,14 @@
 
 using namespace openvpn;
 
+/**
+ *  Maximum number of parsed configuration profiles kept resident in
+ *  memory at the same time.  The raw profile text is always available
+ *  through the memory-mapped ProfileTextStore; parsed option lists
+ *  beyond this limit are released and recreated on demand.
+ */
+#define OPENVPN3_CONFIGMGR_RESIDENT_PROFILES 32
+
 
 /**
  * Helper class to tackle signals sent by the configuration manager
@@ -270,6 +287,71 @@ private:
 };
 
 
+/**
+ *  Provides the parsing limits used when parsing a configuration
+ *  profile, both at import time and when re-parsing from the
+ *  profile text store
+ *
+ * @return Returns an OptionList::Limits object with the limits
+ */
+inline OptionList::Limits profile_parse_limits()
+{
+    return OptionList::Limits("profile is too large",
+                              ProfileParseLimits::MAX_PROFILE_SIZE,
+                              ProfileParseLimits::OPT_OVERHEAD,
+                              ProfileParseLimits::TERM_OVERHEAD,
+                              ProfileParseLimits::MAX_LINE_SIZE,
+                              ProfileParseLimits::MAX_DIRECTIVE_SIZE);
+}
+
+
+/**
+ *  Carries one profile from an ImportBulk call together with its parsed
+ *  option list.  Parsing is the dominant cost of an import and is pure
+ *  string processing, so the configuration manager runs Parse() for a
+ *  whole batch on a worker pool before any D-Bus objects are created;
+ *  the ConfigurationObject constructor then adopts the already parsed
+ *  option list.
+ */
+struct PreparsedProfile
+{
+    std::string name;              ///< User provided profile name
+    std::string profile;           ///< Raw profile text, plain or JSON
+    bool single_use = false;       ///< Remove profile after first use?
+    bool persistent = false;       ///< Persist profile across restarts?
+    OptionListJSON options;        ///< Parsed option list, filled by Parse()
+    std::string parse_error;       ///< Parse failure message, empty on success
+
+    /**
+     *  Parses the profile text into the option list.  Only this
+     *  object is touched, so batches can be parsed concurrently on
+     *  worker threads.  A parse failure is recorded in parse_error
+     *  instead of being thrown, which keeps the worker loop free of
+     *  exception plumbing.
+     */
+    void Parse()
+    {
+        try
+        {
+            if (optparser_profile_is_json(profile))
+            {
+                options.json_import(profile);
+            }
+            else
+            {
+                OptionList::Limits limits = profile_parse_limits();
+                options.parse_from_config(profile, &limits);
+                options.update_map();
+            }
+        }
+        catch (std::exception& excp)
+        {
+            parse_error = excp.what();
+        }
+    }
+};
+
+
 /**
  *  A ConfigurationObject contains information about a specific VPN
  *  configuration profile.  This object is then exposed on the D-Bus through
@@ -289,6 +371,10 @@ public:
      * @param dbuscon  D-Bus connection this object is tied to
      * @param remove_callback  Callback function which must be called when
      *                 destroying this configuration object.
+     * @param rename_callback  Callback function which must be called when
+     *                 the name of this configuration object changes, so
+     *                 the configuration manager can maintain its name
+     *                 based lookup index.
      * @param objpath  D-Bus object path of this object
      * @param default_log_level  Unsigned integer defining the initial log level
      * @param creator  An uid reference of the owner of this object.  This is
@@ -300,12 +386,14 @@ public:
      */
     ConfigurationObject(GDBusConnection *dbuscon,
                         std::function<void()> remove_callback,
+                        std::function<void(const std::string&, const std::string&)> rename_callback,
                         std::string objpath, unsigned int default_log_level,
                         uid_t creator, GVariant *params)
         : DBusObject(objpath),
           ConfigManagerSignals(dbuscon, objpath, default_log_level),
           DBusCredentials(dbuscon, creator),
           remove_callback(remove_callback),
+          rename_callback(rename_callback),
           name(""),
           import_tstamp(std::time(nullptr)),
           last_use_tstamp(0),
@@ -316,7 +404,8 @@ public:
           persistent(false),
           persist_tun(false),
           alias(nullptr),
-          properties(this)
+          properties(this),
+          options_parsed(false)
     {
         gchar *cfgstr;
         gchar *cfgname_c;
@@ -325,14 +414,32 @@ public:
                        &single_use, &persistent);
         name = std::string(cfgname_c);
 
-        // Parse the options from the imported configuration
-        OptionList::Limits limits("profile is too large",
-				  ProfileParseLimits::MAX_PROFILE_SIZE,
-				  ProfileParseLimits::OPT_OVERHEAD,
-				  ProfileParseLimits::TERM_OVERHEAD,
-				  ProfileParseLimits::MAX_LINE_SIZE,
-				  ProfileParseLimits::MAX_DIRECTIVE_SIZE);
-        options.parse_from_config(cfgstr, &limits);
+        // Parse the options from the imported configuration, to
+        // validate it and have it ready for the first Fetch.  JSON
+        // formatted profiles, as exported by FetchJSON, are detected
+        // by the leading '{' and fed through the streaming JSON
+        // importer, which avoids building an intermediate document
+        // tree for the whole profile.
+        if (optparser_profile_is_json(cfgstr))
+        {
+            options.json_import(cfgstr);
+        }
+        else
+        {
+            OptionList::Limits limits = profile_parse_limits();
+            options.parse_from_config(cfgstr, &limits);
+        }
+        options_parsed = true;
+
+        // Intern the inlined certificate/key payloads in the shared
+        // blob pool, and keep only the profile skeleton in the
+        // memory-mapped store; the parsed option list is recreated
+        // from skeleton plus pooled blobs whenever needed
+        dedup_inline_blobs();
+        std::string skeleton;
+        options.string_export(skeleton, false);
+        profile_text.Store(skeleton);
+        lru_touch(this);
 
         std::stringstream msg;
         msg << "Parsed "
@@ -347,53 +454,153 @@ public:
         //         contains files
         valid = true;
 
-        properties.AddBinding(new PropertyType<std::time_t>(this, "import_timestamp", "t", "read", false, &import_tstamp));
-        properties.AddBinding(new PropertyType<std::time_t>(this, "last_used_timestamp", "t", "read", false, &last_use_tstamp));
-        properties.AddBinding(new PropertyType<bool>(this, "locked_down", "b", "readwrite", false, &locked_down));
-        properties.AddBinding(new PropertyType<bool>(this, "persistent", "b", "read", false, &persistent));
-        properties.AddBinding(new PropertyType<bool>(this, "persist_tun", "b", "readwrite", true, &persist_tun));
-        properties.AddBinding(new PropertyType<bool>(this, "readonly", "b", "read", false, &readonly));
-        properties.AddBinding(new PropertyType<bool>(this, "single_use", "b", "read", false, &single_use));
-        properties.AddBinding(new PropertyType<unsigned int>(this, "used_count", "u", "read", false, &used_count));
-        properties.AddBinding(new PropertyType<bool>(this, "valid", "b", "read", false, &valid));
-
-        std::string introsp_xml ="<node name='" + objpath + "'>"
-            "    <interface name='net.openvpn.v3.configuration'>"
-            "        <method name='Fetch'>"
-            "            <arg direction='out' type='s' name='config'/>"
-            "        </method>"
-            "        <method name='FetchJSON'>"
-            "            <arg direction='out' type='s' name='config_json'/>"
-            "        </method>"
-            "        <method name='SetOption'>"
-            "            <arg direction='in' type='s' name='option'/>"
-            "            <arg direction='in' type='s' name='value'/>"
-            "        </method>"
-            "        <method name='AccessGrant'>"
-            "            <arg direction='in' type='u' name='uid'/>"
-            "        </method>"
-            "        <method name='AccessRevoke'>"
-            "            <arg direction='in' type='u' name='uid'/>"
-            "        </method>"
-            "        <method name='Seal'/>"
-            "        <method name='Remove'/>"
-            "        <property type='u' name='owner' access='read'/>"
-            "        <property type='au' name='acl' access='read'/>"
-            "        <property type='s' name='name' access='readwrite'/>"
-            "        <property type='b' name='public_access' access='readwrite'/>"
-            "        <property type='s' name='alias' access='readwrite'/>"
-            + properties.GetIntrospectionXML() +
-            "    </interface>"
-            "</node>";
-        ParseIntrospectionXML(introsp_xml);
+        initialize_properties(objpath);
 
         g_free(cfgname_c);
         g_free(cfgstr);
     }
 
 
+    /**
+     *  Constructor creating a new ConfigurationObject from a profile
+     *  which has already been parsed, typically by the ImportBulk
+     *  worker pool.  The parsed option list is adopted from the
+     *  provided PreparsedProfile, so only the cheap object setup runs
+     *  on the main loop thread.
+     *
+     * @param dbuscon  D-Bus connection this object is tied to
+     * @param remove_callback  Callback function which must be called when
+     *                 destroying this configuration object.
+     * @param rename_callback  Callback function which must be called when
+     *                 the name of this configuration object changes, so
+     *                 the configuration manager can maintain its name
+     *                 based lookup index.
+     * @param objpath  D-Bus object path of this object
+     * @param default_log_level  Unsigned integer defining the initial log level
+     * @param creator  An uid reference of the owner of this object.  This is
+     *                 typically the uid of the front-end user importing this
+     *                 VPN configuration profile.
+     * @param preparsed  PreparsedProfile carrying the profile meta data
+     *                 and the parsed option list.  The option list is
+     *                 moved out of the PreparsedProfile.
+     */
+    ConfigurationObject(GDBusConnection *dbuscon,
+                        std::function<void()> remove_callback,
+                        std::function<void(const std::string&, const std::string&)> rename_callback,
+                        std::string objpath, unsigned int default_log_level,
+                        uid_t creator, PreparsedProfile& preparsed)
+        : DBusObject(objpath),
+          ConfigManagerSignals(dbuscon, objpath, default_log_level),
+          DBusCredentials(dbuscon, creator),
+          remove_callback(remove_callback),
+          rename_callback(rename_callback),
+          name(preparsed.name),
+          import_tstamp(std::time(nullptr)),
+          last_use_tstamp(0),
+          used_count(0),
+          valid(false),
+          readonly(false),
+          single_use(preparsed.single_use),
+          persistent(preparsed.persistent),
+          persist_tun(false),
+          alias(nullptr),
+          properties(this),
+          options_parsed(false)
+    {
+        // Adopt the option list parsed by the worker pool.  The swap
+        // only exchanges the option vectors, so the lookup map must
+        // be rebuilt afterwards.
+        options.swap(preparsed.options);
+        options.update_map();
+        options_parsed = true;
+
+        dedup_inline_blobs();
+        std::string skeleton;
+        options.string_export(skeleton, false);
+        profile_text.Store(skeleton);
+        lru_touch(this);
+
+        std::stringstream msg;
+        msg << "Parsed "
+            << (persistent ? "persistent" : "")
+            << (persistent && single_use ? ", " : "")
+            << (single_use ? "single-use" : "")
+            << " configuration '" << name << "'"
+            << ", owner: " << lookup_username(creator);
+        LogInfo(msg.str());
+
+        valid = true;
+
+        initialize_properties(objpath);
+    }
+
+
+    /**
+     *  Constructor restoring a persistent ConfigurationObject from its
+     *  serialized state, as written by the write-behind state
+     *  persistence layer.  Used by the configuration manager at
+     *  startup.
+     *
+     * @param dbuscon  D-Bus connection this object is tied to
+     * @param remove_callback  Callback function which must be called when
+     *                 destroying this configuration object.
+     * @param rename_callback  Callback function which must be called when
+     *                 the name of this configuration object changes, so
+     *                 the configuration manager can maintain its name
+     *                 based lookup index.
+     * @param objpath  D-Bus object path of this object
+     * @param default_log_level  Unsigned integer defining the initial log level
+     * @param state    Json::Value with the profile state, as produced
+     *                 by SerializeState()
+     */
+    ConfigurationObject(GDBusConnection *dbuscon,
+                        std::function<void()> remove_callback,
+                        std::function<void(const std::string&, const std::string&)> rename_callback,
+                        std::string objpath, unsigned int default_log_level,
+                        const Json::Value& state)
+        : DBusObject(objpath),
+          ConfigManagerSignals(dbuscon, objpath, default_log_level),
+          DBusCredentials(dbuscon, (uid_t) state["owner"].asUInt()),
+          remove_callback(remove_callback),
+          rename_callback(rename_callback),
+          name(state["name"].asString()),
+          import_tstamp((std::time_t) state["import_timestamp"].asLargestUInt()),
+          last_use_tstamp((std::time_t) state["last_used_timestamp"].asLargestUInt()),
+          used_count(state["used_count"].asUInt()),
+          valid(false),
+          readonly(state["readonly"].asBool()),
+          single_use(state["single_use"].asBool()),
+          persistent(true),
+          locked_down(state["locked_down"].asBool()),
+          persist_tun(state["persist_tun"].asBool()),
+          alias(nullptr),
+          properties(this),
+          options_parsed(false)
+    {
+        // The profile body is stored as-is and parsed lazily on the
+        // first use (Fetch, SetOption, ...).  Restoring thousands of
+        // profiles at service start then costs one text store per
+        // profile instead of one full option parse each.
+        profile_text.Store(state["profile"].asString());
+
+        // Restore the access control state
+        SetPublicAccess(state["public_access"].asBool());
+        for (const auto& uid : state["acl"])
+        {
+            GrantAccess((uid_t) uid.asUInt());
+        }
+
+        valid = true;
+        initialize_properties(objpath);
+
+        LogVerb1("Restored persistent configuration '" + name
+                 + "', owner: " + lookup_username(GetOwnerUID()));
+    }
+
+
     ~ConfigurationObject()
     {
+        lru_remove(this);
         remove_callback();
         Debug("Configuration removed");
         IdleCheck_RefDec();
@@ -438,9 +645,15 @@ public:
                     // process (root user) or the configuration profile owner
                     CheckOwnerAccess(sender, true);
                 }
+                ensure_options_parsed();
+
+                // Use the streaming exporter; one allocation for the
+                // whole rendered profile
+                std::string cfgbuf;
+                options.string_export(cfgbuf);
                 g_dbus_method_invocation_return_value(invoc,
                                                       g_variant_new("(s)",
-                                                                    options.string_export().c_str()));
+                                                                    cfgbuf.c_str()));
 
                 // If the fetching user is root, we consider this
                 // configuration to be "used"
@@ -457,6 +670,7 @@ public:
                     }
                     used_count++;
                     last_use_tstamp = std::time(nullptr);
+                    state_dirty();
                 }
                 return;
             }
@@ -480,6 +694,7 @@ public:
                     // read-operations to the configuration profile owner
                     CheckOwnerAccess(sender);
                 }
+                ensure_options_parsed();
                 g_dbus_method_invocation_return_value(invoc,
                                                       g_variant_new("(s)",
                                                                     options.json_export().c_str()));
@@ -537,6 +752,7 @@ public:
                 uid_t uid = -1;
                 g_variant_get(params, "(u)", &uid);
                 GrantAccess(uid);
+                state_dirty();
                 g_dbus_method_invocation_return_value(invoc, NULL);
 
                 LogInfo("Access granted to UID " + std::to_string(uid)
@@ -566,6 +782,7 @@ public:
                 uid_t uid = -1;
                 g_variant_get(params, "(u)", &uid);
                 RevokeAccess(uid);
+                state_dirty();
                 g_dbus_method_invocation_return_value(invoc, NULL);
 
                 LogInfo("Access revoked for UID " + std::to_string(uid)
@@ -586,6 +803,7 @@ public:
 
                 if (valid) {
                     readonly = true;
+                    state_dirty();
                     g_dbus_method_invocation_return_value(invoc, NULL);
                 }
                 else
@@ -749,6 +967,7 @@ public:
             GVariantBuilder * ret = NULL;
             if (("alias" == property_name) && conn)
             {
+                std::string oldalias = GetAliasName();
                 if (nullptr != alias)
                 {
                     alias->RemoveObject(conn);
@@ -764,12 +983,21 @@ public:
                                                     GetObjectPath(),
                                                     GetLogLevel());
                     alias->RegisterObject(conn);
+                    if (alias_callback)
+                    {
+                        alias_callback(oldalias, alias->GetAlias());
+                    }
                     ret = build_set_property_response(property_name, alias->GetAlias());
                 }
                 catch (DBusException& err)
                 {
                     delete alias;
                     alias = nullptr;
+                    if (alias_callback)
+                    {
+                        // The old alias object is gone at this point
+                        alias_callback(oldalias, "");
+                    }
                     throw DBusPropertyException(G_IO_ERROR, G_IO_ERROR_EXISTS,
                                                 obj_path, intf_name, property_name,
                                                 err.getRawError().c_str());
@@ -778,12 +1006,16 @@ public:
             else if (("name" == property_name) && conn)
             {
                 gsize len = 0;
+                std::string oldname = name;
                 name = std::string(g_variant_get_string(value, &len));
+                rename_callback(oldname, name);
+                state_dirty();
                 ret = build_set_property_response(property_name, name);
             }
             else if (("locked_down" == property_name) && conn)
             {
                 ret = properties.SetValue(property_name, value);
+                state_dirty();
                 LogInfo("Configuration lock-down flag set to "
                          + (locked_down ? std::string("true") : std::string("false"))
                          + " by UID " + std::to_string(GetUID(sender)));
@@ -792,6 +1024,7 @@ public:
             {
                 bool acl_public = g_variant_get_boolean(value);
                 SetPublicAccess(acl_public);
+                state_dirty();
                 ret = build_set_property_response(property_name, acl_public);
                 LogInfo("Public access set to "
                          + (acl_public ? std::string("true") : std::string("false"))
@@ -800,6 +1033,7 @@ public:
             else if (conn && properties.Exists(property_name))
             {
                 ret = properties.SetValue(property_name, value);
+                state_dirty();
             }
             else
             {
@@ -820,8 +1054,135 @@ public:
     };
 
 
+    /**
+     *  Returns the name of this configuration profile
+     *
+     * @return Returns a std::string with the profile name
+     */
+    std::string GetConfigName()
+    {
+        return name;
+    }
+
+
+    /**
+     *  Indicates if this configuration profile is marked persistent
+     *  and thus kept by the state persistence layer
+     *
+     * @return Returns true if the profile is persistent
+     */
+    bool IsPersistent()
+    {
+        return persistent;
+    }
+
+
+    /**
+     *  Returns the alias name assigned to this configuration profile
+     *
+     * @return Returns a std::string with the alias name, or an empty
+     *         string if no alias is set
+     */
+    std::string GetAliasName()
+    {
+        return (alias ? std::string(alias->GetAlias()) : "");
+    }
+
+
+    /**
+     *  Registers a callback which is invoked each time the alias of
+     *  this configuration profile changes, so the configuration
+     *  manager can maintain its alias lookup index.  The callback
+     *  receives the old and the new alias name; an empty string means
+     *  no alias.
+     *
+     * @param cb  Callback function receiving (old alias, new alias)
+     */
+    void SetAliasCallback(std::function<void(const std::string&,
+                                             const std::string&)> cb)
+    {
+        alias_callback = cb;
+    }
+
+
+    /**
+     *  Attaches this configuration object to the write-behind state
+     *  persistence layer.  Only persistent profiles are ever written;
+     *  for other profiles the persistence pointer is simply ignored.
+     *
+     * @param statepers  Pointer to the ConfigStatePersistence object
+     *                   owned by the configuration manager service
+     * @param mark       If true (default), the profile is marked dirty
+     *                   right away so a newly imported profile gets
+     *                   its initial state write.  Profiles restored
+     *                   from disk pass false.
+     */
+    void SetStatePersistence(ConfigStatePersistence *statepers,
+                             bool mark = true)
+    {
+        state_persistence = statepers;
+        if (mark)
+        {
+            state_dirty();
+        }
+    }
+
+
+    /**
+     *  Serializes the complete state of this configuration profile -
+     *  metadata, access control list and the profile itself - into a
+     *  JSON formatted string.  This is the format consumed by the
+     *  restoring constructor.
+     *
+     * @return Returns a std::string with the JSON formatted state
+     */
+    std::string SerializeState()
+    {
+        Json::Value state;
+        state["name"] = name;
+        state["owner"] = (Json::UInt) GetOwnerUID();
+        state["public_access"] = GetPublicAccessState();
+        state["readonly"] = readonly;
+        state["single_use"] = single_use;
+        state["locked_down"] = locked_down;
+        state["persist_tun"] = persist_tun;
+        state["used_count"] = used_count;
+        state["import_timestamp"] = (Json::UInt64) import_tstamp;
+        state["last_used_timestamp"] = (Json::UInt64) last_use_tstamp;
+        state["acl"] = Json::Value(Json::arrayValue);
+        for (const auto& uid : GetAccessListVector())
+        {
+            state["acl"].append((Json::UInt) uid);
+        }
+
+        std::string profile;
+        if (options_parsed)
+        {
+            options.string_export(profile);
+        }
+        else
+        {
+            // The profile body was never parsed since it was
+            // restored; reuse the stored text instead of forcing a
+            // full option parse just to re-export it
+            profile = profile_text.Retrieve();
+            for (const auto& blob : inline_blobs)
+            {
+                optparser_appendline(profile, blob.first, *blob.second);
+            }
+        }
+        state["profile"] = profile;
+
+        std::stringstream out;
+        out << state;
+        return out.str();
+    }
+
+
 private:
     std::function<void()> remove_callback;
+    std::function<void(const std::string&, const std::string&)> rename_callback;
+    std::function<void(const std::string&, const std::string&)> alias_callback;
     std::string name;
     std::time_t import_tstamp;
     std::time_t last_use_tstamp;
@@ -835,6 +1196,177 @@ private:
     ConfigurationAlias *alias;
     PropertyCollection properties;
     OptionListJSON options;
+    ProfileTextStore profile_text;
+    std::vector<std::pair<std::string,
+                          std::shared_ptr<const std::string>>> inline_blobs;
+    bool options_parsed;
+    ConfigStatePersistence *state_persistence = nullptr;
+
+
+    /**
+     *  Declares the D-Bus property bindings and parses the
+     *  introspection document of this configuration object.  Shared
+     *  by the importing and the restoring constructor.
+     *
+     * @param objpath  D-Bus object path of this object
+     */
+    void initialize_properties(const std::string& objpath)
+    {
+        properties.AddBinding(new PropertyType<std::time_t>(this, "import_timestamp", "t", "read", false, &import_tstamp));
+        properties.AddBinding(new PropertyType<std::time_t>(this, "last_used_timestamp", "t", "read", false, &last_use_tstamp));
+        properties.AddBinding(new PropertyType<bool>(this, "locked_down", "b", "readwrite", false, &locked_down));
+        properties.AddBinding(new PropertyType<bool>(this, "persistent", "b", "read", false, &persistent));
+        properties.AddBinding(new PropertyType<bool>(this, "persist_tun", "b", "readwrite", true, &persist_tun));
+        properties.AddBinding(new PropertyType<bool>(this, "readonly", "b", "read", false, &readonly));
+        properties.AddBinding(new PropertyType<bool>(this, "single_use", "b", "read", false, &single_use));
+        properties.AddBinding(new PropertyType<unsigned int>(this, "used_count", "u", "read", false, &used_count));
+        properties.AddBinding(new PropertyType<bool>(this, "valid", "b", "read", false, &valid));
+
+        std::string introsp_xml ="<node name='" + objpath + "'>"
+            "    <interface name='net.openvpn.v3.configuration'>"
+            "        <method name='Fetch'>"
+            "            <arg direction='out' type='s' name='config'/>"
+            "        </method>"
+            "        <method name='FetchJSON'>"
+            "            <arg direction='out' type='s' name='config_json'/>"
+            "        </method>"
+            "        <method name='SetOption'>"
+            "            <arg direction='in' type='s' name='option'/>"
+            "            <arg direction='in' type='s' name='value'/>"
+            "        </method>"
+            "        <method name='AccessGrant'>"
+            "            <arg direction='in' type='u' name='uid'/>"
+            "        </method>"
+            "        <method name='AccessRevoke'>"
+            "            <arg direction='in' type='u' name='uid'/>"
+            "        </method>"
+            "        <method name='Seal'/>"
+            "        <method name='Remove'/>"
+            "        <property type='u' name='owner' access='read'/>"
+            "        <property type='au' name='acl' access='read'/>"
+            "        <property type='s' name='name' access='readwrite'/>"
+            "        <property type='b' name='public_access' access='readwrite'/>"
+            "        <property type='s' name='alias' access='readwrite'/>"
+            + properties.GetIntrospectionXML() +
+            "    </interface>"
+            "</node>";
+        ParseIntrospectionXML(introsp_xml);
+    }
+
+
+    /**
+     *  Marks this profile dirty in the state persistence layer, if
+     *  this is a persistent profile and persistence is enabled.  The
+     *  actual disk write happens in the batched background flush.
+     */
+    void state_dirty()
+    {
+        if (state_persistence && persistent)
+        {
+            state_persistence->MarkDirty(GetObjectPath());
+        }
+    }
+
+
+    /**
+     *  Extracts the inlined file payloads (certificates, keys) from
+     *  the parsed option list and interns them in the process wide
+     *  InlineBlobPool.  Identical payloads across imported profiles
+     *  are stored only once; this object keeps reference counted
+     *  pointers to its share of the pool.
+     */
+    void dedup_inline_blobs()
+    {
+        inline_blobs.clear();
+        for (const auto& element : options)
+        {
+            if (element.size() > 1 && optparser_inline_file(element.ref(0)))
+            {
+                inline_blobs.push_back(
+                    std::make_pair(element.ref(0),
+                                   InlineBlobPool::Intern(element.ref(1))));
+            }
+        }
+    }
+
+
+    /**
+     *  Makes sure the parsed option list is available, re-parsing it
+     *  from the memory-mapped profile skeleton plus the pooled inline
+     *  payloads if it has been released by the LRU eviction.  Also
+     *  marks this profile as the most recently used one.
+     */
+    void ensure_options_parsed()
+    {
+        if (!options_parsed)
+        {
+            std::string cfgtext = profile_text.Retrieve();
+            for (const auto& blob : inline_blobs)
+            {
+                optparser_appendline(cfgtext, blob.first, *blob.second);
+            }
+            OptionList::Limits limits = profile_parse_limits();
+            options.parse_from_config(cfgtext, &limits);
+            options_parsed = true;
+        }
+        lru_touch(this);
+    }
+
+
+    /**
+     *  Releases the parsed option list of this profile.  The raw
+     *  profile text stays available in the memory-mapped store.
+     */
+    void release_options()
+    {
+        options = OptionListJSON();
+        options_parsed = false;
+    }
+
+
+    /**
+     *  Provides the list of configuration objects with a resident
+     *  parsed option list, ordered from least to most recently used
+     *
+     * @return Returns a reference to the LRU tracking list
+     */
+    static std::list<ConfigurationObject *>& lru_list()
+    {
+        static std::list<ConfigurationObject *> lru;
+        return lru;
+    }
+
+
+    /**
+     *  Marks a configuration object as most recently used and evicts
+     *  the parsed option lists of the least recently used profiles
+     *  when more than OPENVPN3_CONFIGMGR_RESIDENT_PROFILES are resident
+     *
+     * @param cfgobj  The ConfigurationObject just accessed
+     */
+    static void lru_touch(ConfigurationObject *cfgobj)
+    {
+        std::list<ConfigurationObject *>& lru = lru_list();
+        lru.remove(cfgobj);
+        lru.push_back(cfgobj);
+        while (lru.size() > OPENVPN3_CONFIGMGR_RESIDENT_PROFILES)
+        {
+            ConfigurationObject *evict = lru.front();
+            lru.pop_front();
+            evict->release_options();
+        }
+    }
+
+
+    /**
+     *  Removes a configuration object from the LRU tracking list
+     *
+     * @param cfgobj  The ConfigurationObject being destroyed
+     */
+    static void lru_remove(ConfigurationObject *cfgobj)
+    {
+        lru_list().remove(cfgobj);
+    }
 };
 
 
@@ -852,7 +1384,7 @@ private:
  */
 class ConfigManagerObject : public DBusObject,
                             public ConfigManagerSignals,
-                            public RC<thread_safe_refcount>
+                            public RC<mainloop_refcount>
 {
 public:
     typedef  RCPtr<ConfigManagerObject> Ptr;
@@ -885,7 +1417,20 @@ public:
                           << "        <method name='FetchAvailableConfigs'>"
                           << "          <arg type='ao' name='paths' direction='out'/>"
                           << "        </method>"
+                          << "        <method name='ImportBulk'>"
+                          << "          <arg type='a(ssbb)' name='profiles' direction='in'/>"
+                          << "          <arg type='ao' name='config_paths' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='LookupConfigName'>"
+                          << "          <arg type='s' name='config_name' direction='in'/>"
+                          << "          <arg type='ao' name='config_paths' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='LookupAlias'>"
+                          << "          <arg type='s' name='alias' direction='in'/>"
+                          << "          <arg type='ao' name='config_paths' direction='out'/>"
+                          << "        </method>"
                           << GetLogIntrospection()
+                          << "        <property name='generation' type='u' access='read'/>"
                           << "    </interface>"
                           << "</node>";
         ParseIntrospectionXML(introspection_xml);
@@ -911,6 +1456,141 @@ public:
     }
 
 
+    /**
+     *  Number of configuration objects currently managed by this
+     *  service.  Published via the debug memory object's
+     *  object_counts property.
+     *
+     * @return Returns the number of registered configuration objects
+     */
+    std::uint64_t GetConfigObjectCount()
+    {
+        return config_objects.size();
+    }
+
+
+    /**
+     *  Enables write-behind state persistence for persistent
+     *  configuration profiles.  Profiles already found in the state
+     *  directory from a previous run are restored and registered on
+     *  the D-Bus right away.
+     *
+     * @param statepers  Pointer to the ConfigStatePersistence object,
+     *                   owned by the configuration manager service
+     * @param conn       D-Bus connection to register restored
+     *                   configuration objects on
+     */
+    void EnableStatePersistence(ConfigStatePersistence *statepers,
+                                GDBusConnection *conn)
+    {
+        state_persistence = statepers;
+        state_persistence->SetSerializer(
+            [self=Ptr(this)](const std::string& cfgpath) -> std::string
+            {
+                auto cfgobj = self->config_objects.find(cfgpath);
+                if (self->config_objects.end() == cfgobj)
+                {
+                    return "";
+                }
+                return cfgobj->second->SerializeState();
+            });
+        state_persistence->SetErrorLogger(
+            [self=Ptr(this)](const std::string& msg)
+            {
+                self->LogError("State persistence: " + msg);
+            });
+        state_persistence->SetSnapshotSource(
+            [self=Ptr(this)]()
+            {
+                std::map<std::string, std::string> states;
+                for (auto& item : self->config_objects)
+                {
+                    if (item.second->IsPersistent())
+                    {
+                        states[item.first] = item.second->SerializeState();
+                    }
+                }
+                return states;
+            });
+
+        // Restore from the single snapshot file when it is current;
+        // per-file loading remains the fallback for a stale or
+        // missing snapshot
+        std::map<std::string, std::string> states =
+                state_persistence->LoadSnapshot();
+        bool from_snapshot = !states.empty();
+        if (!from_snapshot)
+        {
+            states = state_persistence->LoadAll();
+        }
+
+        unsigned int restored = 0;
+        for (const auto& entry : states)
+        {
+            Json::Value state;
+            Json::Reader reader;
+            if (!reader.parse(entry.second, state))
+            {
+                LogError("Skipping corrupt state file for profile '"
+                         + entry.first + "'");
+                continue;
+            }
+
+            std::string cfgpath = OpenVPN3DBus_rootp_configuration
+                                  + "/" + entry.first;
+            try
+            {
+                auto *cfgobj = new ConfigurationObject(dbuscon,
+                                                       [self=Ptr(this), cfgpath]()
+                                                       {
+                                                           self->remove_config_object(cfgpath);
+                                                       },
+                                                       [self=Ptr(this), cfgpath](const std::string& oldname,
+                                                                                 const std::string& newname)
+                                                       {
+                                                           self->rename_config_object(cfgpath, oldname, newname);
+                                                       },
+                                                       cfgpath,
+                                                       GetLogLevel(),
+                                                       state);
+                cfgobj->SetAliasCallback([self=Ptr(this), cfgpath](const std::string& oldalias,
+                                                                   const std::string& newalias)
+                                         {
+                                             self->update_alias_index(cfgpath, oldalias, newalias);
+                                         });
+                cfgobj->SetStatePersistence(state_persistence, false);
+                IdleCheck_RefInc();
+                cfgobj->IdleCheck_Register(IdleCheck_Get());
+                cfgobj->RegisterObject(conn);
+                config_objects[cfgpath] = cfgobj;
+                name_index.insert(std::make_pair(cfgobj->GetConfigName(),
+                                                 cfgpath));
+                owner_index.insert(std::make_pair(cfgobj->GetOwnerUID(),
+                                                  cfgpath));
+                restored++;
+            }
+            catch (std::exception& excp)
+            {
+                LogError("Failed restoring configuration profile '"
+                         + entry.first + "': " + std::string(excp.what()));
+            }
+        }
+        if (restored > 0)
+        {
+            generation++;
+            LogInfo("Restored " + std::to_string(restored)
+                    + " persistent configuration profiles"
+                    + (from_snapshot ? " from snapshot" : ""));
+        }
+        if (!from_snapshot)
+        {
+            // Write a fresh snapshot covering the per-file restore,
+            // so the next restart takes the fast path
+            state_persistence->ScheduleSnapshot();
+        }
+    }
+
+
     /**
      *  Callback method called each time a method in the
      *  ConfigurationManagerObject is called over the D-Bus.
@@ -944,20 +1624,171 @@ public:
                                                    {
                                                        self->remove_config_object(cfgpath);
                                                    },
+                                                   [self=Ptr(this), cfgpath](const std::string& oldname,
+                                                                             const std::string& newname)
+                                                   {
+                                                       self->rename_config_object(cfgpath, oldname, newname);
+                                                   },
                                                    cfgpath,
                                                    GetLogLevel(),
                                                    creds.GetUID(sender),
                                                    params);
+            cfgobj->SetAliasCallback([self=Ptr(this), cfgpath](const std::string& oldalias,
+                                                               const std::string& newalias)
+                                     {
+                                         self->update_alias_index(cfgpath, oldalias, newalias);
+                                     });
+            if (state_persistence)
+            {
+                cfgobj->SetStatePersistence(state_persistence);
+            }
             IdleCheck_RefInc();
             cfgobj->IdleCheck_Register(IdleCheck_Get());
             cfgobj->RegisterObject(conn);
             config_objects[cfgpath] = cfgobj;
 
+            // Maintain the secondary lookup indexes
+            name_index.insert(std::make_pair(cfgobj->GetConfigName(), cfgpath));
+            owner_index.insert(std::make_pair(creds.GetUID(sender), cfgpath));
+            generation++;
+
             Debug(std::string("ConfigurationObject registered on '")
                          + intf_name + "': " + cfgpath
                          + " (owner uid " + std::to_string(creds.GetUID(sender)) + ")");
             g_dbus_method_invocation_return_value(invoc, g_variant_new("(o)", cfgpath.c_str()));
         }
+        else if ("ImportBulk" == method_name)
+        {
+            // Import an array of configuration profiles with a single
+            // D-Bus call.  Compared to one Import call per profile this
+            // saves one bus round trip, one ACL setup and one log event
+            // per profile; only a single summary log event is emitted.
+            GVariantIter *profiles = NULL;
+            g_variant_get(params, "(a(ssbb))", &profiles);
+
+            uid_t importer = creds.GetUID(sender);
+
+            // Unpack the whole batch first, then parse the profiles on
+            // a worker pool.  Parsing dominates the import cost (large
+            // profiles carry several inlined certificate payloads) and
+            // only touches the PreparsedProfile itself, so it can run
+            // off the main loop.  Object creation and D-Bus
+            // registration happen afterwards on this thread.
+            std::vector<PreparsedProfile> batch;
+            gchar *cfgname_c = NULL;
+            gchar *cfgstr_c = NULL;
+            gboolean prf_single_use = false;
+            gboolean prf_persistent = false;
+            while (g_variant_iter_next(profiles, "(ssbb)",
+                                       &cfgname_c, &cfgstr_c,
+                                       &prf_single_use, &prf_persistent))
+            {
+                PreparsedProfile prf;
+                prf.name = std::string(cfgname_c);
+                prf.profile = std::string(cfgstr_c);
+                prf.single_use = prf_single_use;
+                prf.persistent = prf_persistent;
+                batch.push_back(std::move(prf));
+                g_free(cfgname_c);
+                g_free(cfgstr_c);
+            }
+            g_variant_iter_free(profiles);
+
+            // One worker per profile, capped by the core count.  A
+            // batch of one is parsed inline without spawning threads.
+            size_t workers = std::min(batch.size(),
+                                      (size_t) std::thread::hardware_concurrency());
+            if (workers > 1)
+            {
+                std::atomic<size_t> next_job(0);
+                std::vector<std::thread> pool;
+                for (size_t i = 0; i < workers; i++)
+                {
+                    pool.push_back(std::thread([&batch, &next_job]()
+                        {
+                            for (size_t job = next_job.fetch_add(1);
+                                 job < batch.size();
+                                 job = next_job.fetch_add(1))
+                            {
+                                batch[job].Parse();
+                            }
+                        }));
+                }
+                for (auto& worker : pool)
+                {
+                    worker.join();
+                }
+            }
+            else
+            {
+                for (auto& prf : batch)
+                {
+                    prf.Parse();
+                }
+            }
+
+            GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("ao"));
+            unsigned int count = 0;
+
+            for (auto& prf : batch)
+            {
+                if (!prf.parse_error.empty())
+                {
+                    // A broken profile does not abort the rest of the
+                    // batch; it is logged and left out of the returned
+                    // object paths, mirroring the persistent profile
+                    // restore at service startup
+                    LogError("Failed importing configuration profile '"
+                             + prf.name + "': " + prf.parse_error);
+                    continue;
+                }
+                std::string cfgpath = generate_path_uuid(OpenVPN3DBus_rootp_configuration, 'x');
+                auto *cfgobj = new ConfigurationObject(dbuscon,
+                                                       [self=Ptr(this), cfgpath]()
+                                                       {
+                                                           self->remove_config_object(cfgpath);
+                                                       },
+                                                       [self=Ptr(this), cfgpath](const std::string& oldname,
+                                                                                 const std::string& newname)
+                                                       {
+                                                           self->rename_config_object(cfgpath, oldname, newname);
+                                                       },
+                                                       cfgpath,
+                                                       GetLogLevel(),
+                                                       importer,
+                                                       prf);
+                cfgobj->SetAliasCallback([self=Ptr(this), cfgpath](const std::string& oldalias,
+                                                                   const std::string& newalias)
+                                         {
+                                             self->update_alias_index(cfgpath, oldalias, newalias);
+                                         });
+                if (state_persistence)
+                {
+                    cfgobj->SetStatePersistence(state_persistence);
+                }
+                IdleCheck_RefInc();
+                cfgobj->IdleCheck_Register(IdleCheck_Get());
+                cfgobj->RegisterObject(conn);
+                config_objects[cfgpath] = cfgobj;
+                name_index.insert(std::make_pair(cfgobj->GetConfigName(), cfgpath));
+                owner_index.insert(std::make_pair(importer, cfgpath));
+
+                g_variant_builder_add(bld, "o", cfgpath.c_str());
+                count++;
+            }
+            generation++;
+
+            LogInfo("Bulk imported " + std::to_string(count)
+                    + " configuration profiles (owner uid "
+                    + std::to_string(importer) + ")");
+
+            GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+            g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+            g_dbus_method_invocation_return_value(invoc,
+                                                  g_variant_builder_end(ret));
+            g_variant_builder_unref(bld);
+            g_variant_builder_unref(ret);
+        }
         else if ("FetchAvailableConfigs" == method_name)
         {
             // Build up an array of object paths to available config objects
@@ -989,6 +1820,87 @@ public:
             g_variant_builder_unref(bld);
             g_variant_builder_unref(ret);
         }
+        else if ("LookupConfigName" == method_name)
+        {
+            // Find all configuration paths with a given profile name,
+            // via the maintained name index instead of a linear scan
+            // with per-entry ACL checks over all configuration objects.
+            gchar *cfgname_c = nullptr;
+            g_variant_get(params, "(s)", &cfgname_c);
+            std::string cfgname(cfgname_c ? cfgname_c : "");
+            g_free(cfgname_c);
+
+            GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("ao"));
+            auto range = name_index.equal_range(cfgname);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                auto cfgobj = config_objects.find(it->second);
+                if (config_objects.end() == cfgobj)
+                {
+                    continue;
+                }
+                try
+                {
+                    // Only return profiles the caller has access to
+                    cfgobj->second->CheckACL(sender);
+                    g_variant_builder_add(bld, "o", it->second.c_str());
+                }
+                catch (DBusCredentialsException& excp)
+                {
+                    // Ignore credentials exceptions.  It means the
+                    // caller does not have access this configuration object
+                }
+            }
+
+            GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+            g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+            g_dbus_method_invocation_return_value(invoc,
+                                                  g_variant_builder_end(ret));
+            g_variant_builder_unref(bld);
+            g_variant_builder_unref(ret);
+        }
+        else if ("LookupAlias" == method_name)
+        {
+            // Resolve an alias to its configuration path via the
+            // maintained alias index, in constant time instead of a
+            // linear scan over all configuration objects.  An alias
+            // maps to at most one configuration, so the result array
+            // carries zero or one path.
+            gchar *aliasname_c = nullptr;
+            g_variant_get(params, "(s)", &aliasname_c);
+            std::string aliasname(aliasname_c ? aliasname_c : "");
+            g_free(aliasname_c);
+
+            GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("ao"));
+            auto aliasit = alias_index.find(aliasname);
+            if (alias_index.end() != aliasit)
+            {
+                auto cfgobj = config_objects.find(aliasit->second);
+                if (config_objects.end() != cfgobj)
+                {
+                    try
+                    {
+                        // Only return a profile the caller has access to
+                        cfgobj->second->CheckACL(sender);
+                        g_variant_builder_add(bld, "o",
+                                              aliasit->second.c_str());
+                    }
+                    catch (DBusCredentialsException& excp)
+                    {
+                        // Ignore credentials exceptions.  It means the
+                        // caller does not have access this configuration
+                        // object
+                    }
+                }
+            }
+
+            GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+            g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+            g_dbus_method_invocation_return_value(invoc,
+                                                  g_variant_builder_end(ret));
+            g_variant_builder_unref(bld);
+            g_variant_builder_unref(ret);
+        }
     };
 
 
@@ -996,9 +1908,11 @@ public:
      *  Callback which is used each time a ConfigManagerObject D-Bus
      *  property is being read.
      *
-     *  For the ConfigManagerObject, this method will just return NULL
-     *  with an error set in the GError return pointer.  The
-     *  ConfigManagerObject does not use properties at all.
+     *  The generation property is a counter which increases each time
+     *  the set of imported configuration profiles changes (import,
+     *  removal or rename).  Clients caching configuration lists, such
+     *  as the shell completion helper, use it to validate their cache
+     *  with a single property read.
      *
      * @param conn           D-Bus connection this event occurred on
      * @param sender         D-Bus bus name of the requester
@@ -1007,8 +1921,9 @@ public:
      * @param property_name  The property name being accessed
      * @param error          A GLib2 GError object if an error occurs
      *
-     * @return  Returns always NULL, as there are no properties in the
-     *          ConfigManagerObject.
+     * @return  Returns a GVariant with the property value on success,
+     *          otherwise NULL with the error details set in the GError
+     *          return pointer.
      */
     GVariant * callback_get_property(GDBusConnection *conn,
                                      const std::string sender,
@@ -1018,6 +1933,11 @@ public:
                                      GError **error)
     {
         IdleCheck_UpdateTimestamp();
+        if ("generation" == property_name)
+        {
+            return g_variant_new_uint32(generation);
+        }
+
         GVariant *ret = NULL;
         g_set_error (error,
                      G_IO_ERROR,
@@ -1061,10 +1981,16 @@ private:
     GDBusConnection *dbuscon;
     DBusConnectionCreds creds;
     std::map<std::string, ConfigurationObject *> config_objects;
+    std::multimap<std::string, std::string> name_index;  ///< name -> config paths
+    std::multimap<uid_t, std::string> owner_index;       ///< owner uid -> config paths
+    std::map<std::string, std::string> alias_index;      ///< alias -> config path
+    guint32 generation = 1;  ///< Bumped on each import/remove/rename
+    ConfigStatePersistence *state_persistence = nullptr;
 
     /**
      * Callback function used by ConfigurationObject instances to remove
-     * its object path from the main registry of configuration objects
+     * its object path from the main registry of configuration objects,
+     * including the secondary lookup indexes
      *
      * @param cfgpath  std::string containing the object path to the object
      *                 to remove
@@ -1072,7 +1998,103 @@ private:
      */
     void remove_config_object(const std::string cfgpath)
     {
+        auto cfgobj = config_objects.find(cfgpath);
+        if (config_objects.end() != cfgobj)
+        {
+            index_erase_path(name_index, cfgobj->second->GetConfigName(),
+                             cfgpath);
+            update_alias_index(cfgpath,
+                               cfgobj->second->GetAliasName(), "");
+        }
+        for (auto it = owner_index.begin(); it != owner_index.end(); ++it)
+        {
+            if (it->second == cfgpath)
+            {
+                owner_index.erase(it);
+                break;
+            }
+        }
         config_objects.erase(cfgpath);
+        if (state_persistence)
+        {
+            state_persistence->Remove(cfgpath);
+        }
+        generation++;
+    }
+
+
+    /**
+     * Callback function used by ConfigurationObject instances to keep the
+     * name index updated when a configuration profile is renamed
+     *
+     * @param cfgpath  std::string containing the object path of the
+     *                 renamed object
+     * @param oldname  std::string with the profile name before the rename
+     * @param newname  std::string with the new profile name
+     */
+    void rename_config_object(const std::string cfgpath,
+                              const std::string oldname,
+                              const std::string newname)
+    {
+        index_erase_path(name_index, oldname, cfgpath);
+        name_index.insert(std::make_pair(newname, cfgpath));
+        generation++;
+    }
+
+
+    /**
+     * Callback function used by ConfigurationObject instances to keep
+     * the alias index updated when a configuration profile alias is
+     * assigned, changed or the profile itself is removed.  An alias
+     * name maps to at most one configuration path, enforced by the
+     * alias D-Bus object registration.
+     *
+     * @param cfgpath   std::string containing the object path of the
+     *                  configuration the alias belongs to
+     * @param oldalias  std::string with the previous alias name; an
+     *                  empty string if no alias was set
+     * @param newalias  std::string with the new alias name; an empty
+     *                  string if the alias was removed
+     */
+    void update_alias_index(const std::string cfgpath,
+                            const std::string oldalias,
+                            const std::string newalias)
+    {
+        if (!oldalias.empty())
+        {
+            auto it = alias_index.find(oldalias);
+            if (alias_index.end() != it && it->second == cfgpath)
+            {
+                alias_index.erase(it);
+            }
+        }
+        if (!newalias.empty())
+        {
+            alias_index[newalias] = cfgpath;
+        }
+    }
+
+
+    /**
+     * Removes a single (key, config path) entry from a string keyed
+     * lookup index
+     *
+     * @param index    The std::multimap index to modify
+     * @param key      Key of the entry to remove
+     * @param cfgpath  Configuration path value of the entry to remove
+     */
+    void index_erase_path(std::multimap<std::string, std::string>& index,
+                          const std::string key, const std::string cfgpath)
+    {
+        auto range = index.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == cfgpath)
+            {
+                index.erase(it);
+                break;
+            }
+        }
     }
 };
 
@@ -1138,6 +2160,19 @@ public:
     }
 
 
+    /**
+     *  Enables write-behind persistence of persistent configuration
+     *  profiles in the given directory.  Must be called before the
+     *  service attaches to the D-Bus.
+     *
+     * @param dirname  Directory where the profile state files are kept
+     */
+    void SetStateDir(std::string dirname)
+    {
+        statedir = dirname;
+    }
+
+
     /**
      *  This callback is called when the service was successfully registered
      *  on the D-Bus.
@@ -1157,10 +2192,29 @@ public:
                                             "ConfigurationManager");
         procsig->ProcessChange(StatusMinor::PROC_STARTED);
 
+        // Heap and object count introspection; the counter callback
+        // keeps a reference to the manager object
+        memdebug.reset(new DebugMemoryObject());
+        memdebug->AddObjectCounter("config_objects",
+                                   [mobj=cfgmgr]()
+                                   {
+                                       return mobj->GetConfigObjectCount();
+                                   });
+        memdebug->RegisterObject(GetConnection());
+
         if (nullptr != idle_checker)
         {
             cfgmgr->IdleCheck_Register(idle_checker);
         }
+
+        if (!statedir.empty())
+        {
+            // Enabled last, so configuration objects restored from
+            // disk are registered with the idle checker as well
+            state_persistence.reset(new ConfigStatePersistence(statedir));
+            cfgmgr->EnableStatePersistence(state_persistence.get(),
+                                           GetConnection());
+        }
     };
 
 
@@ -1197,8 +2251,14 @@ public:
 private:
     unsigned int default_log_level = 6; // LogCategory::DEBUG
     ConfigManagerObject::Ptr cfgmgr;
+    DebugMemoryObject::Ptr memdebug;
     ProcessSignalProducer * procsig;
     std::string logfile;
+    std::string statedir;
+
+    // Declared after cfgmgr, so it is destroyed - and thereby drains
+    // its pending writes - while the configuration objects still exist
+    std::unique_ptr<ConfigStatePersistence> state_persistence;
 };
 
 #endif // OPENVPN3_DBUS_CONFIGMGR_HPP
@@ -53,16 +53,28 @@ static int config_manager(ParsedArgs args)
     }
     cfgmgr.SetLogLevel(log_level);
 
+    if (args.Present("state-dir"))
+    {
+        cfgmgr.SetStateDir(args.GetValue("state-dir", 0));
+    }
+
     IdleCheck::Ptr idle_exit;
     if (idle_wait_min > 0)
     {
         idle_exit.reset(new IdleCheck(main_loop,
                                       std::chrono::minutes(idle_wait_min)));
-        idle_exit->SetPollTime(std::chrono::seconds(30));
         cfgmgr.EnableIdleCheck(idle_exit);
     }
     cfgmgr.Setup();
 
+    // The configuration manager is the first service a cold
+    // 'openvpn3 session-start' activates; pre-activate the session
+    // manager and the backend starter here so all three run their
+    // startup in parallel instead of end to end
+    DBusPrestartServices(cfgmgr.GetConnection(),
+                         {OpenVPN3DBus_name_sessions,
+                          OpenVPN3DBus_name_backends});
+
     if (idle_wait_min > 0)
     {
         idle_exit->Enable();
@@ -73,7 +85,6 @@ static int config_manager(ParsedArgs args)
     if (idle_wait_min > 0)
     {
         idle_exit->Disable();
-        idle_exit->Join();
     }
 
     return 0;
@@ -89,6 +100,9 @@ int main(int argc, char **argv)
     argparser.AddOption("idle-exit", "MINUTES", true,
                         "How long to wait before exiting if being idle. "
                         "0 disables it (Default: 3 minutes)");
+    argparser.AddOption("state-dir", "DIRECTORY", true,
+                        "Directory where persistent configuration profiles "
+                        "are saved and restored (Default: disabled)");
 
 
     try
@@ -0,0 +1,169 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2017 - 2018  OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2017 - 2018  David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   profile-store.hpp
+ *
+ * @brief  Memory-mapped storage of raw configuration profile text.
+ *
+ *         The configuration manager can host thousands of imported
+ *         profiles, where each profile may carry multi-kilobyte inline
+ *         certificate payloads.  Instead of keeping every parsed option
+ *         list resident on the heap for the lifetime of the service,
+ *         the raw profile text is kept in an unlinked, memory-mapped
+ *         temporary file.  Pages which are not used stay out of the
+ *         resident set, and the parsed representation can be recreated
+ *         from this store on demand.
+ */
+
+#ifndef OPENVPN3_DBUS_CONFIGMGR_PROFILESTORE_HPP
+#define OPENVPN3_DBUS_CONFIGMGR_PROFILESTORE_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+
+#include "dbus/exceptions.hpp"
+
+
+/**
+ *  Keeps the raw text of a single configuration profile in a
+ *  memory-mapped, unlinked temporary file.  The file disappears from
+ *  the file system immediately; the mapping is the only reference and
+ *  is released when this object is destroyed.
+ */
+class ProfileTextStore
+{
+public:
+    ProfileTextStore()
+        : data(nullptr), length(0)
+    {
+    }
+
+
+    ~ProfileTextStore()
+    {
+        if (data)
+        {
+            munmap(data, length);
+        }
+    }
+
+
+    // The mapping is tied to this object's lifetime; copying would
+    // require duplicating it, which is not needed anywhere.
+    ProfileTextStore(const ProfileTextStore&) = delete;
+    ProfileTextStore& operator=(const ProfileTextStore&) = delete;
+
+
+    /**
+     *  Stores the profile text.  May only be called once per object.
+     *
+     * @param text  std::string containing the complete profile text
+     */
+    void Store(const std::string& text)
+    {
+        if (data)
+        {
+            THROW_DBUSEXCEPTION("ProfileTextStore",
+                                "Profile text already stored");
+        }
+
+        char tmpl[] = P_tmpdir "/ovpn3-profile-XXXXXX";
+        int fd = mkstemp(tmpl);
+        if (fd < 0)
+        {
+            THROW_DBUSEXCEPTION("ProfileTextStore",
+                                "Failed creating profile store file: "
+                                + std::string(strerror(errno)));
+        }
+        // The mapping keeps the storage alive; no need for a visible file
+        unlink(tmpl);
+
+        size_t written = 0;
+        while (written < text.size())
+        {
+            ssize_t w = write(fd, text.c_str() + written,
+                              text.size() - written);
+            if (w < 0)
+            {
+                close(fd);
+                THROW_DBUSEXCEPTION("ProfileTextStore",
+                                    "Failed writing profile store file: "
+                                    + std::string(strerror(errno)));
+            }
+            written += w;
+        }
+
+        if (text.size() > 0)
+        {
+            void *m = mmap(NULL, text.size(), PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (MAP_FAILED == m)
+            {
+                THROW_DBUSEXCEPTION("ProfileTextStore",
+                                    "Failed mapping profile store file: "
+                                    + std::string(strerror(errno)));
+            }
+            data = (char *) m;
+        }
+        else
+        {
+            close(fd);
+        }
+        length = text.size();
+    }
+
+
+    /**
+     *  Retrieves a copy of the stored profile text.  This faults the
+     *  needed pages back in if they have been reclaimed.
+     *
+     * @return Returns a std::string with the profile text
+     */
+    std::string Retrieve() const
+    {
+        if (!data)
+        {
+            return "";
+        }
+        return std::string(data, length);
+    }
+
+
+    /**
+     *  Size of the stored profile text
+     *
+     * @return Returns the profile text length in bytes
+     */
+    size_t Size() const
+    {
+        return length;
+    }
+
+
+private:
+    char *data;
+    size_t length;
+};
+
+#endif // OPENVPN3_DBUS_CONFIGMGR_PROFILESTORE_HPP
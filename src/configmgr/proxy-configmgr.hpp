@@ -20,6 +20,7 @@
 #ifndef OPENVPN3_DBUS_PROXY_CONFIG_HPP
 #define OPENVPN3_DBUS_PROXY_CONFIG_HPP
 
+#include <tuple>
 #include <vector>
 
 #include "dbus/core.hpp"
@@ -83,6 +84,70 @@ public:
     }
 
 
+    /**
+     * Imports several configuration profiles in a single D-Bus call.
+     * This avoids one bus round trip per profile and lets the
+     * configuration manager register all resulting objects in one pass.
+     *
+     * @param profiles  A std::vector of (name, config blob, single_use,
+     *                  persistent) tuples describing each profile.  The
+     *                  config blob may be either a plain text profile
+     *                  or a JSON formatted one, as exported by
+     *                  GetJSONConfig()
+     *
+     * @return A std::vector<std::string> with the D-Bus object path of
+     *         each imported configuration, in the same order as the input
+     */
+    std::vector<std::string> ImportBulk(const std::vector<std::tuple<std::string, std::string, bool, bool>>& profiles)
+    {
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("a(ssbb)"));
+        for (const auto& profile : profiles)
+        {
+            g_variant_builder_add(bld, "(ssbb)",
+                                  std::get<0>(profile).c_str(),
+                                  std::get<1>(profile).c_str(),
+                                  std::get<2>(profile),
+                                  std::get<3>(profile));
+        }
+        GVariant *res = Call("ImportBulk",
+                             g_variant_new("(a(ssbb))", bld));
+        g_variant_builder_unref(bld);
+        if (NULL == res)
+        {
+            THROW_DBUSEXCEPTION("OpenVPN3ConfigurationProxy",
+                                "Failed to bulk import configurations");
+        }
+        GVariantIter *cfgpaths = NULL;
+        g_variant_get(res, "(ao)", &cfgpaths);
+
+        GVariant *path = NULL;
+        std::vector<std::string> ret;
+        while ((path = g_variant_iter_next_value(cfgpaths)))
+        {
+            gsize len;
+            ret.push_back(std::string(g_variant_get_string(path, &len)));
+            g_variant_unref(path);
+        }
+        g_variant_unref(res);
+        g_variant_iter_free(cfgpaths);
+        return ret;
+    }
+
+
+    /**
+     * Retrieves the configuration manager's generation counter.  This
+     * counter increases every time the set of imported configuration
+     * profiles changes, and can be used to validate cached
+     * configuration lists with a single property read.
+     *
+     * @return An unsigned int with the current generation counter value
+     */
+    guint32 GetGeneration()
+    {
+        return GetUIntProperty("generation");
+    }
+
+
     /**
      * Retrieves a string array of configuration paths which are available
      * to the calling user
@@ -114,6 +179,80 @@ public:
     }
 
 
+    /**
+     * Looks up all configuration paths with a specific profile name which
+     * are available to the calling user.  The lookup is done via an index
+     * maintained by the configuration manager, which avoids a linear scan
+     * over all imported profiles.
+     *
+     * @param cfgname  String containing the profile name to look up
+     *
+     * @return A std::vector<std::string> of configuration paths
+     */
+    std::vector<std::string> LookupConfigName(std::string cfgname)
+    {
+        GVariant *res = Call("LookupConfigName",
+                             g_variant_new("(s)", cfgname.c_str()));
+        if (NULL == res)
+        {
+            THROW_DBUSEXCEPTION("OpenVPN3ConfigurationProxy",
+                                "Failed to lookup configuration names");
+        }
+        GVariantIter *cfgpaths = NULL;
+        g_variant_get(res, "(ao)", &cfgpaths);
+
+        GVariant *path = NULL;
+        std::vector<std::string> ret;
+        while ((path = g_variant_iter_next_value(cfgpaths)))
+        {
+            gsize len;
+            ret.push_back(std::string(g_variant_get_string(path, &len)));
+            g_variant_unref(path);
+        }
+        g_variant_unref(res);
+        g_variant_iter_free(cfgpaths);
+        return ret;
+    }
+
+
+    /**
+     * Resolves a configuration alias to its configuration profile
+     * path.  The lookup is answered from the alias index maintained
+     * by the configuration manager, in constant time regardless of
+     * the number of imported profiles.
+     *
+     * @param alias  String containing the alias name to look up
+     *
+     * @return A std::string with the configuration path the alias
+     *         points at, or an empty string if the alias is unknown
+     *         or not accessible
+     */
+    std::string LookupAlias(std::string alias)
+    {
+        GVariant *res = Call("LookupAlias",
+                             g_variant_new("(s)", alias.c_str()));
+        if (NULL == res)
+        {
+            THROW_DBUSEXCEPTION("OpenVPN3ConfigurationProxy",
+                                "Failed to lookup configuration alias");
+        }
+        GVariantIter *cfgpaths = NULL;
+        g_variant_get(res, "(ao)", &cfgpaths);
+
+        GVariant *path = NULL;
+        std::string ret;
+        while ((path = g_variant_iter_next_value(cfgpaths)))
+        {
+            gsize len;
+            ret = std::string(g_variant_get_string(path, &len));
+            g_variant_unref(path);
+        }
+        g_variant_unref(res);
+        g_variant_iter_free(cfgpaths);
+        return ret;
+    }
+
+
     std::string GetJSONConfig()
     {
         GVariant *res = Call("FetchJSON");
@@ -0,0 +1,704 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   state-persistence.hpp
+ *
+ * @brief  Write-behind state persistence for persistent configuration
+ *         profiles.  Mutations mark a profile dirty; a timer driven
+ *         flusher batches all dirty profiles into one group of
+ *         fsync'd file writes with a single directory sync per batch,
+ *         instead of one synchronous write per mutation.  The full
+ *         state is additionally mirrored into a single snapshot file,
+ *         which the service restores from at startup in one read
+ *         instead of thousands of per-profile file loads.
+ */
+
+#ifndef OPENVPN3_CONFIGMGR_STATE_PERSISTENCE_HPP
+#define OPENVPN3_CONFIGMGR_STATE_PERSISTENCE_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+
+/**
+ *  Manages the on-disk state files of persistent configuration
+ *  profiles.  One file per profile is kept in the state directory,
+ *  named after the profile's D-Bus object path token.
+ *
+ *  Writes are write-behind: MarkDirty() only records the profile and
+ *  arms a flush timer on the GLib main loop.  When the timer fires,
+ *  every dirty profile is serialized and written in one batch; each
+ *  file is written to a temporary name, fsync'd and renamed into
+ *  place, and the directory itself is fsync'd once per batch.  The
+ *  destructor drains any still pending writes.
+ */
+class ConfigStatePersistence
+{
+public:
+    typedef std::function<std::string(const std::string&)> SerializeFunc;
+
+    /**
+     *  Prepares the state directory used for the profile state files
+     *
+     * @param statedir        Directory to keep the state files in.  It
+     *                        is created with 0700 permissions if missing.
+     * @param flush_interval  Maximum number of seconds a dirty profile
+     *                        stays unwritten before the batch flush runs
+     */
+    ConfigStatePersistence(const std::string& statedir,
+                           unsigned int flush_interval = 2)
+        : statedir(statedir),
+          flush_interval(flush_interval),
+          flush_timer(0)
+    {
+        if (mkdir(statedir.c_str(), 0700) < 0 && EEXIST != errno)
+        {
+            throw std::runtime_error("Could not create state directory '"
+                                     + statedir + "': "
+                                     + std::string(strerror(errno)));
+        }
+    }
+
+
+    ~ConfigStatePersistence()
+    {
+        // Drain all pending writes before shutting down
+        if (flush_timer > 0)
+        {
+            g_source_remove(flush_timer);
+            flush_timer = 0;
+        }
+        Flush();
+
+        if (snapshot_timer > 0)
+        {
+            g_source_remove(snapshot_timer);
+            snapshot_timer = 0;
+        }
+        if (snapshot_pending)
+        {
+            WriteSnapshot();
+        }
+    }
+
+
+    ConfigStatePersistence(const ConfigStatePersistence&) = delete;
+    ConfigStatePersistence& operator=(const ConfigStatePersistence&) = delete;
+
+
+    /**
+     *  Registers the callback used to serialize a profile when the
+     *  batch flush runs.  The callback receives the D-Bus object path
+     *  of the profile and returns the serialized state, or an empty
+     *  string if the profile no longer exists.
+     *
+     * @param func  SerializeFunc callback to use
+     */
+    void SetSerializer(SerializeFunc func)
+    {
+        serializer = func;
+    }
+
+
+    /**
+     *  Registers a callback receiving error messages from the flusher,
+     *  which runs from a timer and has no caller to report to
+     *
+     * @param func  Callback receiving a single error message string
+     */
+    void SetErrorLogger(std::function<void(const std::string&)> func)
+    {
+        log_error = func;
+    }
+
+
+    /**
+     *  Registers the callback used to gather the full persistent
+     *  state when a snapshot is written.  The callback returns a map
+     *  of profile D-Bus object path to serialized state.
+     *
+     * @param func  Callback returning the state of all persistent
+     *              profiles
+     */
+    void SetSnapshotSource(std::function<std::map<std::string, std::string>()> func)
+    {
+        snapshot_source = func;
+    }
+
+
+    /**
+     *  Records that a profile's state has changed and needs to be
+     *  written back to disk.  The write itself happens when the flush
+     *  timer fires, batching all profiles dirtied in the meantime.
+     *
+     * @param cfgpath  D-Bus object path of the modified profile
+     */
+    void MarkDirty(const std::string& cfgpath)
+    {
+        dirty.insert(cfgpath);
+        if (0 == flush_timer)
+        {
+            flush_timer = g_timeout_add_seconds(flush_interval,
+                                                flush_callback, this);
+        }
+    }
+
+
+    /**
+     *  Removes the state file of a profile, typically when the profile
+     *  itself is removed
+     *
+     * @param cfgpath  D-Bus object path of the removed profile
+     */
+    void Remove(const std::string& cfgpath)
+    {
+        dirty.erase(cfgpath);
+        if (0 == unlink(state_file(cfgpath).c_str()))
+        {
+            sync_statedir();
+        }
+        // A removal leaves no newer state file behind, which the
+        // snapshot staleness check could miss; rewrite the snapshot
+        ScheduleSnapshot();
+    }
+
+
+    /**
+     *  Writes every dirty profile to disk in one batch.  Called by the
+     *  flush timer and by the destructor when draining at shutdown.
+     */
+    void Flush()
+    {
+        if (dirty.empty() || !serializer)
+        {
+            dirty.clear();
+            return;
+        }
+
+        unsigned int written = 0;
+        for (const auto& cfgpath : dirty)
+        {
+            std::string state = serializer(cfgpath);
+            if (state.empty())
+            {
+                // The profile is already gone
+                continue;
+            }
+            if (write_state_file(cfgpath, state))
+            {
+                written++;
+            }
+        }
+        dirty.clear();
+
+        if (written > 0)
+        {
+            // One directory sync covers all the renames of this batch
+            sync_statedir();
+            ScheduleSnapshot();
+        }
+    }
+
+
+    /**
+     *  Marks the snapshot file as outdated and arms the snapshot
+     *  rewrite timer.  The rewrite is delayed and batched the same
+     *  way the per-profile flushes are, so a burst of mutations costs
+     *  one snapshot write.
+     */
+    void ScheduleSnapshot()
+    {
+        snapshot_pending = true;
+        if (0 == snapshot_timer && snapshot_source)
+        {
+            snapshot_timer = g_timeout_add_seconds(snapshot_interval,
+                                                   snapshot_callback, this);
+        }
+    }
+
+
+    /**
+     *  Writes the complete persistent state into the single snapshot
+     *  file, as gathered from the snapshot source callback.  The
+     *  format is a flat sequence of length-prefixed records which can
+     *  be mapped and walked without any parsing beyond bounds checks.
+     */
+    void WriteSnapshot()
+    {
+        snapshot_pending = false;
+        if (!snapshot_source)
+        {
+            return;
+        }
+        std::map<std::string, std::string> states = snapshot_source();
+
+        std::string fname = statedir + "/" + snapshot_fname;
+        std::string tmpname = fname + ".tmp";
+        int fd = open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0)
+        {
+            report_error("Could not create '" + tmpname + "': "
+                         + std::string(strerror(errno)));
+            return;
+        }
+
+        std::string out;
+        out.append(snapshot_magic(), snapshot_magic_len);
+        append_u32(out, snapshot_version);
+        append_u32(out, (uint32_t) states.size());
+        for (const auto& entry : states)
+        {
+            std::string::size_type slash = entry.first.find_last_of('/');
+            std::string token = (std::string::npos == slash
+                                 ? entry.first
+                                 : entry.first.substr(slash + 1));
+            append_u32(out, (uint32_t) token.size());
+            append_u32(out, (uint32_t) entry.second.size());
+            out.append(token);
+            out.append(entry.second);
+        }
+
+        const char *data = out.c_str();
+        size_t left = out.size();
+        bool failed = false;
+        while (left > 0)
+        {
+            ssize_t w = write(fd, data, left);
+            if (w < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                report_error("Could not write '" + tmpname + "': "
+                             + std::string(strerror(errno)));
+                failed = true;
+                break;
+            }
+            data += w;
+            left -= w;
+        }
+
+        if (!failed && fsync(fd) < 0)
+        {
+            report_error("Could not sync '" + tmpname + "': "
+                         + std::string(strerror(errno)));
+            failed = true;
+        }
+        close(fd);
+
+        if (failed || rename(tmpname.c_str(), fname.c_str()) < 0)
+        {
+            unlink(tmpname.c_str());
+            return;
+        }
+        sync_statedir();
+    }
+
+
+    /**
+     *  Reads the snapshot file, if it is present and still in sync
+     *  with the per-profile state files.  The snapshot is considered
+     *  stale when any state file is newer than it or when the set of
+     *  profiles on disk no longer matches its contents; the caller
+     *  then falls back to LoadAll().
+     *
+     * @return Returns a std::map of object path token to serialized
+     *         state content; empty if no usable snapshot exists
+     */
+    std::map<std::string, std::string> LoadSnapshot()
+    {
+        std::map<std::string, std::string> ret;
+
+        std::string fname = statedir + "/" + snapshot_fname;
+        struct stat snap_st;
+        if (stat(fname.c_str(), &snap_st) < 0)
+        {
+            return ret;
+        }
+
+        // Gather the state files on disk and check none is newer
+        // than the snapshot
+        std::set<std::string> disk_tokens;
+        DIR *dir = opendir(statedir.c_str());
+        if (NULL == dir)
+        {
+            return ret;
+        }
+        struct dirent *entry = NULL;
+        bool stale = false;
+        while (NULL != (entry = readdir(dir)))
+        {
+            std::string fn(entry->d_name);
+            if (fn.size() <= suffix.size()
+                || fn.substr(fn.size() - suffix.size()) != suffix)
+            {
+                continue;
+            }
+            struct stat st;
+            if (stat((statedir + "/" + fn).c_str(), &st) == 0
+                && st.st_mtime > snap_st.st_mtime)
+            {
+                stale = true;
+                break;
+            }
+            disk_tokens.insert(fn.substr(0, fn.size() - suffix.size()));
+        }
+        closedir(dir);
+        if (stale)
+        {
+            return ret;
+        }
+
+        // Map the snapshot and walk the length-prefixed records
+        int fd = open(fname.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return ret;
+        }
+        size_t len = (size_t) snap_st.st_size;
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (MAP_FAILED == map)
+        {
+            return ret;
+        }
+
+        const char *p = (const char *) map;
+        const char *end = p + len;
+        bool valid = (len >= snapshot_magic_len + 8
+                      && 0 == memcmp(p, snapshot_magic(),
+                                     snapshot_magic_len));
+        if (valid)
+        {
+            p += snapshot_magic_len;
+            uint32_t version = read_u32(p);
+            uint32_t count = read_u32(p);
+            valid = (snapshot_version == version);
+            for (uint32_t i = 0; valid && i < count; i++)
+            {
+                if (end - p < 8)
+                {
+                    valid = false;
+                    break;
+                }
+                uint32_t token_len = read_u32(p);
+                uint32_t state_len = read_u32(p);
+                if ((size_t)(end - p) < (size_t) token_len + state_len)
+                {
+                    valid = false;
+                    break;
+                }
+                std::string token(p, token_len);
+                p += token_len;
+                ret[token] = std::string(p, state_len);
+                p += state_len;
+            }
+        }
+        munmap(map, len);
+
+        if (!valid)
+        {
+            ret.clear();
+            return ret;
+        }
+
+        // The snapshot must describe exactly the profiles on disk
+        if (ret.size() != disk_tokens.size())
+        {
+            ret.clear();
+            return ret;
+        }
+        for (const auto& item : ret)
+        {
+            if (disk_tokens.end() == disk_tokens.find(item.first))
+            {
+                ret.clear();
+                return ret;
+            }
+        }
+        return ret;
+    }
+
+
+    /**
+     *  Reads all profile state files found in the state directory.
+     *  Used at startup to restore the persistent profiles from the
+     *  previous run.
+     *
+     * @return Returns a std::map of object path token to serialized
+     *         state content
+     */
+    std::map<std::string, std::string> LoadAll()
+    {
+        std::map<std::string, std::string> ret;
+
+        DIR *dir = opendir(statedir.c_str());
+        if (NULL == dir)
+        {
+            return ret;
+        }
+
+        struct dirent *entry = NULL;
+        while (NULL != (entry = readdir(dir)))
+        {
+            std::string fname(entry->d_name);
+            if (fname.size() <= suffix.size()
+                || fname.substr(fname.size() - suffix.size()) != suffix)
+            {
+                continue;
+            }
+
+            std::ifstream statefile(statedir + "/" + fname);
+            std::stringstream content;
+            content << statefile.rdbuf();
+            if (statefile.fail())
+            {
+                report_error("Could not read state file '" + fname + "'");
+                continue;
+            }
+            ret[fname.substr(0, fname.size() - suffix.size())] = content.str();
+        }
+        closedir(dir);
+        return ret;
+    }
+
+
+private:
+    const std::string suffix = ".json";
+    const std::string snapshot_fname = "snapshot.bin";
+    static const uint32_t snapshot_version = 1;
+    static const size_t snapshot_magic_len = 8;
+    std::string statedir;
+    unsigned int flush_interval;
+    unsigned int snapshot_interval = 60;  ///< Seconds between snapshot rewrites
+    guint flush_timer;
+    guint snapshot_timer = 0;
+    bool snapshot_pending = false;
+    std::set<std::string> dirty;
+    SerializeFunc serializer;
+    std::function<std::map<std::string, std::string>()> snapshot_source;
+    std::function<void(const std::string&)> log_error;
+
+
+    /**
+     *  The magic bytes identifying a snapshot file
+     */
+    static const char * snapshot_magic()
+    {
+        static const char magic[snapshot_magic_len] = { 'O', 'V', 'P', 'N',
+                                                        '3', 'S', 'N', 'P' };
+        return magic;
+    }
+
+
+    /**
+     *  Appends a 32 bit value to the snapshot buffer in little endian
+     *  byte order
+     */
+    static void append_u32(std::string& out, uint32_t val)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out.push_back((char)((val >> (i * 8)) & 0xff));
+        }
+    }
+
+
+    /**
+     *  Reads a 32 bit little endian value from a snapshot record and
+     *  advances the read pointer
+     */
+    static uint32_t read_u32(const char *& p)
+    {
+        uint32_t val = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            val |= ((uint32_t)(unsigned char) p[i]) << (i * 8);
+        }
+        p += 4;
+        return val;
+    }
+
+
+    /**
+     *  GLib2 timer callback rewriting the snapshot file.  The timer
+     *  is one-shot; the next ScheduleSnapshot() arms a new one.
+     *
+     * @param user_data  Pointer to the ConfigStatePersistence object
+     *
+     * @return Always returns G_SOURCE_REMOVE
+     */
+    static gboolean snapshot_callback(gpointer user_data)
+    {
+        ConfigStatePersistence *self = (ConfigStatePersistence *) user_data;
+        self->snapshot_timer = 0;
+        self->WriteSnapshot();
+        return G_SOURCE_REMOVE;
+    }
+
+
+    /**
+     *  GLib2 timer callback running the batch flush.  The timer is
+     *  one-shot; the next MarkDirty() arms a new one.
+     *
+     * @param user_data  Pointer to the ConfigStatePersistence object
+     *
+     * @return Always returns G_SOURCE_REMOVE
+     */
+    static gboolean flush_callback(gpointer user_data)
+    {
+        ConfigStatePersistence *self = (ConfigStatePersistence *) user_data;
+        self->flush_timer = 0;
+        self->Flush();
+        return G_SOURCE_REMOVE;
+    }
+
+
+    /**
+     *  Maps a profile's D-Bus object path to its state file name.
+     *  Only the last path element (the unique profile token) is used.
+     *
+     * @param cfgpath  D-Bus object path of the profile
+     *
+     * @return Returns the full path of the profile's state file
+     */
+    std::string state_file(const std::string& cfgpath)
+    {
+        std::string::size_type slash = cfgpath.find_last_of('/');
+        std::string token = (std::string::npos == slash
+                             ? cfgpath : cfgpath.substr(slash + 1));
+        return statedir + "/" + token + suffix;
+    }
+
+
+    /**
+     *  Writes one profile state file.  The content goes to a temporary
+     *  file first, which is fsync'd and renamed over the final name,
+     *  so a crash mid-write can never corrupt an existing state file.
+     *
+     * @param cfgpath  D-Bus object path of the profile
+     * @param state    Serialized state content to write
+     *
+     * @return Returns true on success
+     */
+    bool write_state_file(const std::string& cfgpath,
+                          const std::string& state)
+    {
+        std::string fname = state_file(cfgpath);
+        std::string tmpname = fname + ".tmp";
+
+        int fd = open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0)
+        {
+            report_error("Could not create '" + tmpname + "': "
+                         + std::string(strerror(errno)));
+            return false;
+        }
+
+        const char *data = state.c_str();
+        size_t left = state.size();
+        while (left > 0)
+        {
+            ssize_t w = write(fd, data, left);
+            if (w < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                report_error("Could not write '" + tmpname + "': "
+                             + std::string(strerror(errno)));
+                close(fd);
+                unlink(tmpname.c_str());
+                return false;
+            }
+            data += w;
+            left -= w;
+        }
+
+        if (fsync(fd) < 0)
+        {
+            report_error("Could not sync '" + tmpname + "': "
+                         + std::string(strerror(errno)));
+            close(fd);
+            unlink(tmpname.c_str());
+            return false;
+        }
+        close(fd);
+
+        if (rename(tmpname.c_str(), fname.c_str()) < 0)
+        {
+            report_error("Could not rename '" + tmpname + "': "
+                         + std::string(strerror(errno)));
+            unlink(tmpname.c_str());
+            return false;
+        }
+        return true;
+    }
+
+
+    /**
+     *  Syncs the state directory itself, making the renames of a
+     *  completed batch durable
+     */
+    void sync_statedir()
+    {
+        int dfd = open(statedir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dfd >= 0)
+        {
+            (void) fsync(dfd);
+            close(dfd);
+        }
+    }
+
+
+    /**
+     *  Forwards an error message to the registered error logger, if any
+     *
+     * @param msg  The error message
+     */
+    void report_error(const std::string& msg)
+    {
+        if (log_error)
+        {
+            log_error(msg);
+        }
+    }
+};
+
+#endif // OPENVPN3_CONFIGMGR_STATE_PERSISTENCE_HPP
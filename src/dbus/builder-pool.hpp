@@ -0,0 +1,120 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   builder-pool.hpp
+ *
+ * @brief  Thread-local pool of reusable GVariantBuilder objects.
+ *         Signal and property paths which build dict or array values
+ *         per event can acquire an initialized builder from the pool
+ *         and hand it back after ending it, instead of allocating and
+ *         freeing a fresh builder every time.
+ */
+
+#ifndef OPENVPN3_DBUS_BUILDER_POOL_HPP
+#define OPENVPN3_DBUS_BUILDER_POOL_HPP
+
+#include <vector>
+
+#include <gio/gio.h>
+
+/**
+ *  Maximum number of builders kept per thread; anything beyond this
+ *  is released back to the allocator
+ */
+#define OPENVPN3_BUILDER_POOL_SIZE 16
+
+
+class GVariantBuilderPool
+{
+public:
+    /**
+     *  Acquires a builder from the pool, initialized for the given
+     *  variant type.  The builder must be finished with
+     *  g_variant_builder_end() and then handed back via Release().
+     *
+     * @param type  GVariantType the builder will produce
+     *
+     * @return Returns a ready-to-use GVariantBuilder
+     */
+    static GVariantBuilder * Acquire(const GVariantType *type)
+    {
+        std::vector<GVariantBuilder *>& p = pool();
+        GVariantBuilder *bldr;
+        if (p.empty())
+        {
+            bldr = g_new0(GVariantBuilder, 1);
+        }
+        else
+        {
+            bldr = p.back();
+            p.pop_back();
+        }
+        g_variant_builder_init(bldr, type);
+        return bldr;
+    }
+
+
+    /**
+     *  Acquires a builder from the pool, initialized for the given
+     *  variant type string, such as "a{sv}" or "a(uus)"
+     *
+     * @param type  D-Bus type string the builder will produce
+     *
+     * @return Returns a ready-to-use GVariantBuilder
+     */
+    static GVariantBuilder * Acquire(const std::string type)
+    {
+        return Acquire(G_VARIANT_TYPE(type.c_str()));
+    }
+
+
+    /**
+     *  Returns an ended builder to the pool for reuse.  The builder
+     *  must have been completed with g_variant_builder_end() (or
+     *  consumed by g_variant_new()); an unfinished builder needs a
+     *  g_variant_builder_clear() call first.
+     *
+     * @param bldr  GVariantBuilder previously handed out by Acquire()
+     */
+    static void Release(GVariantBuilder *bldr)
+    {
+        std::vector<GVariantBuilder *>& p = pool();
+        if (p.size() >= OPENVPN3_BUILDER_POOL_SIZE)
+        {
+            g_free(bldr);
+            return;
+        }
+        p.push_back(bldr);
+    }
+
+
+private:
+    /**
+     *  Per-thread builder cache.  Thread-local storage avoids any
+     *  locking on the signal emission paths.
+     */
+    static std::vector<GVariantBuilder *>& pool()
+    {
+        static thread_local std::vector<GVariantBuilder *> builders;
+        return builders;
+    }
+};
+
+#endif // OPENVPN3_DBUS_BUILDER_POOL_HPP
@@ -31,6 +31,8 @@
 
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <mutex>
 #include <sys/types.h>
 
 #include "proxy.hpp"
@@ -44,6 +46,14 @@ namespace openvpn
      *   bus name.  Each D-Bus client performing an operation on a D-Bus
      *   object in a service connects with a unique bus name.  This is a
      *   safe method for retrieving information about who the caller is.
+     *
+     *   Lookup results are cached process wide, keyed by bus name.  The
+     *   credentials of a bus name cannot change for as long as the name
+     *   is owned by the same connection, so cached entries are only
+     *   invalidated when the D-Bus daemon signals NameOwnerChanged for
+     *   that name.  This turns the ACL check done on essentially every
+     *   method call and property access into a hash lookup instead of a
+     *   synchronous round trip to the bus daemon.
      */
     class DBusConnectionCreds : public DBusProxy
     {
@@ -61,6 +71,7 @@ namespace openvpn
         {
             SetGDBusCallFlags(G_DBUS_CALL_FLAGS_NO_AUTO_START);
             proxy = SetupProxy();
+            subscribe_name_owner_changed(dbuscon);
         }
 
 
@@ -73,6 +84,16 @@ namespace openvpn
          */
         uid_t GetUID(std::string busname)
         {
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex());
+                auto entry = credentials_cache().find(busname);
+                if (credentials_cache().end() != entry
+                    && entry->second.have_uid)
+                {
+                    return entry->second.uid;
+                }
+            }
+
             try
             {
                 GVariant *result = Call("GetConnectionUnixUser",
@@ -80,6 +101,10 @@ namespace openvpn
                 uid_t ret;
                 g_variant_get(result, "(u)", &ret);
                 g_variant_unref(result);
+
+                std::lock_guard<std::mutex> lock(cache_mutex());
+                credentials_cache()[busname].uid = ret;
+                credentials_cache()[busname].have_uid = true;
                 return ret;
             }
             catch (DBusException& excp)
@@ -100,6 +125,16 @@ namespace openvpn
          */
         pid_t GetPID(std::string busname)
         {
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex());
+                auto entry = credentials_cache().find(busname);
+                if (credentials_cache().end() != entry
+                    && entry->second.have_pid)
+                {
+                    return entry->second.pid;
+                }
+            }
+
             try
             {
                 GVariant *result = Call("GetConnectionUnixProcessID",
@@ -107,6 +142,10 @@ namespace openvpn
                 pid_t ret;
                 g_variant_get(result, "(u)", &ret);
                 g_variant_unref(result);
+
+                std::lock_guard<std::mutex> lock(cache_mutex());
+                credentials_cache()[busname].pid = ret;
+                credentials_cache()[busname].have_pid = true;
                 return ret;
             }
             catch (DBusException& excp)
@@ -116,6 +155,105 @@ namespace openvpn
                                     + busname + "': " + excp.getRawError());
             }
         }
+
+
+    private:
+        /**
+         *  Cached credentials for a single bus name.  UID and PID are
+         *  looked up through separate bus calls, so they are tracked
+         *  independently.
+         */
+        struct CachedCreds
+        {
+            uid_t uid = 0;
+            pid_t pid = 0;
+            bool have_uid = false;
+            bool have_pid = false;
+        };
+
+
+        /**
+         *  Process wide credentials cache, keyed by bus name
+         */
+        static std::map<std::string, struct CachedCreds>& credentials_cache()
+        {
+            static std::map<std::string, struct CachedCreds> cache;
+            return cache;
+        }
+
+
+        /**
+         *  Protects the credentials cache.  Lookups may happen from the
+         *  GLib main loop as well as worker threads using their own
+         *  DBusConnectionCreds objects.
+         */
+        static std::mutex& cache_mutex()
+        {
+            static std::mutex mtx;
+            return mtx;
+        }
+
+
+        /**
+         *  Subscribes to the NameOwnerChanged signal from the D-Bus
+         *  daemon, which is the invalidation source for the credentials
+         *  cache.  Only a single subscription is set up per process,
+         *  regardless of how many DBusConnectionCreds objects exist.
+         *
+         * @param dbuscon  Established D-Bus connection to subscribe on
+         */
+        static void subscribe_name_owner_changed(GDBusConnection *dbuscon)
+        {
+            static bool subscribed = false;
+
+            std::lock_guard<std::mutex> lock(cache_mutex());
+            if (subscribed)
+            {
+                return;
+            }
+            g_dbus_connection_signal_subscribe(dbuscon,
+                                               "org.freedesktop.DBus",
+                                               "org.freedesktop.DBus",
+                                               "NameOwnerChanged",
+                                               "/org/freedesktop/DBus",
+                                               NULL,
+                                               G_DBUS_SIGNAL_FLAGS_NONE,
+                                               name_owner_changed,
+                                               NULL,
+                                               NULL);
+            subscribed = true;
+        }
+
+
+        /**
+         *  Callback for the NameOwnerChanged D-Bus signal.  Whenever a
+         *  bus name changes owner - including names disappearing when a
+         *  client disconnects - any cached credentials for that name are
+         *  dropped.
+         */
+        static void name_owner_changed(GDBusConnection *connection,
+                                       const gchar *sender,
+                                       const gchar *object_path,
+                                       const gchar *interface_name,
+                                       const gchar *signal_name,
+                                       GVariant *params,
+                                       gpointer user_data)
+        {
+            gchar *name = NULL;
+            gchar *old_owner = NULL;
+            gchar *new_owner = NULL;
+            g_variant_get(params, "(sss)", &name, &old_owner, &new_owner);
+
+            if (name)
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex());
+                credentials_cache().erase(std::string(name));
+            }
+
+            g_free(name);
+            g_free(old_owner);
+            g_free(new_owner);
+        }
     };
 
 
@@ -238,6 +376,17 @@ private:
         }
 
 
+        /**
+         *  Returns this objects owner's UID as a plain uid_t value
+         *
+         * @return uid_t of the object owner
+         */
+        uid_t GetOwnerUID()
+        {
+            return owner;
+        }
+
+
         /**
          *  Sets the public access attribute.  If set to true,
          *  the ACL check is effectively disabled - unless a
@@ -263,6 +412,29 @@ private:
         }
 
 
+        /**
+         *  Retrieves the public access attribute as a plain boolean
+         *
+         * @return Returns true if public access is enabled
+         */
+        bool GetPublicAccessState()
+        {
+            return acl_public;
+        }
+
+
+        /**
+         *  Retrieve the ACL list of UIDs granted access as a plain
+         *  std::vector.  The owner UID is not enlisted.
+         *
+         * @return Returns a std::vector<uid_t> copy of the access list
+         */
+        std::vector<uid_t> GetAccessListVector()
+        {
+            return acl_list;
+        }
+
+
         /**
          *  Retrieve the ACL list of UIDs granted access.  The owner UID
          *  is not enlisted.
@@ -27,9 +27,87 @@
 #define OPENVPN3_DBUS_CONNECTION_HPP
 
 #include <iostream>
+#include <map>
+#include <mutex>
 
 namespace openvpn
 {
+    /**
+     *  Process wide registry of established D-Bus connections, one per
+     *  bus type.  Every DBus object (and thereby every DBusProxy and
+     *  DBusSignalSubscription) shares the same underlying
+     *  GDBusConnection, which is established lazily on first use.
+     *  The registry keeps its own reference for the lifetime of the
+     *  process, so the shared connection survives any individual
+     *  owner being destructed.
+     */
+    class DBusConnectionRegistry
+    {
+    public:
+        /**
+         *  Returns the shared connection for a bus type, establishing
+         *  it on first use or when a previous connection has been
+         *  closed.  The caller receives its own reference and must
+         *  g_object_unref() it when done.
+         *
+         * @param bus_type  GBusType of the bus to connect to
+         *
+         * @return Returns a referenced GDBusConnection.  Throws a
+         *         DBusException if the connection cannot be
+         *         established.
+         */
+        static GDBusConnection * Get(GBusType bus_type)
+        {
+            std::lock_guard<std::mutex> guard(registry_mutex());
+
+            std::map<GBusType, GDBusConnection *>& reg = registry();
+            auto found = reg.find(bus_type);
+            if (reg.end() != found
+                && !g_dbus_connection_is_closed(found->second))
+            {
+                return (GDBusConnection *) g_object_ref(found->second);
+            }
+
+            if (reg.end() != found)
+            {
+                // The cached connection was closed; drop the
+                // registry's reference before re-establishing
+                g_object_unref(found->second);
+                reg.erase(found);
+            }
+
+            GError *error = NULL;
+            GDBusConnection *conn = g_bus_get_sync(bus_type, NULL, &error);
+            if (!conn || error)
+            {
+                std::string errmsg = "Could not connect to the D-Bus daemon";
+                if (error)
+                {
+                    errmsg += ": " + std::string(error->message);
+                    g_error_free(error);
+                }
+                THROW_DBUSEXCEPTION("DBusConnectionRegistry", errmsg);
+            }
+            reg[bus_type] = conn;
+            return (GDBusConnection *) g_object_ref(conn);
+        }
+
+
+    private:
+        static std::mutex& registry_mutex()
+        {
+            static std::mutex m;
+            return m;
+        }
+
+        static std::map<GBusType, GDBusConnection *>& registry()
+        {
+            static std::map<GBusType, GDBusConnection *> connections;
+            return connections;
+        }
+    };
+
+
     /**
      *  This is the D-Bus connector object.  This acquires the requested
      *  well known bus name on either G_BUS_TYPE_SYSTEM (system bus) or
@@ -88,7 +166,11 @@ namespace openvpn
 
 
         /**
-         *  Open a connection to the D-Bus infrastructure
+         *  Open a connection to the D-Bus infrastructure.  The
+         *  connection itself is shared process wide through
+         *  DBusConnectionRegistry, so any number of DBus, DBusProxy
+         *  and DBusSignalSubscription objects reuse a single
+         *  established bus connection per bus type.
          */
         void Connect()
         {
@@ -97,17 +179,15 @@ namespace openvpn
                 return;
             }
 
-            // Get D-Bus connection
-            GError *error = NULL;
-            dbuscon = g_bus_get_sync(bus_type, NULL, &error);
-            if (!dbuscon || error)
+            try
             {
-                std::string errmsg = "Could not connect to the D-Bus daemon for " + busname;
-                if (error)
-                {
-                    errmsg += ": " + std::string(error->message);
-                }
-                THROW_DBUSEXCEPTION("DBus", errmsg);
+                dbuscon = DBusConnectionRegistry::Get(bus_type);
+            }
+            catch (DBusException&)
+            {
+                THROW_DBUSEXCEPTION("DBus",
+                                    "Could not connect to the D-Bus daemon for "
+                                    + busname);
             }
             connected = true;
         }
@@ -317,13 +397,15 @@ namespace openvpn
                 && G_IS_DBUS_CONNECTION(dbuscon))
             {
                 g_bus_unown_name(busid);
+                // The connection itself is shared with every other
+                // DBus/DBusProxy object in this process via
+                // DBusConnectionRegistry, so it must not be closed
+                // here; flush what we still have pending and drop
+                // our reference only
                 GError *err = NULL;
-                g_dbus_connection_close_sync(dbuscon, NULL, &err);
+                g_dbus_connection_flush_sync(dbuscon, NULL, &err);
                 if (err)
                 {
-                    std::cout << "** ERROR ** D-Bus disconnect failed:"
-                              << err->message
-                              << std::endl;
                     g_error_free(err);
                 }
             }
@@ -31,6 +31,7 @@
 
 /* Logger service */
 const std::string OpenVPN3DBus_interf_logger = "net.openvpn.v3.logger";
+const std::string OpenVPN3DBus_rootp_logger = "/net/openvpn/v3/logger";
 
 /* Configuration Manager */
 const std::string OpenVPN3DBus_name_configuration = "net.openvpn.v3.configuration";
@@ -51,6 +52,10 @@ const std::string OpenVPN3DBus_interf_backends = "net.openvpn.v3.backends";
 const std::string OpenVPN3DBus_interf_backends_manager = OpenVPN3DBus_interf_backends + ".manager";
 
 
+/* Heap and object count introspection, exposed by every service */
+const std::string OpenVPN3DBus_interf_debug = "net.openvpn.v3.debug";
+const std::string OpenVPN3DBus_rootp_debug_memory = "/net/openvpn/v3/debug/memory";
+
 /* Backend VPN client process (openvpn-service-client) - which is the real tunnel instance */
 const std::string OpenVPN3DBus_name_backends_be = "net.openvpn.v3.backends.be";
 const std::string OpenVPN3DBus_rootp_backends_sessions =  OpenVPN3DBus_rootp_backends + "/sessions";
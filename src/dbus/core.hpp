@@ -24,8 +24,13 @@
 
 #include "dbus/constants.hpp"
 #include "dbus/exceptions.hpp"
+#include "dbus/builder-pool.hpp"
+#include "dbus/gvariant-typed.hpp"
+#include "dbus/mainloop-rc.hpp"
 #include "dbus/object.hpp"
+#include "dbus/debug-memory.hpp"
 #include "dbus/connection.hpp"
+#include "dbus/prestart.hpp"
 #include "dbus/proxy.hpp"
 #include "dbus/signals.hpp"
 #include "dbus/processwatch.hpp"
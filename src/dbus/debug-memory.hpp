@@ -0,0 +1,289 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   debug-memory.hpp
+ *
+ * @brief  Heap and object count introspection D-Bus object, shared
+ *         by all the OpenVPN 3 D-Bus services
+ */
+
+#ifndef OPENVPN3_DBUS_DEBUG_MEMORY_HPP
+#define OPENVPN3_DBUS_DEBUG_MEMORY_HPP
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace openvpn
+{
+    /**
+     *  D-Bus object giving live read access to the heap state of the
+     *  service process it runs in, together with a set of per-service
+     *  object counters (managed configurations, sessions, queued log
+     *  lines) which the owning service registers at start-up.
+     *
+     *  The object is registered under /net/openvpn/v3/debug/memory on
+     *  every service and allows chasing memory growth in a long
+     *  running service with a property read instead of a restart
+     *  under a profiler.  All values are gathered on access; an idle
+     *  service pays nothing for carrying this object.
+     */
+    class DebugMemoryObject : public DBusObject,
+                              public RC<mainloop_refcount>
+    {
+    public:
+        typedef RCPtr<DebugMemoryObject> Ptr;
+
+        /**
+         *  Callable returning the current number of live objects in
+         *  one subsystem of the owning service
+         */
+        using ObjectCounter = std::function<std::uint64_t()>;
+
+        /**
+         *  Prepares the debug memory object.  The owning service
+         *  should add its object counters via AddObjectCounter()
+         *  before registering the object on the D-Bus.
+         */
+        DebugMemoryObject()
+            : DBusObject(OpenVPN3DBus_rootp_debug_memory)
+        {
+            std::stringstream introspection_xml;
+            introspection_xml << "<node name='" << OpenVPN3DBus_rootp_debug_memory << "'>"
+                              << "    <interface name='" << OpenVPN3DBus_interf_debug << "'>"
+                              << "        <method name='TrimHeap'>"
+                              << "            <arg type='b' name='trimmed' direction='out'/>"
+                              << "        </method>"
+                              << "        <property type='t' name='heap_arena' access='read'/>"
+                              << "        <property type='t' name='heap_allocated' access='read'/>"
+                              << "        <property type='t' name='heap_free' access='read'/>"
+                              << "        <property type='t' name='heap_mmapped' access='read'/>"
+                              << "        <property type='a{st}' name='object_counts' access='read'/>"
+                              << "    </interface>"
+                              << "</node>";
+            ParseIntrospectionXML(introspection_xml);
+
+            RegisterMethodHandler("TrimHeap",
+                                  [this](GDBusConnection *conn,
+                                         const std::string& sender,
+                                         GVariant *params,
+                                         GDBusMethodInvocation *invoc)
+                                  {
+                                      method_trim_heap(conn, sender,
+                                                       params, invoc);
+                                  });
+            RegisterGetPropertyHandler("heap_arena",
+                                       [](GDBusConnection *conn,
+                                          const std::string& sender,
+                                          GError **error)
+                                       {
+                                           return g_variant_new_uint64(heap_stat(HeapStat::ARENA));
+                                       });
+            RegisterGetPropertyHandler("heap_allocated",
+                                       [](GDBusConnection *conn,
+                                          const std::string& sender,
+                                          GError **error)
+                                       {
+                                           return g_variant_new_uint64(heap_stat(HeapStat::ALLOCATED));
+                                       });
+            RegisterGetPropertyHandler("heap_free",
+                                       [](GDBusConnection *conn,
+                                          const std::string& sender,
+                                          GError **error)
+                                       {
+                                           return g_variant_new_uint64(heap_stat(HeapStat::FREE));
+                                       });
+            RegisterGetPropertyHandler("heap_mmapped",
+                                       [](GDBusConnection *conn,
+                                          const std::string& sender,
+                                          GError **error)
+                                       {
+                                           return g_variant_new_uint64(heap_stat(HeapStat::MMAPPED));
+                                       });
+            RegisterGetPropertyHandler("object_counts",
+                                       [this](GDBusConnection *conn,
+                                              const std::string& sender,
+                                              GError **error)
+                                       {
+                                           return build_object_counts();
+                                       });
+        }
+
+
+        /**
+         *  Registers a named object counter with this debug object.
+         *  The callable is invoked each time the object_counts
+         *  property is read, so it must stay valid for the lifetime
+         *  of this object.
+         *
+         * @param name     Name the counter is published under
+         * @param counter  ObjectCounter callable returning the
+         *                 current count
+         */
+        void AddObjectCounter(const std::string name, ObjectCounter counter)
+        {
+            counters[name] = counter;
+        }
+
+
+        void callback_method_call(GDBusConnection *conn,
+                                  const std::string sender,
+                                  const std::string obj_path,
+                                  const std::string intf_name,
+                                  const std::string method_name,
+                                  GVariant *params,
+                                  GDBusMethodInvocation *invoc)
+        {
+            // All methods of this object are registered in the
+            // dispatch table; anything else is unknown
+            std::string errmsg = "No method named " + method_name + " is available";
+            GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.error.invalid",
+                                                          errmsg.c_str());
+            g_dbus_method_invocation_return_gerror(invoc, err);
+            g_error_free(err);
+        }
+
+
+        GVariant * callback_get_property(GDBusConnection *conn,
+                                         const std::string sender,
+                                         const std::string obj_path,
+                                         const std::string intf_name,
+                                         const std::string property_name,
+                                         GError **error)
+        {
+            g_set_error(error,
+                        G_IO_ERROR,
+                        G_IO_ERROR_FAILED,
+                        "Unknown property");
+            return NULL;
+        }
+
+
+        GVariantBuilder * callback_set_property(GDBusConnection *conn,
+                                                const std::string sender,
+                                                const std::string obj_path,
+                                                const std::string intf_name,
+                                                const std::string property_name,
+                                                GVariant *value,
+                                                GError **error)
+        {
+            THROW_DBUSEXCEPTION("DebugMemoryObject",
+                                "set property not implemented");
+        }
+
+
+    private:
+        /**
+         *  The heap figures available via the read-only properties
+         */
+        enum class HeapStat : std::uint_fast8_t
+        {
+            ARENA,      ///< Bytes in the main sbrk() arena
+            ALLOCATED,  ///< Bytes in blocks handed out by malloc()
+            FREE,       ///< Free bytes held by the allocator
+            MMAPPED     ///< Bytes in mmap() backed allocations
+        };
+
+        std::map<std::string, ObjectCounter> counters;
+
+
+        /**
+         *  Reads one heap figure from the allocator.  On glibc 2.33
+         *  or newer this uses mallinfo2(); older versions fall back
+         *  to mallinfo(), whose int fields wrap beyond 2 GB.  On
+         *  other C libraries all figures read as zero.
+         *
+         * @param which  HeapStat selecting the figure to read
+         *
+         * @return Returns the selected figure in bytes
+         */
+        static std::uint64_t heap_stat(HeapStat which)
+        {
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+            struct mallinfo2 mi = mallinfo2();
+#else
+            struct mallinfo mi = mallinfo();
+#endif
+            switch (which)
+            {
+            case HeapStat::ARENA:
+                return (std::uint64_t) mi.arena;
+            case HeapStat::ALLOCATED:
+                return (std::uint64_t) mi.uordblks;
+            case HeapStat::FREE:
+                return (std::uint64_t) mi.fordblks;
+            case HeapStat::MMAPPED:
+                return (std::uint64_t) mi.hblkhd;
+            }
+#endif
+            return 0;
+        }
+
+
+        /**
+         *  Builds the object_counts property value by querying every
+         *  registered counter
+         *
+         * @return Returns a floating GVariant a{st} dictionary
+         */
+        GVariant * build_object_counts()
+        {
+            GVariantBuilder *b = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a{st}"));
+            for (auto& item : counters)
+            {
+                g_variant_builder_add(b, "{st}",
+                                      item.first.c_str(),
+                                      item.second());
+            }
+            GVariant *ret = g_variant_builder_end(b);
+            GVariantBuilderPool::Release(b);
+            return ret;
+        }
+
+
+        /**
+         *  Dispatch handler for the TrimHeap method call, which asks
+         *  the allocator to return free heap pages to the kernel
+         */
+        void method_trim_heap(GDBusConnection *conn,
+                              const std::string& sender,
+                              GVariant *params,
+                              GDBusMethodInvocation *invoc)
+        {
+            bool trimmed = false;
+#ifdef __GLIBC__
+            trimmed = (malloc_trim(0) > 0);
+#endif
+            GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+            g_variant_builder_add(ret, "b", trimmed);
+            g_dbus_method_invocation_return_value(invoc,
+                                                  g_variant_builder_end(ret));
+            g_variant_builder_unref(ret);
+        }
+    };
+};  // namespace openvpn
+#endif // OPENVPN3_DBUS_DEBUG_MEMORY_HPP
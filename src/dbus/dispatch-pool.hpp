@@ -0,0 +1,298 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   dispatch-pool.hpp
+ *
+ * @brief  Worker pool executing D-Bus method calls off the GLib main
+ *         loop, with a strict per-object serialization guarantee.
+ *
+ *         A service where every method call runs on the single main
+ *         loop thread suffers head-of-line blocking: one slow method
+ *         on one object delays every call on every other object.
+ *         This pool gives each object its own ordered task queue; at
+ *         most one task per object runs at any time (so an object's
+ *         methods still execute in arrival order, never concurrently
+ *         with each other), while tasks of different objects run in
+ *         parallel on the worker threads.  Any worker picks up any
+ *         object with pending work, so the aggregate throughput
+ *         scales with the number of workers instead of being bound
+ *         to one thread.
+ *
+ *         The main loop keeps doing the routing only; see
+ *         DBusObject::EnableThreadedDispatch() in dbus/object.hpp for
+ *         how method invocations are handed over to this pool.
+ */
+
+#ifndef OPENVPN3_DBUS_DISPATCH_POOL_HPP
+#define OPENVPN3_DBUS_DISPATCH_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openvpn
+{
+    class DBusDispatchPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        /**
+         *  Constructs the pool and starts the worker threads
+         *
+         * @param num_workers  Number of worker threads to start.  The
+         *                     default (0) sizes the pool after the
+         *                     number of online CPUs, within reasonable
+         *                     bounds.
+         */
+        DBusDispatchPool(unsigned int num_workers = 0)
+        {
+            if (0 == num_workers)
+            {
+                num_workers = std::thread::hardware_concurrency();
+                if (num_workers < 2)
+                {
+                    num_workers = 2;
+                }
+                else if (num_workers > 8)
+                {
+                    num_workers = 8;
+                }
+            }
+            for (unsigned int i = 0; i < num_workers; i++)
+            {
+                workers.push_back(std::thread(&DBusDispatchPool::worker_loop,
+                                              this));
+            }
+        }
+
+
+        ~DBusDispatchPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(guard);
+                stop = true;
+            }
+            queue_cond.notify_all();
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        DBusDispatchPool(const DBusDispatchPool&) = delete;
+        DBusDispatchPool& operator=(const DBusDispatchPool&) = delete;
+
+
+        /**
+         *  Queues a task on the ordered queue of the given object.
+         *  Tasks queued under the same key run one at a time, in the
+         *  order they were queued; tasks queued under different keys
+         *  run in parallel.
+         *
+         * @param key   Opaque pointer identifying the object the task
+         *              belongs to, typically the object itself
+         * @param task  The work to execute on a worker thread
+         */
+        void Enqueue(void *key, Task task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(guard);
+                ObjectQueue& objq = queues[key];
+                objq.tasks.push_back(std::move(task));
+                if (!objq.running && !objq.scheduled)
+                {
+                    objq.scheduled = true;
+                    ready_keys.push_back(key);
+                }
+            }
+            queue_cond.notify_one();
+        }
+
+
+        /**
+         *  Waits until every task queued for the given object has
+         *  finished.  Must be called before the object behind the key
+         *  is destroyed, so no worker can touch a deleted object.
+         *
+         *  When called from within one of the object's own tasks, the
+         *  remaining queued tasks are executed inline - still in
+         *  order, still serialized - instead of deadlocking on the
+         *  task we are running from.
+         *
+         * @param key  The object key used when queueing the tasks
+         */
+        void Flush(void *key)
+        {
+            std::unique_lock<std::mutex> lock(guard);
+            auto it = queues.find(key);
+            if (queues.end() == it)
+            {
+                return;
+            }
+
+            if (it->second.running
+                && std::this_thread::get_id() == it->second.worker)
+            {
+                while (queues.end() != it && !it->second.tasks.empty())
+                {
+                    Task task = std::move(it->second.tasks.front());
+                    it->second.tasks.pop_front();
+                    lock.unlock();
+                    run_task(task);
+                    lock.lock();
+                    it = queues.find(key);
+                }
+                if (queues.end() != it)
+                {
+                    // The worker loop we were called from erases the
+                    // queue entry when the current task returns
+                    it->second.detached = true;
+                }
+                return;
+            }
+
+            drained_cond.wait(lock,
+                              [this, key]()
+                              {
+                                  return queues.end() == queues.find(key);
+                              });
+        }
+
+
+    private:
+        /**
+         *  Per-object task queue state.  The entry exists only while
+         *  the object has queued or running work; an idle object costs
+         *  nothing.
+         */
+        struct ObjectQueue
+        {
+            std::deque<Task> tasks;
+            bool running = false;    ///< A worker is executing a task now
+            bool scheduled = false;  ///< The key is on the ready list
+            bool detached = false;   ///< Erase the entry when the
+                                     ///< running task returns; set by
+                                     ///< Flush() called from the task
+            std::thread::id worker;  ///< Thread running the current task
+        };
+
+        std::mutex guard;
+        std::condition_variable queue_cond;
+        std::condition_variable drained_cond;
+        std::map<void *, ObjectQueue> queues;
+        std::deque<void *> ready_keys;
+        bool stop = false;
+        std::vector<std::thread> workers;
+
+
+        /**
+         *  Main loop of one worker thread.  Picks the next object
+         *  with pending work off the shared ready list, runs one of
+         *  its tasks and puts the object back on the list if more
+         *  tasks arrived meanwhile.
+         */
+        void worker_loop()
+        {
+            std::unique_lock<std::mutex> lock(guard);
+            while (true)
+            {
+                queue_cond.wait(lock,
+                                [this]()
+                                {
+                                    return stop || !ready_keys.empty();
+                                });
+                if (ready_keys.empty())
+                {
+                    // Only reached on shutdown, after the remaining
+                    // work has been drained
+                    return;
+                }
+
+                void *key = ready_keys.front();
+                ready_keys.pop_front();
+                auto it = queues.find(key);
+                if (queues.end() == it)
+                {
+                    continue;
+                }
+                it->second.scheduled = false;
+                if (it->second.tasks.empty())
+                {
+                    queues.erase(it);
+                    drained_cond.notify_all();
+                    continue;
+                }
+
+                it->second.running = true;
+                it->second.worker = std::this_thread::get_id();
+                Task task = std::move(it->second.tasks.front());
+                it->second.tasks.pop_front();
+
+                lock.unlock();
+                run_task(task);
+                lock.lock();
+
+                // The entry cannot be erased by anyone else while
+                // running is set; re-find it since other entries may
+                // have come and gone while the lock was released
+                it = queues.find(key);
+                it->second.running = false;
+                if (it->second.detached || it->second.tasks.empty())
+                {
+                    queues.erase(it);
+                    drained_cond.notify_all();
+                }
+                else
+                {
+                    it->second.scheduled = true;
+                    ready_keys.push_back(key);
+                    queue_cond.notify_one();
+                }
+            }
+        }
+
+
+        /**
+         *  Executes one task, keeping the worker thread alive if the
+         *  task leaks an exception.  Method handlers are expected to
+         *  convert their errors into D-Bus error replies themselves;
+         *  this is the last line of defense.
+         */
+        void run_task(Task& task)
+        {
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                // Nothing sensible can be done with it here; the
+                // invocation this task served will time out on the
+                // caller's side
+            }
+        }
+    };
+};
+#endif // OPENVPN3_DBUS_DISPATCH_POOL_HPP
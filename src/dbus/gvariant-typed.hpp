@@ -0,0 +1,174 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   gvariant-typed.hpp
+ *
+ * @brief  Compile-time typed GVariant construction.
+ *
+ *         g_variant_new("(uus)", ...) parses and validates the format
+ *         string on every call.  For values built once per method
+ *         call that cost is noise, but the signal emitters run on
+ *         every log line and status change.  The helpers here map
+ *         C++ argument types to the matching GVariant leaf
+ *         constructors at compile time and assemble containers
+ *         through the low-level g_variant_new_tuple() and
+ *         g_variant_new_dict_entry() entry points, so no format text
+ *         is ever parsed at runtime and a type mismatch is a
+ *         compile error instead of a runtime g_critical().
+ */
+
+#ifndef OPENVPN3_DBUS_GVARIANT_TYPED_HPP
+#define OPENVPN3_DBUS_GVARIANT_TYPED_HPP
+
+#include <string>
+#include <vector>
+
+#include <gio/gio.h>
+
+
+class GVariantTyped
+{
+public:
+    /**
+     *  Leaf value constructors.  Each C++ type maps to exactly one
+     *  GVariant basic type; the overload set is resolved at compile
+     *  time by the Tuple() and DictEntry() helpers below.
+     */
+    static GVariant * Value(bool v)
+    {
+        return g_variant_new_boolean(v);
+    }
+
+    static GVariant * Value(guint32 v)
+    {
+        return g_variant_new_uint32(v);
+    }
+
+    static GVariant * Value(gint32 v)
+    {
+        return g_variant_new_int32(v);
+    }
+
+    static GVariant * Value(guint64 v)
+    {
+        return g_variant_new_uint64(v);
+    }
+
+    static GVariant * Value(gint64 v)
+    {
+        return g_variant_new_int64(v);
+    }
+
+    static GVariant * Value(double v)
+    {
+        return g_variant_new_double(v);
+    }
+
+    static GVariant * Value(const char *v)
+    {
+        return g_variant_new_string(v);
+    }
+
+    static GVariant * Value(const std::string& v)
+    {
+        return g_variant_new_string(v.c_str());
+    }
+
+    /**
+     *  Pass-through for already constructed values, so nested
+     *  containers can be placed inside a Tuple()
+     */
+    static GVariant * Value(GVariant *v)
+    {
+        return v;
+    }
+
+
+    /**
+     *  Builds a tuple from the arguments, with the element types
+     *  deduced at compile time.  GVariantTyped::Tuple(a, b, c) is the
+     *  drop-in replacement for g_variant_new("(...)", a, b, c)
+     *  without the format string.
+     *
+     * @return Returns a floating GVariant tuple reference, exactly
+     *         like g_variant_new()
+     */
+    template<typename... T>
+    static GVariant * Tuple(const T&... args)
+    {
+        GVariant *children[sizeof...(T)] = { Value(args)... };
+        return g_variant_new_tuple(children, sizeof...(T));
+    }
+
+
+    /**
+     *  Builds a single {sv}-style dictionary entry with a typed value
+     */
+    template<typename V>
+    static GVariant * DictEntry(const char *key, const V& value)
+    {
+        return g_variant_new_dict_entry(g_variant_new_string(key),
+                                        Value(value));
+    }
+
+
+    /**
+     *  Incremental builder for a{sx} dictionaries (the connection
+     *  statistics shape), assembling dict entries without any
+     *  per-entry format string parsing.  The entry buffer is reused
+     *  across End() calls when the builder object is kept around.
+     */
+    class DictInt64
+    {
+    public:
+        void Add(const std::string& key, gint64 value)
+        {
+            children.push_back(g_variant_new_dict_entry(
+                                   g_variant_new_string(key.c_str()),
+                                   g_variant_new_int64(value)));
+        }
+
+        /**
+         *  Finishes the dictionary and resets the builder for reuse
+         *
+         * @return Returns a floating GVariant of type a{sx}
+         */
+        GVariant * End()
+        {
+            GVariant *ret;
+            if (children.empty())
+            {
+                ret = g_variant_new_array(G_VARIANT_TYPE("{sx}"), NULL, 0);
+            }
+            else
+            {
+                ret = g_variant_new_array(NULL, children.data(),
+                                          children.size());
+            }
+            children.clear();
+            return ret;
+        }
+
+    private:
+        std::vector<GVariant *> children;
+    };
+};
+
+#endif  // OPENVPN3_DBUS_GVARIANT_TYPED_HPP
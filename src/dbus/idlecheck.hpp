@@ -20,15 +20,29 @@
 #ifndef OPENVPN3_DBUS_IDLECHECK_HPP
 #define OPENVPN3_DBUS_IDLECHECK_HPP
 
+#include <chrono>
 #include <iostream>
-#include <memory>
-#include <thread>
 
 #include <openvpn/common/rc.hpp>
 
+#include "dbus/mainloop-rc.hpp"
+
 using namespace openvpn;
 
-class IdleCheck : public RC<thread_safe_refcount>
+/**
+ *  Shuts down an idle service by quitting its GMainLoop once no D-Bus
+ *  objects are registered (RefCountInc()/RefCountDec()) and no activity
+ *  (UpdateTimestamp()) has been seen for the configured idle time.
+ *
+ *  The idle detection is driven by a single-shot GLib timeout source
+ *  hooked into the service main loop.  The source is only armed while
+ *  the object count is zero and is scheduled for the moment the idle
+ *  time expires, so a completely idle process does not wake up at all
+ *  before its shutdown deadline.  All the methods below are expected
+ *  to be called from the main loop thread, which is where the GDBus
+ *  callbacks of these services run.
+ */
+class IdleCheck : public RC<mainloop_refcount>
 {
 public:
     typedef RCPtr<IdleCheck> Ptr;
@@ -36,105 +50,155 @@ public:
     IdleCheck(GMainLoop *mainloop, std::chrono::duration<double> idle_time)
         : mainloop(mainloop),
           idle_time(idle_time),
-          poll_time(idle_time),
           enabled(false),
-          running(false),
-          refcount(0)
+          refcount(0),
+          timeout_source(0)
     {
             UpdateTimestamp();
     }
 
 
-    void UpdateTimestamp()
+    ~IdleCheck()
     {
-        last_operation = std::chrono::system_clock::now();
+        drop_timer();
     }
 
 
-    void SetPollTime(std::chrono::duration<double> pollt)
+    /**
+     *  Registers activity.  The shutdown deadline moves accordingly;
+     *  the timer itself is left alone and re-arms itself for the
+     *  remaining time when it fires, which keeps this method cheap
+     *  for busy services.
+     */
+    void UpdateTimestamp()
     {
-        poll_time = pollt;
+        last_operation = std::chrono::system_clock::now();
     }
 
 
     void Enable()
     {
-        if (running)
-        {
-            return;
-        }
-
         if (enabled)
         {
             return;
         }
 
         enabled = true;
-        idle_checker.reset(new std::thread([self=Ptr(this)]()
-                           {
-                               self->_cb_idlechecker__loop();
-                           }));
+        if (0 == refcount)
+        {
+            arm_timer();
+        }
     }
 
 
     void Disable()
     {
         enabled = false;
+        drop_timer();
     }
 
 
     void RefCountInc()
     {
         refcount++;
+        // While objects are registered the process must not shut
+        // down, so no timer needs to run either
+        drop_timer();
     }
 
 
     void RefCountDec()
     {
         refcount--;
+        if (0 == refcount)
+        {
+            UpdateTimestamp();
+            arm_timer();
+        }
     }
 
 
-    void Join()
+    /**
+     *  Evaluates the idle state when the timeout source fires.  Either
+     *  initiates the main loop shutdown or re-arms the timer for the
+     *  remaining idle time if activity happened after it was scheduled.
+     *
+     * @return Always returns G_SOURCE_REMOVE; re-arming schedules a
+     *         fresh single-shot source
+     */
+    gboolean _cb_idlechecker__evaluate()
     {
-        idle_checker->join();
-    }
-
+        timeout_source = 0;
+        if (!enabled || 0 < refcount)
+        {
+            return G_SOURCE_REMOVE;
+        }
 
-    void _cb_idlechecker__loop()
-    {
-        running = true;
-        while( enabled )
+        auto now = std::chrono::system_clock::now();
+        if ((last_operation + idle_time) < now)
         {
-            // FIXME: Consider to swap sleep_for() with
-            // std::condition_variable::wait_for() which can
-            // unlock on cv.notify_one() call.
-            std::this_thread::sleep_for(poll_time);
-            auto now = std::chrono::system_clock::now();
-            if (0 == refcount && (last_operation + idle_time) < now)
-            {
-                // We timed out, start the main loop shutdown
+            // We timed out, start the main loop shutdown
 #ifdef SHUTDOWN_NOTIF_PROCESS_NAME
             std::cout << SHUTDOWN_NOTIF_PROCESS_NAME
                       << " starting idle shutdown "
                       << "(pid: " << std::to_string(getpid()) << ")"
                       << std::endl;
 #endif
-                g_main_loop_quit(mainloop);
-                enabled = false;
-            }
+            g_main_loop_quit(mainloop);
+            enabled = false;
+            return G_SOURCE_REMOVE;
         }
-        running = false;
+
+        arm_timer();
+        return G_SOURCE_REMOVE;
     }
 
 private:
     GMainLoop *mainloop;
     std::chrono::duration<double> idle_time;
-    std::chrono::duration<double> poll_time;
     bool enabled;
-    bool running;
     uint16_t refcount;
+    guint timeout_source;
     std::chrono::time_point<std::chrono::system_clock> last_operation;
-    std::unique_ptr<std::thread> idle_checker;
+
+
+    /**
+     *  Schedules the timeout source for the moment the idle time runs
+     *  out, based on the last registered activity
+     */
+    void arm_timer()
+    {
+        if (0 != timeout_source || !enabled)
+        {
+            return;
+        }
+
+        auto deadline = last_operation + idle_time;
+        auto now = std::chrono::system_clock::now();
+        guint delay_ms = 0;
+        if (now < deadline)
+        {
+            delay_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            deadline - now).count() + 1;
+        }
+        timeout_source = g_timeout_add(delay_ms, idle_timeout_cb, this);
+    }
+
+
+    void drop_timer()
+    {
+        if (0 != timeout_source)
+        {
+            g_source_remove(timeout_source);
+            timeout_source = 0;
+        }
+    }
+
+
+    static gboolean idle_timeout_cb(gpointer this_ptr)
+    {
+        IdleCheck *ichk = (IdleCheck *) this_ptr;
+        return ichk->_cb_idlechecker__evaluate();
+    }
 };
 #endif // OPENVPN3_DBUS_IDLECHECK_HPP
@@ -0,0 +1,116 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   mainloop-rc.hpp
+ *
+ * @brief  Reference count policy for objects confined to the GLib
+ *         main loop thread
+ */
+
+#ifndef OPENVPN3_DBUS_MAINLOOP_RC_HPP
+#define OPENVPN3_DBUS_MAINLOOP_RC_HPP
+
+#ifndef NDEBUG
+#include <cassert>
+#include <thread>
+#endif
+
+#include <openvpn/common/rc.hpp>
+
+using namespace openvpn;
+
+/**
+ *  Reference count policy for RC<> based classes which live their whole
+ *  life on the GLib main loop thread, which is where all the GDBus
+ *  callbacks of these services run.
+ *
+ *  Such objects do not need the atomic read-modify-write operations of
+ *  thread_safe_refcount; every Ptr copy and destruction then becomes a
+ *  plain increment or decrement.  In debug builds each refcount
+ *  operation asserts that it happens on the thread which created the
+ *  object, so a class which later grows a thread crossing is caught
+ *  immediately instead of corrupting its refcount silently.
+ */
+class mainloop_refcount
+{
+public:
+    mainloop_refcount() noexcept
+#ifndef NDEBUG
+        : owner(std::this_thread::get_id())
+#endif
+    {
+    }
+
+    mainloop_refcount(const mainloop_refcount&) = delete;
+    mainloop_refcount& operator=(const mainloop_refcount&) = delete;
+
+    void operator++() noexcept
+    {
+        assert_confined();
+        ++rc;
+    }
+
+    long operator--() noexcept
+    {
+        assert_confined();
+        return --rc;
+    }
+
+    bool inc_if_nonzero() noexcept
+    {
+        assert_confined();
+        if (0 == rc)
+        {
+            return false;
+        }
+        ++rc;
+        return true;
+    }
+
+    long use_count() const noexcept
+    {
+        return rc;
+    }
+
+    static constexpr bool is_thread_safe()
+    {
+        return false;
+    }
+
+private:
+    /**
+     *  Verifies, in debug builds only, that the calling thread is the
+     *  thread which constructed this object
+     */
+    void assert_confined() const noexcept
+    {
+#ifndef NDEBUG
+        assert(std::this_thread::get_id() == owner
+               && "mainloop_refcount object used outside its owning thread");
+#endif
+    }
+
+    long rc = 0;
+#ifndef NDEBUG
+    std::thread::id owner;
+#endif
+};
+
+#endif // OPENVPN3_DBUS_MAINLOOP_RC_HPP
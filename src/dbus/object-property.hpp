@@ -21,13 +21,18 @@
 
 #pragma once
 
+#include <unordered_map>
+
 #include <openvpn/common/rc.hpp>
 
+#include "dbus/mainloop-rc.hpp"
 #include "dbus/object.hpp"
 
 using namespace openvpn;
 
-class Property : public RC<thread_safe_refcount>
+// Properties are only ever touched from the GDBus property callbacks,
+// which all run on the service main loop
+class Property : public RC<mainloop_refcount>
 {
 public:
     typedef RCPtr<Property> Ptr;
@@ -68,9 +73,34 @@ public:
         return allow_root;
     }
 
+    virtual ~PropertyType()
+    {
+        if (cached_variant)
+        {
+            g_variant_unref(cached_variant);
+        }
+    }
+
     virtual GVariant *GetValue() const override
     {
-        return g_variant_new(dbus_type.c_str(), *value);
+        // Most properties are read far more often than they change.
+        // Keep the serialized GVariant around and hand out new
+        // references to it for as long as the backing value is
+        // unchanged; this also stays correct when the owning object
+        // modifies the value directly without going through SetValue()
+        if (cached_variant && cached_value == *value)
+        {
+            return g_variant_ref(cached_variant);
+        }
+
+        if (cached_variant)
+        {
+            g_variant_unref(cached_variant);
+        }
+        cached_variant = g_variant_ref_sink(g_variant_new(dbus_type.c_str(),
+                                                          *value));
+        cached_value = *value;
+        return g_variant_ref(cached_variant);
     }
 
     virtual GVariantBuilder *SetValue(GVariant *value_arg) override
@@ -91,6 +121,8 @@ private:
     std::string dbus_acl;
     bool allow_root;
     T *value = nullptr;
+    mutable T cached_value;
+    mutable GVariant *cached_variant = nullptr;
 };
 
 
@@ -150,5 +182,8 @@ class PropertyCollection
     }
 
   private:
-    std::map<std::string, Property::Ptr> properties;
+    // Property lookups happen on every Get/Set property D-Bus call;
+    // resolve them with a hash lookup instead of ordered string
+    // comparisons
+    std::unordered_map<std::string, Property::Ptr> properties;
 };
@@ -20,6 +20,12 @@
 #ifndef OPENVPN3_DBUS_OBJECT_HPP
 #define OPENVPN3_DBUS_OBJECT_HPP
 
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "dispatch-pool.hpp"
 #include "idlecheck.hpp"
 
 namespace openvpn
@@ -52,6 +58,25 @@ namespace openvpn
     class DBusObject
     {
     public:
+        /**
+         *  Handler signature for a method registered in the dispatch
+         *  table.  The handler owns the method invocation and must
+         *  return a value or error on it.
+         */
+        using MethodDispatchHandler = std::function<void(GDBusConnection *conn,
+                                                         const std::string& sender,
+                                                         GVariant *params,
+                                                         GDBusMethodInvocation *invoc)>;
+
+        /**
+         *  Handler signature for a property getter registered in the
+         *  dispatch table.  Same contract as callback_get_property():
+         *  return the property value, or NULL with the error set.
+         */
+        using PropertyGetHandler = std::function<GVariant *(GDBusConnection *conn,
+                                                            const std::string& sender,
+                                                            GError **error)>;
+
         DBusObject(std::string obj_path, std::string introspection_xml) :
             registered(false),
             object_path(obj_path),
@@ -143,6 +168,16 @@ namespace openvpn
             // Remove the object from the D-Bus
             g_dbus_connection_unregister_object(dbuscon, object_id);
 
+            // With threaded dispatch active, wait until every method
+            // call already handed to the worker pool has finished.
+            // New calls can no longer arrive, so after this no thread
+            // touches this object again
+            if (dispatch_pool)
+            {
+                dispatch_pool->Flush(this);
+                dispatch_pool = nullptr;
+            }
+
             // Allow the implementor to add more cleaning up
             callback_destructor();
 
@@ -399,11 +434,85 @@ namespace openvpn
         virtual void callback_destructor () {}
 
     protected:
+        /**
+         *  Registers a handler for a D-Bus method in the object's
+         *  dispatch table.  Dispatch then costs one hash lookup and
+         *  one indirect call instead of walking a chain of string
+         *  comparisons in callback_method_call().  The table is meant
+         *  to be filled once, during object construction; method names
+         *  without a registered handler still fall back to the virtual
+         *  callback_method_call().
+         *
+         * @param meth_name  D-Bus method name the handler serves
+         * @param handler    MethodDispatchHandler callable handling the
+         *                   method invocation
+         */
+        void RegisterMethodHandler(const std::string meth_name,
+                                   MethodDispatchHandler handler)
+        {
+            method_dispatch[meth_name] = handler;
+        }
+
+
+        /**
+         *  Registers a handler for a D-Bus property read in the
+         *  object's dispatch table, with the same lookup semantics as
+         *  @RegisterMethodHandler().  Property names without a
+         *  registered handler fall back to the virtual
+         *  callback_get_property().
+         *
+         * @param property_name  D-Bus property name the handler serves
+         * @param handler        PropertyGetHandler callable returning
+         *                       the property value
+         */
+        void RegisterGetPropertyHandler(const std::string property_name,
+                                        PropertyGetHandler handler)
+        {
+            property_get_dispatch[property_name] = handler;
+        }
+
+
+        /**
+         *  Routes this object's incoming method calls through a
+         *  DBusDispatchPool instead of running them on the GLib main
+         *  loop thread.  The pool serializes the calls per object, so
+         *  the method handlers keep the one-call-at-a-time semantics
+         *  they were written for - but a slow call on this object no
+         *  longer blocks method calls on other objects, and the main
+         *  loop only does the routing.
+         *
+         *  Property reads and writes are quick and stay on the main
+         *  loop thread; implementors must keep that in mind for state
+         *  shared between property handlers and method handlers.
+         *
+         *  This is meant to be called once, during object
+         *  construction.  The pool must outlive this object;
+         *  RemoveObject() drains the object's queue before the object
+         *  can be deleted.
+         *
+         * @param pool  Pointer to the DBusDispatchPool to route the
+         *              method calls through, owned by the caller
+         */
+        void EnableThreadedDispatch(DBusDispatchPool *pool)
+        {
+            dispatch_pool = pool;
+        }
+
+
         /**
          *  Parses and processes the introspection XML document
          *  describing this object.  This is used when registering this object
          *  to the D-Bus bus.
          *
+         *  The parsed GDBusNodeInfo structures are kept in a process
+         *  wide cache.  Objects of the same class build byte-identical
+         *  introspection documents, apart from the object path in the
+         *  root node's name attribute - which the object registration
+         *  never looks at.  That attribute is stripped before the
+         *  document is used as cache key, so the XML is parsed once
+         *  per distinct document and every later registration just
+         *  takes a new reference on the shared structure.
+         *
          *  @param xmlstr  std::string containing the introspection XML document to use
          */
         void ParseIntrospectionXML(std::string xmlstr)
@@ -414,12 +523,29 @@ namespace openvpn
                                     "Cannot modify the introspection document.");
             }
 
+            strip_node_name(xmlstr);
+
+            static std::mutex cache_guard;
+            static std::map<std::string, GDBusNodeInfo *> cache;
+
+            std::lock_guard<std::mutex> lock(cache_guard);
+            auto cached = cache.find(xmlstr);
+            if (cache.end() != cached)
+            {
+                introspection = g_dbus_node_info_ref(cached->second);
+                return;
+            }
+
             GError *error = nullptr;
             introspection = g_dbus_node_info_new_for_xml(xmlstr.c_str(), &error);
             if (NULL == introspection || NULL != error)
             {
                 THROW_DBUSEXCEPTION("DBusObject", "Failed to parse introspection XML:" + std::string(error->message));
             }
+
+            // The cache keeps its own reference for the lifetime of
+            // the process
+            cache[xmlstr] = g_dbus_node_info_ref(introspection);
         }
 
 
@@ -483,6 +609,76 @@ namespace openvpn
         guint object_id;
         IdleCheck *idle_checker;
         GDBusNodeInfo *introspection;
+        std::unordered_map<std::string, MethodDispatchHandler> method_dispatch;
+        std::unordered_map<std::string, PropertyGetHandler> property_get_dispatch;
+        DBusDispatchPool *dispatch_pool = nullptr;
+
+
+        /**
+         *  Runs one method call through the dispatch table, falling
+         *  back to the virtual callback_method_call().  With threaded
+         *  dispatch enabled this executes on a pool worker thread,
+         *  otherwise directly on the main loop.
+         */
+        void dispatch_method_call(GDBusConnection *conn,
+                                  const std::string sender,
+                                  const std::string obj_path,
+                                  const std::string intf_name,
+                                  const std::string meth_name,
+                                  GVariant *params,
+                                  GDBusMethodInvocation *invoc)
+        {
+            // Methods registered in the dispatch table are routed with
+            // a single hash lookup and an indirect call
+            auto handler = method_dispatch.find(meth_name);
+            if (method_dispatch.end() != handler)
+            {
+                IdleCheck_UpdateTimestamp();
+                handler->second(conn, sender, params, invoc);
+                return;
+            }
+
+            callback_method_call(conn, sender, obj_path, intf_name,
+                                 meth_name, params, invoc);
+        }
+
+
+        /**
+         *  Removes the name attribute from the root node tag of an
+         *  introspection XML document, in place.  The attribute
+         *  carries the per-object D-Bus path and is the only part
+         *  of the document which differs between objects of the same
+         *  class; removing it makes the document usable as a cache
+         *  key shared by all of them.
+         *
+         *  @param xmlstr  std::string with the XML document to modify
+         */
+        static void strip_node_name(std::string& xmlstr)
+        {
+            std::string::size_type node = xmlstr.find("<node");
+            if (std::string::npos == node)
+            {
+                return;
+            }
+            std::string::size_type tag_end = xmlstr.find(">", node);
+            std::string::size_type name = xmlstr.find("name=", node);
+            if (std::string::npos == name || std::string::npos == tag_end
+                || name > tag_end)
+            {
+                return;
+            }
+            char quote = xmlstr[name + 5];
+            if ('\'' != quote && '"' != quote)
+            {
+                return;
+            }
+            std::string::size_type close = xmlstr.find(quote, name + 6);
+            if (std::string::npos == close || close > tag_end)
+            {
+                return;
+            }
+            xmlstr.erase(name, close - name + 1);
+        }
 
         /**
          *  Callback loook-up table for D-Bus
@@ -504,7 +700,32 @@ namespace openvpn
                                                      gpointer this_ptr)
         {
             class DBusObject *obj = (class DBusObject *) this_ptr;
-            obj->callback_method_call(conn,
+
+            if (obj->dispatch_pool)
+            {
+                // Hand the call over to the worker pool, keyed on the
+                // object so its calls stay serialized.  The invocation
+                // object keeps itself and the parameters alive until
+                // the handler returns its reply, which GDBus accepts
+                // from any thread.
+                std::string sender_s(sender);
+                std::string obj_path_s(obj_path);
+                std::string intf_name_s(intf_name);
+                std::string meth_name_s(meth_name);
+                obj->dispatch_pool->Enqueue(obj,
+                            [obj, conn, sender_s, obj_path_s, intf_name_s,
+                             meth_name_s, params, invoc]()
+                            {
+                                obj->dispatch_method_call(conn, sender_s,
+                                                          obj_path_s,
+                                                          intf_name_s,
+                                                          meth_name_s,
+                                                          params, invoc);
+                            });
+                return;
+            }
+
+            obj->dispatch_method_call(conn,
                                       std::string(sender),
                                       std::string(obj_path),
                                       std::string(intf_name),
@@ -522,6 +743,13 @@ namespace openvpn
                                                            gpointer this_ptr)
         {
             class DBusObject *obj = (class DBusObject *) this_ptr;
+
+            auto handler = obj->property_get_dispatch.find(property_name);
+            if (obj->property_get_dispatch.end() != handler)
+            {
+                return handler->second(conn, std::string(sender), error);
+            }
+
             return obj->callback_get_property(conn,
                                               std::string(sender),
                                               std::string(obj_path),
@@ -0,0 +1,73 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   prestart.hpp
+ *
+ * @brief  Asynchronous pre-activation of peer D-Bus services
+ */
+
+#ifndef OPENVPN3_DBUS_PRESTART_HPP
+#define OPENVPN3_DBUS_PRESTART_HPP
+
+#include <string>
+#include <vector>
+
+namespace openvpn
+{
+    /**
+     *  Asks the D-Bus daemon to activate a set of peer services,
+     *  without waiting for any of them to appear.
+     *
+     *  The bus daemon launches each service at most once and queues
+     *  method calls to a name until its owner has registered, so
+     *  pre-activating the services a caller will need shortly lets
+     *  all of them run their startup in parallel with the caller's
+     *  own setup, instead of each one being activated on first use
+     *  at the tail of the previous one.
+     *
+     *  The activation results are deliberately ignored; a service
+     *  which fails to start is reported on the first real method
+     *  call to it, with the same error as without pre-activation.
+     *
+     * @param conn      D-Bus connection to request the activations on
+     * @param services  Well-known bus names of the services to activate
+     */
+    inline void DBusPrestartServices(GDBusConnection *conn,
+                                     const std::vector<std::string>& services)
+    {
+        for (const auto& service : services)
+        {
+            g_dbus_connection_call(conn,
+                                   "org.freedesktop.DBus",
+                                   "/org/freedesktop/DBus",
+                                   "org.freedesktop.DBus",
+                                   "StartServiceByName",
+                                   g_variant_new("(su)",
+                                                 service.c_str(), 0),
+                                   G_VARIANT_TYPE("(u)"),
+                                   G_DBUS_CALL_FLAGS_NONE,
+                                   -1,       // Default timeout
+                                   NULL,     // Not cancellable
+                                   NULL,     // Fire-and-forget, no callback
+                                   NULL);
+        }
+    }
+};
+#endif // OPENVPN3_DBUS_PRESTART_HPP
@@ -20,6 +20,8 @@
 #ifndef OPENVPN3_DBUS_PROXY_HPP
 #define OPENVPN3_DBUS_PROXY_HPP
 
+#include <future>
+
 namespace openvpn
 {
     class DBusProxy : public DBus
@@ -242,6 +244,53 @@ namespace openvpn
         }
 
 
+        /**
+         *  Calls a D-Bus method asynchronously.  The method call is put
+         *  on the wire immediately and this call returns without waiting
+         *  for the service to respond.  The result is delivered through
+         *  the returned std::future once the thread-default GMainContext
+         *  of the calling thread has been iterated.
+         *
+         *  This allows a caller to issue method calls against many
+         *  services or objects in parallel and then collect the results,
+         *  instead of serializing one synchronous round trip per object.
+         *
+         * @param method  D-Bus method to call
+         * @param params  GVariant tuple with method arguments, or NULL
+         *
+         * @return Returns a std::future carrying the GVariant result of
+         *         the method call.  The caller must g_variant_unref() the
+         *         result.  If the method call failed, retrieving the
+         *         future value will throw a DBusException.
+         */
+        std::future<GVariant *> CallAsync(std::string method, GVariant *params)
+        {
+            if (method.empty())
+            {
+                THROW_DBUSEXCEPTION("DBusProxy", "Method cannot be empty");
+            }
+
+            AsyncCallData *cbdata = new AsyncCallData;
+            cbdata->method = method;
+            std::future<GVariant *> ret = cbdata->promise.get_future();
+            g_dbus_proxy_call(proxy,
+                              method.c_str(),
+                              params,
+                              call_flags,
+                              -1,       // timeout, -1 == default
+                              NULL,     // GCancellable
+                              async_call_ready,
+                              cbdata);
+            return ret;
+        }
+
+
+        std::future<GVariant *> CallAsync(std::string method)
+        {
+            return CallAsync(method, NULL);
+        }
+
+
         GVariant * GetProperty(std::string property)
         {
             if (property.empty())
@@ -284,6 +333,47 @@ namespace openvpn
         }
 
 
+        /**
+         *  Retrieves all properties of the object with a single
+         *  org.freedesktop.DBus.Properties.GetAll call, instead of one
+         *  bus round trip per property via GetProperty()
+         *
+         * @return Returns a GVariant object of type a{sv}, mapping
+         *         property names to their values.  The caller must
+         *         g_variant_unref() the result.  Individual values are
+         *         extracted with g_variant_lookup_value().
+         */
+        GVariant * GetAllProperties()
+        {
+            GError *error = NULL;
+            GVariant *response = g_dbus_proxy_call_sync(property_proxy,
+                                                        "GetAll",
+                                                        g_variant_new("(s)",
+                                                                      interface.c_str()),
+                                                        G_DBUS_CALL_FLAGS_NONE,
+                                                        -1,          // timeout, -1 == default
+                                                        NULL,        // GCancellable
+                                                        &error);
+            if (!response || error)
+            {
+                std::stringstream errmsg;
+                errmsg << "Failed calling D-Bus method "
+                       << "org.freedesktop.DBus.Properties.GetAll("
+                       << "interface=" << interface
+                       << ")";
+                if (error)
+                {
+                    errmsg << ": " << error->message;
+                }
+                THROW_DBUSEXCEPTION("DBusProxy", errmsg.str());
+            }
+            GVariant * ret = NULL;
+            g_variant_get(response, "(@a{sv})", &ret);
+            g_variant_unref(response);
+            return ret;
+        }
+
+
         bool GetBoolProperty(std::string property)
         {
             GVariant *res = GetProperty(property);
@@ -455,6 +545,57 @@ namespace openvpn
         bool proxy_init;
         bool property_proxy_init;
 
+        /**
+         *  Internal container following a single asynchronous method
+         *  call from CallAsync() until the response arrives.
+         */
+        struct AsyncCallData
+        {
+            std::promise<GVariant *> promise;
+            std::string method;
+        };
+
+
+        /**
+         *  GAsyncReadyCallback used by CallAsync().  Completes the
+         *  std::promise with either the method result or a DBusException
+         *  and releases the AsyncCallData container.
+         */
+        static void async_call_ready(GObject *source, GAsyncResult *res,
+                                     gpointer user_data)
+        {
+            AsyncCallData *cbdata = static_cast<AsyncCallData *>(user_data);
+
+            GError *error = NULL;
+            GVariant *ret = g_dbus_proxy_call_finish(G_DBUS_PROXY(source),
+                                                     res, &error);
+            if (!ret || error)
+            {
+                std::stringstream errmsg;
+                errmsg << "Failed calling D-Bus method "
+                       << cbdata->method << ": "
+                       << (error ? error->message : "(unspecified error)");
+                try
+                {
+                    THROW_DBUSEXCEPTION("DBusProxy", errmsg.str());
+                }
+                catch (DBusException&)
+                {
+                    cbdata->promise.set_exception(std::current_exception());
+                }
+                if (error)
+                {
+                    g_error_free(error);
+                }
+            }
+            else
+            {
+                cbdata->promise.set_value(ret);
+            }
+            delete cbdata;
+        }
+
+
         GVariant * dbus_proxy_call(GDBusProxy *prx, std::string method,
                                    GVariant *params, bool noresponse,
                                    GDBusCallFlags flags)
@@ -63,17 +63,28 @@ public:
      *                                 QueueCheck method
      * @param method_providereponse    String containing the name of the
      *                                 QueueProvideResponse method
+     * @param method_queuefetchall     (optional) String containing the name
+     *                                 of the batched QueueFetchAll method.
+     *                                 If empty, bulk fetches fall back to
+     *                                 one QueueFetch call per slot.
+     * @param method_provideall        (optional) String containing the name
+     *                                 of the batched QueueProvideAll method.
+     *                                 If empty, bulk responses fall back to
+     *                                 one ProvideResponse call per slot.
      *
      * The method names must match the defined introspection of the service
      * side.
      */
     DBusRequiresQueueProxy(GBusType bus_type, std::string destination , std::string interface, std::string objpath,
-                           std::string method_quechktypegroup, std::string method_queuefetch, std::string method_queuecheck, std::string method_providereponse)
+                           std::string method_quechktypegroup, std::string method_queuefetch, std::string method_queuecheck, std::string method_providereponse,
+                           std::string method_queuefetchall = "", std::string method_provideall = "")
         : DBusProxy(bus_type, destination, interface, objpath),
           method_quechktypegroup(method_quechktypegroup),
           method_queuefetch(method_queuefetch),
           method_queuecheck(method_queuecheck),
-          method_provideresponse(method_providereponse)
+          method_provideresponse(method_providereponse),
+          method_queuefetchall(method_queuefetchall),
+          method_provideall(method_provideall)
     {
     }
 
@@ -97,17 +108,28 @@ public:
      *                                 QueueCheck method
      * @param method_providereponse    String containing the name of the
      *                                 QueueProvideResponse method
+     * @param method_queuefetchall     (optional) String containing the name
+     *                                 of the batched QueueFetchAll method.
+     *                                 If empty, bulk fetches fall back to
+     *                                 one QueueFetch call per slot.
+     * @param method_provideall        (optional) String containing the name
+     *                                 of the batched QueueProvideAll method.
+     *                                 If empty, bulk responses fall back to
+     *                                 one ProvideResponse call per slot.
      *
      * The method names must match the defined introspection of the service
      * side.
      */
     DBusRequiresQueueProxy(DBus & dbusobj, std::string destination , std::string interface, std::string objpath,
-                           std::string method_quechktypegroup, std::string method_queuefetch, std::string method_queuecheck, std::string method_providereponse)
+                           std::string method_quechktypegroup, std::string method_queuefetch, std::string method_queuecheck, std::string method_providereponse,
+                           std::string method_queuefetchall = "", std::string method_provideall = "")
         : DBusProxy(dbusobj, destination, interface, objpath),
           method_quechktypegroup(method_quechktypegroup),
           method_queuefetch(method_queuefetch),
           method_queuecheck(method_queuecheck),
-          method_provideresponse(method_providereponse)
+          method_provideresponse(method_providereponse),
+          method_queuefetchall(method_queuefetchall),
+          method_provideall(method_provideall)
     {
     }
 
@@ -147,11 +169,40 @@ public:
      */
     void QueueFetchAll(std::vector<struct RequiresSlot>& slots, ClientAttentionType type, ClientAttentionGroup group)
     {
-        std::vector<unsigned int> reqids = QueueCheck(type, group);
-        for (auto& id : reqids)
+        if (method_queuefetchall.empty())
         {
-            slots.push_back(QueueFetch(type, group, id));
+            // Service does not provide a batched fetch method; do one
+            // QueueFetch round trip per unresolved slot instead.
+            std::vector<unsigned int> reqids = QueueCheck(type, group);
+            for (auto& id : reqids)
+            {
+                slots.push_back(QueueFetch(type, group, id));
+            }
+            return;
+        }
+
+        GVariant *res = Call(method_queuefetchall);
+        if (NULL == res)
+        {
+            THROW_DBUSEXCEPTION("DBusRequiresQueueProxy",
+                                "Failed during call to QueueFetchAll()");
+        }
+
+        GVariantIter *ar_slots = NULL;
+        g_variant_get(res, "(a(uuussb))", &ar_slots);
+
+        GVariant *e = NULL;
+        while ((e = g_variant_iter_next_value(ar_slots)))
+        {
+            struct RequiresSlot slot = deserialize(e);
+            if (slot.type == type && slot.group == group)
+            {
+                slots.push_back(std::move(slot));
+            }
+            g_variant_unref(e);
         }
+        g_variant_unref(res);
+        g_variant_iter_free(ar_slots);
     }
 
 
@@ -241,11 +292,51 @@ public:
     }
 
 
+    /**
+     *  Provides all the front-end responses in a single D-Bus call, if
+     *  the service implements the batched QueueProvideAll method.
+     *  Otherwise each slot is sent with a separate ProvideResponse() call.
+     *
+     * @param slots  A std::vector<RequiresSlot> of items with their
+     *               values filled in.
+     */
+    void ProvideAllResponses(std::vector<struct RequiresSlot>& slots)
+    {
+        if (method_provideall.empty())
+        {
+            for (auto& slot : slots)
+            {
+                ProvideResponse(slot);
+            }
+            return;
+        }
+
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("a(uuus)"));
+        for (auto& slot : slots)
+        {
+            g_variant_builder_add(bld, "(uuus)",
+                                  slot.type, slot.group, slot.id,
+                                  slot.value.c_str());
+        }
+        GVariant *res = Call(method_provideall,
+                             g_variant_new("(a(uuus))", bld));
+        g_variant_builder_unref(bld);
+        if (NULL == res)
+        {
+            THROW_DBUSEXCEPTION("DBusRequiresQueueProxy",
+                                "Failed during call to QueueProvideAll()");
+        }
+        g_variant_unref(res);
+    }
+
+
 private:
     std::string method_quechktypegroup;
     std::string method_queuefetch;
     std::string method_queuecheck;
     std::string method_provideresponse;
+    std::string method_queuefetchall;
+    std::string method_provideall;
 
 
     /**
@@ -21,6 +21,7 @@
 #define OPENVPN3_DBUS_SIGNALS_HPP
 
 #include <map>
+#include <vector>
 
 namespace openvpn
 {
@@ -36,6 +37,143 @@ namespace openvpn
     }
 
 
+    class DBusSignalSubscription;
+
+    /**
+     *  Process wide signal subscription hub.
+     *
+     *  Each g_dbus_connection_signal_subscribe() call installs a match
+     *  rule in the bus daemon, which is evaluated against every signal
+     *  passing through the bus.  A service holding per-object
+     *  subscriptions - like the session manager with its log and status
+     *  proxies per session - quickly accumulates hundreds of match
+     *  rules, all burning bus-daemon CPU.
+     *
+     *  The hub installs a single wildcard subscription per
+     *  (connection, interface) pair and routes incoming signals to the
+     *  registered handlers locally, via a dispatch table keyed by
+     *  sender and object path.  Registering any number of handlers on
+     *  the same interface therefore costs one match rule in total.
+     */
+    class DBusSignalHub
+    {
+    public:
+        /**
+         *  Registers a signal handler in the hub.  The wildcard bus
+         *  subscription for the (connection, interface) pair is
+         *  installed on first use.
+         *
+         * @param conn         D-Bus connection to receive signals on
+         * @param interface    D-Bus interface of the signals
+         * @param sender       D-Bus bus name to match, or "" for any
+         * @param object_path  D-Bus object path to match, or "" for any
+         * @param signal_name  Signal name to match, or "" for any
+         * @param handler      DBusSignalSubscription receiving matches
+         */
+        static void Register(GDBusConnection *conn,
+                             std::string interface,
+                             std::string sender,
+                             std::string object_path,
+                             std::string signal_name,
+                             DBusSignalSubscription *handler);
+
+        /**
+         *  Removes all handler registrations for a specific handler
+         *  object on a (connection, interface) pair.  The wildcard bus
+         *  subscription stays installed; it is shared with the other
+         *  handlers on the same interface.
+         *
+         * @param conn       D-Bus connection the handler was registered on
+         * @param interface  D-Bus interface the handler was registered on
+         * @param handler    The handler object to remove
+         */
+        static void Unregister(GDBusConnection *conn,
+                               std::string interface,
+                               DBusSignalSubscription *handler);
+
+        /**
+         *  Removes the handler registrations matching a specific signal
+         *  name for a handler object on a (connection, interface) pair
+         *
+         * @param conn         D-Bus connection the handler was registered on
+         * @param interface    D-Bus interface the handler was registered on
+         * @param signal_name  Signal name of the registrations to remove
+         * @param handler      The handler object to remove
+         */
+        static void Unregister(GDBusConnection *conn,
+                               std::string interface,
+                               std::string signal_name,
+                               DBusSignalSubscription *handler);
+
+    private:
+        /**
+         *  A single handler registration in the dispatch table
+         */
+        struct HandlerEntry
+        {
+            std::string sender;
+            std::string object_path;
+            std::string signal_name;
+            DBusSignalSubscription *handler;
+        };
+
+        /**
+         *  State of one wildcard bus subscription, covering all
+         *  handlers registered against one (connection, interface)
+         */
+        struct InterfaceHub
+        {
+            GDBusConnection *conn;
+            std::string interface;
+            guint subscription_id;
+
+            // Dispatch table.  Keyed by "sender|object_path" so an
+            // incoming signal finds its handlers with hash lookups
+            // instead of walking all registrations; entries with a
+            // wildcard sender or path are looked up under the partly
+            // empty keys.
+            std::multimap<std::string, struct HandlerEntry> handlers;
+        };
+
+        static std::string hash_key(const std::string& sender,
+                                    const std::string& object_path)
+        {
+            return sender + "|" + object_path;
+        }
+
+        static std::map<std::string, struct InterfaceHub>& hubs()
+        {
+            static std::map<std::string, struct InterfaceHub> h;
+            return h;
+        }
+
+        static std::string hub_key(GDBusConnection *conn,
+                                   const std::string& interface)
+        {
+            std::stringstream key;
+            key << (void *) conn << "|" << interface;
+            return key.str();
+        }
+
+        static void dispatch(struct InterfaceHub& hub,
+                             const std::string& key,
+                             GDBusConnection *conn,
+                             const gchar *sender,
+                             const gchar *obj_path,
+                             const gchar *intf_name,
+                             const gchar *sign_name,
+                             GVariant *params);
+
+        static void hub_signal_handler(GDBusConnection *conn,
+                                       const gchar *sender,
+                                       const gchar *obj_path,
+                                       const gchar *intf_name,
+                                       const gchar *sign_name,
+                                       GVariant *params,
+                                       gpointer hub_ptr);
+    };
+
+
     class DBusSignalSubscription
     {
     public:
@@ -168,6 +306,42 @@ namespace openvpn
         }
 
 
+        /**
+         *  Subscribes to a signal through the process wide
+         *  DBusSignalHub instead of installing a dedicated match rule
+         *  in the bus daemon.  All handlers sharing an interface on the
+         *  same connection then share a single bus-side subscription,
+         *  and the routing on sender/object path happens locally.
+         *
+         *  The callback_signal_handler() method is invoked for matches,
+         *  exactly as with Subscribe().
+         *
+         * @param busname      D-Bus bus name to match, or "" for any
+         * @param objpath      D-Bus object path to match, or "" for any
+         * @param signal_name  Signal name to match
+         */
+        void SubscribeShared(std::string busname, std::string objpath,
+                             std::string signal_name)
+        {
+            DBusSignalHub::Register(conn, interface, busname, objpath,
+                                    signal_name, this);
+            shared_subscription = true;
+            subscribed = true;
+        }
+
+
+        void SubscribeShared(std::string objpath, std::string signal_name)
+        {
+            SubscribeShared(bus_name, objpath, signal_name);
+        }
+
+
+        void SubscribeShared(std::string signal_name)
+        {
+            SubscribeShared(object_path, signal_name);
+        }
+
+
         void Unsubscribe(std::string signal_name)
         {
             if (subscriptions[signal_name] > 0)
@@ -175,6 +349,10 @@ namespace openvpn
                 g_dbus_connection_signal_unsubscribe(conn, subscriptions[signal_name]);
                 subscriptions[signal_name] = 0;
             }
+            if (shared_subscription)
+            {
+                DBusSignalHub::Unregister(conn, interface, signal_name, this);
+            }
         }
 
 
@@ -198,6 +376,11 @@ namespace openvpn
                 }
                 subscriptions[sub.first] = 0;
             }
+            if (shared_subscription)
+            {
+                DBusSignalHub::Unregister(conn, interface, this);
+                shared_subscription = false;
+            }
             subscribed = false;
         }
 
@@ -234,9 +417,160 @@ namespace openvpn
         std::string object_path;
         std::map<std::string, guint> subscriptions;
         bool subscribed;
+        bool shared_subscription = false;
     };
 
 
+    inline void DBusSignalHub::Register(GDBusConnection *conn,
+                                        std::string interface,
+                                        std::string sender,
+                                        std::string object_path,
+                                        std::string signal_name,
+                                        DBusSignalSubscription *handler)
+    {
+        std::string key = hub_key(conn, interface);
+        auto hub = hubs().find(key);
+        if (hubs().end() == hub)
+        {
+            // First handler on this (connection, interface); install
+            // the one and only wildcard subscription for it
+            struct InterfaceHub newhub;
+            newhub.conn = conn;
+            newhub.interface = interface;
+            hubs()[key] = newhub;
+            hub = hubs().find(key);
+            hub->second.subscription_id =
+                g_dbus_connection_signal_subscribe(conn,
+                                                   NULL,
+                                                   string2C_char(interface),
+                                                   NULL,
+                                                   NULL,
+                                                   NULL,
+                                                   G_DBUS_SIGNAL_FLAGS_NONE,
+                                                   hub_signal_handler,
+                                                   &hub->second,
+                                                   NULL);
+        }
+
+        struct HandlerEntry entry;
+        entry.sender = sender;
+        entry.object_path = object_path;
+        entry.signal_name = signal_name;
+        entry.handler = handler;
+        hub->second.handlers.insert(std::make_pair(hash_key(sender,
+                                                            object_path),
+                                                   entry));
+    }
+
+
+    inline void DBusSignalHub::Unregister(GDBusConnection *conn,
+                                          std::string interface,
+                                          DBusSignalSubscription *handler)
+    {
+        auto hub = hubs().find(hub_key(conn, interface));
+        if (hubs().end() == hub)
+        {
+            return;
+        }
+        for (auto it = hub->second.handlers.begin();
+             it != hub->second.handlers.end();)
+        {
+            if (it->second.handler == handler)
+            {
+                it = hub->second.handlers.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+
+    inline void DBusSignalHub::Unregister(GDBusConnection *conn,
+                                          std::string interface,
+                                          std::string signal_name,
+                                          DBusSignalSubscription *handler)
+    {
+        auto hub = hubs().find(hub_key(conn, interface));
+        if (hubs().end() == hub)
+        {
+            return;
+        }
+        for (auto it = hub->second.handlers.begin();
+             it != hub->second.handlers.end();)
+        {
+            if (it->second.handler == handler
+                && it->second.signal_name == signal_name)
+            {
+                it = hub->second.handlers.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+
+    inline void DBusSignalHub::dispatch(struct InterfaceHub& hub,
+                                        const std::string& key,
+                                        GDBusConnection *conn,
+                                        const gchar *sender,
+                                        const gchar *obj_path,
+                                        const gchar *intf_name,
+                                        const gchar *sign_name,
+                                        GVariant *params)
+    {
+        // Collect the handlers first; a handler callback may register
+        // or unregister entries, which would invalidate iterators
+        std::vector<DBusSignalSubscription *> matched;
+        auto range = hub.handlers.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second.signal_name.empty()
+                || it->second.signal_name == sign_name)
+            {
+                matched.push_back(it->second.handler);
+            }
+        }
+
+        for (auto& handler : matched)
+        {
+            handler->callback_signal_handler(conn,
+                                             C_char2string(sender),
+                                             C_char2string(obj_path),
+                                             C_char2string(intf_name),
+                                             C_char2string(sign_name),
+                                             params);
+        }
+    }
+
+
+    inline void DBusSignalHub::hub_signal_handler(GDBusConnection *conn,
+                                                  const gchar *sender,
+                                                  const gchar *obj_path,
+                                                  const gchar *intf_name,
+                                                  const gchar *sign_name,
+                                                  GVariant *params,
+                                                  gpointer hub_ptr)
+    {
+        struct InterfaceHub *hub = (struct InterfaceHub *) hub_ptr;
+        std::string snd = C_char2string(sender);
+        std::string path = C_char2string(obj_path);
+
+        // Route to exact matches and every wildcard combination
+        dispatch(*hub, hash_key(snd, path),
+                 conn, sender, obj_path, intf_name, sign_name, params);
+        dispatch(*hub, hash_key(snd, ""),
+                 conn, sender, obj_path, intf_name, sign_name, params);
+        dispatch(*hub, hash_key("", path),
+                 conn, sender, obj_path, intf_name, sign_name, params);
+        dispatch(*hub, hash_key("", ""),
+                 conn, sender, obj_path, intf_name, sign_name, params);
+    }
+
+
 
     class DBusSignalProducer
     {
@@ -341,6 +675,25 @@ namespace openvpn
         }
 
 
+        /**
+         *  Sends the signal unicast to a specific destination, using
+         *  the producer's default interface and object path.  The bus
+         *  daemon then routes the message directly to that connection
+         *  instead of evaluating it against every connection's match
+         *  rules, which is considerably cheaper on busy hosts.
+         *
+         * @param target       Unique D-Bus bus name of the receiver
+         * @param signal_name  Name of the signal to send
+         * @param params       GVariant tuple containing the signal payload
+         */
+        void SendTarget(const std::string target,
+                        const std::string signal_name,
+                        GVariant *params)
+        {
+            Send(target, interface, object_path, signal_name, params);
+        }
+
+
     protected:
         void validate_params()
         {
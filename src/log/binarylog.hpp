@@ -0,0 +1,526 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   binarylog.hpp
+ *
+ * @brief  Structured binary on-disk log format.  Log events are
+ *         appended as fixed-header records into a ring of mmap'd
+ *         segment files.  Each finalized segment carries an embedded
+ *         index mapping D-Bus object paths to the record offsets of
+ *         that path, so a reader can answer "show me this session's
+ *         history" without scanning the segment.
+ */
+
+#ifndef OPENVPN3_LOG_BINARYLOG_HPP
+#define OPENVPN3_LOG_BINARYLOG_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log-helpers.hpp"
+
+#define OPENVPN3_BINARYLOG_MAGIC    "OVPN3BLG"
+#define OPENVPN3_BINARYLOG_VERSION  1
+
+#ifndef OPENVPN3_BINARYLOG_SEGMENT_SIZE
+#define OPENVPN3_BINARYLOG_SEGMENT_SIZE (4 * 1024 * 1024)
+#endif
+
+#ifndef OPENVPN3_BINARYLOG_SEGMENTS
+#define OPENVPN3_BINARYLOG_SEGMENTS 8
+#endif
+
+
+/**
+ *  File header at offset 0 of every segment file.  index_offset is 0
+ *  while the segment is being written to and points at the embedded
+ *  index once the segment has been finalized.
+ */
+struct BinaryLogFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t segment_seq;
+    uint64_t index_offset;
+};
+
+
+/**
+ *  Fixed header preceding every log record.  The sender string and the
+ *  message string follow directly after the header; the object path is
+ *  stored once per segment in the index and referenced by path_id.
+ */
+struct BinaryLogRecordHeader
+{
+    uint64_t timestamp;
+    uint32_t group;
+    uint32_t category;
+    uint32_t path_id;
+    uint32_t sender_len;
+    uint32_t msg_len;
+};
+
+
+/**
+ *  Appends log records to a ring of OPENVPN3_BINARYLOG_SEGMENTS mmap'd
+ *  segment files named <basename>.<N>.ovpn3log.  When a segment fills
+ *  up its index is written, the file is truncated to its used size and
+ *  the next segment in the ring is (re)created.
+ */
+class BinaryLogWriter
+{
+public:
+    /**
+     *  Initializes the writer and opens the first segment
+     *
+     * @param basename  Path prefix used for the segment file names
+     */
+    BinaryLogWriter(std::string basename)
+        : basename(basename)
+    {
+        open_segment();
+    }
+
+
+    ~BinaryLogWriter()
+    {
+        finalize_segment();
+    }
+
+
+    BinaryLogWriter(const BinaryLogWriter&) = delete;
+    BinaryLogWriter& operator=(const BinaryLogWriter&) = delete;
+
+
+    /**
+     *  Appends a single log record, rotating to the next segment in
+     *  the ring when the current one is full
+     *
+     * @param group        LogGroup of the log event
+     * @param catg         LogCategory of the log event
+     * @param sender       D-Bus unique bus name of the sender
+     * @param object_path  D-Bus object path the event relates to
+     * @param msg          The log message itself
+     */
+    void Append(const LogGroup group, const LogCategory catg,
+                const std::string& sender, const std::string& object_path,
+                const std::string& msg)
+    {
+        size_t record_size = sizeof(BinaryLogRecordHeader)
+                             + sender.size() + msg.size();
+
+        // Rotate before the record and the grown index would no
+        // longer fit inside the segment
+        if (write_pos + record_size + index_size_estimate(object_path)
+            > OPENVPN3_BINARYLOG_SEGMENT_SIZE)
+        {
+            finalize_segment();
+            open_segment();
+        }
+
+        uint32_t path_id = lookup_path_id(object_path);
+        path_offsets[path_id].push_back(write_pos);
+
+        BinaryLogRecordHeader rechdr;
+        rechdr.timestamp = (uint64_t) std::time(NULL);
+        rechdr.group = (uint32_t) group;
+        rechdr.category = (uint32_t) catg;
+        rechdr.path_id = path_id;
+        rechdr.sender_len = sender.size();
+        rechdr.msg_len = msg.size();
+
+        memcpy(segment + write_pos, &rechdr, sizeof(rechdr));
+        write_pos += sizeof(rechdr);
+        memcpy(segment + write_pos, sender.data(), sender.size());
+        write_pos += sender.size();
+        memcpy(segment + write_pos, msg.data(), msg.size());
+        write_pos += msg.size();
+    }
+
+
+private:
+    std::string basename;
+    int fd = -1;
+    char *segment = nullptr;
+    size_t write_pos = 0;
+    uint32_t segment_seq = 0;
+    std::map<std::string, uint32_t> path_ids;
+    std::map<uint32_t, std::vector<uint64_t>> path_offsets;
+
+
+    /**
+     *  Returns the path_id of an object path, assigning the next free
+     *  id on the first occurrence within the current segment
+     */
+    uint32_t lookup_path_id(const std::string& object_path)
+    {
+        auto found = path_ids.find(object_path);
+        if (path_ids.end() != found)
+        {
+            return found->second;
+        }
+        uint32_t id = path_ids.size();
+        path_ids[object_path] = id;
+        return id;
+    }
+
+
+    /**
+     *  Upper estimate of the embedded index size, including the
+     *  growth caused by one more record for the given object path
+     */
+    size_t index_size_estimate(const std::string& object_path)
+    {
+        size_t size = sizeof(uint32_t);  // path count
+        for (const auto& p : path_ids)
+        {
+            size += 3 * sizeof(uint32_t) + p.first.size()
+                    + path_offsets[p.second].size() * sizeof(uint64_t);
+        }
+        if (path_ids.end() == path_ids.find(object_path))
+        {
+            size += 3 * sizeof(uint32_t) + object_path.size();
+        }
+        return size + sizeof(uint64_t);
+    }
+
+
+    void open_segment()
+    {
+        std::string fname = basename + "."
+                            + std::to_string(segment_seq
+                                             % OPENVPN3_BINARYLOG_SEGMENTS)
+                            + ".ovpn3log";
+        fd = open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0)
+        {
+            THROW_LOGEXCEPTION("Could not open binary log segment: " + fname);
+        }
+        if (ftruncate(fd, OPENVPN3_BINARYLOG_SEGMENT_SIZE) < 0)
+        {
+            close(fd);
+            THROW_LOGEXCEPTION("Could not size binary log segment: " + fname);
+        }
+
+        segment = (char *) mmap(NULL, OPENVPN3_BINARYLOG_SEGMENT_SIZE,
+                                PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == segment)
+        {
+            close(fd);
+            THROW_LOGEXCEPTION("Could not mmap binary log segment: " + fname);
+        }
+
+        BinaryLogFileHeader filehdr;
+        memset(&filehdr, 0, sizeof(filehdr));
+        memcpy(filehdr.magic, OPENVPN3_BINARYLOG_MAGIC, sizeof(filehdr.magic));
+        filehdr.version = OPENVPN3_BINARYLOG_VERSION;
+        filehdr.segment_seq = segment_seq;
+        filehdr.index_offset = 0;
+        memcpy(segment, &filehdr, sizeof(filehdr));
+        write_pos = sizeof(filehdr);
+
+        path_ids.clear();
+        path_offsets.clear();
+    }
+
+
+    /**
+     *  Writes the embedded index after the last record, publishes its
+     *  offset in the file header and truncates the segment file to
+     *  its used size
+     */
+    void finalize_segment()
+    {
+        if (nullptr == segment)
+        {
+            return;
+        }
+
+        uint64_t index_offset = write_pos;
+        uint32_t path_count = path_ids.size();
+        memcpy(segment + write_pos, &path_count, sizeof(path_count));
+        write_pos += sizeof(path_count);
+
+        for (const auto& p : path_ids)
+        {
+            uint32_t id = p.second;
+            uint32_t pathlen = p.first.size();
+            const std::vector<uint64_t>& offsets = path_offsets[id];
+            uint32_t noffsets = offsets.size();
+
+            memcpy(segment + write_pos, &id, sizeof(id));
+            write_pos += sizeof(id);
+            memcpy(segment + write_pos, &pathlen, sizeof(pathlen));
+            write_pos += sizeof(pathlen);
+            memcpy(segment + write_pos, p.first.data(), pathlen);
+            write_pos += pathlen;
+            memcpy(segment + write_pos, &noffsets, sizeof(noffsets));
+            write_pos += sizeof(noffsets);
+            memcpy(segment + write_pos, offsets.data(),
+                   noffsets * sizeof(uint64_t));
+            write_pos += noffsets * sizeof(uint64_t);
+        }
+
+        // The published index offset is what marks the segment as
+        // complete for readers
+        ((BinaryLogFileHeader *) segment)->index_offset = index_offset;
+
+        msync(segment, write_pos, MS_SYNC);
+        munmap(segment, OPENVPN3_BINARYLOG_SEGMENT_SIZE);
+        segment = nullptr;
+
+        if (ftruncate(fd, write_pos) < 0)
+        {
+            // Not fatal; the segment is just left at its full
+            // preallocated size
+        }
+        close(fd);
+        fd = -1;
+        segment_seq++;
+    }
+};
+
+
+/**
+ *  Reads finalized binary log segments.  Record lookups for a single
+ *  object path go through the embedded index, so only the matching
+ *  records are touched.
+ */
+class BinaryLogReader
+{
+public:
+    /**
+     *  A fully decoded log record
+     */
+    struct Record
+    {
+        std::time_t timestamp;
+        LogGroup group;
+        LogCategory category;
+        std::string sender;
+        std::string object_path;
+        std::string message;
+    };
+
+
+    /**
+     *  Opens a single segment file and parses its embedded index
+     *
+     * @param filename  Segment file to open
+     */
+    BinaryLogReader(std::string filename)
+        : filename(filename)
+    {
+        fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            THROW_LOGEXCEPTION("Could not open binary log segment: "
+                               + filename);
+        }
+
+        BinaryLogFileHeader filehdr;
+        read_at(0, &filehdr, sizeof(filehdr));
+        if (0 != memcmp(filehdr.magic, OPENVPN3_BINARYLOG_MAGIC,
+                        sizeof(filehdr.magic))
+            || OPENVPN3_BINARYLOG_VERSION != filehdr.version)
+        {
+            close(fd);
+            THROW_LOGEXCEPTION("Not a binary log segment: " + filename);
+        }
+        if (0 == filehdr.index_offset)
+        {
+            close(fd);
+            THROW_LOGEXCEPTION("Binary log segment is not finalized: "
+                               + filename);
+        }
+        segment_seq = filehdr.segment_seq;
+        parse_index(filehdr.index_offset);
+    }
+
+
+    ~BinaryLogReader()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+
+    BinaryLogReader(const BinaryLogReader&) = delete;
+    BinaryLogReader& operator=(const BinaryLogReader&) = delete;
+
+
+    /**
+     *  Lists all object paths occurring in this segment
+     */
+    std::vector<std::string> GetPaths()
+    {
+        std::vector<std::string> ret;
+        for (const auto& p : paths)
+        {
+            ret.push_back(p.second);
+        }
+        return ret;
+    }
+
+
+    /**
+     *  Returns the sequence number the writer assigned this segment,
+     *  used to order segments of a ring chronologically
+     */
+    uint32_t GetSegmentSeq()
+    {
+        return segment_seq;
+    }
+
+
+    /**
+     *  Retrieves all records of a single object path via the index
+     *
+     * @param object_path  D-Bus object path to look up
+     * @return Returns the decoded records in append order.  The
+     *         result is empty if the path does not occur in this
+     *         segment.
+     */
+    std::vector<Record> FetchPath(const std::string& object_path)
+    {
+        std::vector<Record> ret;
+        for (const auto& p : paths)
+        {
+            if (p.second == object_path)
+            {
+                for (const auto& offset : path_offsets[p.first])
+                {
+                    ret.push_back(read_record(offset));
+                }
+            }
+        }
+        return ret;
+    }
+
+
+    /**
+     *  Retrieves every record of the segment, in append order
+     */
+    std::vector<Record> FetchAll()
+    {
+        std::vector<std::pair<uint64_t, uint32_t>> all;
+        for (const auto& p : path_offsets)
+        {
+            for (const auto& offset : p.second)
+            {
+                all.push_back(std::make_pair(offset, p.first));
+            }
+        }
+        std::sort(all.begin(), all.end());
+
+        std::vector<Record> ret;
+        for (const auto& entry : all)
+        {
+            ret.push_back(read_record(entry.first));
+        }
+        return ret;
+    }
+
+
+private:
+    std::string filename;
+    int fd = -1;
+    uint32_t segment_seq = 0;
+    std::map<uint32_t, std::string> paths;
+    std::map<uint32_t, std::vector<uint64_t>> path_offsets;
+
+
+    void read_at(uint64_t offset, void *buf, size_t len)
+    {
+        ssize_t r = pread(fd, buf, len, offset);
+        if (r < 0 || (size_t) r != len)
+        {
+            THROW_LOGEXCEPTION("Short read in binary log segment: "
+                               + filename);
+        }
+    }
+
+
+    void parse_index(uint64_t index_offset)
+    {
+        uint64_t pos = index_offset;
+        uint32_t path_count;
+        read_at(pos, &path_count, sizeof(path_count));
+        pos += sizeof(path_count);
+
+        for (uint32_t i = 0; i < path_count; i++)
+        {
+            uint32_t id;
+            uint32_t pathlen;
+            read_at(pos, &id, sizeof(id));
+            pos += sizeof(id);
+            read_at(pos, &pathlen, sizeof(pathlen));
+            pos += sizeof(pathlen);
+
+            std::vector<char> pathbuf(pathlen);
+            read_at(pos, pathbuf.data(), pathlen);
+            pos += pathlen;
+            paths[id] = std::string(pathbuf.data(), pathlen);
+
+            uint32_t noffsets;
+            read_at(pos, &noffsets, sizeof(noffsets));
+            pos += sizeof(noffsets);
+
+            std::vector<uint64_t> offsets(noffsets);
+            read_at(pos, offsets.data(), noffsets * sizeof(uint64_t));
+            pos += noffsets * sizeof(uint64_t);
+            path_offsets[id] = offsets;
+        }
+    }
+
+
+    Record read_record(uint64_t offset)
+    {
+        BinaryLogRecordHeader rechdr;
+        read_at(offset, &rechdr, sizeof(rechdr));
+
+        std::vector<char> buf(rechdr.sender_len + rechdr.msg_len);
+        read_at(offset + sizeof(rechdr), buf.data(), buf.size());
+
+        Record rec;
+        rec.timestamp = (std::time_t) rechdr.timestamp;
+        rec.group = (LogGroup) rechdr.group;
+        rec.category = (LogCategory) rechdr.category;
+        rec.sender = std::string(buf.data(), rechdr.sender_len);
+        rec.object_path = paths[rechdr.path_id];
+        rec.message = std::string(buf.data() + rechdr.sender_len,
+                                  rechdr.msg_len);
+        return rec;
+    }
+};
+
+#endif // OPENVPN3_LOG_BINARYLOG_HPP
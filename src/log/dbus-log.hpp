@@ -20,28 +20,63 @@
 #ifndef OPENVPN3_DBUS_LOG_HPP
 #define OPENVPN3_DBUS_LOG_HPP
 
+#include <chrono>
 #include <fstream>
 #include <ctime>
 #include <iomanip>
+#include <map>
+#include <vector>
 
+#include "common/tracepoints.hpp"
 #include "log-helpers.hpp"
 
+/**
+ *  Maximum number of log events accumulated before a LogBatch signal
+ *  is emitted, when log batching is enabled in LogSender
+ */
+#define OPENVPN3_LOGBATCH_MAX_EVENTS 32
+
+/**
+ *  Maximum time (milliseconds) a log event stays in the batch buffer
+ *  before it is flushed, when log batching is enabled in LogSender
+ */
+#define OPENVPN3_LOGBATCH_FLUSH_MS 5
+
+/**
+ *  When log rate limiting suppresses events, every Nth suppressed
+ *  event is still emitted as a sample so the flood stays observable
+ */
+#define OPENVPN3_LOGRATE_SAMPLE_INTERVAL 100
+
 namespace openvpn
 {
     std::string GetTimestamp()
     {
+        //  The rendered timestamp has second resolution, so the
+        //  localtime() call and string formatting only needs to be
+        //  redone when the clock has moved to the next second.  At
+        //  sustained log rates of thousands of lines per second, this
+        //  caching removes almost all of the formatting cost.
+        static time_t cached_time = 0;
+        static std::string cached_timestamp;
+
         time_t now = time(0);
-        tm *ltm = localtime(&now);
-
-        std::stringstream ret;
-        ret << 1900 + ltm->tm_year
-            << "-" << std::setw(2) << std::setfill('0') << 1 + ltm->tm_mon
-            << "-" << std::setw(2) << std::setfill('0') << ltm->tm_mday
-            << " " << std::setw(2) << std::setfill('0') << ltm->tm_hour
-            << ":" << std::setw(2) << std::setfill('0') << ltm->tm_min
-            << ":" << std::setw(2) << std::setfill('0') << ltm->tm_sec
-            << " ";
-        return ret.str();
+        if (now != cached_time)
+        {
+            tm *ltm = localtime(&now);
+
+            std::stringstream ret;
+            ret << 1900 + ltm->tm_year
+                << "-" << std::setw(2) << std::setfill('0') << 1 + ltm->tm_mon
+                << "-" << std::setw(2) << std::setfill('0') << ltm->tm_mday
+                << " " << std::setw(2) << std::setfill('0') << ltm->tm_hour
+                << ":" << std::setw(2) << std::setfill('0') << ltm->tm_min
+                << ":" << std::setw(2) << std::setfill('0') << ltm->tm_sec
+                << " ";
+            cached_timestamp = ret.str();
+            cached_time = now;
+        }
+        return cached_timestamp;
     }
 
 
@@ -192,7 +227,8 @@ namespace openvpn
             {
                   logfs << "[" << sender << "]";
             }
-            logfs << LogPrefix(lgroup, catg)
+            logfs << LogGroupName(lgroup) << " "
+                  << LogCategoryName(catg) << ": "
                   << msg
                   << std::endl;
             logfs.flush();
@@ -232,6 +268,21 @@ namespace openvpn
 
         virtual ~LogSender()
         {
+            if (batch_flush_source > 0)
+            {
+                g_source_remove(batch_flush_source);
+                batch_flush_source = 0;
+            }
+            // Push out anything still waiting in the batch buffer.  The
+            // emit may fail if the connection is gone; there is nothing
+            // sensible to do about that during destruction.
+            try
+            {
+                FlushLogBatch();
+            }
+            catch (DBusException&)
+            {
+            }
         }
 
         const std::string GetLogIntrospection()
@@ -241,9 +292,144 @@ namespace openvpn
                 "            <arg type='u' name='group' direction='out'/>"
                 "            <arg type='u' name='level' direction='out'/>"
                 "            <arg type='s' name='message' direction='out'/>"
+                "        </signal>"
+                "        <signal name='LogBatch'>"
+                "            <arg type='a(uus)' name='events' direction='out'/>"
                 "        </signal>";
         }
 
+
+        /**
+         *  Introspection of the log watch negotiation methods.  Only
+         *  objects which dispatch RegisterLogWatch/UnregisterLogWatch
+         *  in their callback_method_call() should include this.
+         */
+        const std::string GetLogWatchIntrospection()
+        {
+            return
+                "        <method name='RegisterLogWatch'>"
+                "            <arg type='u' name='loglevel' direction='in'/>"
+                "        </method>"
+                "        <method name='UnregisterLogWatch'/>";
+        }
+
+
+        /**
+         *  Registers the log level a specific consumer wants to
+         *  receive.  Once at least one consumer is registered, log
+         *  events no registered consumer is interested in are not
+         *  emitted on the bus at all.
+         *
+         * @param busname  Unique D-Bus bus name of the consumer
+         * @param loglev   Log level (0-6) the consumer wants
+         */
+        void RegisterLogConsumerLevel(const std::string busname,
+                                      unsigned int loglev)
+        {
+            if (loglev > 6)
+            {
+                THROW_DBUSEXCEPTION("LogSender", "Invalid log level");
+            }
+            consumer_log_levels[busname] = loglev;
+        }
+
+
+        /**
+         *  Removes a consumer's registered log level.  When the last
+         *  registration is gone, emission falls back to the sender's
+         *  own log level filtering only.
+         *
+         * @param busname  Unique D-Bus bus name of the consumer
+         */
+        void UnregisterLogConsumerLevel(const std::string busname)
+        {
+            consumer_log_levels.erase(busname);
+        }
+
+
+        /**
+         *  Enables or disables unicast signal delivery.  With unicast
+         *  delivery enabled and at least one consumer registered
+         *  through RegisterLogWatch, signals are sent directly to each
+         *  registered consumer's unique bus name instead of being
+         *  broadcast; the bus daemon then routes each message to one
+         *  connection instead of evaluating it against every
+         *  connection's match rules.  While no consumer is registered,
+         *  emission falls back to broadcast.
+         *
+         * @param enable  Boolean enabling/disabling unicast delivery
+         */
+        void SetUnicastDelivery(bool enable)
+        {
+            unicast_delivery = enable;
+        }
+
+
+        /**
+         *  Enables or disables log event batching.  With batching
+         *  enabled, log events accumulate in a small buffer and are
+         *  flushed as a single array-typed LogBatch signal, either when
+         *  the buffer is full or after a few milliseconds.  This cuts
+         *  the per-event signal emission overhead considerably when
+         *  many log lines are produced in a short burst, such as during
+         *  connection setup.
+         *
+         *  CRIT and FATAL events always flush the buffer immediately.
+         *
+         * @param enable  Boolean enabling/disabling the batching mode
+         */
+        void SetLogBatching(bool enable)
+        {
+            if (!enable)
+            {
+                FlushLogBatch();
+            }
+            batch_mode = enable;
+        }
+
+
+        /**
+         *  Emits all buffered log events as a single LogBatch signal.
+         *  A buffer holding only one event is sent as an ordinary Log
+         *  signal instead.  No-op if the buffer is empty.
+         */
+        void FlushLogBatch()
+        {
+            if (batch_flush_source > 0)
+            {
+                g_source_remove(batch_flush_source);
+                batch_flush_source = 0;
+            }
+            if (batch_buffer.empty())
+            {
+                return;
+            }
+
+            if (1 == batch_buffer.size())
+            {
+                SendToConsumers("Log",
+                                GVariantTyped::Tuple(batch_buffer[0].group,
+                                                     batch_buffer[0].catg,
+                                                     batch_buffer[0].msg),
+                                (int) consumer_level_needed(
+                                    (LogCategory) batch_buffer[0].catg));
+                batch_buffer.clear();
+                return;
+            }
+
+            GVariantBuilder *bld = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a(uus)"));
+            for (const auto& ev : batch_buffer)
+            {
+                g_variant_builder_add(bld, "(uus)",
+                                      ev.group, ev.catg, ev.msg.c_str());
+            }
+            batch_buffer.clear();
+            // The "a" format consumes the builder by ending it, so it
+            // can go straight back to the pool afterwards
+            SendToConsumers("LogBatch", g_variant_new("(a(uus))", bld));
+            GVariantBuilderPool::Release(bld);
+        }
+
         const std::string GetStatusChangeIntrospection()
         {
             return
@@ -266,12 +452,17 @@ namespace openvpn
 
             if (LogFilterAllow(catg))
             {
-                Send("Log", values);
+                SendToConsumers("Log", values,
+                                (int) consumer_level_needed((LogCategory) catg));
             }
         }
 
         void Log(const LogGroup group, const LogCategory catg, const std::string msg)
         {
+            OPENVPN3_PROBE3(log_event,
+                            (unsigned int) group, (unsigned int) catg,
+                            msg.c_str());
+
             // Don't log unless the log level filtering allows it
             // The filtering is done against the LogCategory of the message
             if (!LogFilterAllow(catg))
@@ -283,9 +474,50 @@ namespace openvpn
             {
                 LogWrite("", group, catg, msg);
             }
-            guint gr = (guint) group;
-            guint cg = (guint) catg;
-            Send("Log", g_variant_new("(uus)", gr, cg, msg.c_str()));
+
+            // With consumers registered through RegisterLogWatch, the
+            // signal emission is suppressed entirely when none of them
+            // wants this verbosity.  The local log file above is
+            // intentionally not affected by this.
+            if (!ConsumerFilterAllow(catg))
+            {
+                return;
+            }
+
+            // A flooding sender (thousands of identical error lines
+            // per second) must not be able to saturate the log
+            // consumers; CRIT and FATAL always pass
+            if (rate_limit > 0
+                && LogCategory::CRIT != catg
+                && LogCategory::FATAL != catg
+                && !rate_limit_allow((guint) group, msg))
+            {
+                return;
+            }
+
+            emit_log_event((guint) group, (guint) catg, msg);
+        }
+
+
+        /**
+         *  Configures token bucket based rate limiting of emitted log
+         *  events, tracked per LogGroup.  When the bucket is empty,
+         *  events are counted and summarized ("message repeated N
+         *  times") instead of emitted, with every
+         *  OPENVPN3_LOGRATE_SAMPLE_INTERVAL'th suppressed event still
+         *  let through as a sample.
+         *
+         * @param events_per_second  Sustained emission rate; 0 disables
+         *                           rate limiting
+         * @param burst              Bucket size, the number of events
+         *                           allowed to pass back-to-back
+         */
+        void SetLogRateLimit(unsigned int events_per_second,
+                             unsigned int burst)
+        {
+            rate_limit = events_per_second;
+            rate_burst = burst;
+            rate_buckets.clear();
         }
 
         virtual void Debug(std::string msg)
@@ -334,6 +566,236 @@ namespace openvpn
 
     protected:
         LogGroup log_group;
+
+
+        /**
+         *  Checks the registered consumer log levels against a
+         *  LogCategory.  CRIT and FATAL events are always allowed.
+         *
+         * @param catg  LogCategory of the log event to evaluate
+         *
+         * @return Returns true if no consumer levels are registered or
+         *         at least one registered consumer wants this category
+         */
+        bool ConsumerFilterAllow(LogCategory catg)
+        {
+            if (consumer_log_levels.empty())
+            {
+                return true;
+            }
+
+            unsigned int needed = consumer_level_needed(catg);
+            for (const auto& consumer : consumer_log_levels)
+            {
+                if (consumer.second >= needed)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+
+        /**
+         *  Maps a LogCategory to the log level (0-6) a consumer needs
+         *  to have registered to receive it.  CRIT and FATAL map to 0,
+         *  so they always pass.
+         *
+         * @param catg  LogCategory of the log event
+         *
+         * @return Returns the minimum registered consumer log level
+         */
+        static unsigned int consumer_level_needed(LogCategory catg)
+        {
+            switch (catg)
+            {
+            case LogCategory::DEBUG:
+                return 6;
+            case LogCategory::VERB2:
+                return 5;
+            case LogCategory::VERB1:
+                return 4;
+            case LogCategory::INFO:
+                return 3;
+            case LogCategory::WARN:
+                return 2;
+            case LogCategory::ERROR:
+                return 1;
+            default:
+                return 0;
+            }
+        }
+
+
+        /**
+         *  Emits a signal to the registered log consumers.  With
+         *  unicast delivery enabled and at least one consumer
+         *  registered, one signal is sent per registered consumer with
+         *  its unique bus name as the destination; otherwise the
+         *  signal is broadcast as before.
+         *
+         * @param signal_name   Name of the signal to emit
+         * @param params        GVariant tuple containing the payload
+         * @param needed_level  Minimum registered log level a consumer
+         *                      needs to receive this signal; -1 sends
+         *                      it to every registered consumer
+         */
+        void SendToConsumers(const std::string signal_name, GVariant *params,
+                             int needed_level = -1)
+        {
+            if (!unicast_delivery || consumer_log_levels.empty())
+            {
+                Send(signal_name, params);
+                return;
+            }
+
+            // The emission consumes a floating parameter reference, so
+            // grab a full reference which survives the whole loop
+            g_variant_ref_sink(params);
+            for (const auto& consumer : consumer_log_levels)
+            {
+                if (needed_level >= 0
+                    && consumer.second < (unsigned int) needed_level)
+                {
+                    continue;
+                }
+                SendTarget(consumer.first, signal_name, params);
+            }
+            g_variant_unref(params);
+        }
+
+
+    private:
+        std::map<std::string, unsigned int> consumer_log_levels;
+        bool unicast_delivery = false;
+
+        /**
+         *  Token bucket state for one LogGroup
+         */
+        struct RateBucket
+        {
+            double tokens;
+            std::chrono::steady_clock::time_point last_refill;
+            unsigned long suppressed;
+            std::string last_msg;
+        };
+
+        unsigned int rate_limit = 0;
+        unsigned int rate_burst = 0;
+        std::map<guint, struct RateBucket> rate_buckets;
+
+        /**
+         *  A single buffered log event, waiting for a batch flush
+         */
+        struct LogBatchEvent
+        {
+            guint group;
+            guint catg;
+            std::string msg;
+        };
+
+        bool batch_mode = false;
+        guint batch_flush_source = 0;
+        std::vector<struct LogBatchEvent> batch_buffer;
+
+
+        /**
+         *  GLib timeout callback flushing the batch buffer when the
+         *  flush timer fires
+         */
+        static gboolean batch_flush_cb(gpointer this_ptr)
+        {
+            class LogSender *sender = (class LogSender *) this_ptr;
+            sender->batch_flush_source = 0;
+            sender->FlushLogBatch();
+            return G_SOURCE_REMOVE;
+        }
+
+
+        /**
+         *  Performs the actual signal emission of a log event which
+         *  passed all the filters, either buffered into the current
+         *  batch or as an individual Log signal
+         */
+        void emit_log_event(guint gr, guint cg, const std::string& msg)
+        {
+            if (batch_mode)
+            {
+                batch_buffer.push_back(LogBatchEvent{gr, cg, msg});
+                if (batch_buffer.size() >= OPENVPN3_LOGBATCH_MAX_EVENTS
+                    || (guint) LogCategory::CRIT == cg
+                    || (guint) LogCategory::FATAL == cg)
+                {
+                    FlushLogBatch();
+                }
+                else if (0 == batch_flush_source)
+                {
+                    batch_flush_source = g_timeout_add(OPENVPN3_LOGBATCH_FLUSH_MS,
+                                                       batch_flush_cb,
+                                                       this);
+                }
+                return;
+            }
+            SendToConsumers("Log",
+                            GVariantTyped::Tuple(gr, cg, msg),
+                            (int) consumer_level_needed((LogCategory) cg));
+        }
+
+
+        /**
+         *  Refills the LogGroup's token bucket and decides whether a
+         *  log event may be emitted.  Suppressed events are counted;
+         *  once a token is available again a "message repeated N
+         *  times" summary is emitted before normal delivery resumes.
+         *
+         * @param gr   LogGroup (as guint) of the log event
+         * @param msg  The log message, kept as the suppression sample
+         *
+         * @return Returns true if the event should be emitted
+         */
+        bool rate_limit_allow(guint gr, const std::string& msg)
+        {
+            auto now = std::chrono::steady_clock::now();
+            auto bucket = rate_buckets.find(gr);
+            if (rate_buckets.end() == bucket)
+            {
+                bucket = rate_buckets.insert(
+                    std::make_pair(gr, RateBucket{(double) rate_burst,
+                                                  now, 0, ""})).first;
+            }
+
+            std::chrono::duration<double> elapsed = now - bucket->second.last_refill;
+            bucket->second.tokens += elapsed.count() * rate_limit;
+            if (bucket->second.tokens > rate_burst)
+            {
+                bucket->second.tokens = rate_burst;
+            }
+            bucket->second.last_refill = now;
+
+            if (bucket->second.tokens >= 1.0)
+            {
+                bucket->second.tokens -= 1.0;
+                if (bucket->second.suppressed > 0)
+                {
+                    std::string summary = "Log rate limit: message repeated "
+                          + std::to_string(bucket->second.suppressed)
+                          + " times: " + bucket->second.last_msg;
+                    bucket->second.suppressed = 0;
+                    emit_log_event(gr, (guint) LogCategory::WARN, summary);
+                }
+                return true;
+            }
+
+            bucket->second.suppressed++;
+            bucket->second.last_msg = msg;
+            if (0 == bucket->second.suppressed % OPENVPN3_LOGRATE_SAMPLE_INTERVAL)
+            {
+                // Let one event through as a sample so the flood does
+                // not go completely dark; it does not consume a token
+                return true;
+            }
+            return false;
+        }
     };
 
 
@@ -343,10 +805,14 @@ namespace openvpn
     {
     public:
         LogConsumer(GDBusConnection * dbuscon, std::string interf, std::string objpath)
-            : DBusSignalSubscription(dbuscon, "", interf, objpath, "Log"),
+            : DBusSignalSubscription(dbuscon, "", interf, objpath),
               FileLog(),
               LogFilter(6)  // By design, accept all kinds of log messages when receiving
         {
+            // Routed through the shared signal hub; all log consumers
+            // on the same interface share one bus-side match rule
+            SubscribeShared("Log");
+            SubscribeShared("LogBatch");
         }
 
         virtual void ConsumeLogEvent(const std::string sender, const std::string interface, const std::string object_path,
@@ -359,6 +825,23 @@ namespace openvpn
                                      const std::string signal_name,
                                      GVariant *parameters)
         {
+            if ("LogBatch" == signal_name)
+            {
+                // Unpack a batched signal and process each log event
+                // the same way as individual Log signals
+                GVariantIter *events = NULL;
+                g_variant_get(parameters, "(a(uus))", &events);
+
+                GVariant *event = NULL;
+                while ((event = g_variant_iter_next_value(events)))
+                {
+                    process_log_event(sender_name, interface_name,
+                                      object_path, event);
+                    g_variant_unref(event);
+                }
+                g_variant_iter_free(events);
+                return;
+            }
             process_log_event(sender_name, interface_name, object_path, parameters);
         }
 
@@ -408,12 +891,75 @@ namespace openvpn
                                      const LogCategory catg,
                                      const std::string msg) = 0;
 
+
+        /**
+         *  Enables the zero-copy pass-through mode.  Each received log
+         *  event is then relayed as the very same GVariant object it
+         *  arrived in, and the interception hook is given a borrowed
+         *  pointer to the message instead of a std::string copy.  Pure
+         *  relay objects should enable this; it removes all per-line
+         *  string allocations from the proxy path.
+         */
+        void EnablePassThrough()
+        {
+            pass_through = true;
+        }
+
+
+        /**
+         *  Interception hook used in pass-through mode instead of
+         *  @ConsumeLogEvent().  The message pointer is borrowed from
+         *  the received GVariant and is only valid for the duration of
+         *  the call; an implementation which needs to keep the message
+         *  must copy it.  The default implementation does nothing.
+         *
+         * @param sender       D-Bus bus name of the sender of the log event
+         * @param interface    D-Bus interface of the sender of the log event
+         * @param object_path  D-Bus object path of the sender of the log event
+         * @param group        LogGroup reference of the log event
+         * @param catg         LogCategory reference of the log event
+         * @param msg          Borrowed pointer to the log message
+         */
+        virtual void ConsumeLogEventBorrowed(const std::string& sender,
+                                             const std::string& interface,
+                                             const std::string& object_path,
+                                             const LogGroup group,
+                                             const LogCategory catg,
+                                             const char *msg)
+        {
+        }
+
     protected:
         virtual void process_log_event(const std::string sender,
                                        const std::string interface,
                                        const std::string object_path,
                                        GVariant *params)
         {
+            if (pass_through)
+            {
+                // Zero-copy relay: the group/category and a borrowed
+                // message pointer are extracted without duplicating
+                // anything, and the received GVariant itself is
+                // forwarded as-is
+                guint group = 0;
+                guint catg = 0;
+                const gchar *msg = NULL;
+                g_variant_get(params, "(uu&s)", &group, &catg, &msg);
+
+                if (openvpn::LogConsumer::GetLogActive())
+                {
+                    openvpn::LogConsumer::LogWrite(sender,
+                                                   (LogGroup) group,
+                                                   (LogCategory) catg,
+                                                   std::string(msg));
+                }
+                ConsumeLogEventBorrowed(sender, interface, object_path,
+                                        (LogGroup) group,
+                                        (LogCategory) catg, msg);
+                ProxyLog(params);
+                return;
+            }
+
             guint group;
             guint catg;
             gchar *msg;
@@ -428,6 +974,9 @@ namespace openvpn
             ProxyLog(params);
             g_free(msg);
         }
+
+    private:
+        bool pass_through = false;
     };
 };
 
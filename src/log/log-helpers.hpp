@@ -90,7 +90,7 @@ enum class LogGroup : std::uint_fast8_t {
         CLIENT                  /**< OpenVPN 3 Core tunnel object in the session process */
 };
 
-const std::array<const std::string, LogGroupCount> LogGroup_str = {
+constexpr std::array<const char *, LogGroupCount> LogGroup_str = {{
         "[[UNDEFINED]]",
         "Master Process",
         "Config Manager",
@@ -99,7 +99,7 @@ const std::array<const std::string, LogGroupCount> LogGroup_str = {
         "Logger",
         "Backend Session Process",
         "Client"
-};
+}};
 
 enum class LogCategory : uint_fast8_t {
         UNDEFINED,              /**< Undefined/not set */
@@ -113,7 +113,7 @@ enum class LogCategory : uint_fast8_t {
         FATAL                   /**< Fatal errors - The current operation is going to stop */
 };
 
-const std::array<const std::string, 9> LogCategory_str = {
+constexpr std::array<const char *, 9> LogCategory_str = {{
         "[[UNDEFINED]]",        // LogCategory::UNDEFINED
         "DEBUG",                // LogFlags::DEBUG
         "VERB2",                // LogFlags::VERB2
@@ -123,22 +123,55 @@ const std::array<const std::string, 9> LogCategory_str = {
         "-- ERROR --",          // LogFlags::ERROR
         "!! CRITICAL !!",       // LogFlags::CRIT
         "**!! FATAL !!**",      // LogFlags::FATAL
-};
+}};
 
-const std::string LogPrefix(LogGroup group, LogCategory catg)
+/**
+ *  Returns the display name of a LogGroup value as a string constant,
+ *  range checking the numeric value first
+ */
+inline const char * LogGroupName(LogGroup group)
 {
         if ((uint_fast8_t) group >= LogGroupCount) {
             THROW_LOGEXCEPTION("Invalid Log Group value");
         }
+        return LogGroup_str[(uint8_t) group];
+}
 
-        if ((uint8_t) catg < 0 || (uint8_t) catg > 8) {
+
+/**
+ *  Returns the display name of a LogCategory value as a string
+ *  constant, range checking the numeric value first
+ */
+inline const char * LogCategoryName(LogCategory catg)
+{
+        if ((uint8_t) catg > 8) {
             THROW_LOGEXCEPTION("Invalid category in log flags");
         }
+        return LogCategory_str[(uint8_t) catg];
+}
+
 
-        std::stringstream ret;
-        ret << LogGroup_str[(uint8_t) group] << " "
-            << LogCategory_str[(uint8_t)catg] << ": ";
-        return ret.str();
+/**
+ *  Appends the "<group> <category>: " log prefix to the caller's
+ *  buffer.  The hot log formatting paths use this to render into an
+ *  already reserved string instead of allocating a temporary per
+ *  event.
+ */
+inline void LogPrefixRender(std::string& buf, LogGroup group, LogCategory catg)
+{
+        buf.append(LogGroupName(group));
+        buf.append(" ");
+        buf.append(LogCategoryName(catg));
+        buf.append(": ");
+}
+
+
+inline const std::string LogPrefix(LogGroup group, LogCategory catg)
+{
+        std::string ret;
+        ret.reserve(48);
+        LogPrefixRender(ret, group, catg);
+        return ret;
 }
 
 #endif // OPENVPN3_LOG_HELPERS_HPP
@@ -0,0 +1,324 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2017 - 2018  OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2017 - 2018  David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   logwriter.hpp
+ *
+ * @brief  Asynchronous log line writer, built on a bounded lock-free
+ *         ring buffer.
+ *
+ *         The log service receives Log signals from every running
+ *         service and client process.  Formatting and writing each
+ *         line synchronously inside the D-Bus signal callback makes
+ *         signal delivery back up when many clients log at once.  With
+ *         this writer the signal callback only copies a fixed-size
+ *         record into the ring buffer; a dedicated writer thread
+ *         drains the buffer in batches using writev().  If the buffer
+ *         is full the record is dropped and counted, so producers
+ *         never block.
+ */
+
+#ifndef OPENVPN3_DBUS_LOG_LOGWRITER_HPP
+#define OPENVPN3_DBUS_LOG_LOGWRITER_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ *  Number of record slots in the ring buffer.  Must be a power of two.
+ */
+#define OPENVPN3_LOGWRITE_QUEUE_SIZE 2048
+
+/**
+ *  Maximum size of a single queued log line.  Longer lines are
+ *  truncated; log lines in this project are well below this limit.
+ */
+#define OPENVPN3_LOGWRITE_RECORD_SIZE 768
+
+/**
+ *  Maximum number of records written by a single writev() call
+ */
+#define OPENVPN3_LOGWRITE_BATCH_SIZE 64
+
+
+/**
+ *  Writes log lines to a file descriptor from a dedicated writer
+ *  thread.  Multiple producer threads may call Enqueue() concurrently;
+ *  the implementation is the classic bounded queue with per-slot
+ *  sequence counters, so producers neither block nor take locks.
+ */
+class AsyncLogWriter
+{
+public:
+    /**
+     *  Initializes the writer and starts the writer thread
+     *
+     * @param fd  File descriptor the log lines are written to
+     */
+    AsyncLogWriter(int fd)
+        : fd(fd),
+          buffer(OPENVPN3_LOGWRITE_QUEUE_SIZE),
+          enqueue_pos(0),
+          dequeue_pos(0),
+          overflows(0),
+          shutdown(false)
+    {
+        for (size_t i = 0; i < buffer.size(); i++)
+        {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writer_thread = std::thread([this]() { writer_main(); });
+    }
+
+
+    ~AsyncLogWriter()
+    {
+        shutdown.store(true, std::memory_order_release);
+        writer_thread.join();
+    }
+
+
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+
+    /**
+     *  Queues a log line for writing.  This only copies the line into
+     *  a free ring buffer slot and returns; the write happens on the
+     *  writer thread.  If the ring buffer is full the line is dropped
+     *  and the overflow counter is increased - producers never block.
+     *
+     * @param line  Complete log line, including any trailing newline
+     *
+     * @return Returns true if the line was queued, false if it was
+     *         dropped due to a full buffer
+     */
+    bool Enqueue(const std::string& line)
+    {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        struct LogRecordSlot *slot;
+        for (;;)
+        {
+            slot = &buffer[pos & (buffer.size() - 1)];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+            if (0 == diff)
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The slot is still owned by the consumer; buffer full
+                overflows.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        size_t len = line.size();
+        if (len > OPENVPN3_LOGWRITE_RECORD_SIZE)
+        {
+            len = OPENVPN3_LOGWRITE_RECORD_SIZE;
+        }
+        memcpy(slot->text, line.c_str(), len);
+        slot->length = len;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+
+    /**
+     *  Retrieves the number of log lines dropped because the ring
+     *  buffer was full
+     *
+     * @return Returns the number of dropped log lines
+     */
+    uint64_t GetOverflowCount() const
+    {
+        return overflows.load(std::memory_order_relaxed);
+    }
+
+
+    /**
+     *  Retrieves the number of log lines currently queued in the ring
+     *  buffer, waiting for the writer thread.  The value is a
+     *  snapshot taken with relaxed loads and may be slightly stale.
+     *
+     * @return Returns the number of queued log lines
+     */
+    uint64_t GetQueueOccupancy() const
+    {
+        size_t enq = enqueue_pos.load(std::memory_order_relaxed);
+        size_t deq = dequeue_pos.load(std::memory_order_relaxed);
+        return (uint64_t) (enq > deq ? enq - deq : 0);
+    }
+
+
+private:
+    /**
+     *  A single ring buffer slot.  The sequence counter tracks the
+     *  hand-over between producers and the writer thread.
+     */
+    struct LogRecordSlot
+    {
+        std::atomic<size_t> sequence;
+        unsigned short length;
+        char text[OPENVPN3_LOGWRITE_RECORD_SIZE];
+    };
+
+    int fd;
+    std::vector<struct LogRecordSlot> buffer;
+    std::atomic<size_t> enqueue_pos;
+    std::atomic<size_t> dequeue_pos;
+    std::atomic<uint64_t> overflows;
+    std::atomic<bool> shutdown;
+    std::thread writer_thread;
+
+
+    /**
+     *  Dequeues a batch of records and gathers them into an iovec
+     *  array.  Only called from the writer thread, which is the single
+     *  consumer.
+     *
+     * @param iov  Array of iovec entries to fill in
+     * @param max  Maximum number of entries to dequeue
+     *
+     * @return Returns the number of iovec entries filled in.  The
+     *         corresponding slots are released back to the producers
+     *         by release_batch() once written.
+     */
+    unsigned int dequeue_batch(struct iovec *iov, unsigned int max)
+    {
+        unsigned int count = 0;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (count < max)
+        {
+            struct LogRecordSlot *slot = &buffer[pos & (buffer.size() - 1)];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            if (seq != pos + 1)
+            {
+                break;  // Slot not yet committed by a producer
+            }
+            iov[count].iov_base = slot->text;
+            iov[count].iov_len = slot->length;
+            count++;
+            pos++;
+        }
+        return count;
+    }
+
+
+    /**
+     *  Releases a batch of consumed slots back to the producers
+     *
+     * @param count Number of slots to release, as returned by
+     *              dequeue_batch()
+     */
+    void release_batch(unsigned int count)
+    {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            struct LogRecordSlot *slot = &buffer[pos & (buffer.size() - 1)];
+            slot->sequence.store(pos + buffer.size(),
+                                 std::memory_order_release);
+            pos++;
+        }
+        dequeue_pos.store(pos, std::memory_order_relaxed);
+    }
+
+
+    /**
+     *  Writer thread main loop.  Drains the ring buffer in batches
+     *  with writev() and sleeps briefly when the buffer is empty.
+     *  On shutdown, everything still queued is flushed first.
+     */
+    void writer_main()
+    {
+        struct iovec iov[OPENVPN3_LOGWRITE_BATCH_SIZE];
+        for (;;)
+        {
+            unsigned int count = dequeue_batch(iov,
+                                               OPENVPN3_LOGWRITE_BATCH_SIZE);
+            if (count > 0)
+            {
+                write_all(iov, count);
+                release_batch(count);
+                continue;
+            }
+            if (shutdown.load(std::memory_order_acquire))
+            {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+
+    /**
+     *  Writes a complete iovec batch, retrying on short writes and
+     *  EINTR.  Write errors are silently ignored; there is no better
+     *  place to report them from the log service itself.
+     *
+     * @param iov    Array of iovec entries to write
+     * @param count  Number of entries in the array
+     */
+    void write_all(struct iovec *iov, unsigned int count)
+    {
+        unsigned int idx = 0;
+        while (idx < count)
+        {
+            ssize_t written = writev(fd, &iov[idx], count - idx);
+            if (written < 0)
+            {
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                return;
+            }
+            while (idx < count && (size_t) written >= iov[idx].iov_len)
+            {
+                written -= iov[idx].iov_len;
+                idx++;
+            }
+            if (idx < count && written > 0)
+            {
+                iov[idx].iov_base = (char *) iov[idx].iov_base + written;
+                iov[idx].iov_len -= written;
+            }
+        }
+    }
+};
+
+#endif // OPENVPN3_DBUS_LOG_LOGWRITER_HPP
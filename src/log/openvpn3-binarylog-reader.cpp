@@ -0,0 +1,141 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   openvpn3-binarylog-reader.cpp
+ *
+ * @brief  Queries binary log segments written by openvpn3-service-logger.
+ *         Lookups for a single session path use the embedded per-segment
+ *         index, so only the matching records are read from disk.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <ctime>
+
+#include "binarylog.hpp"
+#include "common/utils.hpp"
+#include "common/cmdargparser.hpp"
+
+
+/**
+ *  Prints a single decoded record in the same layout as the text
+ *  logger output
+ *
+ * @param rec  BinaryLogReader::Record to print
+ */
+static void print_record(const BinaryLogReader::Record& rec)
+{
+    struct tm *ltime = localtime(&rec.timestamp);
+    char tstamp[32];
+    strftime(tstamp, sizeof(tstamp), "%Y-%m-%d %H:%M:%S", ltime);
+
+    std::cout << tstamp
+              << " sender=" << rec.sender
+              << ", path=" << rec.object_path
+              << std::endl
+              << "                    "
+              << LogPrefix(rec.group, rec.category) << rec.message
+              << std::endl;
+}
+
+
+static int binarylog_reader(ParsedArgs args)
+{
+    if (!args.Present("file"))
+    {
+        throw CommandException("openvpn3-binarylog-reader",
+                               "No log segment files provided (--file)");
+    }
+
+    // Open all provided segments and order them the way the writer
+    // filled them, so multi-segment output comes out chronologically
+    std::vector<std::unique_ptr<BinaryLogReader>> readers;
+    for (const auto& fname : args.GetAllValues("file"))
+    {
+        readers.push_back(std::unique_ptr<BinaryLogReader>(
+                                        new BinaryLogReader(fname)));
+    }
+    std::sort(readers.begin(), readers.end(),
+              [](const std::unique_ptr<BinaryLogReader>& a,
+                 const std::unique_ptr<BinaryLogReader>& b)
+              {
+                  return a->GetSegmentSeq() < b->GetSegmentSeq();
+              });
+
+    if (args.Present("list-paths"))
+    {
+        for (const auto& rdr : readers)
+        {
+            for (const auto& path : rdr->GetPaths())
+            {
+                std::cout << path << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    for (const auto& rdr : readers)
+    {
+        std::vector<BinaryLogReader::Record> records;
+        if (args.Present("path"))
+        {
+            records = rdr->FetchPath(args.GetValue("path", 0));
+        }
+        else
+        {
+            records = rdr->FetchAll();
+        }
+
+        for (const auto& rec : records)
+        {
+            print_record(rec);
+        }
+    }
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    SingleCommand argparser(argv[0], "OpenVPN 3 binary log reader",
+                            binarylog_reader);
+    argparser.AddOption("file", 'f', "FILE", true,
+                        "Binary log segment file to read (can be used multiple times)");
+    argparser.AddOption("path", 'p', "OBJECT-PATH", true,
+                        "Only show log records for this D-Bus object path");
+    argparser.AddOption("list-paths", 0,
+                        "List the object paths found in the provided segments");
+
+    try
+    {
+        return argparser.RunCommand(simple_basename(argv[0]), argc, argv);
+    }
+    catch (CommandException& excp)
+    {
+        std::cout << excp.what() << std::endl;
+        return 2;
+    }
+    catch (LogException& excp)
+    {
+        std::cout << excp.what() << std::endl;
+        return 2;
+    }
+}
@@ -24,6 +24,8 @@
 
 #include "dbus/core.hpp"
 #include "dbus-log.hpp"
+#include "logwriter.hpp"
+#include "binarylog.hpp"
 #include "common/utils.hpp"
 #include "common/cmdargparser.hpp"
 
@@ -45,9 +47,11 @@ public:
     };
 
 
-    Logger(GDBusConnection *dbuscon, std::string tag, std::string interf,
+    Logger(GDBusConnection *dbuscon, AsyncLogWriter *writer,
+           std::string tag, std::string interf,
            unsigned int log_level = 3, bool timestamp = false)
         : LogConsumer(dbuscon, interf, ""),
+          writer(writer),
           log_tag(tag),
           timestamp(timestamp),
           colourscheme(""),
@@ -173,6 +177,19 @@ public:
     }
 
 
+    /**
+     *  Attaches a binary log writer.  Consumed log events are then
+     *  also appended as structured records, in addition to the
+     *  formatted text output.
+     *
+     * @param binwriter  BinaryLogWriter to append records to
+     */
+    void SetBinaryLog(BinaryLogWriter *binwriter)
+    {
+        binlog = binwriter;
+    }
+
+
     void ConsumeLogEvent(const std::string sender,
                          const std::string interface,
                          const std::string object_path,
@@ -187,19 +204,31 @@ public:
             }
         }
 
-        std::cout << timestampcolour << (timestamp ? GetTimestamp() : "")
-                  << colourscheme
-                  << log_tag << ":: sender=" << sender
-                  << ", interface=" << interface
-                  << ", path=" << object_path
-                  << std::endl
-                  << (timestamp ? "                    " : "       ")
-                  << LogPrefix(group, catg) << msg
-                  << std::endl << colourreset;
-
+        // Only timestamp and format the line here; the write itself
+        // happens on the AsyncLogWriter thread, so a log burst does
+        // not back up the D-Bus signal delivery in the main loop
+        std::stringstream line;
+        line << timestampcolour << (timestamp ? GetTimestamp() : "")
+             << colourscheme
+             << log_tag << ":: sender=" << sender
+             << ", interface=" << interface
+             << ", path=" << object_path
+             << std::endl
+             << (timestamp ? "                    " : "       ")
+             << LogGroupName(group) << " "
+             << LogCategoryName(catg) << ": " << msg
+             << std::endl << colourreset;
+        writer->Enqueue(line.str());
+
+        if (binlog)
+        {
+            binlog->Append(group, catg, sender, object_path, msg);
+        }
     }
 
 private:
+    AsyncLogWriter *writer;
+    BinaryLogWriter *binlog = nullptr;
     std::string log_tag;
     bool timestamp;
     std::string colourscheme;
@@ -208,6 +237,81 @@ private:
     std::vector<LogGroup> exclude_loggroup;
 };
 
+/**
+ *  D-Bus object exposing runtime counters of the log writer.  The log
+ *  service does not own a well-known bus name, so this object is
+ *  reachable via the service's unique bus name.
+ */
+class LoggerStatsObject : public DBusObject
+{
+public:
+    /**
+     *  Initializes the statistics object
+     *
+     * @param writer  AsyncLogWriter the counters are read from
+     */
+    LoggerStatsObject(AsyncLogWriter *writer)
+        : DBusObject(OpenVPN3DBus_rootp_logger),
+          writer(writer)
+    {
+        std::string introsp_xml = "<node name='" + OpenVPN3DBus_rootp_logger + "'>"
+            "    <interface name='" + OpenVPN3DBus_interf_logger + "'>"
+            "        <property type='t' name='log_overflows' access='read'/>"
+            "    </interface>"
+            "</node>";
+        ParseIntrospectionXML(introsp_xml);
+    }
+
+
+    void callback_method_call(GDBusConnection *conn,
+                              const std::string sender,
+                              const std::string obj_path,
+                              const std::string intf_name,
+                              const std::string method_name,
+                              GVariant *params,
+                              GDBusMethodInvocation *invoc)
+    {
+        THROW_DBUSEXCEPTION("LoggerStatsObject", "method_call not implemented");
+    }
+
+
+    GVariant * callback_get_property(GDBusConnection *conn,
+                                     const std::string sender,
+                                     const std::string obj_path,
+                                     const std::string intf_name,
+                                     const std::string property_name,
+                                     GError **error)
+    {
+        if ("log_overflows" == property_name)
+        {
+            return g_variant_new_uint64(writer->GetOverflowCount());
+        }
+
+        g_set_error(error,
+                    G_IO_ERROR,
+                    G_IO_ERROR_FAILED,
+                    "Unknown property");
+        return NULL;
+    }
+
+
+    GVariantBuilder * callback_set_property(GDBusConnection *conn,
+                                            const std::string sender,
+                                            const std::string obj_path,
+                                            const std::string intf_name,
+                                            const std::string property_name,
+                                            GVariant *value,
+                                            GError **error)
+    {
+        THROW_DBUSEXCEPTION("LoggerStatsObject", "set property not implemented");
+    }
+
+
+private:
+    AsyncLogWriter *writer;
+};
+
+
 static int logger(ParsedArgs args)
 {
     int ret = 0;
@@ -223,6 +327,28 @@ static int logger(ParsedArgs args)
     DBus dbus(G_BUS_TYPE_SYSTEM);
     dbus.Connect();
 
+    AsyncLogWriter logwriter(STDOUT_FILENO);
+    LoggerStatsObject statsobj(&logwriter);
+    statsobj.RegisterObject(dbus.GetConnection());
+
+    // Heap and object count introspection, reachable via the unique
+    // bus name of this process as the logger service owns no
+    // well-known name
+    DebugMemoryObject memdebug;
+    memdebug.AddObjectCounter("log_queue_occupancy",
+                              [&logwriter]()
+                              {
+                                  return logwriter.GetQueueOccupancy();
+                              });
+    memdebug.RegisterObject(dbus.GetConnection());
+
+    // Optional structured binary log, written alongside the text output
+    std::unique_ptr<BinaryLogWriter> binlog;
+    if (args.Present("binary-log-file"))
+    {
+        binlog.reset(new BinaryLogWriter(args.GetValue("binary-log-file", 0)));
+    }
+
     Logger * be_subscription = nullptr;
     Logger * session_subscr = nullptr;
     Logger * config_subscr = nullptr;
@@ -230,9 +356,13 @@ static int logger(ParsedArgs args)
     {
         if (args.Present("vpn-backend"))
         {
-            be_subscription = new Logger(dbus.GetConnection(), "[B]",
+            be_subscription = new Logger(dbus.GetConnection(), &logwriter, "[B]",
                                          OpenVPN3DBus_interf_backends,
                                          log_level, timestamp);
+            if (binlog)
+            {
+                be_subscription->SetBinaryLog(binlog.get());
+            }
             if (colour)
             {
                 be_subscription->SetColourScheme(Logger::LogColour::BRIGHT_BLUE, Logger::LogColour::BLACK);
@@ -242,9 +372,13 @@ static int logger(ParsedArgs args)
         if (args.Present("session-manager")
             || args.Present("session-manager-client-proxy"))
         {
-            session_subscr = new Logger(dbus.GetConnection(), "[S]",
+            session_subscr = new Logger(dbus.GetConnection(), &logwriter, "[S]",
                                         OpenVPN3DBus_interf_sessions,
                                         log_level, timestamp);
+            if (binlog)
+            {
+                session_subscr->SetBinaryLog(binlog.get());
+            }
 
             if (!args.Present("session-manager-client-proxy"))
             {
@@ -266,9 +400,13 @@ static int logger(ParsedArgs args)
 
         if (args.Present("config-manager"))
         {
-            config_subscr = new Logger(dbus.GetConnection(), "[C]",
+            config_subscr = new Logger(dbus.GetConnection(), &logwriter, "[C]",
                                        OpenVPN3DBus_interf_configuration,
                                        log_level, timestamp);
+            if (binlog)
+            {
+                config_subscr->SetBinaryLog(binlog.get());
+            }
             if (colour)
             {
                 config_subscr->SetColourScheme(Logger::LogColour::WHITE, Logger::LogColour::GREEN);
@@ -338,6 +476,8 @@ int main(int argc, char **argv)
                         "Subscribe to VPN client log entries");
     argparser.AddOption("log-level", 0, "LEVEL", true,
                         "Set the log verbosity level (default 3)");
+    argparser.AddOption("binary-log-file", 0, "BASENAME", true,
+                        "Also write structured binary log segments, using BASENAME as file name prefix");
 
     try
     {
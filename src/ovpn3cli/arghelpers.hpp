@@ -27,15 +27,130 @@
 #ifndef OPENVPN3_ARGHELPERS_HPP
 #define OPENVPN3_ARGHELPERS_HPP
 
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+
+/**
+ *  Returns the file name of the per-user shell completion cache.  The
+ *  file lives in XDG_RUNTIME_DIR when available, otherwise in /tmp
+ *  with the uid embedded in the file name.
+ *
+ * @return std::string with the full path of the completion cache file
+ */
+static std::string completion_cache_file()
+{
+    const char *rundir = getenv("XDG_RUNTIME_DIR");
+    if (rundir && '\0' != rundir[0])
+    {
+        return std::string(rundir) + "/openvpn3-completion.cache";
+    }
+    return "/tmp/openvpn3-completion-" + std::to_string(getuid())
+           + ".cache";
+}
+
+
+/**
+ *  Attempts to load the completion cache, provided it was written for
+ *  the given configuration manager generation.  The cache file carries
+ *  the generation counter on the first line and the space separated
+ *  configuration paths on the second.
+ *
+ * @param generation  Current generation counter value of the
+ *                    configuration manager
+ * @param paths       Return buffer for the cached path list
+ *
+ * @return Returns true if the cache was present and written for the
+ *         given generation, otherwise false
+ */
+static bool completion_cache_load(guint32 generation, std::string& paths)
+{
+    std::ifstream cache(completion_cache_file());
+    if (!cache)
+    {
+        return false;
+    }
+
+    std::string cached_gen;
+    if (!std::getline(cache, cached_gen)
+        || cached_gen != std::to_string(generation))
+    {
+        return false;
+    }
+    std::getline(cache, paths);
+    return true;
+}
+
+
+/**
+ *  Writes the completion cache for the given configuration manager
+ *  generation.  The file is written with 0600 permissions to a
+ *  temporary name first and then renamed into place, so a completion
+ *  run in parallel never sees a partially written cache.
+ *
+ * @param generation  Generation counter value the path list was
+ *                    retrieved under
+ * @param paths       Space separated configuration path list to save
+ */
+static void completion_cache_store(guint32 generation,
+                                   const std::string& paths)
+{
+    std::string destination = completion_cache_file();
+    std::string tmpfile = destination + "." + std::to_string(getpid());
+    {
+        std::ofstream cache(tmpfile);
+        if (!cache)
+        {
+            return;
+        }
+        cache << std::to_string(generation) << std::endl
+              << paths << std::endl;
+    }
+    if (0 != chmod(tmpfile.c_str(), S_IRUSR | S_IWUSR)
+        || 0 != rename(tmpfile.c_str(), destination.c_str()))
+    {
+        (void) ::remove(tmpfile.c_str());
+    }
+}
+
+
 /**
  * Retrieves a list of available configuration paths
  *
+ * This list is served from a small per-user on-disk cache whenever the
+ * configuration manager's generation counter matches the cached one,
+ * which reduces a TAB completion to a single property read plus one
+ * file read.  When the generation differs, the path list is fetched
+ * from the configuration manager and the cache is rewritten.
+ *
  * @return std::string with all available paths, each separated by space
  */
 std::string arghelper_config_paths()
 {
     OpenVPN3ConfigurationProxy confmgr(G_BUS_TYPE_SYSTEM, OpenVPN3DBus_rootp_configuration);
 
+    guint32 generation = 0;
+    try
+    {
+        generation = confmgr.GetGeneration();
+    }
+    catch (DBusException&)
+    {
+        // Older configuration managers do not carry the generation
+        // property; fall through to an uncached fetch
+    }
+
+    std::string cached;
+    if (generation > 0 && completion_cache_load(generation, cached))
+    {
+        return cached;
+    }
+
     std::stringstream res;
     for (auto& cfg : confmgr.FetchAvailableConfigs())
     {
@@ -45,6 +160,10 @@ std::string arghelper_config_paths()
         }
         res << cfg << " ";
     }
+    if (generation > 0)
+    {
+        completion_cache_store(generation, res.str());
+    }
     return res.str();
 }
 
@@ -23,6 +23,8 @@
  * @brief  Implementation of all the various openvpn3 config-* commands
  */
 
+#include <json/json.h>
+
 #include "common/cmdargparser.hpp"
 #include "../lookup.hpp"
 #include "../arghelpers.hpp"
@@ -161,11 +163,123 @@ static int cmd_config_import(ParsedArgs args)
  * @return Returns the exit code which will be returned to the calling shell
  *
  */
+static Json::Value gvariant_to_json(GVariant *value)
+{
+    const GVariantType *type = g_variant_get_type(value);
+    if (g_variant_type_equal(type, G_VARIANT_TYPE_BOOLEAN))
+    {
+        return (bool) g_variant_get_boolean(value);
+    }
+    else if (g_variant_type_equal(type, G_VARIANT_TYPE_UINT32))
+    {
+        return (Json::Value::UInt) g_variant_get_uint32(value);
+    }
+    else if (g_variant_type_equal(type, G_VARIANT_TYPE_INT32))
+    {
+        return (Json::Value::Int) g_variant_get_int32(value);
+    }
+    else if (g_variant_type_equal(type, G_VARIANT_TYPE_UINT64))
+    {
+        return (Json::Value::UInt64) g_variant_get_uint64(value);
+    }
+    else if (g_variant_type_equal(type, G_VARIANT_TYPE_INT64))
+    {
+        return (Json::Value::Int64) g_variant_get_int64(value);
+    }
+    else if (g_variant_type_equal(type, G_VARIANT_TYPE_DOUBLE))
+    {
+        return g_variant_get_double(value);
+    }
+    else if (g_variant_type_equal(type, G_VARIANT_TYPE_STRING)
+             || g_variant_type_equal(type, G_VARIANT_TYPE_OBJECT_PATH))
+    {
+        return g_variant_get_string(value, NULL);
+    }
+    else if (g_variant_type_equal(type, G_VARIANT_TYPE_STRING_ARRAY)
+             || g_variant_type_equal(type, G_VARIANT_TYPE_OBJECT_PATH_ARRAY))
+    {
+        Json::Value arr(Json::arrayValue);
+        for (gsize i = 0; i < g_variant_n_children(value); i++)
+        {
+            GVariant *child = g_variant_get_child_value(value, i);
+            arr.append(g_variant_get_string(child, NULL));
+            g_variant_unref(child);
+        }
+        return arr;
+    }
+
+    // Fallback for any other shape; rendered as the GVariant text format
+    gchar *dump = g_variant_print(value, FALSE);
+    Json::Value ret(dump);
+    g_free(dump);
+    return ret;
+}
+
+
+/**
+ *  Renders the configs-list --json output.  Each profile is fetched
+ *  with a single org.freedesktop.DBus.Properties.GetAll call, so the
+ *  cost per profile is one bus round trip regardless of how many
+ *  properties the object carries.
+ *
+ * @param confmgr  Configuration manager proxy, used to enumerate the
+ *                 available profile paths
+ * @return Returns the exit code which will be returned to the calling shell
+ */
+static int configs_list_json(OpenVPN3ConfigurationProxy& confmgr)
+{
+    Json::Value jout(Json::arrayValue);
+    for (auto& cfg : confmgr.FetchAvailableConfigs())
+    {
+        if (cfg.empty())
+        {
+            continue;
+        }
+        Json::Value jcfg;
+        jcfg["path"] = cfg;
+        try
+        {
+            OpenVPN3ConfigurationProxy cprx(G_BUS_TYPE_SYSTEM, cfg);
+            GVariant *props = cprx.GetAllProperties();
+            GVariantIter iter;
+            g_variant_iter_init(&iter, props);
+            gchar *key = nullptr;
+            GVariant *val = nullptr;
+            while (g_variant_iter_next(&iter, "{sv}", &key, &val))
+            {
+                jcfg[key] = gvariant_to_json(val);
+                if (0 == g_strcmp0(key, "owner"))
+                {
+                    jcfg["owner_username"] =
+                        lookup_username(g_variant_get_uint32(val));
+                }
+                g_variant_unref(val);
+                g_free(key);
+            }
+            g_variant_unref(props);
+        }
+        catch (DBusException&)
+        {
+            // The profile may have been removed while enumerating;
+            // keep the entry with the path only
+        }
+        jout.append(jcfg);
+    }
+    std::cout << jout << std::endl;
+    return 0;
+}
+
+
 static int cmd_configs_list(ParsedArgs args)
 {
     OpenVPN3ConfigurationProxy confmgr(G_BUS_TYPE_SYSTEM, OpenVPN3DBus_rootp_configuration );
     confmgr.Ping();
 
+    if (args.Present("json"))
+    {
+        return configs_list_json(confmgr);
+    }
+
     std::cout << "Configuration path" << std::endl;
     std::cout << "Imported" << std::setw(32-8) << std::setfill(' ') << " "
               << "Last used" << std::setw(26-9) << " "
@@ -638,100 +752,116 @@ static int cmd_config_remove(ParsedArgs args)
 }
 
 
+//
+//  Deferred option setup functions for the lazily registered commands.
+//  Each of these only runs when its command is actually materialized.
+//
+
+static void options_config_import(SingleCommand& cmd)
+{
+    cmd.AddOption("config", 'c', "CFG-FILE", true,
+                  "Configuration file to import");
+    cmd.AddOption("name", 'n', "NAME", true,
+                  "Provide a different name for the configuration (default: CFG-FILE)");
+    cmd.AddOption("persistent", 'p',
+                  "Make the configuration file persistent through boots");
+}
+
+
+static void options_config_manage(SingleCommand& cmd)
+{
+    cmd.AddOption("path", 'o', "CONFIG-PATH", true,
+                  "Path to the configuration in the configuration manager",
+                   arghelper_config_paths);
+    cmd.AddOption("alias", 'n', "ALIAS-NAME", true,
+                  "Set an alias name to use for this configuration");
+    cmd.AddOption("alias-delete", 'D',
+                  "Delete this alias");
+    cmd.AddOption("rename", 'r', "NEW-CONFIG-NAME", true,
+                  "Renames the configuration");
+    cmd.AddOption("persist-tun", "<true|false>", true,
+                  "Set/unset the persistent tun/seamless tunnel flag",
+                  arghelper_boolean);
+}
+
+
+static void options_config_acl(SingleCommand& cmd)
+{
+    cmd.AddOption("path", 'o', "OBJ-PATH", true,
+                  "Path to the configuration in the configuration manager",
+                  arghelper_config_paths);
+    cmd.AddOption("show", 's',
+                  "Show the current access control lists");
+    cmd.AddOption("grant", 'G', "<UID | username>", true,
+                  "Grant this user access to this configuration profile");
+    cmd.AddOption("revoke", 'R', "<UID | username>", true,
+                  "Revoke this user access from this configuration profile");
+    cmd.AddOption("public-access", "<true|false>", true,
+                  "Set/unset the public access flag",
+                  arghelper_boolean);
+    cmd.AddOption("lock-down", "<true|false>", true,
+                  "Set/unset the lock-down flag.  Will disable config retrieval for users",
+                  arghelper_boolean);
+    cmd.AddOption("seal", 'S',
+                  "Make the configuration profile permanently read-only");
+}
+
+
+static void options_config_show(SingleCommand& cmd)
+{
+    cmd.AddOption("path", 'o', "OBJ-PATH", true,
+                  "Path to the configuration in the configuration manager",
+                  arghelper_config_paths);
+    cmd.AddOption("json", 'j', "Dump the configuration in JSON format");
+}
+
+
+static void options_config_remove(SingleCommand& cmd)
+{
+    cmd.AddOption("path", 'o', "OBJ-PATH", true,
+                  "Path to the configuration in the configuration manager",
+                  arghelper_config_paths);
+    cmd.AddOption("force",
+                  "Force the deletion process without asking for confirmation");
+}
+
+
+static void options_configs_list(SingleCommand& cmd)
+{
+    cmd.AddOption("json", 'j',
+                  "Output the configuration list as a single JSON document");
+}
+
+
 /**
  *  Declare all the supported commands and their options and arguments.
  *
  *  This function should only be called once by the main openvpn3 program,
  *  which sends a reference to the Commands argument parser which is used
- *  for this registration process
+ *  for this registration process.  The commands are registered lazily;
+ *  only the command actually being invoked gets its options built.
  *
  * @param ovpn3  Commands object where to register all the commands, options
  *               and arguments.
  */
 void RegisterCommands_config(Commands& ovpn3)
 {
-    //
-    //  config-import command
-    //
-    auto cmd = ovpn3.AddCommand("config-import",
-                                "Import configuration profiles",
-                                cmd_config_import);
-    cmd->AddOption("config", 'c', "CFG-FILE", true,
-                   "Configuration file to import");
-    cmd->AddOption("name", 'n', "NAME", true,
-                   "Provide a different name for the configuration (default: CFG-FILE)");
-    cmd->AddOption("persistent", 'p',
-                   "Make the configuration file persistent through boots");
-
-    //
-    //  config-manage command
-    cmd = ovpn3.AddCommand("config-manage",
-                           "Manage configuration properties",
-                           cmd_config_manage);
-    cmd->AddOption("path", 'o', "CONFIG-PATH", true,
-                   "Path to the configuration in the configuration manager",
-                    arghelper_config_paths);
-    cmd->AddOption("alias", 'n', "ALIAS-NAME", true,
-                   "Set an alias name to use for this configuration");
-    cmd->AddOption("alias-delete", 'D',
-                   "Delete this alias");
-    cmd->AddOption("rename", 'r', "NEW-CONFIG-NAME", true,
-                   "Renames the configuration");
-    cmd->AddOption("persist-tun", "<true|false>", true,
-                   "Set/unset the persistent tun/seamless tunnel flag",
-                   arghelper_boolean);
-
-    //
-    //  config-acl command
-    //
-    cmd = ovpn3.AddCommand("config-acl",
-                           "Manage access control lists for configurations",
-                           cmd_config_acl);
-    cmd->AddOption("path", 'o', "OBJ-PATH", true,
-                   "Path to the configuration in the configuration manager",
-                   arghelper_config_paths);
-    cmd->AddOption("show", 's',
-                   "Show the current access control lists");
-    cmd->AddOption("grant", 'G', "<UID | username>", true,
-                   "Grant this user access to this configuration profile");
-    cmd->AddOption("revoke", 'R', "<UID | username>", true,
-                   "Revoke this user access from this configuration profile");
-    cmd->AddOption("public-access", "<true|false>", true,
-                   "Set/unset the public access flag",
-                   arghelper_boolean);
-    cmd->AddOption("lock-down", "<true|false>", true,
-                   "Set/unset the lock-down flag.  Will disable config retrieval for users",
-                   arghelper_boolean);
-    cmd->AddOption("seal", 'S',
-                   "Make the configuration profile permanently read-only");
-
-    //
-    //  config-show command
-    //
-    cmd = ovpn3.AddCommand("config-show",
-                           "Show/dump a configuration profile",
-                           cmd_config_show);
-    cmd->AddOption("path", 'o', "OBJ-PATH", true,
-                   "Path to the configuration in the configuration manager",
-                   arghelper_config_paths);
-    cmd->AddOption("json", 'j', "Dump the configuration in JSON format");
-
-    //
-    //  config-remove command
-    //
-    cmd = ovpn3.AddCommand("config-remove",
-                           "Remove an available configuration profile",
-                           cmd_config_remove);
-    cmd->AddOption("path", 'o', "OBJ-PATH", true,
-                   "Path to the configuration in the configuration manager",
-                   arghelper_config_paths);
-    cmd->AddOption("force",
-                   "Force the deletion process without asking for confirmation");
-
-    //
-    //  config-list command
-    //
-    cmd = ovpn3.AddCommand("configs-list",
-                           "List all available configuration profiles",
-                           cmd_configs_list);
+    ovpn3.AddCommandLazy("config-import",
+                         "Import configuration profiles",
+                         cmd_config_import, options_config_import);
+    ovpn3.AddCommandLazy("config-manage",
+                         "Manage configuration properties",
+                         cmd_config_manage, options_config_manage);
+    ovpn3.AddCommandLazy("config-acl",
+                         "Manage access control lists for configurations",
+                         cmd_config_acl, options_config_acl);
+    ovpn3.AddCommandLazy("config-show",
+                         "Show/dump a configuration profile",
+                         cmd_config_show, options_config_show);
+    ovpn3.AddCommandLazy("config-remove",
+                         "Remove an available configuration profile",
+                         cmd_config_remove, options_config_remove);
+    ovpn3.AddCommandLazy("configs-list",
+                         "List all available configuration profiles",
+                         cmd_configs_list, options_configs_list);
 }
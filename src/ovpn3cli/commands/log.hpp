@@ -23,6 +23,13 @@
  * @brief  Commands related to receive log entries from various sessions
  */
 
+#include <cerrno>
+#include <deque>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 #include "dbus/core.hpp"
 #include "log/dbus-log.hpp"
 
@@ -30,7 +37,15 @@ using namespace openvpn;
 
 
 /**
- *  Simple class to handle Log signal events
+ *  Class handling Log signal events for the log command.
+ *
+ *  Received events are not written to the terminal synchronously.
+ *  They are rendered into a bounded internal queue and flushed in
+ *  batches with writev() on a non-blocking stdout.  A stalled
+ *  terminal (such as a slow SSH connection) therefore never blocks
+ *  the GLib main loop and the D-Bus subscription behind it; instead,
+ *  once the queue is full, the oldest Debug entries are dropped and
+ *  accounted for with an "events skipped" marker in the output.
  */
 class Logger : public LogConsumer,
                public RC<thread_unsafe_refcount>
@@ -51,11 +66,42 @@ public:
            std::string object_path)
         : LogConsumer(dbscon, interf, object_path)
     {
+        // Writing must never block the main loop; a full terminal
+        // buffer results in EAGAIN and the flush is retried when
+        // stdout becomes writable again
+        stdout_flags = fcntl(STDOUT_FILENO, F_GETFL, 0);
+        fcntl(STDOUT_FILENO, F_SETFL, stdout_flags | O_NONBLOCK);
+    }
+
+
+    ~Logger()
+    {
+        if (flush_source > 0)
+        {
+            g_source_remove(flush_source);
+        }
+
+        // Write out what is still queued, blocking; at this point the
+        // main loop is gone and losing the tail of the log would be
+        // worse than waiting for the terminal
+        fcntl(STDOUT_FILENO, F_SETFL, stdout_flags);
+        insert_skip_marker();
+        while (!queue.empty())
+        {
+            const std::string& line = queue.front().line;
+            ssize_t r = write(STDOUT_FILENO,
+                              line.c_str() + front_written,
+                              line.size() - front_written);
+            (void) r;
+            front_written = 0;
+            queue.pop_front();
+        }
     }
 
 
     /**
-     *  This method is called on each Log signal event.
+     *  This method is called on each Log signal event.  The rendered
+     *  line is queued for the next batched flush.
      *
      * @param sender       std::string with the sender of the Log event sender
      * @param interface    std::string with the interface the Log signal origins from
@@ -70,9 +116,182 @@ public:
                          const LogGroup group, const LogCategory catg,
                          const std::string msg)
     {
-        std::cout << GetTimestamp()
-                  << LogPrefix(group, catg) << msg
-                  << std::endl;
+        if (queue.size() >= queue_capacity)
+        {
+            collapse_oldest();
+        }
+
+        struct PendingLine entry;
+        entry.catg = catg;
+        entry.line = GetTimestamp();
+        entry.line.reserve(entry.line.size() + msg.size() + 64);
+        LogPrefixRender(entry.line, group, catg);
+        entry.line += msg;
+        entry.line += "\n";
+        queue.push_back(std::move(entry));
+
+        if (0 == flush_source)
+        {
+            flush_source = g_idle_add(flush_idle_cb, this);
+        }
+    }
+
+
+private:
+    /**
+     *  A single rendered log line waiting to be written out
+     */
+    struct PendingLine
+    {
+        LogCategory catg;  ///< Category, deciding what may be dropped
+        std::string line;  ///< Fully rendered line, including newline
+    };
+
+    // Bounds the memory a stalled terminal can pile up; with the
+    // queue full, old Debug entries make room for new events
+    static const size_t queue_capacity = 1024;
+
+    // Upper limit of lines handed to a single writev() call;
+    // conservatively below any IOV_MAX
+    static const size_t flush_batch = 64;
+
+    std::deque<struct PendingLine> queue;
+    uint64_t skipped = 0;      ///< Events dropped since the last marker
+    size_t front_written = 0;  ///< Bytes of the front line already written
+    guint flush_source = 0;    ///< Active idle/fd-watch source, if any
+    int stdout_flags = 0;      ///< Original stdout file status flags
+
+
+    /**
+     *  Makes room in a full queue.  The oldest Debug entry is dropped
+     *  first; if none is left, the oldest entry regardless of
+     *  category goes.  Every drop is counted and later surfaced as an
+     *  "events skipped" marker in the output stream.
+     */
+    void collapse_oldest()
+    {
+        // The front line may be partially written already and can
+        // then not be removed
+        size_t first_removable = (front_written > 0 ? 1 : 0);
+
+        for (size_t i = first_removable; i < queue.size(); i++)
+        {
+            if (LogCategory::DEBUG == queue[i].catg)
+            {
+                queue.erase(queue.begin() + i);
+                skipped++;
+                return;
+            }
+        }
+        if (queue.size() > first_removable)
+        {
+            queue.erase(queue.begin() + first_removable);
+            skipped++;
+        }
+    }
+
+
+    /**
+     *  Surfaces the number of dropped events as a rendered line,
+     *  queued in front of the events which followed the drops
+     */
+    void insert_skip_marker()
+    {
+        if (0 == skipped)
+        {
+            return;
+        }
+        struct PendingLine marker;
+        marker.catg = LogCategory::WARN;
+        marker.line = GetTimestamp() + ".... "
+                      + std::to_string(skipped)
+                      + " events skipped (terminal too slow)\n";
+        queue.insert(queue.begin() + (front_written > 0 ? 1 : 0),
+                     std::move(marker));
+        skipped = 0;
+    }
+
+
+    /**
+     *  Writes queued lines to stdout in writev() batches until the
+     *  queue is drained or the terminal stops accepting data.  On
+     *  EAGAIN, a watch on stdout re-triggers the flush once the
+     *  terminal is writable again.
+     */
+    void flush()
+    {
+        flush_source = 0;
+        insert_skip_marker();
+
+        while (!queue.empty())
+        {
+            struct iovec iov[flush_batch];
+            size_t n = 0;
+            for (const auto& entry : queue)
+            {
+                if (n >= flush_batch)
+                {
+                    break;
+                }
+                iov[n].iov_base = (void *) (entry.line.c_str()
+                                            + (0 == n ? front_written : 0));
+                iov[n].iov_len = entry.line.size()
+                                 - (0 == n ? front_written : 0);
+                n++;
+            }
+
+            ssize_t w = writev(STDOUT_FILENO, iov, n);
+            if (w < 0)
+            {
+                if (EAGAIN == errno || EWOULDBLOCK == errno)
+                {
+                    // Terminal backpressure; retry when writable
+                    flush_source = g_unix_fd_add(STDOUT_FILENO, G_IO_OUT,
+                                                 flush_fd_cb, this);
+                }
+                return;
+            }
+
+            // Advance over the lines the kernel accepted
+            while (w > 0 && !queue.empty())
+            {
+                size_t left = queue.front().line.size() - front_written;
+                if ((size_t) w >= left)
+                {
+                    w -= left;
+                    front_written = 0;
+                    queue.pop_front();
+                }
+                else
+                {
+                    front_written += w;
+                    w = 0;
+                }
+            }
+        }
+    }
+
+
+    /**
+     *  GLib2 idle callback starting a flush round after new events
+     *  have been queued
+     */
+    static gboolean flush_idle_cb(gpointer user_data)
+    {
+        ((Logger *) user_data)->flush();
+        return G_SOURCE_REMOVE;
+    }
+
+
+    /**
+     *  GLib2 fd watch callback resuming a flush once a previously
+     *  blocked stdout has become writable again
+     */
+    static gboolean flush_fd_cb(gint fd, GIOCondition cond,
+                                gpointer user_data)
+    {
+        ((Logger *) user_data)->flush();
+        return G_SOURCE_REMOVE;
     }
 };
 
@@ -180,20 +399,27 @@ static int cmd_log_listen(ParsedArgs args)
  * @param ovpn3  Commands object where to register all the commands, options
  *               and arguments.
  */
+//
+//  Deferred option setup function for the lazily registered log command.
+//  This only runs when the command is actually materialized.
+//
+
+static void options_log(SingleCommand& cmd)
+{
+    cmd.AddOption("session-path", "SESSION-PATH", true,
+                  "Receive log events for a specific session",
+                  arghelper_session_paths);
+    cmd.AddOption("log-level", "LOG-LEVEL", true,
+                  "Set the log verbosity level of messages to be shown (default: 4)",
+                  arghelper_log_levels);
+    cmd.AddOption("config-events",
+                  "Receive log events issued by the configuration manager");
+}
+
+
 void RegisterCommands_log(Commands& ovpn3)
 {
-    //
-    //  session-start command
-    //
-    auto cmd = ovpn3.AddCommand("log",
-                                "Receive log events as they occur",
-                                cmd_log_listen);
-    cmd->AddOption("session-path", "SESSION-PATH", true,
-                   "Receive log events for a specific session",
-                   arghelper_session_paths);
-    cmd->AddOption("log-level", "LOG-LEVEL", true,
-                   "Set the log verbosity level of messages to be shown (default: 4)",
-                   arghelper_log_levels);
-    cmd->AddOption("config-events",
-                   "Receive log events issued by the configuration manager");
+    ovpn3.AddCommandLazy("log",
+                         "Receive log events as they occur",
+                         cmd_log_listen, options_log);
 }
@@ -23,6 +23,10 @@
  * @brief  Commands to start and manage VPN sessions
  */
 
+#include <algorithm>
+#include <cctype>
+#include <map>
+
 #include <json/json.h>
 
 #include "common/cmdargparser.hpp"
@@ -271,7 +275,7 @@ static int cmd_session_start(ParsedArgs args)
                                 char *pass = getpass(prompt.c_str());
                                 response = std::string(pass);
                             }
-                            r.value = response;
+                            r.value = std::move(response);
                             session.ProvideResponse(r);
                         }
                     }
@@ -295,6 +299,158 @@ static int cmd_session_start(ParsedArgs args)
 }
 
 
+/**
+ *  Parses a StatusMinor filter value provided on the command line.
+ *  Accepts the raw numeric StatusMinor value or the status description
+ *  from StatusMinor_str, matched case-insensitively with or without the
+ *  "Client " prefix - so both "connected" and "Client connected" select
+ *  CONN_CONNECTED.
+ *
+ * @param input  String with the status value as given on the command line
+ * @return Returns the StatusMinor value the input maps to
+ */
+static StatusMinor parse_status_minor(const std::string& input)
+{
+    if (!input.empty()
+        && input.find_first_not_of("0123456789") == std::string::npos)
+    {
+        unsigned int v = std::atoi(input.c_str());
+        if (v < StatusMinorCount)
+        {
+            return (StatusMinor) v;
+        }
+        throw CommandException("sessions-list",
+                               "Invalid status value: " + input);
+    }
+
+    std::string needle(input);
+    std::transform(needle.begin(), needle.end(), needle.begin(), ::tolower);
+    for (unsigned int i = 0; i < StatusMinorCount; i++)
+    {
+        std::string hay(StatusMinor_str[i]);
+        std::transform(hay.begin(), hay.end(), hay.begin(), ::tolower);
+        if (needle == hay
+            || (0 == hay.compare(0, 7, "client ")
+                && needle == hay.substr(7)))
+        {
+            return (StatusMinor) i;
+        }
+    }
+    throw CommandException("sessions-list",
+                           "Unknown status value: " + input);
+}
+
+
+/**
+ *  Converts a single session record into a JSON object for the
+ *  sessions-list --json output.  Configuration profile names are
+ *  resolved once per unique configuration path through the provided
+ *  cache, so a fleet of sessions sharing one profile costs a single
+ *  extra bus round trip.
+ *
+ * @param srec      SessionRecord to convert
+ * @param cfgnames  Cache mapping configuration paths to profile names
+ * @return Returns a Json::Value object with all the record fields
+ */
+static Json::Value session_record_json(const SessionRecord& srec,
+                                       std::map<std::string, std::string>& cfgnames)
+{
+    Json::Value jrec;
+    jrec["path"] = srec.path;
+    jrec["owner"] = (Json::Value::UInt) srec.owner;
+    jrec["owner_username"] = lookup_username(srec.owner);
+    jrec["backend_pid"] = (Json::Value::UInt) srec.backend_pid;
+    jrec["backend_ready"] = srec.backend_ready;
+    jrec["session_created"] = (Json::Value::UInt64) srec.session_created;
+    jrec["config_path"] = srec.config_path;
+
+    auto cached = cfgnames.find(srec.config_path);
+    if (cfgnames.end() == cached)
+    {
+        std::string cfgname = "";
+        try
+        {
+            OpenVPN3ConfigurationProxy cprx(G_BUS_TYPE_SYSTEM,
+                                            srec.config_path);
+            cfgname = cprx.GetStringProperty("name");
+        }
+        catch (...)
+        {
+            // Failure is okay here, the profile may be deleted.
+        }
+        cached = cfgnames.insert({srec.config_path, cfgname}).first;
+    }
+    jrec["config_name"] = cached->second;
+
+    jrec["status"]["major"] = (Json::Value::UInt)(unsigned int) srec.status.major;
+    jrec["status"]["minor"] = (Json::Value::UInt)(unsigned int) srec.status.minor;
+    jrec["status"]["major_string"] = srec.status.major_str;
+    jrec["status"]["minor_string"] = srec.status.minor_str;
+    jrec["status"]["message"] = srec.status.message;
+    return jrec;
+}
+
+
+/**
+ *  Prints a single session record of the sessions-list output
+ *
+ * @param srec   SessionRecord to render
+ * @param first  True if this is the first record printed, which gets
+ *               the leading separator line instead of a blank line
+ */
+static void print_session_record(const SessionRecord& srec, bool first)
+{
+    if (first)
+    {
+        std::cout << std::setw(77) << std::setfill('-') << "-" << std::endl;
+    }
+    else
+    {
+        std::cout << std::endl;
+    }
+
+    std::string owner = lookup_username(srec.owner);
+
+    std::string status_str;
+    std::string cfgname = "";
+    if (StatusMajor::UNSET != srec.status.major)
+    {
+        status_str = "[" + std::to_string((unsigned int) srec.status.major) + ","
+                        + std::to_string((unsigned int) srec.status.minor) + "] "
+                        + srec.status.major_str + ", " + srec.status.minor_str;
+    }
+    else
+    {
+        status_str = "(No status information available)";
+    }
+    try
+    {
+        OpenVPN3ConfigurationProxy cprx(G_BUS_TYPE_SYSTEM, srec.config_path);
+        cfgname = cprx.GetStringProperty("name");
+    }
+    catch (...)
+    {
+        // Failure is okay here, the profile may be deleted.
+    }
+
+    std::cout << "        Path: " << srec.path << std::endl;
+
+    std::cout << "     Created: " << std::asctime(std::localtime(&srec.session_created));
+
+    std::cout << "       Owner: " << owner << std::setw(43 - owner.size())
+              << std::setfill(' ') << " "
+              << "PID: " << std::to_string(srec.backend_pid) << std::endl;
+    if (!cfgname.empty())
+    {
+        std::cout << " Config name: " << cfgname << std::endl;
+    }
+    std::cout << "      Status: " << status_str << std::endl;
+    std::cout << "         "
+              << (srec.status.message.empty() ? "(no status message)" : srec.status.message)
+              << std::endl;
+}
+
+
 /**
  *  openvpn3 session-list command
  *
@@ -303,6 +459,10 @@ static int cmd_session_start(ParsedArgs args)
  *  or sessions tagged with public_access will be listed.  This restriction
  *  is handled by the Session Manager
  *
+ *  The filter options are evaluated by the session manager against its
+ *  session registry, so only the matching records are transferred.  The
+ *  list is fetched in chunks and rendered as the chunks arrive.
+ *
  * @param args  ParsedArgs object containing all related options and arguments
  * @return Returns the exit code which will be returned to the calling shell
  */
@@ -312,72 +472,104 @@ static int cmd_session_list(ParsedArgs args)
                                  OpenVPN3DBus_rootp_sessions);
     sessmgr.Ping();
 
-    bool first = true;
-    for (auto& sessp : sessmgr.FetchAvailableSessions())
+    SessionListFilter filter;
+    if (args.Present("owner"))
     {
-        if (sessp.empty())
-        {
-            continue;
-        }
-        OpenVPN3SessionProxy sprx(G_BUS_TYPE_SYSTEM, sessp);
+        filter.by_owner = true;
+        filter.owner = get_userid(args.GetValue("owner", 0));
+    }
+    if (args.Present("status") && args.Present("not-status"))
+    {
+        throw CommandException("sessions-list",
+                               "--status and --not-status cannot be combined");
+    }
+    if (args.Present("status"))
+    {
+        filter.by_status_minor = true;
+        filter.status_minor = parse_status_minor(args.GetValue("status", 0));
+    }
+    if (args.Present("not-status"))
+    {
+        filter.by_status_minor = true;
+        filter.status_minor_negate = true;
+        filter.status_minor = parse_status_minor(args.GetValue("not-status", 0));
+    }
+    if (args.Present("config"))
+    {
+        filter.config_name = args.GetValue("config", 0);
+    }
+    bool filtered = filter.by_owner || filter.by_status_minor
+                    || !filter.config_name.empty();
+    bool json = args.Present("json");
+    Json::Value jout(Json::arrayValue);
+    std::map<std::string, std::string> cfgname_cache;
 
-        if (first)
+    bool first = true;
+    try
+    {
+        // Fetch and render the list in chunks, so the first rows are
+        // on the terminal while later chunks are still being fetched
+        const guint32 chunk_size = 25;
+        guint32 offset = 0;
+        bool more = true;
+        while (more)
         {
-            std::cout << std::setw(77) << std::setfill('-') << "-" << std::endl;
+            more = false;
+            for (auto& srec : sessmgr.FetchManagedSessionsFiltered(filter,
+                                                                   chunk_size,
+                                                                   offset,
+                                                                   more))
+            {
+                offset++;
+                if (srec.path.empty())
+                {
+                    continue;
+                }
+                if (json)
+                {
+                    jout.append(session_record_json(srec, cfgname_cache));
+                }
+                else
+                {
+                    print_session_record(srec, first);
+                }
+                first = false;
+            }
         }
-        else
+    }
+    catch (DBusException& excp)
+    {
+        if (filtered || !first)
         {
-            std::cout << std::endl;
+            std::stringstream errm;
+            errm << "Failed to list sessions: " << excp.getRawError();
+            throw CommandException("sessions-list", errm.str());
         }
-        first = false;
-
-        std::string owner = lookup_username(sprx.GetUIntProperty("owner"));
-        pid_t be_pid = sprx.GetUIntProperty("backend_pid");
 
-        std::string status_str;
-        BackendStatus status;
-        std::string cfgname = "";
-        try
+        // An older session manager without the filtered method; fall
+        // back to fetching everything in one reply
+        for (auto& srec : sessmgr.FetchManagedSessions())
         {
-            status = sprx.GetLastStatus();
-            status_str = "[" + std::to_string((unsigned int) status.major) + ","
-                            + std::to_string((unsigned int) status.minor) + "] "
-                            + status.major_str + ", " + status.minor_str;
-
-            std::string config_path = sprx.GetStringProperty("config_path");
-            try
+            if (srec.path.empty())
             {
-                OpenVPN3ConfigurationProxy cprx(G_BUS_TYPE_SYSTEM, config_path);
-                cfgname = cprx.GetStringProperty("name");
+                continue;
             }
-            catch (...)
+            if (json)
             {
-                // Failure is okay here, the profile may be deleted.
+                jout.append(session_record_json(srec, cfgname_cache));
             }
+            else
+            {
+                print_session_record(srec, first);
+            }
+            first = false;
         }
-        catch (DBusException &excp)
-        {
-            status_str = "(No status information available)";
-        }
-
-        std::cout << "        Path: " << sessp << std::endl;
-
-        std::time_t sess_created = sprx.GetUInt64Property("session_created");
-        std::cout << "     Created: " << std::asctime(std::localtime(&sess_created));
-
-        std::cout << "       Owner: " << owner << std::setw(43 - owner.size())
-                  << std::setfill(' ') << " "
-                  << "PID: " << std::to_string(be_pid) << std::endl;
-        if (!cfgname.empty())
-        {
-            std::cout << " Config name: " << cfgname << std::endl;
-        }
-        std::cout << "      Status: " << status_str << std::endl;
-        std::cout << "         "
-                  << (status.message.empty() ? "(no status message)" : status.message)
-                  << std::endl;
     }
-    if (first)
+    if (json)
+    {
+        std::cout << jout << std::endl;
+    }
+    else if (first)
     {
         std::cout << "No sessions available" << std::endl;
     }
@@ -672,71 +864,94 @@ static int cmd_session_acl(ParsedArgs args)
 }
 
 
+//
+//  Deferred option setup functions for the lazily registered commands.
+//  Each of these only runs when its command is actually materialized.
+//
+
+static void options_session_start(SingleCommand& cmd)
+{
+    cmd.AddOption("config", 'c', "CONFIG-FILE", true,
+                  "Configuration file to start directly");
+    cmd.AddOption("config-path", 'p', "CONFIG-PATH", true,
+                  "Configuration path to an already imported configuration",
+                  arghelper_config_paths);
+    cmd.AddOption("persist-tun", 0,
+                  "Enforces persistent tun/seamless tunnel (requires --config)");
+}
+
+
+static void options_session_manage(SingleCommand& cmd)
+{
+    cmd.AddOption("path", 'o', "SESSION-PATH", true,
+                  "Path to the session in the session manager",
+                  arghelper_session_paths);
+    cmd.AddOption("pause", 'P', "Pauses the VPN session");
+    cmd.AddOption("resume", 'R', "Resumes a paused VPN session");
+    cmd.AddOption("restart", "Disconnect and reconnect a running VPN session");
+    cmd.AddOption("disconnect", 'D', "Disconnects a VPN session");
+}
+
+
+static void options_session_acl(SingleCommand& cmd)
+{
+    cmd.AddOption("path", 'o', "SESSION-PATH", true,
+                  "Path to the session in the session manager",
+                  arghelper_session_paths);
+    cmd.AddOption("show", 's',
+                  "Show the current access control lists");
+    cmd.AddOption("grant", 'G', "<UID | username>", true,
+                  "Grant this user access to this session");
+    cmd.AddOption("revoke", 'R', "<UID | username>", true,
+                  "Revoke this user access from this session");
+    cmd.AddOption("public-access", "<true|false>", true,
+                  "Set/unset the public access flag",
+                  arghelper_boolean);
+}
+
+
+static void options_sessions_list(SingleCommand& cmd)
+{
+    cmd.AddOption("owner", 'u', "<UID | username>", true,
+                  "Only show sessions owned by this user");
+    cmd.AddOption("status", "STATUS", true,
+                  "Only show sessions with this status, "
+                  "e.g. \"connected\"");
+    cmd.AddOption("not-status", "STATUS", true,
+                  "Only show sessions without this status, "
+                  "e.g. \"connected\"");
+    cmd.AddOption("config", 'c', "CONFIG-NAME", true,
+                  "Only show sessions started from this configuration "
+                  "profile");
+    cmd.AddOption("json", 'j',
+                  "Output the session list as a single JSON document");
+}
+
+
+static void options_session_stats(SingleCommand& cmd)
+{
+    cmd.AddOption("path", 'o', "SESSION-PATH", true,
+                  "Path to the configuration in the configuration manager",
+                  arghelper_session_paths);
+    cmd.AddOption("json", 'j', "Dump the configuration in JSON format");
+}
+
+
 void RegisterCommands_session(Commands& ovpn3)
 {
-    //
-    //  session-start command
-    //
-    auto cmd = ovpn3.AddCommand("session-start",
-                                "Start a new VPN session",
-                                cmd_session_start);
-    cmd->AddOption("config", 'c', "CONFIG-FILE", true,
-                   "Configuration file to start directly");
-    cmd->AddOption("config-path", 'p', "CONFIG-PATH", true,
-                   "Configuration path to an already imported configuration",
-                   arghelper_config_paths);
-    cmd->AddOption("persist-tun", 0,
-                   "Enforces persistent tun/seamless tunnel (requires --config)");
-
-    //
-    //  session-manage command
-    //
-    cmd = ovpn3.AddCommand("session-manage",
-                           "Manage VPN sessions",
-                           cmd_session_manage);
-    cmd->AddOption("path", 'o', "SESSION-PATH", true,
-                   "Path to the session in the session manager",
-                   arghelper_session_paths);
-    cmd->AddOption("pause", 'P', "Pauses the VPN session");
-    cmd->AddOption("resume", 'R', "Resumes a paused VPN session");
-    cmd->AddOption("restart", "Disconnect and reconnect a running VPN session");
-    cmd->AddOption("disconnect", 'D', "Disconnects a VPN session");
-
-    //
-    //  session-acl command
-    //
-    cmd = ovpn3.AddCommand("session-acl",
-                           "Manage access control lists for sessions",
-                           cmd_session_acl);
-    cmd->AddOption("path", 'o', "SESSION-PATH", true,
-                   "Path to the session in the session manager",
-                   arghelper_session_paths);
-    cmd->AddOption("show", 's',
-                   "Show the current access control lists");
-    cmd->AddOption("grant", 'G', "<UID | username>", true,
-                   "Grant this user access to this session");
-    cmd->AddOption("revoke", 'R', "<UID | username>", true,
-                   "Revoke this user access from this session");
-    cmd->AddOption("public-access", "<true|false>", true,
-                   "Set/unset the public access flag",
-                   arghelper_boolean);
-
-    //
-    //  session-stats command
-    //
-    cmd = ovpn3.AddCommand("session-stats",
-                           "Show session statistics",
-                           cmd_session_stats);
-    cmd->AddOption("path", 'o', "SESSION-PATH", true,
-                   "Path to the configuration in the configuration manager",
-                   arghelper_session_paths);
-    cmd->AddOption("json", 'j', "Dump the configuration in JSON format");
-
-
-    //
-    //  sessions-list command
-    //
-    cmd = ovpn3.AddCommand("sessions-list",
-                           "List available VPN sessions",
-                           cmd_session_list);
+    ovpn3.AddCommandLazy("session-start",
+                         "Start a new VPN session",
+                         cmd_session_start, options_session_start);
+    ovpn3.AddCommandLazy("session-manage",
+                         "Manage VPN sessions",
+                         cmd_session_manage, options_session_manage);
+    ovpn3.AddCommandLazy("session-acl",
+                         "Manage access control lists for sessions",
+                         cmd_session_acl, options_session_acl);
+    ovpn3.AddCommandLazy("session-stats",
+                         "Show session statistics",
+                         cmd_session_stats, options_session_stats);
+    ovpn3.AddCommandLazy("sessions-list",
+                         "List available VPN sessions",
+                         cmd_session_list, options_sessions_list);
 }
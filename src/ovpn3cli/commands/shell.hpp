@@ -0,0 +1,236 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   shell.hpp
+ *
+ * @brief  The openvpn3 shell command - an interactive and batch mode
+ *         running many openvpn3 commands within a single process.
+ *
+ *         Provisioning scripts which exec openvpn3 hundreds of times
+ *         pay the process startup, command table setup and D-Bus
+ *         connection cost on every invocation.  In shell mode the
+ *         command table is built once and every command dispatched
+ *         through it reuses this process and its shared
+ *         GDBusConnection (g_bus_get_sync() hands out one connection
+ *         per process, so every proxy created by the commands rides
+ *         on the same established bus connection).
+ *
+ *         Commands are read line by line from standard input, or from
+ *         a file via --commands-from, and parsed with the same
+ *         SingleCommand infrastructure as the ordinary command line.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "common/cmdargparser.hpp"
+
+//  Command registration functions from the other commands/*.hpp
+//  files; this header must be included after them in openvpn3.cpp
+void RegisterCommands_config(Commands& ovpn3);
+void RegisterCommands_session(Commands& ovpn3);
+void RegisterCommands_log(Commands& ovpn3);
+
+
+/**
+ *  Splits one shell input line into argument tokens.  Handles single
+ *  and double quoting plus backslash escaping outside quotes, which
+ *  covers what provisioning scripts feed this mode; full shell word
+ *  expansion is intentionally out of scope.
+ *
+ * @param line  The input line to tokenize
+ * @return Returns a std::vector of the parsed tokens, in order
+ */
+static std::vector<std::string> shell_tokenize(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    std::string current;
+    bool in_token = false;
+    char quote = 0;
+
+    for (size_t i = 0; i < line.size(); i++)
+    {
+        char c = line[i];
+        if (quote)
+        {
+            if (c == quote)
+            {
+                quote = 0;
+            }
+            else
+            {
+                current += c;
+            }
+        }
+        else if ('\'' == c || '"' == c)
+        {
+            quote = c;
+            in_token = true;
+        }
+        else if ('\\' == c && i + 1 < line.size())
+        {
+            current += line[++i];
+            in_token = true;
+        }
+        else if (' ' == c || '\t' == c)
+        {
+            if (in_token)
+            {
+                tokens.push_back(current);
+                current.clear();
+                in_token = false;
+            }
+        }
+        else
+        {
+            current += c;
+            in_token = true;
+        }
+    }
+    if (in_token)
+    {
+        tokens.push_back(current);
+    }
+    return tokens;
+}
+
+
+/**
+ *  openvpn3 shell command
+ *
+ *  Reads openvpn3 commands line by line and runs them within this
+ *  process.  Empty lines and lines starting with '#' are skipped;
+ *  'exit' or 'quit' ends the session.
+ *
+ * @param args  ParsedArgs object containing all related options and arguments
+ * @return Returns 0 when every command succeeded, otherwise the exit
+ *         code of the last failing command
+ */
+static int cmd_shell(ParsedArgs args)
+{
+    std::ifstream cmdfile;
+    std::istream *input = &std::cin;
+    if (args.Present("commands-from"))
+    {
+        cmdfile.open(args.GetValue("commands-from", 0));
+        if (cmdfile.fail())
+        {
+            throw CommandException("shell",
+                                   "Cannot open command file "
+                                   + args.GetValue("commands-from", 0));
+        }
+        input = &cmdfile;
+    }
+    bool stop_on_error = args.Present("stop-on-error");
+    bool interactive = (input == &std::cin) && isatty(STDIN_FILENO);
+
+    // The command table is built once and reused for every line; the
+    // lazily registered commands materialize their option tables the
+    // first time each command is used
+    Commands shellcmds("OpenVPN3",
+                       "Command line interface to manage OpenVPN 3 "
+                       "configurations and sessions");
+    RegisterCommands_config(shellcmds);
+    RegisterCommands_session(shellcmds);
+    RegisterCommands_log(shellcmds);
+
+    int last_failure = 0;
+    std::string line;
+    while (true)
+    {
+        if (interactive)
+        {
+            std::cout << "openvpn3> " << std::flush;
+        }
+        if (!std::getline(*input, line))
+        {
+            break;
+        }
+
+        std::vector<std::string> tokens = shell_tokenize(line);
+        if (tokens.empty() || '#' == tokens[0][0])
+        {
+            continue;
+        }
+        if ("exit" == tokens[0] || "quit" == tokens[0])
+        {
+            break;
+        }
+
+        // Assemble an argv array the ordinary command line entry
+        // point understands; parse_commandline() resets the getopt
+        // state per call, so repeated parsing in one process is fine
+        std::vector<char *> argv;
+        argv.push_back((char *) "openvpn3");
+        for (auto& t : tokens)
+        {
+            argv.push_back((char *) t.c_str());
+        }
+
+        int rc = 1;
+        try
+        {
+            rc = shellcmds.ProcessCommandLine(argv.size(), argv.data());
+        }
+        catch (CommandException& excp)
+        {
+            if (excp.gotErrorMessage())
+            {
+                std::cerr << excp.getCommand() << ": ** ERROR ** "
+                          << excp.what() << std::endl;
+            }
+        }
+        catch (std::exception& excp)
+        {
+            std::cerr << "** ERROR ** " << excp.what() << std::endl;
+        }
+
+        if (0 != rc)
+        {
+            last_failure = rc;
+            if (stop_on_error)
+            {
+                return rc;
+            }
+        }
+    }
+    return last_failure;
+}
+
+
+static void options_shell(SingleCommand& cmd)
+{
+    cmd.AddOption("commands-from", 'f', "FILE", true,
+                  "Read commands from this file instead of standard input");
+    cmd.AddOption("stop-on-error",
+                  "Abort on the first failing command instead of continuing");
+}
+
+
+void RegisterCommands_shell(Commands& ovpn3)
+{
+    ovpn3.AddCommandLazy("shell",
+                         "Run multiple openvpn3 commands in one process",
+                         cmd_shell, options_shell);
+}
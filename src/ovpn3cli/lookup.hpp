@@ -27,11 +27,94 @@
 #define OPENVPN3_OVPN3CLI_LOOKUP_HPP
 
 #include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <vector>
 #include <sys/types.h>
 #include <pwd.h>
 
 #include "common/utils.hpp"
 
+/**
+ *  How long (seconds) cached user/uid lookup results are considered
+ *  valid.  On NSS setups backed by LDAP each getpwuid_r()/getpwnam_r()
+ *  call can be a network round-trip, and the account database rarely
+ *  changes while a command or service is running.
+ */
+#define OPENVPN3_LOOKUP_CACHE_TTL 30
+
+
+/**
+ *  Process wide cache of user account lookups, keeping both
+ *  uid -> username and username -> uid mappings for a limited time.
+ *  All access must happen with lookup_cache_mutex() held.
+ */
+struct LookupCacheEntry
+{
+    std::string username;
+    uid_t uid;
+    std::time_t expires;
+};
+
+static inline std::mutex& lookup_cache_mutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+static inline std::map<uid_t, LookupCacheEntry>& lookup_cache_by_uid()
+{
+    static std::map<uid_t, LookupCacheEntry> cache;
+    return cache;
+}
+
+static inline std::map<std::string, LookupCacheEntry>& lookup_cache_by_name()
+{
+    static std::map<std::string, LookupCacheEntry> cache;
+    return cache;
+}
+
+
+/**
+ *  Returns a reusable lookup buffer for getpwuid_r()/getpwnam_r(),
+ *  allocated once per process.  Must only be used with
+ *  lookup_cache_mutex() held.
+ *
+ * @return Returns a reference to the preallocated buffer
+ */
+static inline std::vector<char>& lookup_buffer()
+{
+    static std::vector<char> buf;
+    if (buf.empty())
+    {
+        long buflen = sysconf(_SC_GETPW_R_SIZE_MAX);
+        if (buflen < 0)
+        {
+            buflen = 16384;
+        }
+        buf.resize(buflen);
+    }
+    return buf;
+}
+
+
+/**
+ *  Stores a lookup result in both cache directions
+ *
+ * @param uid       uid_t of the account
+ * @param username  std::string with the account name
+ */
+static inline void lookup_cache_store(uid_t uid, const std::string& username)
+{
+    LookupCacheEntry entry;
+    entry.username = username;
+    entry.uid = uid;
+    entry.expires = std::time(NULL) + OPENVPN3_LOOKUP_CACHE_TTL;
+    lookup_cache_by_uid()[uid] = entry;
+    lookup_cache_by_name()[username] = entry;
+}
+
 /**
  *  Looks up the uid of a user account to extract its username
  *
@@ -41,25 +124,30 @@
  */
 static std::string lookup_username(uid_t uid)
 {
+    std::lock_guard<std::mutex> guard(lookup_cache_mutex());
+
+    auto cached = lookup_cache_by_uid().find(uid);
+    if (lookup_cache_by_uid().end() != cached
+        && std::time(NULL) < cached->second.expires)
+    {
+        return cached->second.username;
+    }
+
     struct passwd pwrec;
     struct passwd *result = nullptr;
-    size_t buflen = sysconf(_SC_GETPW_R_SIZE_MAX);
-    char *buf = nullptr;
-
-    buf = (char *) malloc(buflen);
-    memset(buf, 0, buflen);
+    std::vector<char>& buf = lookup_buffer();
 
     std::string ret;
-    int r = getpwuid_r(uid, &pwrec, buf, buflen, &result);
+    int r = getpwuid_r(uid, &pwrec, buf.data(), buf.size(), &result);
     if ( (0 == r) && (NULL != result))
     {
         ret = std::string(pwrec.pw_name);
+        lookup_cache_store(uid, ret);
     }
     else
     {
         ret = "(" + std::to_string(uid) + ")";
     }
-    free(buf);
     return ret;
 }
 
@@ -72,25 +160,31 @@ static std::string lookup_username(uid_t uid)
  */
 static uid_t lookup_uid(std::string username)
 {
+    std::lock_guard<std::mutex> guard(lookup_cache_mutex());
+
+    auto cached = lookup_cache_by_name().find(username);
+    if (lookup_cache_by_name().end() != cached
+        && std::time(NULL) < cached->second.expires)
+    {
+        return cached->second.uid;
+    }
+
     struct passwd pwrec;
     struct passwd *result = nullptr;
-    size_t buflen = sysconf(_SC_GETPW_R_SIZE_MAX);
-    char *buf = nullptr;
+    std::vector<char>& buf = lookup_buffer();
 
-    buf = (char *) malloc(buflen);
-    memset(buf, 0, buflen);
     uid_t ret;
-    int r = getpwnam_r(username.c_str(), &pwrec, buf, buflen, &result);
+    int r = getpwnam_r(username.c_str(), &pwrec, buf.data(), buf.size(), &result);
     if ( (0 == r) && (NULL != result))
     {
 
         ret = result->pw_uid;
+        lookup_cache_store(ret, username);
     }
     else
     {
         ret =  -1;
     }
-    free(buf);
     return ret;
 }
 
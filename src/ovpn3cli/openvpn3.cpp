@@ -37,6 +37,7 @@
 #include "commands/config.hpp"
 #include "commands/session.hpp"
 #include "commands/log.hpp"
+#include "commands/shell.hpp"
 
 
 /**
@@ -60,13 +61,14 @@ int main(int argc, char **argv)
                       "configurations and sessions");
 
     //  Add a separate 'version' command, which just prints version information.
-    openvpn3.AddCommand("version", "Show OpenVPN 3 version information",
-                        cmd_version);
+    openvpn3.AddCommandLazy("version", "Show OpenVPN 3 version information",
+                            cmd_version);
 
     //  Register commands found in ./commands/*.hpp
     RegisterCommands_config(openvpn3);
     RegisterCommands_session(openvpn3);
     RegisterCommands_log(openvpn3);
+    RegisterCommands_shell(openvpn3);
 
     try
     {
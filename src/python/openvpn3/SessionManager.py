@@ -25,6 +25,8 @@
 #
 
 import dbus
+import os
+import struct
 from functools import wraps
 from openvpn3.constants import StatusMajor, StatusMinor
 from openvpn3.constants import ClientAttentionType, ClientAttentionGroup
@@ -238,6 +240,25 @@ class Session(object):
                 status['status_message'])
 
 
+    ##
+    #  Fetch the journaled status and log events newer than the given
+    #  cursor, so a monitor can catch up after losing its signal
+    #  subscription for a while.
+    #
+    #  @param cursor  Sequence number of the last event already seen;
+    #                 0 fetches everything still in the journal
+    #
+    #  @return Returns a tuple of (events, next_cursor).  Each event is
+    #          a tuple of (seq, timestamp, evtype, code1, code2, message)
+    #          where evtype 0 carries StatusMajor/StatusMinor and
+    #          evtype 1 carries LogGroup/LogCategory in code1/code2.
+    #
+    @__delete_check
+    def FetchEventsSince(self, cursor=0):
+        (events, next_cursor) = self.__session_intf.FetchEventsSince(cursor)
+        return (events, next_cursor)
+
+
     ##
     #  Retrieve session statistics
     #
@@ -368,6 +389,69 @@ class Session(object):
 
 
 
+##
+#  The SessionEventStream object reads the binary StatusChange event
+#  stream of the session manager.  Each event arrives as one fixed
+#  size binary record over a plain Unix socket, so following the
+#  status of hundreds of sessions costs one read() and one
+#  struct.unpack() per event instead of one D-Bus signal delivery
+#
+class SessionEventStream(object):
+    #  Record layout, must match struct EventStreamRecord in
+    #  src/sessionmgr/event-stream.hpp: a little-endian uint64
+    #  timestamp, uint32 StatusMajor, uint32 StatusMinor and the NUL
+    #  padded session path token
+    RECORD_FORMAT = '<QII48s'
+    RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+    ##
+    #  Initialize the SessionEventStream object
+    #
+    #  @param fd  File descriptor of the event stream socket, as
+    #             returned by the session manager
+    #
+    def __init__(self, fd):
+        self.__fd = fd
+
+    ##
+    #  Returns the underlying file descriptor, making this object
+    #  usable directly with select/poll based main loops
+    #
+    def fileno(self):
+        return self.__fd
+
+    ##
+    #  Reads one event record from the stream.  Blocks until a full
+    #  record has arrived, unless the caller waited for readability
+    #  on fileno() first
+    #
+    #  @return Returns a tuple of (session D-Bus path, StatusMajor,
+    #          StatusMinor, timestamp), or None if the session
+    #          manager closed the stream
+    #
+    def Receive(self):
+        data = b''
+        while len(data) < self.RECORD_SIZE:
+            chunk = os.read(self.__fd, self.RECORD_SIZE - len(data))
+            if len(chunk) == 0:
+                return None
+            data += chunk
+
+        (tstamp, major, minor, token) = struct.unpack(self.RECORD_FORMAT,
+                                                      data)
+        path = '/net/openvpn/v3/sessions/' \
+               + token.rstrip(b'\0').decode('ascii')
+        return (path, StatusMajor(major), StatusMinor(minor), tstamp)
+
+    ##
+    #  Closes the event stream
+    #
+    def Close(self):
+        if self.__fd >= 0:
+            os.close(self.__fd)
+            self.__fd = -1
+
+
 ##
 #  The SessionManager object provides access to the main object in
 #  the session manager D-Bus service.  This is primarily used to create
@@ -427,3 +511,87 @@ class SessionManager(object):
         for s in self.__manager_intf.FetchAvailableSessions():
             ret.append(Session(self.__dbuscon, s))
         return ret
+
+
+    ##
+    #  Opens the binary StatusChange event stream of the session
+    #  manager.  The stream carries events for all sessions the
+    #  calling user has access to, without any per-event D-Bus
+    #  signal marshalling
+    #
+    #  @return Returns a SessionEventStream object
+    #
+    def OpenEventStream(self):
+        fd = self.__manager_intf.OpenEventStream()
+        return SessionEventStream(fd.take())
+
+
+    ##
+    #  Disconnects all VPN sessions the calling user has access to,
+    #  in one method call
+    #
+    #  @param owner        (optional) Only disconnect sessions owned by
+    #                      this numeric user id
+    #  @param config_path  (optional) Only disconnect sessions started
+    #                      from this configuration profile path
+    #
+    #  @return Returns a tuple of (list of disconnected session paths,
+    #          number of sessions skipped)
+    #
+    def DisconnectAll(self, owner=None, config_path=None):
+        (paths, skipped) = self.__manager_intf.DisconnectAll(
+            self.__bulk_filters(owner, config_path))
+        return ([str(p) for p in paths], int(skipped))
+
+
+    ##
+    #  Pauses all VPN sessions the calling user has access to,
+    #  in one method call
+    #
+    #  @param owner        (optional) Only pause sessions owned by
+    #                      this numeric user id
+    #  @param config_path  (optional) Only pause sessions started
+    #                      from this configuration profile path
+    #  @param reason       (optional) Reason string passed to the
+    #                      VPN backends
+    #
+    #  @return Returns a tuple of (list of paused session paths,
+    #          number of sessions skipped)
+    #
+    def PauseAll(self, owner=None, config_path=None, reason=None):
+        (paths, skipped) = self.__manager_intf.PauseAll(
+            self.__bulk_filters(owner, config_path, reason))
+        return ([str(p) for p in paths], int(skipped))
+
+
+    ##
+    #  Resumes all paused VPN sessions the calling user has access to,
+    #  in one method call
+    #
+    #  @param owner        (optional) Only resume sessions owned by
+    #                      this numeric user id
+    #  @param config_path  (optional) Only resume sessions started
+    #                      from this configuration profile path
+    #
+    #  @return Returns a tuple of (list of resumed session paths,
+    #          number of sessions skipped)
+    #
+    def ResumeAll(self, owner=None, config_path=None):
+        (paths, skipped) = self.__manager_intf.ResumeAll(
+            self.__bulk_filters(owner, config_path))
+        return ([str(p) for p in paths], int(skipped))
+
+
+    ##
+    #  Internal helper building the a{sv} filters dictionary used by
+    #  the bulk session operations
+    #
+    def __bulk_filters(self, owner, config_path, reason=None):
+        filters = dbus.Dictionary({}, signature='sv')
+        if owner is not None:
+            filters['owner'] = dbus.UInt32(owner)
+        if config_path is not None:
+            filters['config_path'] = dbus.String(config_path)
+        if reason is not None:
+            filters['reason'] = dbus.String(reason)
+        return filters
@@ -32,4 +32,4 @@ __all__ = ['StatusMajor', 'StatusMinor',
 from .constants import *
 from .ConfigParser import ConfigParser
 from .ConfigManager import ConfigurationManager, Configuration
-from .SessionManager import SessionManager, Session
+from .SessionManager import SessionManager, Session, SessionEventStream
@@ -0,0 +1,191 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   event-journal.hpp
+ *
+ * @brief  Bounded per-session journal of status and log events.
+ *         The session object keeps only the single last status and
+ *         log event for its D-Bus properties; the journal keeps a
+ *         fixed size ring of recent events with monotonic sequence
+ *         numbers, so a monitoring client which lost its signal
+ *         subscription for a while can catch up with one
+ *         FetchEventsSince call instead of holding a permanent
+ *         subscription.
+ */
+
+#ifndef OPENVPN3_SESSIONMGR_EVENT_JOURNAL_HPP
+#define OPENVPN3_SESSIONMGR_EVENT_JOURNAL_HPP
+
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+
+
+/**
+ *  One journaled event.  Status events carry StatusMajor/StatusMinor
+ *  in code1/code2, log events carry LogGroup/LogCategory.  The entry
+ *  objects live in a preallocated ring and are overwritten in place,
+ *  so the message buffer keeps its capacity across rounds.
+ */
+struct SessionJournalEntry
+{
+    uint64_t seq = 0;           ///< Monotonic sequence number, starts at 1
+    uint64_t timestamp = 0;     ///< Unix timestamp when the event was seen
+    guint32 evtype = 0;         ///< Event type, one of the TYPE_ constants
+    guint32 code1 = 0;          ///< StatusMajor or LogGroup
+    guint32 code2 = 0;          ///< StatusMinor or LogCategory
+    std::string message;        ///< Event message text
+};
+
+
+/**
+ *  Fixed size ring journal of session events.  All entries are
+ *  preallocated at construction and recycled in sequence number
+ *  order; appending an event never allocates once the ring's message
+ *  buffers have grown to their working size.
+ *
+ *  Events are appended from the GLib main loop by the signal proxy
+ *  callbacks, while FetchEventsSince is served from the session
+ *  manager's method dispatch pool; a mutex keeps the two apart.  The
+ *  lock is uncontended outside a concurrent fetch and held only for
+ *  the ring access itself.
+ */
+class SessionEventJournal
+{
+public:
+    static const guint32 TYPE_STATUS = 0;  ///< Entry is a StatusChange event
+    static const guint32 TYPE_LOG = 1;     ///< Entry is a Log event
+
+    /**
+     *  Constructs the journal with a fixed capacity
+     *
+     * @param capacity  Number of entries the ring holds before the
+     *                  oldest entries are overwritten
+     */
+    SessionEventJournal(size_t capacity = 64)
+        : entries(capacity), next_seq(1)
+    {
+    }
+
+    /**
+     *  Records a StatusChange event in the journal
+     *
+     * @param major  StatusMajor value of the event
+     * @param minor  StatusMinor value of the event
+     * @param msg    Status message text
+     */
+    void AppendStatus(guint32 major, guint32 minor, const char *msg)
+    {
+        append(TYPE_STATUS, major, minor, msg ? msg : "");
+    }
+
+    /**
+     *  Records a Log event in the journal
+     *
+     * @param group  LogGroup value of the event
+     * @param catg   LogCategory value of the event
+     * @param msg    The log message itself
+     */
+    void AppendLog(guint32 group, guint32 catg, const char *msg)
+    {
+        append(TYPE_LOG, group, catg, msg ? msg : "");
+    }
+
+    /**
+     *  Retrieves the highest sequence number handed out so far.  A
+     *  client passes this value back as the cursor of its next
+     *  FetchEventsSince call.
+     *
+     * @return Returns the sequence number of the newest journaled
+     *         event, or 0 when the journal is empty
+     */
+    uint64_t LastSequence()
+    {
+        std::lock_guard<std::mutex> lock(guard);
+        return next_seq - 1;
+    }
+
+    /**
+     *  Builds a D-Bus array of all journaled events newer than the
+     *  provided cursor, in sequence number order.  Events which have
+     *  already been overwritten in the ring are silently absent; the
+     *  client detects the gap by comparing the first returned
+     *  sequence number against its cursor.
+     *
+     * @param cursor  Sequence number of the last event the caller has
+     *                seen; 0 fetches everything still in the ring
+     *
+     * @return Returns a new GVariant containing an a(ttuuus) array of
+     *         (seq, timestamp, evtype, code1, code2, message) entries
+     */
+    GVariant * FetchSince(uint64_t cursor)
+    {
+        std::lock_guard<std::mutex> lock(guard);
+        GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE("a(ttuuus)"));
+
+        // Oldest sequence number still present in the ring
+        uint64_t oldest = 1;
+        if (next_seq - 1 > entries.size())
+        {
+            oldest = next_seq - entries.size();
+        }
+        uint64_t first = (cursor + 1 > oldest ? cursor + 1 : oldest);
+        for (uint64_t seq = first; seq < next_seq; seq++)
+        {
+            const SessionJournalEntry& e = entries[(seq - 1) % entries.size()];
+            g_variant_builder_add(b, "(ttuuus)",
+                                  e.seq, e.timestamp,
+                                  e.evtype, e.code1, e.code2,
+                                  e.message.c_str());
+        }
+        GVariant *ret = g_variant_builder_end(b);
+        g_variant_builder_unref(b);
+        return ret;
+    }
+
+
+private:
+    std::vector<SessionJournalEntry> entries;  ///< Preallocated entry ring
+    uint64_t next_seq;                         ///< Next sequence number to assign
+    std::mutex guard;                          ///< Serializes appends against fetches
+
+    /**
+     *  Overwrites the oldest ring slot with a new event.  The slot's
+     *  message buffer is assigned into, which reuses its capacity.
+     */
+    void append(guint32 evtype, guint32 code1, guint32 code2,
+                const char *msg)
+    {
+        std::lock_guard<std::mutex> lock(guard);
+        SessionJournalEntry& slot = entries[(next_seq - 1) % entries.size()];
+        slot.seq = next_seq++;
+        slot.timestamp = (uint64_t) std::time(nullptr);
+        slot.evtype = evtype;
+        slot.code1 = code1;
+        slot.code2 = code2;
+        slot.message = msg;
+    }
+};
+
+#endif // OPENVPN3_SESSIONMGR_EVENT_JOURNAL_HPP
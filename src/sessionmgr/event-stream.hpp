@@ -0,0 +1,208 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   event-stream.hpp
+ *
+ * @brief  Binary StatusChange event stream for the session manager.
+ *         Clients attach via the OpenEventStream D-Bus method and
+ *         receive one fixed size binary record per StatusChange event
+ *         over a plain Unix socket, instead of one D-Bus signal per
+ *         event.  A front-end watching hundreds of sessions then pays
+ *         one read() and one struct unpack per event, with no GVariant
+ *         marshalling on either side.
+ */
+
+#ifndef OPENVPN3_SESSIONMGR_EVENT_STREAM_HPP
+#define OPENVPN3_SESSIONMGR_EVENT_STREAM_HPP
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/**
+ *  One record on the binary event stream.  The layout is fixed and
+ *  little-endian on all supported platforms, so a Python client can
+ *  parse it with a single struct.unpack('<QII48s', record) call.
+ *
+ *  The session_token field carries the unique token of the session's
+ *  D-Bus object path (the last path element), NUL padded.
+ */
+struct EventStreamRecord
+{
+    uint64_t timestamp;
+    uint32_t major;
+    uint32_t minor;
+    char session_token[48];
+};
+static_assert(64 == sizeof(struct EventStreamRecord),
+              "EventStreamRecord layout must match the documented wire format");
+
+
+/**
+ *  Keeps track of the attached event stream clients and fans each
+ *  StatusChange event out to them as binary records.
+ *
+ *  Each client is one end of a socketpair; the peer end was handed to
+ *  the client over D-Bus when it attached.  Writes are non-blocking:
+ *  a client too slow to drain its socket buffer misses events rather
+ *  than stalling the session manager, and a client which closed its
+ *  end is detached on the first failed write.
+ */
+class EventStreamHub
+{
+public:
+    EventStreamHub()
+    {
+    }
+
+    ~EventStreamHub()
+    {
+        for (const auto& client : clients)
+        {
+            close(client.fd);
+        }
+    }
+
+    EventStreamHub(const EventStreamHub&) = delete;
+    EventStreamHub& operator=(const EventStreamHub&) = delete;
+
+
+    /**
+     *  Attaches a new event stream client.  A socketpair is created;
+     *  the hub keeps one end for writing events and the other end is
+     *  returned to be passed to the client over D-Bus.
+     *
+     * @param uid  uid of the attaching client, used to filter the
+     *             stream down to the sessions the client may access
+     *
+     * @return Returns the file descriptor to hand to the client.  The
+     *         caller owns it and must close it once it has been sent.
+     *         Returns -1 if the socketpair could not be created.
+     */
+    int AttachClient(uid_t uid)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       0, fds) < 0)
+        {
+            return -1;
+        }
+
+        Client client;
+        client.fd = fds[0];
+        client.uid = uid;
+        clients.push_back(client);
+        return fds[1];
+    }
+
+
+    /**
+     *  Checks if any clients are attached, allowing event producers
+     *  to skip building records nobody will receive
+     *
+     * @return Returns true if at least one client is attached
+     */
+    bool HasClients()
+    {
+        return !clients.empty();
+    }
+
+
+    /**
+     *  Sends one StatusChange event to every attached client allowed
+     *  to see the session
+     *
+     * @param session_path  D-Bus object path of the session the event
+     *                      belongs to; only the unique token (the last
+     *                      path element) goes on the wire
+     * @param major         StatusMajor value of the event
+     * @param minor         StatusMinor value of the event
+     * @param acl_check     Callback deciding if a client uid may see
+     *                      events of this session
+     */
+    void Broadcast(const std::string& session_path,
+                   uint32_t major, uint32_t minor,
+                   std::function<bool(uid_t)> acl_check)
+    {
+        if (clients.empty())
+        {
+            return;
+        }
+
+        struct EventStreamRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.timestamp = (uint64_t) time(NULL);
+        rec.major = major;
+        rec.minor = minor;
+
+        std::string::size_type slash = session_path.find_last_of('/');
+        std::string token = (std::string::npos == slash
+                             ? session_path : session_path.substr(slash + 1));
+        token.copy(rec.session_token,
+                   sizeof(rec.session_token) - 1);
+
+        for (auto it = clients.begin(); it != clients.end(); )
+        {
+            if (acl_check && !acl_check(it->uid))
+            {
+                ++it;
+                continue;
+            }
+
+            ssize_t w = write(it->fd, &rec, sizeof(rec));
+            if (w < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+            {
+                // The client is not draining its socket buffer.
+                // Dropping the event for this client beats blocking
+                // the session manager main loop on it.
+                ++it;
+                continue;
+            }
+            if (w != sizeof(rec))
+            {
+                // Closed or broken peer; detach the client
+                close(it->fd);
+                it = clients.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+
+
+private:
+    struct Client
+    {
+        int fd = -1;
+        uid_t uid = 0;
+    };
+    std::vector<Client> clients;
+};
+
+#endif  // OPENVPN3_SESSIONMGR_EVENT_STREAM_HPP
@@ -0,0 +1,224 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   metrics-endpoint.hpp
+ *
+ * @brief  Unix socket endpoint serving Prometheus exposition format
+ *         metrics.  Each connection receives a single HTTP response
+ *         with the current metrics snapshot and is then closed, so a
+ *         scrape of any number of sessions is one connect, one read.
+ */
+
+#ifndef OPENVPN3_SESSIONMGR_METRICS_ENDPOINT_HPP
+#define OPENVPN3_SESSIONMGR_METRICS_ENDPOINT_HPP
+
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+
+
+class MetricsEndpoint
+{
+public:
+    /**
+     *  Creates and starts the metrics endpoint on a Unix socket.  The
+     *  socket file is created with 0600 permissions.
+     *
+     * @param socket_path  File system path of the Unix socket to serve on
+     * @param render       Callback rendering the current metrics in
+     *                     Prometheus exposition format
+     */
+    MetricsEndpoint(std::string socket_path,
+                    std::function<std::string()> render)
+        : socket_path(socket_path),
+          render(render)
+    {
+        service = g_socket_service_new();
+
+        // With systemd socket activation the listening socket is
+        // created before this process and passed in following the
+        // sd_listen_fds protocol; adopt it instead of binding our
+        // own, so the endpoint is reachable from the very first
+        // moment of the process lifetime
+        if (adopt_activation_socket())
+        {
+            g_signal_connect(service, "incoming",
+                             G_CALLBACK(incoming_cb), this);
+            g_socket_service_start(service);
+            return;
+        }
+
+        // A stale socket file from a previous run blocks the bind
+        ::unlink(socket_path.c_str());
+
+        GSocketAddress *addr = g_unix_socket_address_new(socket_path.c_str());
+        GError *error = NULL;
+        if (!g_socket_listener_add_address(G_SOCKET_LISTENER(service),
+                                           addr,
+                                           G_SOCKET_TYPE_STREAM,
+                                           G_SOCKET_PROTOCOL_DEFAULT,
+                                           NULL, NULL, &error))
+        {
+            std::string errmsg = "Could not open metrics socket "
+                                 + socket_path;
+            if (error)
+            {
+                errmsg += ": " + std::string(error->message);
+                g_error_free(error);
+            }
+            g_object_unref(addr);
+            g_object_unref(service);
+            service = nullptr;
+            throw std::runtime_error(errmsg);
+        }
+        g_object_unref(addr);
+        chmod(socket_path.c_str(), S_IRUSR | S_IWUSR);
+
+        g_signal_connect(service, "incoming",
+                         G_CALLBACK(incoming_cb), this);
+        g_socket_service_start(service);
+    }
+
+
+    ~MetricsEndpoint()
+    {
+        if (service)
+        {
+            g_socket_service_stop(service);
+            g_object_unref(service);
+        }
+        if (!socket_adopted)
+        {
+            // An adopted socket file belongs to the process which
+            // created it (the service manager), not to us
+            ::unlink(socket_path.c_str());
+        }
+    }
+
+
+    MetricsEndpoint(const MetricsEndpoint&) = delete;
+    MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+
+private:
+    std::string socket_path;
+    std::function<std::string()> render;
+    GSocketService *service = nullptr;
+    bool socket_adopted = false;
+
+
+    /**
+     *  Checks for a listening socket passed in by the service manager
+     *  following the sd_listen_fds protocol (LISTEN_PID/LISTEN_FDS
+     *  environment, first descriptor at fd 3) and hands it over to
+     *  the socket service.  The protocol is simple enough that no
+     *  libsystemd dependency is needed for it.
+     *
+     * @return Returns true if an activation socket was adopted
+     */
+    bool adopt_activation_socket()
+    {
+        const char *listen_pid = std::getenv("LISTEN_PID");
+        const char *listen_fds = std::getenv("LISTEN_FDS");
+        if (!listen_pid || !listen_fds)
+        {
+            return false;
+        }
+        if ((pid_t) std::atol(listen_pid) != getpid()
+            || std::atoi(listen_fds) < 1)
+        {
+            return false;
+        }
+
+        // SD_LISTEN_FDS_START == 3; only a single metrics socket
+        // is expected
+        GError *error = NULL;
+        GSocket *sock = g_socket_new_from_fd(3, &error);
+        if (!sock)
+        {
+            if (error)
+            {
+                g_error_free(error);
+            }
+            return false;
+        }
+
+        if (!g_socket_listener_add_socket(G_SOCKET_LISTENER(service),
+                                          sock, NULL, &error))
+        {
+            if (error)
+            {
+                g_error_free(error);
+            }
+            g_object_unref(sock);
+            return false;
+        }
+        g_object_unref(sock);
+        socket_adopted = true;
+        return true;
+    }
+
+
+    /**
+     *  GLib2 callback invoked for each incoming connection on the
+     *  metrics socket.  Writes a minimal HTTP response carrying the
+     *  rendered metrics and lets the connection close.  The request
+     *  itself is not parsed; every connection receives the full
+     *  snapshot.
+     *
+     * @param service     GSocketService the connection arrived on
+     * @param connection  The incoming GSocketConnection
+     * @param source      Source object provided at listen time (unused)
+     * @param user_data   Pointer to the MetricsEndpoint object
+     *
+     * @return Always returns TRUE, as the connection is fully handled
+     */
+    static gboolean incoming_cb(GSocketService *service,
+                                GSocketConnection *connection,
+                                GObject *source,
+                                gpointer user_data)
+    {
+        MetricsEndpoint *self = (MetricsEndpoint *) user_data;
+
+        std::string body = self->render();
+        std::string reply = "HTTP/1.0 200 OK\r\n"
+                            "Content-Type: text/plain; version=0.0.4\r\n"
+                            "Content-Length: "
+                            + std::to_string(body.size())
+                            + "\r\n\r\n"
+                            + body;
+
+        GOutputStream *out =
+            g_io_stream_get_output_stream(G_IO_STREAM(connection));
+        g_output_stream_write_all(out, reply.c_str(), reply.size(),
+                                  NULL, NULL, NULL);
+        g_output_stream_flush(out, NULL, NULL);
+        return TRUE;
+    }
+};
+
+#endif  // OPENVPN3_SESSIONMGR_METRICS_ENDPOINT_HPP
@@ -48,16 +48,27 @@ static int session_manager(ParsedArgs args)
     }
     sessmgr.SetManagerLogLevel(log_level);
 
+    if (args.Present("metrics-socket"))
+    {
+        sessmgr.SetMetricsSocket(args.GetValue("metrics-socket", 0));
+    }
+
     IdleCheck::Ptr idle_exit;
     if (idle_wait_min > 0)
     {
         idle_exit.reset(new IdleCheck(main_loop,
                                       std::chrono::minutes(idle_wait_min)));
-        idle_exit->SetPollTime(std::chrono::seconds(30));
         sessmgr.EnableIdleCheck(idle_exit);
     }
     sessmgr.Setup();
 
+    // Pre-activate the services the first session will need, so
+    // their startup runs in parallel with ours instead of being
+    // triggered one by one at the tail of the first NewTunnel call
+    DBusPrestartServices(sessmgr.GetConnection(),
+                         {OpenVPN3DBus_name_backends,
+                          OpenVPN3DBus_name_configuration});
+
     if (idle_wait_min > 0)
     {
         idle_exit->Enable();
@@ -68,7 +79,6 @@ static int session_manager(ParsedArgs args)
     if (idle_wait_min > 0)
     {
         idle_exit->Disable();
-        idle_exit->Join();
     }
 
     return 0;
@@ -84,6 +94,9 @@ int main(int argc, char **argv)
     argparser.AddOption("idle-exit", "MINUTES", true,
                         "How long to wait before exiting if being idle. "
                         "0 disables it (Default: 3 minutes)");
+    argparser.AddOption("metrics-socket", "SOCKET-PATH", true,
+                        "Serve Prometheus formatted session metrics on "
+                        "this Unix socket (Default: disabled)");
 
     try
     {
@@ -110,6 +110,40 @@ struct LogEvent
 };
 
 
+/**
+ *  Summary record for a single managed VPN session, as returned by
+ *  OpenVPN3SessionProxy::FetchManagedSessions()
+ */
+struct SessionRecord
+{
+    std::string path;
+    uid_t owner = 0;
+    pid_t backend_pid = 0;
+    bool backend_ready = false;
+    std::time_t session_created = 0;
+    std::string config_path;
+    BackendStatus status;
+};
+
+
+/**
+ *  Filter specification for
+ *  OpenVPN3SessionProxy::FetchManagedSessionsFiltered().  The enabled
+ *  filters are evaluated server side by the session manager, so only
+ *  the matching session records cross the D-Bus.
+ */
+struct SessionListFilter
+{
+    bool by_owner = false;            ///< Filter on the owner uid
+    uid_t owner = 0;                  ///< Owner uid to match
+    bool by_status_minor = false;     ///< Filter on the StatusMinor value
+    bool status_minor_negate = false; ///< Invert the StatusMinor match
+    StatusMinor status_minor = StatusMinor::UNSET;  ///< StatusMinor to match
+    std::string config_name;          ///< Configuration profile name to
+                                      ///< match; empty disables the filter
+};
+
+
 /**
  * This exception is thrown when the OpenVPN3SessionProxy::Ready() call
  * indicates the VPN backend client needs more information from the
@@ -162,7 +196,9 @@ public:
                                  "UserInputQueueGetTypeGroup",
                                  "UserInputQueueFetch",
                                  "UserInputQueueCheck",
-                                 "UserInputProvide")
+                                 "UserInputProvide",
+                                 "UserInputQueueFetchAll",
+                                 "UserInputProvideAll")
     {
     }
 
@@ -181,7 +217,9 @@ public:
                                  "UserInputQueueGetTypeGroup",
                                  "UserInputQueueFetch",
                                  "UserInputQueueCheck",
-                                 "UserInputProvide")
+                                 "UserInputProvide",
+                                 "UserInputQueueFetchAll",
+                                 "UserInputProvideAll")
     {
     }
 
@@ -247,6 +285,95 @@ public:
     }
 
 
+    /**
+     * Retrieves a summary record for each session available to the
+     * calling user.  Unlike FetchAvailableSessions() followed by
+     * per-session property reads, this retrieves every session's full
+     * property set in one single D-Bus call to the session manager.
+     *
+     * @return A std::vector<SessionRecord>, one entry per session
+     */
+    std::vector<SessionRecord> FetchManagedSessions()
+    {
+        GVariant *res = Call("FetchManagedSessions");
+        if (NULL == res)
+        {
+            THROW_DBUSEXCEPTION("OpenVPN3SessionProxy",
+                                "Failed to retrieve managed sessions");
+        }
+        GVariantIter *sessions = NULL;
+        g_variant_get(res, "(a{oa{sv}})", &sessions);
+
+        std::vector<SessionRecord> ret = parse_session_records(sessions);
+        g_variant_iter_free(sessions);
+        g_variant_unref(res);
+        return ret;
+    }
+
+
+    /**
+     * Filtered and chunked variant of FetchManagedSessions().  The
+     * filters are evaluated by the session manager against its session
+     * registry, so only the matching records are marshalled and sent
+     * back.  Using a non-zero chunk size, a caller can page through a
+     * large result and render rows while fetching the next chunk.
+     *
+     * @param filter      SessionListFilter with the enabled filters
+     * @param chunk_size  Maximum number of records per reply; 0 means
+     *                    no limit
+     * @param offset      Number of matching records to skip, used to
+     *                    fetch the next chunk
+     * @param more        Set to true if more matching records are
+     *                    available beyond this chunk
+     *
+     * @return A std::vector<SessionRecord> with the matching records
+     */
+    std::vector<SessionRecord> FetchManagedSessionsFiltered(const SessionListFilter& filter,
+                                                            guint32 chunk_size,
+                                                            guint32 offset,
+                                                            bool& more)
+    {
+        GVariantBuilder *fb = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+        if (filter.by_owner)
+        {
+            g_variant_builder_add(fb, "{sv}", "owner",
+                                  g_variant_new_uint32(filter.owner));
+        }
+        if (filter.by_status_minor)
+        {
+            g_variant_builder_add(fb, "{sv}",
+                                  (filter.status_minor_negate
+                                   ? "status_minor_not" : "status_minor"),
+                                  g_variant_new_uint32((guint32) filter.status_minor));
+        }
+        if (!filter.config_name.empty())
+        {
+            g_variant_builder_add(fb, "{sv}", "config_name",
+                                  g_variant_new_string(filter.config_name.c_str()));
+        }
+
+        GVariant *res = Call("FetchManagedSessionsFiltered",
+                             g_variant_new("(a{sv}uu)", fb,
+                                           chunk_size, offset));
+        g_variant_builder_unref(fb);
+        if (NULL == res)
+        {
+            THROW_DBUSEXCEPTION("OpenVPN3SessionProxy",
+                                "Failed to retrieve filtered session list");
+        }
+
+        GVariantIter *sessions = NULL;
+        gboolean more_flag = FALSE;
+        g_variant_get(res, "(a{oa{sv}}b)", &sessions, &more_flag);
+
+        std::vector<SessionRecord> ret = parse_session_records(sessions);
+        g_variant_iter_free(sessions);
+        g_variant_unref(res);
+        more = more_flag;
+        return ret;
+    }
+
+
     /**
      *  Makes the VPN backend client process start the connecting to the
      *  VPN server
@@ -256,6 +383,21 @@ public:
         simple_call("Connect", "Failed to start a new tunnel");
     }
 
+
+    /**
+     *  Asynchronous variant of Connect().  The request is put on the
+     *  wire without waiting for the backend to respond, so calls against
+     *  several session objects can be in flight at the same time.
+     *
+     * @return Returns a std::future carrying the raw method result.  See
+     *         DBusProxy::CallAsync() for the completion semantics.
+     */
+    std::future<GVariant *> ConnectAsync()
+    {
+        return CallAsync("Connect");
+    }
+
+
     /**
      *  Makes the VPN backend client process disconnect and then
      *  instantly reconnect to the VPN server
@@ -266,6 +408,15 @@ public:
     }
 
 
+    /**
+     *  Asynchronous variant of Restart(); see ConnectAsync() for details.
+     */
+    std::future<GVariant *> RestartAsync()
+    {
+        return CallAsync("Restart");
+    }
+
+
     /**
      *  Disconnects and shuts down the VPN backend process.  This call
      *  will invalidate the current session object.  This can also be used
@@ -277,6 +428,16 @@ public:
     }
 
 
+    /**
+     *  Asynchronous variant of Disconnect(); see ConnectAsync() for
+     *  details.
+     */
+    std::future<GVariant *> DisconnectAsync()
+    {
+        return CallAsync("Disconnect");
+    }
+
+
     /**
      *  Pause an on-going VPN tunnel.  Pausing and Resuming an existing VPN
      *  tunnel is generally much faster than doing a full Disconnect() and
@@ -298,6 +459,18 @@ public:
     }
 
 
+    /**
+     *  Asynchronous variant of Pause(); see ConnectAsync() for details.
+     *
+     * @param reason  A string provided to the VPN backend process why the
+     *                tunnel was suspended.  Primarily used for logging.
+     */
+    std::future<GVariant *> PauseAsync(std::string reason)
+    {
+        return CallAsync("Pause", g_variant_new("(s)", reason.c_str()));
+    }
+
+
     /**
      *   Resumes a paused VPN tunnel
      */
@@ -307,6 +480,15 @@ public:
     }
 
 
+    /**
+     *  Asynchronous variant of Resume(); see ConnectAsync() for details.
+     */
+    std::future<GVariant *> ResumeAsync()
+    {
+        return CallAsync("Resume");
+    }
+
+
     /**
      *  Checks if the VPN backend process has all it needs to start connecting
      *  to a VPN server.  If it needs more information from the front-end, a
@@ -339,6 +521,19 @@ public:
     }
 
 
+    /**
+     *  Has the VPN client backend process registered with the session
+     *  manager?  Session startup is asynchronous; method calls proxied
+     *  to the backend will fail until the registration has completed.
+     *
+     * @return  Returns true once the backend registration is done
+     */
+    bool GetBackendReady()
+    {
+        return GetBoolProperty("backend_ready");
+    }
+
+
     /**
      *  Will the VPN client backend send log messages via
      *  the session manager?
@@ -532,6 +727,77 @@ public:
 
 
 private:
+    /**
+     * Parses an array of session records as returned by the
+     * FetchManagedSessions and FetchManagedSessionsFiltered methods
+     * in the session manager
+     *
+     * @param sessions  GVariantIter over an a{oa{sv}} session array
+     *
+     * @return A std::vector<SessionRecord>, one entry per session
+     */
+    std::vector<SessionRecord> parse_session_records(GVariantIter *sessions)
+    {
+        std::vector<SessionRecord> ret;
+        gchar *path = NULL;
+        GVariant *props = NULL;
+        while (g_variant_iter_next(sessions, "{o@a{sv}}", &path, &props))
+        {
+            SessionRecord rec;
+            rec.path = std::string(path);
+            g_free(path);
+
+            GVariant *d = NULL;
+            d = g_variant_lookup_value(props, "owner", G_VARIANT_TYPE_UINT32);
+            if (NULL != d)
+            {
+                rec.owner = g_variant_get_uint32(d);
+                g_variant_unref(d);
+            }
+            d = g_variant_lookup_value(props, "backend_pid",
+                                       G_VARIANT_TYPE_UINT32);
+            if (NULL != d)
+            {
+                rec.backend_pid = g_variant_get_uint32(d);
+                g_variant_unref(d);
+            }
+            d = g_variant_lookup_value(props, "backend_ready",
+                                       G_VARIANT_TYPE_BOOLEAN);
+            if (NULL != d)
+            {
+                rec.backend_ready = g_variant_get_boolean(d);
+                g_variant_unref(d);
+            }
+            d = g_variant_lookup_value(props, "session_created",
+                                       G_VARIANT_TYPE_UINT64);
+            if (NULL != d)
+            {
+                rec.session_created = g_variant_get_uint64(d);
+                g_variant_unref(d);
+            }
+            gsize len;
+            d = g_variant_lookup_value(props, "config_path",
+                                       G_VARIANT_TYPE_STRING);
+            if (NULL != d)
+            {
+                rec.config_path = std::string(g_variant_get_string(d, &len));
+                g_variant_unref(d);
+            }
+            d = g_variant_lookup_value(props, "status",
+                                       G_VARIANT_TYPE("a{sv}"));
+            if (NULL != d)
+            {
+                rec.status.Parse(d);
+                g_variant_unref(d);
+            }
+
+            ret.push_back(rec);
+            g_variant_unref(props);
+        }
+        return ret;
+    }
+
+
     /**
      * Simple wrapper for simple D-Bus method calls not requiring much
      * input.  Will also throw a DBusException in case of errors.
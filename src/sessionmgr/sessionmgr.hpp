@@ -33,14 +33,20 @@
 #ifndef OPENVPN3_DBUS_SESSIONMGR_HPP
 #define OPENVPN3_DBUS_SESSIONMGR_HPP
 
+#include <algorithm>
 #include <cstring>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <ctime>
 
+#include <gio/gunixfdlist.h>
+
 #include <openvpn/common/likely.hpp>
 #include <openvpn/log/logsimple.hpp>
 
 #include "common/core-extensions.hpp"
+#include "common/pidfd-watch.hpp"
 #include "common/requiresqueue.hpp"
 #include "common/utils.hpp"
 #include "dbus/core.hpp"
@@ -48,6 +54,11 @@
 #include "dbus/path.hpp"
 #include "log/dbus-log.hpp"
 #include "client/backendstatus.hpp"
+#include "client/statistics.hpp"
+#include "client/statistics-shm.hpp"
+#include "sessionmgr/event-journal.hpp"
+#include "sessionmgr/event-stream.hpp"
+#include "sessionmgr/metrics-endpoint.hpp"
 #include "ovpn3cli/lookup.hpp"
 
 using namespace openvpn;
@@ -127,7 +138,8 @@ public:
      */
     void StatusChange(const StatusMajor major, const StatusMinor minor, std::string msg)
     {
-        GVariant *params = g_variant_new("(uus)", (guint) major, (guint) minor, msg.c_str());
+        GVariant *params = GVariantTyped::Tuple((guint) major, (guint) minor,
+                                                msg);
         Send("StatusChange", params);
     }
 
@@ -139,7 +151,8 @@ public:
      */
     void StatusChange(const StatusMajor major, const StatusMinor minor)
     {
-        GVariant *params = g_variant_new("(uus)", (guint) major, (guint) minor, "");
+        GVariant *params = GVariantTyped::Tuple((guint) major, (guint) minor,
+                                                "");
         Send("StatusChange", params);
     }
 };
@@ -175,6 +188,10 @@ public:
         : LogConsumerProxy(conn, interface, be_obj_path,
                            OpenVPN3DBus_interf_sessions, sigproxy_obj_path)
     {
+        // This object is a pure relay; let the proxy forward the
+        // received GVariant as-is instead of deserializing and
+        // reserializing every log line
+        EnablePassThrough();
     }
 
 
@@ -199,6 +216,53 @@ public:
         last_group = group;
         last_logcateg = catg;
         last_msg = msg;
+        if (journal)
+        {
+            journal->AppendLog((guint32) group, (guint32) catg, msg.c_str());
+        }
+    }
+
+
+    /**
+     *  Pass-through mode counterpart of @ConsumeLogEvent().  Captures
+     *  the last log event for the last_log property; assigning into
+     *  the existing last_msg buffer reuses its capacity, so no
+     *  allocation happens once the buffer has grown large enough.
+     *
+     * @param sender       D-Bus bus name of the sender of the log event
+     * @param interface    D-Bus interface of the sender of the log event
+     * @param object_path  D-Bus object path of the sender of the log event
+     * @param group        LogGroup reference of the log event
+     * @param catg         LogCategory reference of the log event
+     * @param msg          Borrowed pointer to the log message
+     */
+    void ConsumeLogEventBorrowed(const std::string& sender,
+                                 const std::string& interface,
+                                 const std::string& object_path,
+                                 const LogGroup group, const LogCategory catg,
+                                 const char *msg) override
+    {
+        last_group = group;
+        last_logcateg = catg;
+        last_msg = msg;
+        if (journal)
+        {
+            journal->AppendLog((guint32) group, (guint32) catg, msg);
+        }
+    }
+
+
+    /**
+     *  Registers the event journal of the owning session object.  Every
+     *  log event proxied by this object is then also recorded in the
+     *  journal, so monitors can replay it via FetchEventsSince.
+     *
+     * @param j  Pointer to the SessionEventJournal owned by the session
+     *           object.  The journal outlives this proxy object.
+     */
+    void SetJournal(SessionEventJournal *j)
+    {
+        journal = j;
     }
 
 
@@ -214,12 +278,12 @@ public:
         {
             return NULL;  // Nothing have been logged, nothing to report
         }
-        GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+        GVariantBuilder *b = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a{sv}"));
         g_variant_builder_add (b, "{sv}", "log_group", g_variant_new_uint32((guint32) last_group));
         g_variant_builder_add (b, "{sv}", "log_category", g_variant_new_uint32((guint32) last_logcateg));
         g_variant_builder_add (b, "{sv}", "log_message", g_variant_new_string(last_msg.c_str()));
         GVariant *ret = g_variant_builder_end(b);
-        g_variant_builder_unref(b);
+        GVariantBuilderPool::Release(b);
         return ret;
     }
 
@@ -233,6 +297,7 @@ private:
     LogGroup last_group;
     LogCategory last_logcateg;
     std::string last_msg;
+    SessionEventJournal *journal = nullptr;
 };
 
 
@@ -266,12 +331,26 @@ public:
                         std::string interface,
                         std::string be_obj_path,
                         std::string sigproxy_obj_path)
-        : DBusSignalSubscription(conn, bus_name, interface, be_obj_path, "StatusChange"),
+        : DBusSignalSubscription(conn, bus_name, interface, be_obj_path),
           DBusSignalProducer(conn, "", OpenVPN3DBus_interf_sessions, sigproxy_obj_path),
           last_major(0),
           last_minor(0),
           last_msg("")
     {
+        // One shared match rule per interface instead of one per
+        // session; the routing on backend bus name and object path
+        // happens locally in the DBusSignalHub
+        SubscribeShared("StatusChange");
+    }
+
+
+    ~SessionStatusChange()
+    {
+        if (flush_source > 0)
+        {
+            g_source_remove(flush_source);
+            flush_source = 0;
+        }
     }
 
     /**
@@ -307,6 +386,13 @@ public:
         gchar *msg;
         g_variant_get (status, "(uus)", &maj, &min, &msg);
 
+        // The journal records the raw event stream, independent of
+        // the CONN_AUTH_FAILED preservation below
+        if (journal)
+        {
+            journal->AppendStatus(maj, min, msg);
+        }
+
         // If the last status received was CONNECTION:CONN_AUTH_FAILED,
         // preserve this status message
         if (!(StatusMajor::CONNECTION == (StatusMajor) last_major
@@ -316,10 +402,11 @@ public:
             last_minor = min;
             last_msg = std::string(msg);
         }
+        std::string message(msg);
         g_free(msg);
 
         // Proxy this mesage via DBusSignalProducer
-        Send("StatusChange", status);
+        coalesce_and_send(maj, min, message);
     }
 
 
@@ -327,6 +414,13 @@ public:
     {
         BackendStatus be_status(status);
 
+        if (journal)
+        {
+            journal->AppendStatus((guint32) be_status.major,
+                                  (guint32) be_status.minor,
+                                  be_status.message.c_str());
+        }
+
         // If the last status received was CONNECTION:CONN_AUTH_FAILED,
         // preserve this status message
         if (!(StatusMajor::CONNECTION == (StatusMajor) last_major
@@ -338,11 +432,30 @@ public:
         }
 
         // Proxy this mesage via DBusSignalProducer
-        GVariant *sig = g_variant_new("(uus)",
-                                      (guint32) be_status.major,
-                                      (guint32) be_status.minor,
-                                      be_status.message.c_str());
-        Send("StatusChange", sig);
+        coalesce_and_send((guint32) be_status.major,
+                          (guint32) be_status.minor,
+                          be_status.message);
+    }
+
+
+    /**
+     *  Sets the coalescing window for proxied StatusChange signals.
+     *  Within this window, transitions which repeat the last emitted
+     *  status or bounce back to the previous one (A-B-A, as seen on a
+     *  flapping uplink) are merged into a single delayed emission
+     *  carrying a repeat count in the status message.  The raw event
+     *  stream is still recorded in the event journal.
+     *
+     * @param ms  Window length in milliseconds.  0 (the default)
+     *            disables coalescing and proxies every transition.
+     */
+    void SetCoalesceWindow(unsigned int ms)
+    {
+        coalesce_window = ms;
+        if (0 == ms)
+        {
+            flush_pending();
+        }
     }
 
     /**
@@ -351,6 +464,34 @@ public:
      * @return  Returns a GVariant Glib2 object containing a key/value
      *          dictionary of the last signal sent
      */
+    /**
+     *  Retrieve the StatusMinor value of the last processed status
+     *  change.  Used by the session manager when evaluating status
+     *  filters against the session registry.
+     *
+     * @return Returns the raw StatusMinor value of the last event, or
+     *         0 (UNSET) if no event has been seen yet
+     */
+    guint32 GetLastMinor()
+    {
+        return last_minor;
+    }
+
+
+    /**
+     *  Registers the event journal of the owning session object.  Every
+     *  status event proxied by this object is then also recorded in
+     *  the journal, so monitors can replay it via FetchEventsSince.
+     *
+     * @param j  Pointer to the SessionEventJournal owned by the session
+     *           object.  The journal outlives this proxy object.
+     */
+    void SetJournal(SessionEventJournal *j)
+    {
+        journal = j;
+    }
+
+
     GVariant * GetLastStatusChange()
     {
         if( last_msg.empty() && 0 == last_major && 0 == last_minor)
@@ -358,12 +499,12 @@ public:
             return NULL;  // Nothing have been logged, nothing to report
         }
 
-        GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+        GVariantBuilder *b = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a{sv}"));
         g_variant_builder_add (b, "{sv}", "major", g_variant_new_uint32(last_major));
         g_variant_builder_add (b, "{sv}", "minor", g_variant_new_uint32(last_minor));
         g_variant_builder_add (b, "{sv}", "status_message", g_variant_new_string(last_msg.c_str()));
         GVariant *ret = g_variant_builder_end(b);
-        g_variant_builder_unref(b);
+        GVariantBuilderPool::Release(b);
         return ret;
     }
 
@@ -395,7 +536,124 @@ private:
     guint32 last_major;
     guint32 last_minor;
     std::string last_msg;
+    SessionEventJournal *journal = nullptr;
+
+    unsigned int coalesce_window = 0;  ///< Coalescing window (ms), 0 = off
+    guint32 emit_major = 0;            ///< Last emitted StatusMajor
+    guint32 emit_minor = 0;            ///< Last emitted StatusMinor
+    std::string emit_msg;              ///< Last emitted status message
+    guint32 prev_major = 0;            ///< StatusMajor emitted before that
+    guint32 prev_minor = 0;            ///< StatusMinor emitted before that
+    gint64 emit_time = 0;              ///< Monotonic time of last emission
+    guint32 pending_count = 0;         ///< Suppressed events since last emission
+    guint32 pending_major = 0;         ///< StatusMajor of the newest suppressed event
+    guint32 pending_minor = 0;         ///< StatusMinor of the newest suppressed event
+    std::string pending_msg;           ///< Message of the newest suppressed event
+    guint flush_source = 0;            ///< Active delayed flush timer, if any
+
+
+    /**
+     *  Emits a proxied StatusChange signal, unless the transition
+     *  repeats the last emitted status or bounces back to the
+     *  previous one within the coalescing window.  Suppressed
+     *  transitions are merged into one delayed emission with a repeat
+     *  count appended to the status message.
+     *
+     * @param maj  Raw StatusMajor value of the event
+     * @param min  Raw StatusMinor value of the event
+     * @param msg  std::string with the status message of the event
+     */
+    void coalesce_and_send(guint32 maj, guint32 min,
+                           const std::string& msg)
+    {
+        if (0 == coalesce_window)
+        {
+            send_status(maj, min, msg);
+            return;
+        }
+
+        bool repeat = (maj == emit_major && min == emit_minor);
+        bool bounce = (maj == prev_major && min == prev_minor
+                       && (0 != prev_major || 0 != prev_minor));
+        gint64 now = g_get_monotonic_time();
+        if ((repeat || bounce)
+            && (now - emit_time) < ((gint64) coalesce_window * 1000))
+        {
+            pending_major = maj;
+            pending_minor = min;
+            pending_msg = msg;
+            pending_count++;
+            if (0 == flush_source)
+            {
+                flush_source = g_timeout_add(coalesce_window,
+                                             coalesce_flush_cb, this);
+            }
+            return;
+        }
+
+        // A genuinely new transition; release anything held back
+        // first so the signal order stays intact
+        flush_pending();
+        send_status(maj, min, msg);
+    }
+
+
+    /**
+     *  Emits one proxied StatusChange signal and records it as the
+     *  last emitted transition for the coalescing logic
+     */
+    void send_status(guint32 maj, guint32 min, const std::string& msg)
+    {
+        if (maj != emit_major || min != emit_minor)
+        {
+            prev_major = emit_major;
+            prev_minor = emit_minor;
+        }
+        emit_major = maj;
+        emit_minor = min;
+        emit_msg = msg;
+        emit_time = g_get_monotonic_time();
+        Send("StatusChange", GVariantTyped::Tuple(maj, min, msg));
+    }
+
+
+    /**
+     *  Emits the summary signal for any suppressed transitions and
+     *  disarms the delayed flush timer
+     */
+    void flush_pending()
+    {
+        if (flush_source > 0)
+        {
+            g_source_remove(flush_source);
+            flush_source = 0;
+        }
+        if (0 == pending_count)
+        {
+            return;
+        }
+        std::string summary = pending_msg
+                              + " (event repeated "
+                              + std::to_string(pending_count)
+                              + (1 == pending_count ? " time)" : " times)");
+        guint32 maj = pending_major;
+        guint32 min = pending_minor;
+        pending_count = 0;
+        send_status(maj, min, summary);
+    }
 
+
+    /**
+     *  GLib2 timeout callback flushing suppressed status transitions
+     *  once the coalescing window has passed
+     */
+    static gboolean coalesce_flush_cb(gpointer user_data)
+    {
+        SessionStatusChange *self = (SessionStatusChange *) user_data;
+        self->flush_source = 0;
+        self->flush_pending();
+        return G_SOURCE_REMOVE;
+    }
 };
 
 
@@ -421,12 +679,15 @@ public:
      * @param objpath  D-Bus object path of this object
      * @param cfg_path D-Bus object path of the VPN profile configuration this
      *                 session is tied to.
+     * @param dispatch_pool  DBusDispatchPool owned by the session manager,
+     *                 which this object's method calls are routed through
      */
     SessionObject(GDBusConnection *dbuscon,
                   std::function<void()> remove_callback,
                   uid_t owner,
                   std::string objpath, std::string cfg_path,
-                  unsigned int manager_log_level)
+                  unsigned int manager_log_level,
+                  DBusDispatchPool *dispatch_pool)
         : DBusObject(objpath),
           DBusSignalSubscription(dbuscon, "", OpenVPN3DBus_interf_backends, ""),
           DBusCredentials(dbuscon, owner),
@@ -440,15 +701,25 @@ public:
           sig_logevent(nullptr),
           backend_token(""),
           backend_pid(0),
+          stats_shm(nullptr),
           be_conn(nullptr),
           registered(false),
-          selfdestruct_complete(false)
+          selfdestruct_complete(false),
+          selfdestruct_scheduled(false),
+          destruct_conn(nullptr)
     {
+        // Session method calls are proxied synchronously to the
+        // backend and can be slow; they run on the session manager's
+        // worker pool, serialized per session, so one slow session
+        // never delays calls to the others.  Property access stays on
+        // the main loop thread and is unaffected.
+        EnableThreadedDispatch(dispatch_pool);
+
         // Only for the initialization of this object, use the manager's
         // log level.  Once the object is registered with a backend, it
         // will switch to the default session log level.
         SetLogLevel(manager_log_level);
-        Subscribe("RegistrationRequest");
+        SubscribeShared("RegistrationRequest");
         RequiresQueue dummyqueue;  // Only used to get introspection data
 
         // Register configuration the configuration object
@@ -469,10 +740,17 @@ public:
                           << "        <method name='AccessRevoke'>"
                           << "            <arg direction='in' type='u' name='uid'/>"
                           << "        </method>"
+                          << "        <method name='FetchEventsSince'>"
+                          << "            <arg direction='in' type='t' name='cursor'/>"
+                          << "            <arg direction='out' type='a(ttuuus)' name='events'/>"
+                          << "            <arg direction='out' type='t' name='next_cursor'/>"
+                          << "        </method>"
                           << dummyqueue.IntrospectionMethods("UserInputQueueGetTypeGroup",
                                                              "UserInputQueueFetch",
+                                                             "UserInputQueueFetchAll",
                                                              "UserInputQueueCheck",
-                                                             "UserInputProvide")
+                                                             "UserInputProvide",
+                                                             "UserInputProvideAll")
                           << "        <signal name='AttentionRequired'>"
                           << "            <arg type='u' name='type' direction='out'/>"
                           << "            <arg type='u' name='group' direction='out'/>"
@@ -487,10 +765,15 @@ public:
                           << "        <property type='a{sv}' name='status' access='read'/>"
                           << "        <property type='a{sv}' name='last_log' access='read'/>"
                           << "        <property type='a{sx}' name='statistics' access='read'/>"
+                          << "        <property type='a{sv}' name='statistics_rates' access='read'/>"
                           << "        <property type='o' name='config_path' access='read'/>"
                           << "        <property type='u' name='backend_pid' access='read'/>"
+                          << "        <property type='b' name='backend_ready' access='read'/>"
                           << "        <property type='b' name='receive_log_events' access='readwrite'/>"
                           << "        <property type='u' name='log_verbosity' access='readwrite'/>"
+                          << "        <property type='u' name='status_coalesce_window' access='readwrite'/>"
+                          << "        <property type='u' name='crypto_workers' access='readwrite'/>"
+                          << "        <property type='a{sv}' name='transport_tuning' access='readwrite'/>"
                           << "    </interface>"
                           << "</node>";
         ParseIntrospectionXML(introspection_xml);
@@ -501,29 +784,31 @@ public:
         // have initialized, it reports back to the session manager using
         // this token as a reference.  This is used to tie the backend process
         // to this specific SessionObject.
+        //
+        // The StartClient call is asynchronous.  The constructor - and
+        // thereby the NewTunnel method call - returns as soon as the
+        // request is on the wire, so several session startups can
+        // overlap instead of queueing up behind each other in the
+        // session manager dispatch.  The rest of the startup continues
+        // in start_client_ready() and, once the backend process has
+        // initialized, in the RegistrationRequest signal handler.  The
+        // backend_ready property tells front-ends when the registration
+        // has completed.
         backend_token = generate_path_uuid("", 't');
 
-        auto backend_start = DBusProxy(G_BUS_TYPE_SYSTEM,
-                                       OpenVPN3DBus_name_backends,
-                                       OpenVPN3DBus_interf_backends,
-                                       OpenVPN3DBus_rootp_backends);
-        GVariant *res_g = backend_start.Call("StartClient",
-                                              g_variant_new("(s)", backend_token.c_str()));
-        if (NULL == res_g) {
-                THROW_DBUSEXCEPTION("SessionObject",
-                                    "Failed to extract the result of the "
-                                    "StartClient request");
-        }
-        g_variant_get(res_g, "(u)", &backend_pid);
+        g_dbus_connection_call(dbuscon,
+                               OpenVPN3DBus_name_backends.c_str(),
+                               OpenVPN3DBus_rootp_backends.c_str(),
+                               OpenVPN3DBus_interf_backends.c_str(),
+                               "StartClient",
+                               g_variant_new("(s)", backend_token.c_str()),
+                               G_VARIANT_TYPE("(u)"),
+                               G_DBUS_CALL_FLAGS_NONE,
+                               -1,
+                               NULL,
+                               start_client_ready,
+                               this);
 
-        // The PID value we get here is just a temporary.  This is the
-        // PID returned by openvpn3-service-backendstart.  This will again
-        // start the openvpn3-service-client process, which will fork() once
-        // to be completely independent.  When this last fork() happens,
-        // the backend will report back its final PID.
-        StatusChange(StatusMajor::SESSION, StatusMinor::PROC_STARTED,
-                             "session_path=" + GetObjectPath()
-                             + ", backend_pid=" + std::to_string(backend_pid));
         Debug("SessionObject registered on '" + OpenVPN3DBus_interf_sessions + "': "
               + objpath + " [backend_token=" + backend_token + "]");
 
@@ -533,6 +818,117 @@ public:
         LogVerb1(msg.str());
     }
 
+    /**
+     *  Registers a callback invoked once the backend registration for
+     *  this session has finished, successfully or not.  Used by the
+     *  bulk session start orchestrator to admit the next queued
+     *  session once a running one has settled.  The callback is
+     *  dropped after it has been invoked.
+     *
+     * @param cb  Callback function receiving true on successful
+     *            registration and false when the backend failed
+     */
+    void SetRegistrationCompleteCallback(std::function<void(bool)> cb)
+    {
+        registration_complete_callback = cb;
+    }
+
+    /**
+     *  Registers the binary event stream hub of the session manager.
+     *  Each StatusChange event from the backend is then also sent to
+     *  the attached event stream clients allowed to access this
+     *  session, as a fixed size binary record.
+     *
+     * @param hub  Pointer to the EventStreamHub owned by the session
+     *             manager object.  The hub outlives this session.
+     */
+    void SetEventStreamHub(EventStreamHub *hub)
+    {
+        event_stream = hub;
+    }
+
+    /**
+     *  Retrieves the D-Bus object path of the configuration profile
+     *  this session was started from.  Used by the session manager
+     *  when evaluating config name filters against the registry.
+     *
+     * @return Returns a string with the configuration D-Bus path
+     */
+    std::string GetConfigPath()
+    {
+        return config_path;
+    }
+
+    /**
+     *  Retrieves the StatusMinor value of the last StatusChange event
+     *  seen for this session.  Used by the session manager when
+     *  evaluating status filters against the registry.
+     *
+     * @return Returns the StatusMinor of the last event, or
+     *         StatusMinor::UNSET if no event has been seen yet
+     */
+    StatusMinor GetStatusMinor()
+    {
+        if (nullptr == sig_statuschg)
+        {
+            return StatusMinor::UNSET;
+        }
+        return (StatusMinor) sig_statuschg->GetLastMinor();
+    }
+
+    /**
+     *  Retrieves the current connection statistics for this session.
+     *  Prefers the shared memory statistics segment published by the
+     *  backend client process, falling back to the D-Bus statistics
+     *  property on older backends.  Used by the session manager when
+     *  aggregating metrics for all sessions in a single operation.
+     *
+     * @return Returns a ConnectionStats array with the current
+     *         counters.  The array is empty if the backend is not yet
+     *         registered or the statistics could not be retrieved.
+     */
+    ConnectionStats GetStatistics()
+    {
+        if (!stats_shm && !backend_token.empty())
+        {
+            stats_shm = ConnectionStatsShm::AttachReader(backend_token);
+        }
+
+        if (stats_shm)
+        {
+            return stats_shm->Read();
+        }
+
+        ConnectionStats ret;
+        if (!be_proxy)
+        {
+            return ret;
+        }
+        try
+        {
+            GVariant *res = be_proxy->GetProperty("statistics");
+            GVariantIter *iter = NULL;
+            g_variant_get(res, "a{sx}", &iter);
+
+            gchar *key = NULL;
+            gint64 value = 0;
+            while (g_variant_iter_loop(iter, "{sx}", &key, &value))
+            {
+                ret.push_back(ConnectionStatDetails(std::string(key),
+                                                    value));
+            }
+            g_variant_iter_free(iter);
+            g_variant_unref(res);
+        }
+        catch (DBusException& excp)
+        {
+            // The backend may be gone or not yet ready; an empty
+            // statistics array is the proper answer in both cases
+        }
+        return ret;
+    }
+
+
     ~SessionObject()
     {
         if (sig_statuschg)
@@ -549,6 +945,14 @@ public:
         {
             delete be_proxy;
         }
+
+        if (stats_shm)
+        {
+            // Unmaps the statistics segment; the backend process owns
+            // the segment itself and unlinks it on its own exit
+            delete stats_shm;
+            stats_shm = nullptr;
+        }
         LogVerb1("Session is closing");
         StatusChange(StatusMajor::SESSION, StatusMinor::SESS_REMOVED);
         remove_callback();
@@ -612,20 +1016,37 @@ public:
                 return;
             }
 
+            OPENVPN3_PROBE1(session_registration_request,
+                            backend_token.c_str());
             try
             {
-                Subscribe(sender_name, be_path, "AttentionRequired");
-                Subscribe(sender_name, be_path, "StatusChange");
+                SubscribeShared(sender_name, be_path, "AttentionRequired");
+                SubscribeShared(sender_name, be_path, "StatusChange");
                 register_backend();
+                OPENVPN3_PROBE1(session_backend_registered,
+                                backend_token.c_str());
                 Unsubscribe("RegistrationRequest");
                 SetLogLevel(default_session_log_level);
                 LogVerb2("Backend VPN client process registered");
+
+                // Now the final pid of the re-initiated backend
+                // process is known; supervise it through a pidfd so a
+                // crash is noticed the moment it happens instead of at
+                // the next proxy call or ping
+                backend_pid = GetPID(be_busname);
+                pidfd_watch.reset(new PidfdWatch(backend_pid,
+                                  [this]()
+                                  {
+                                      backend_process_exited();
+                                  }));
+                notify_registration_complete(true);
             }
             catch (DBusException& err)
             {
                 LogError("Could not register backend process, removing session object");
                 Debug(be_busname, be_path, backend_pid, std::string(err.what()));
                 StatusChange(StatusMajor::SESSION, StatusMinor::PROC_KILLED, "Backend process died");
+                notify_registration_complete(false);
                 selfdestruct(conn);
             }
         }
@@ -637,6 +1058,18 @@ public:
             gchar *msg;
             g_variant_get (params, "(uus)", &major_u, &minor_u, &msg);
 
+            OPENVPN3_PROBE3(session_statuschange,
+                            major_u, minor_u, backend_token.c_str());
+
+            if (event_stream && event_stream->HasClients())
+            {
+                event_stream->Broadcast(GetObjectPath(), major_u, minor_u,
+                                        [this](uid_t uid)
+                                        {
+                                            return event_stream_allowed(uid);
+                                        });
+            }
+
             StatusMajor major = (StatusMajor) major_u;
             StatusMinor minor = (StatusMinor) minor_u;
             g_free(msg);
@@ -695,6 +1128,27 @@ public:
         bool ping = false;
 
         try {
+            if ("FetchEventsSince" == method_name)
+            {
+                // Served locally from the session's event journal,
+                // before any backend liveness checks; a monitor needs
+                // to catch up on events exactly when the backend is in
+                // trouble
+                CheckACL(sender);
+
+                guint64 cursor = 0;
+                g_variant_get(params, "(t)", &cursor);
+
+                GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+                g_variant_builder_add_value(ret, event_journal.FetchSince(cursor));
+                g_variant_builder_add(ret, "t",
+                                      (guint64) event_journal.LastSequence());
+                g_dbus_method_invocation_return_value(invoc,
+                                                      g_variant_builder_end(ret));
+                g_variant_builder_unref(ret);
+                return;
+            }
+
             if (!be_proxy)
             {
                 THROW_DBUSEXCEPTION("SessionObject", "No backend proxy connection available. Backend died?");
@@ -803,6 +1257,21 @@ public:
                 }
                 return;
             }
+            else if ("UserInputQueueFetchAll" == method_name)
+            {
+                CheckACL(sender);
+                try
+                {
+                    GVariant *res = be_proxy->Call("UserInputQueueFetchAll", params);
+                    g_dbus_method_invocation_return_value(invoc, res);
+                    g_variant_unref(res);
+                }
+                catch (RequiresQueueException& excp)
+                {
+                    excp.GenerateDBusError(invoc);
+                }
+                return;
+            }
             else if ("UserInputQueueCheck" == method_name)
             {
                 CheckACL(sender);
@@ -828,6 +1297,23 @@ public:
                 }
                 return;
             }
+            else if ("UserInputProvideAll" == method_name)
+            {
+                CheckACL(sender);
+                try
+                {
+                    GVariant *res = be_proxy->Call("UserInputProvideAll", params);
+                    g_dbus_method_invocation_return_value(invoc, res);
+                    g_variant_unref(res);
+                }
+                catch (RequiresQueueException& excp)
+                {
+                    // Convert this exception into an error sent back
+                    // to the requester as a D-Bus error instead.
+                    excp.GenerateDBusError(invoc);
+                }
+                return;
+            }
             else if ("AccessGrant" == method_name)
             {
                 CheckOwnerAccess(sender);
@@ -1007,14 +1493,50 @@ public:
         }
         else if ("statistics" == property_name)
         {
+            // Prefer the shared memory statistics segment published by
+            // the backend client process; it avoids a full D-Bus round
+            // trip to the backend for every statistics poll.
+            if (!stats_shm && !backend_token.empty())
+            {
+                stats_shm = ConnectionStatsShm::AttachReader(backend_token);
+            }
+
+            if (stats_shm)
+            {
+                GVariantTyped::DictInt64 b;
+                for (auto& sd : stats_shm->Read())
+                {
+                    b.Add(sd.key, sd.value);
+                }
+                ret = b.End();
+            }
+            else
+            {
+                // Older backends without the shared memory segment
+                try
+                {
+                    ret = be_proxy->GetProperty("statistics");
+                }
+                catch (DBusException& exp)
+                {
+                    g_set_error(error, G_DBUS_ERROR, G_IO_ERROR_FAILED,
+                                "Failed retrieving connection statistics");
+                    ret = NULL;
+                }
+            }
+        }
+        else if ("statistics_rates" == property_name)
+        {
+            // Derived rates and histograms maintained by the backend
+            // client; see src/client/statistics-rates.hpp
             try
             {
-                ret = be_proxy->GetProperty("statistics");
+                ret = be_proxy->GetProperty("statistics_rates");
             }
             catch (DBusException& exp)
             {
                 g_set_error(error, G_DBUS_ERROR, G_IO_ERROR_FAILED,
-                            "Failed retrieving connection statistics");
+                            "Failed retrieving connection rate statistics");
                 ret = NULL;
             }
         }
@@ -1026,10 +1548,64 @@ public:
         {
             ret = g_variant_new_uint32 (backend_pid);
         }
+        else if ("backend_ready" == property_name)
+        {
+            ret = g_variant_new_boolean (registered);
+        }
         else if ("log_verbosity" == property_name)
         {
             ret = g_variant_new_uint32 (GetLogLevel());
         }
+        else if ("status_coalesce_window" == property_name)
+        {
+            ret = g_variant_new_uint32 (status_coalesce_window);
+        }
+        else if ("crypto_workers" == property_name)
+        {
+            // The worker count lives in the backend client process;
+            // read it back from there so the answer reflects what is
+            // actually in effect
+            ret = NULL;
+            if (be_proxy)
+            {
+                try
+                {
+                    ret = be_proxy->GetProperty("crypto_workers");
+                }
+                catch (DBusException& excp)
+                {
+                    ret = NULL;
+                }
+            }
+            if (NULL == ret)
+            {
+                ret = g_variant_new_uint32(0);
+            }
+        }
+        else if ("transport_tuning" == property_name)
+        {
+            // The transport tuning settings live in the backend client
+            // process, which applies them on the transport socket.
+            // Read them back from there, so the answer reflects what
+            // is actually in effect.
+            ret = NULL;
+            if (be_proxy)
+            {
+                try
+                {
+                    ret = be_proxy->GetProperty("transport_tuning");
+                }
+                catch (DBusException& excp)
+                {
+                    ret = NULL;
+                }
+            }
+            if (NULL == ret)
+            {
+                g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_NO_REPLY,
+                            "Backend VPN process is not ready");
+            }
+        }
         else if ("public_access" == property_name)
         {
             ret = GetPublicAccess();
@@ -1109,6 +1685,7 @@ public:
                                     be_path,
                                     GetObjectPath());
                     sig_logevent->SetLogLevel(default_session_log_level);
+                    sig_logevent->SetJournal(&event_journal);
                 }
                 else if (!recv_log_events && nullptr != sig_logevent)
                 {
@@ -1127,6 +1704,43 @@ public:
                 return build_set_property_response(property_name,
                                                    (guint32) log_verb);
             }
+            else if ("status_coalesce_window" == property_name)
+            {
+                // Coalescing window (milliseconds) for proxied
+                // StatusChange signals; 0 disables coalescing
+                status_coalesce_window = g_variant_get_uint32(value);
+                if (nullptr != sig_statuschg)
+                {
+                    sig_statuschg->SetCoalesceWindow(status_coalesce_window);
+                }
+                return build_set_property_response(property_name,
+                                                   (guint32) status_coalesce_window);
+            }
+            else if (("crypto_workers" == property_name) && be_proxy)
+            {
+                // Forward the requested data channel worker count to
+                // the backend client process
+                be_proxy->SetProperty("crypto_workers", value);
+                LogVerb1("Crypto worker count updated by uid "
+                         + std::to_string(GetUID(sender)));
+                GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
+                g_variant_builder_add(bld, "{sv}",
+                                      property_name.c_str(), value);
+                return bld;
+            }
+            else if (("transport_tuning" == property_name) && be_proxy)
+            {
+                // Forward the tuning dictionary to the backend client
+                // process, which stores it and applies it on the
+                // transport socket before the next (re)connect
+                be_proxy->SetProperty("transport_tuning", value);
+                LogVerb1("Transport tuning updated by uid "
+                         + std::to_string(GetUID(sender)));
+                GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
+                g_variant_builder_add(bld, "{sv}",
+                                      property_name.c_str(), value);
+                return bld;
+            }
             else if (("public_access" == property_name) && conn)
             {
                 bool acl_public = g_variant_get_boolean(value);
@@ -1150,6 +1764,141 @@ public:
     }
 
 
+    /**
+     *  Builds a dictionary with this session's main properties.  Used
+     *  by the session manager's FetchManagedSessions method, which
+     *  returns the property set of every accessible session in a
+     *  single reply instead of one property round trip per value.
+     *
+     * @return Returns a floating GVariant a{sv} dictionary
+     */
+    GVariant * GetSessionSummary()
+    {
+        GVariantBuilder *b = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a{sv}"));
+        g_variant_builder_add(b, "{sv}", "owner", GetOwner());
+        g_variant_builder_add(b, "{sv}", "session_created",
+                              g_variant_new_uint64(session_created));
+        g_variant_builder_add(b, "{sv}", "backend_pid",
+                              g_variant_new_uint32(backend_pid));
+        g_variant_builder_add(b, "{sv}", "backend_ready",
+                              g_variant_new_boolean(registered));
+        g_variant_builder_add(b, "{sv}", "config_path",
+                              g_variant_new_string(config_path.c_str()));
+        if (nullptr != sig_statuschg)
+        {
+            update_last_status();
+            GVariant *status = sig_statuschg->GetLastStatusChange();
+            if (NULL != status)
+            {
+                g_variant_builder_add(b, "{sv}", "status", status);
+            }
+        }
+        GVariant *ret = g_variant_builder_end(b);
+        GVariantBuilderPool::Release(b);
+        return ret;
+    }
+
+
+    /**
+     *  First phase of a bulk disconnect, issued by the session
+     *  manager's DisconnectAll method.  The Disconnect call is sent to
+     *  the backend without waiting for the process to exit, which
+     *  allows the caller to fan the request out over many sessions and
+     *  apply one shared grace period instead of one per session.
+     *
+     * @return Returns true if the backend was told to disconnect.  If
+     *         the session has no ready backend or the call failed,
+     *         false is returned and the session must be skipped.
+     */
+    bool BulkPrepareDisconnect()
+    {
+        if (!registered || nullptr == be_proxy)
+        {
+            return false;
+        }
+        if (pidfd_watch)
+        {
+            pidfd_watch->Disarm();
+        }
+        try
+        {
+            be_proxy->Call("Disconnect", true);
+        }
+        catch (DBusException& excp)
+        {
+            return false;
+        }
+        return true;
+    }
+
+
+    /**
+     *  Second phase of a bulk disconnect, called once the shared grace
+     *  period after BulkPrepareDisconnect() has passed.  Sends the
+     *  closing StatusChange signal and destroys this session object.
+     */
+    void BulkFinishDisconnect()
+    {
+        StatusChange(StatusMajor::SESSION, StatusMinor::PROC_STOPPED,
+                     "Session closed");
+        selfdestruct(DBusSignalSubscription::GetConnection());
+    }
+
+
+    /**
+     *  Pauses this session on behalf of the session manager's PauseAll
+     *  method.  The Pause call is sent without waiting for a reply.
+     *
+     * @param reason  std::string describing why the session is paused
+     *
+     * @return Returns true if the backend was told to pause, false if
+     *         the session has no ready backend or the call failed.
+     */
+    bool BulkPause(const std::string& reason)
+    {
+        if (!registered || nullptr == be_proxy)
+        {
+            return false;
+        }
+        try
+        {
+            be_proxy->Call("Pause",
+                           g_variant_new("(s)", reason.c_str()), true);
+        }
+        catch (DBusException& excp)
+        {
+            return false;
+        }
+        return true;
+    }
+
+
+    /**
+     *  Resumes this session on behalf of the session manager's
+     *  ResumeAll method.  The Resume call is sent without waiting for
+     *  a reply.
+     *
+     * @return Returns true if the backend was told to resume, false if
+     *         the session has no ready backend or the call failed.
+     */
+    bool BulkResume()
+    {
+        if (!registered || nullptr == be_proxy)
+        {
+            return false;
+        }
+        try
+        {
+            be_proxy->Call("Resume", true);
+        }
+        catch (DBusException& excp)
+        {
+            return false;
+        }
+        return true;
+    }
+
+
     /**
      *  Clean-up function triggered by the D-Bus library when an object
      *  is removed from the D-Bus
@@ -1172,6 +1921,7 @@ public:
 
 private:
     unsigned int default_session_log_level = 4; // LogCategory::INFO messages
+    unsigned int status_coalesce_window = 0;  // StatusChange coalescing (ms), 0 = off
     std::function<void()> remove_callback;
     DBusProxy *be_proxy;
     bool recv_log_events;
@@ -1179,16 +1929,104 @@ private:
     std::string config_path;
     SessionStatusChange *sig_statuschg;
     SessionLogEvent *sig_logevent;
+    // Declared before the proxy objects are created, and kept for the
+    // whole session lifetime; both proxy handlers append into it
+    SessionEventJournal event_journal;
     std::string backend_token;
+    std::function<void(bool)> registration_complete_callback;
+    EventStreamHub *event_stream = nullptr;
+    std::unique_ptr<PidfdWatch> pidfd_watch;
     pid_t backend_pid;
+    ConnectionStatsShm *stats_shm;
     GDBusConnection *be_conn;
     std::string be_busname;
     std::string be_path;
     bool registered;
     bool selfdestruct_complete;
+    bool selfdestruct_scheduled;
+    GDBusConnection *destruct_conn;
     std::mutex selfdestruct_guard;
 
 
+    /**
+     *  Checks if a uid may receive event stream records for this
+     *  session.  This mirrors the CheckACL() rules for D-Bus callers,
+     *  but works on the raw uid recorded when the event stream client
+     *  attached, as there is no D-Bus sender to resolve on this path.
+     *
+     * @param uid  uid of the attached event stream client
+     *
+     * @return Returns true if the uid is the session owner, is on the
+     *         access control list or the session allows public access
+     */
+    bool event_stream_allowed(uid_t uid)
+    {
+        if (GetPublicAccessState() || GetOwnerUID() == uid)
+        {
+            return true;
+        }
+        for (const auto& acl_uid : GetAccessListVector())
+        {
+            if (acl_uid == uid)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    /**
+     *  Callback for the asynchronous StartClient call issued by the
+     *  constructor.  On success it records the PID reported by the
+     *  backend starter service; on failure the session object is
+     *  torn down again, since no backend process will ever register
+     *  against it.
+     *
+     * @param src       GObject the async call was issued on; this is
+     *                  the D-Bus connection
+     * @param res       GAsyncResult with the result of the call
+     * @param this_ptr  Pointer to the SessionObject owning the call
+     */
+    static void start_client_ready(GObject *src, GAsyncResult *res,
+                                   gpointer this_ptr)
+    {
+        SessionObject *self = (SessionObject *) this_ptr;
+
+        GError *error = NULL;
+        GVariant *result = g_dbus_connection_call_finish(G_DBUS_CONNECTION(src),
+                                                         res, &error);
+        if (NULL == result)
+        {
+            std::string errmsg(error && error->message ? error->message
+                                                       : "(unspecified error)");
+            if (error)
+            {
+                g_error_free(error);
+            }
+            self->LogError("Could not start backend VPN client process: "
+                           + errmsg);
+            self->StatusChange(StatusMajor::SESSION, StatusMinor::PROC_KILLED,
+                               "Backend process could not be started");
+            self->notify_registration_complete(false);
+            self->selfdestruct(self->DBusSignalSubscription::GetConnection());
+            return;
+        }
+        g_variant_get(result, "(u)", &self->backend_pid);
+        g_variant_unref(result);
+
+        // The PID value we get here is just a temporary.  This is the
+        // PID returned by openvpn3-service-backendstart.  This will again
+        // start the openvpn3-service-client process, which will fork() once
+        // to be completely independent.  When this last fork() happens,
+        // the backend will report back its final PID.
+        self->StatusChange(StatusMajor::SESSION, StatusMinor::PROC_STARTED,
+                           "session_path=" + self->GetObjectPath()
+                           + ", backend_pid="
+                           + std::to_string(self->backend_pid));
+    }
+
+
     /**
      *  Ties the VPN client backend process to this SessionObject.  Once that
      *  is done, it calls the RegistrationConfirmation method in the backend
@@ -1216,6 +2054,8 @@ private:
                                                     OpenVPN3DBus_interf_backends,
                                                     be_path,
                                                     GetObjectPath());
+            sig_statuschg->SetJournal(&event_journal);
+            sig_statuschg->SetCoalesceWindow(status_coalesce_window);
 
             GVariant *res_g = be_proxy->Call("RegistrationConfirmation",
                                              g_variant_new("(so)",
@@ -1238,6 +2078,13 @@ private:
                          + " backend_busname=" + be_busname
                          + " backend_path=" + be_path);
             registered = true;
+
+            // Tell the backend which verbosity this manager will
+            // actually consume, so more verbose log events never
+            // leave the client process
+            be_proxy->Call("RegisterLogWatch",
+                           g_variant_new("(u)", default_session_log_level),
+                           true);
         }
         catch (DBusException& err)
         {
@@ -1246,6 +2093,41 @@ private:
     }
 
 
+    /**
+     *  Invoked from the pidfd watch when the backend VPN client
+     *  process has exited without this session object asking for it.
+     *  Announces the death immediately and removes the session, so
+     *  front-ends are not left talking to a dead session object until
+     *  the next ping or proxy call times out.
+     */
+    void backend_process_exited()
+    {
+        LogError("Backend process (pid " + std::to_string(backend_pid)
+                 + ") exited unexpectedly, removing session object");
+        StatusChange(StatusMajor::SESSION, StatusMinor::PROC_KILLED,
+                     "Backend process died");
+        selfdestruct(DBusSignalSubscription::GetConnection());
+    }
+
+
+    /**
+     *  Invokes the registered registration complete callback, if any,
+     *  and drops it afterwards.  Dropping the callback releases the
+     *  reference it may hold to the bulk start job once it is no
+     *  longer needed.
+     *
+     * @param success  True if the backend registration succeeded
+     */
+    void notify_registration_complete(bool success)
+    {
+        if (registration_complete_callback)
+        {
+            registration_complete_callback(success);
+            registration_complete_callback = nullptr;
+        }
+    }
+
+
     /**
      * Simple ping-pong game between this SessionObject and its VPN client
      * backend.  If the backend does not respond, we treat it as dead and will
@@ -1332,6 +2214,12 @@ private:
      */
     void shutdown(bool forced, bool selfdestruct_flag)
     {
+        // The backend process is about to exit deliberately; the
+        // pidfd exit callback must not treat that as a crash
+        if (pidfd_watch)
+        {
+            pidfd_watch->Disarm();
+        }
         be_proxy->Call( (!forced ? "Disconnect" : "ForceShutdown"), true );
         // Wait for child to exit
         sleep(2); // FIXME: Catch the ProcessChange StatusMinor::PROC_STOPPED signal from backend
@@ -1378,92 +2266,153 @@ private:
         // !! WARNING:       MAY CALL THIS FUNCTION!           !!
         //
         std::lock_guard<std::mutex> guard(selfdestruct_guard);
-        if (selfdestruct_complete)
+        if (selfdestruct_complete || selfdestruct_scheduled)
         {
             return;
         }
-        RemoveObject(conn);
-        selfdestruct_complete = true;
 
-        delete this;
+        // The removal and deletion always happens on the main loop
+        // thread, via an idle callback.  Method calls run on the
+        // dispatch pool workers, and a worker must never delete the
+        // object whose task it is currently executing; deferring also
+        // lets the callers of selfdestruct() finish their error
+        // reporting on this object before it goes away.
+        selfdestruct_scheduled = true;
+        destruct_conn = conn;
+        g_idle_add(selfdestruct_idle_callback, this);
+    }
+
+
+    /**
+     *  Idle callback on the main loop carrying out a scheduled
+     *  selfdestruct().  RemoveObject() drains this session's worker
+     *  queue before returning, so after it no thread can touch this
+     *  object and deleting it is safe.
+     *
+     * @param this_ptr  Pointer to the SessionObject to remove
+     *
+     * @return Always returns G_SOURCE_REMOVE; the callback runs once
+     */
+    static gboolean selfdestruct_idle_callback(gpointer this_ptr)
+    {
+        SessionObject *self = (SessionObject *) this_ptr;
+
+        // RemoveObject() blocks until the worker queue has drained,
+        // and queued tasks may themselves call selfdestruct(), which
+        // takes selfdestruct_guard.  So the guard must NOT be held
+        // across RemoveObject(), or the main loop waits for a worker
+        // which waits for the main loop.  Not holding it here is
+        // safe: selfdestruct_scheduled ensures this callback is
+        // scheduled exactly once, and it is the only place setting
+        // selfdestruct_complete or deleting the object.
+        self->RemoveObject(self->destruct_conn);
+
+        {
+            std::lock_guard<std::mutex> guard(self->selfdestruct_guard);
+            self->selfdestruct_complete = true;
+        }
+        delete self;
+        return G_SOURCE_REMOVE;
     }
 };
 
 
 /**
- *   A SessionManagerObject is the main entry point when starting new
- *   VPN tunnels.  It should only exist a single SessionManagerObject during
- *   the life cycle of the openvpn3-service-sessoinmgr process.
+ *  Represents one bulk session start job, created via the
+ *  SessionManagerObject StartSessions method.
+ *
+ *  The job holds a queue of configuration profile paths and starts the
+ *  corresponding sessions with a bounded number of backend
+ *  registrations in flight; another queued session is admitted each
+ *  time a running registration completes or fails.  Progress is
+ *  published through the StartProgress signal and the job object's
+ *  properties, and the job object removes itself from the D-Bus a
+ *  minute after the last session has settled.
  */
-class SessionManagerObject : public DBusObject,
-                             public SessionManagerSignals,
-                             public RC<thread_safe_refcount>
+class SessionStartJob : public DBusObject,
+                        public DBusSignalProducer,
+                        public RC<mainloop_refcount>
 {
 public:
-    typedef RCPtr<SessionManagerObject> Ptr;
+    typedef RCPtr<SessionStartJob> Ptr;
 
     /**
-     *  Constructor initializing the SessionManagerObject to be registered on
-     *  the D-Bus.
+     *  Factory function starting a single session.  Receives the
+     *  configuration profile path and a completion callback, and
+     *  returns the D-Bus path of the created session object.
+     */
+    using SessionFactory = std::function<std::string(const std::string,
+                                                     std::function<void(bool)>)>;
+
+    /**
+     *  Constructor initializing the SessionStartJob to be registered
+     *  on the D-Bus.
      *
-     * @param dbuscon  D-Bus this object is tied to
-     * @param objpath  D-Bus object path to this object
+     * @param dbuscon      D-Bus connection this object is tied to
+     * @param objpath      D-Bus object path to this job object
+     * @param cfgpaths     Configuration profile paths to start sessions for
+     * @param parallelism  Maximum number of backend registrations in flight
+     * @param factory      Callback into the session manager creating one
+     *                     session object
+     * @param remove_callback  Callback removing this job from the session
+     *                     manager's job registry
      */
-    SessionManagerObject(GDBusConnection *dbuscon, const std::string objpath,
-                         unsigned int manager_log_level)
+    SessionStartJob(GDBusConnection *dbuscon, const std::string objpath,
+                    std::vector<std::string> cfgpaths,
+                    unsigned int parallelism,
+                    SessionFactory factory,
+                    std::function<void()> remove_callback)
         : DBusObject(objpath),
-          SessionManagerSignals(dbuscon, objpath, manager_log_level),
+          DBusSignalProducer(dbuscon, "", OpenVPN3DBus_interf_sessions, objpath),
           dbuscon(dbuscon),
-          creds(dbuscon)
+          queue(cfgpaths.begin(), cfgpaths.end()),
+          total(cfgpaths.size()),
+          parallelism(parallelism > 0 ? parallelism : 1),
+          factory(factory),
+          remove_callback(remove_callback)
     {
         std::stringstream introspection_xml;
         introspection_xml << "<node name='" << objpath << "'>"
                           << "    <interface name='" << OpenVPN3DBus_interf_sessions << "'>"
-                          << "        <method name='NewTunnel'>"
-                          << "          <arg type='o' name='config_path' direction='in'/>"
-                          << "          <arg type='o' name='session_path' direction='out'/>"
-                          << "        </method>"
-                          << "        <method name='FetchAvailableSessions'>"
-                          << "          <arg type='ao' name='paths' direction='out'/>"
-                          << "        </method>"
-                          << GetLogIntrospection()
+                          << "        <signal name='StartProgress'>"
+                          << "            <arg type='u' name='completed' direction='out'/>"
+                          << "            <arg type='u' name='failed' direction='out'/>"
+                          << "            <arg type='u' name='total' direction='out'/>"
+                          << "        </signal>"
+                          << "        <property type='u' name='total' access='read'/>"
+                          << "        <property type='u' name='completed' access='read'/>"
+                          << "        <property type='u' name='failed' access='read'/>"
+                          << "        <property type='u' name='running' access='read'/>"
+                          << "        <property type='u' name='pending' access='read'/>"
+                          << "        <property type='b' name='done' access='read'/>"
+                          << "        <property type='ao' name='session_paths' access='read'/>"
                           << "    </interface>"
                           << "</node>";
         ParseIntrospectionXML(introspection_xml);
-
-        Debug("SessionManagerObject registered on '" + OpenVPN3DBus_interf_sessions + "': "
-                      + objpath);
     }
 
-    ~SessionManagerObject()
+
+    ~SessionStartJob()
     {
-        LogInfo("Shutting down");
         RemoveObject(dbuscon);
     }
 
+
     /**
-     * Enables logging to file in addition to the D-Bus Log signal events
-     *
-     * @param filename  String containing the name of the log file
+     *  Starts the job by admitting the first batch of sessions, up to
+     *  the configured parallelism
      */
-    void OpenLogFile(std::string filename)
+    void Start()
     {
-        SessionManagerSignals::OpenLogFile(filename);
+        admit_next();
     }
 
+
     /**
-     *  Callback method called each time a method in the SessionManagerObject
-     *  is called over the D-Bus.
-     *
-     * @param conn       D-Bus connection where the method call occurred
-     * @param sender     D-Bus bus name of the sender of the method call
-     * @param obj_path   D-Bus object path of the target object.
-     * @param intf_name  D-Bus interface of the method call
-     * @param method_name D-Bus method name to be executed
-     * @param params     GVariant Glib2 object containing the arguments for
-     *                   the method call
-     * @param invoc      GDBusMethodInvocation where the response/result of
-     *                   the method call will be returned.
+     *  Callback method called each time a method in the SessionStartJob
+     *  is called over the D-Bus.  The job object carries no methods;
+     *  progress is observed via the StartProgress signal and the job
+     *  properties.
      */
     void callback_method_call(GDBusConnection *conn,
                               const std::string sender,
@@ -1473,83 +2422,16 @@ public:
                               GVariant *params,
                               GDBusMethodInvocation *invoc)
     {
-        // std::cout << "SessionManagerObject::callback_method_call: " << method_name << std::endl;
-        if ("NewTunnel" == method_name)
-        {
-            IdleCheck_UpdateTimestamp();
-
-            // Retrieve the configuration path for the tunnel
-            // from the request
-            gchar *config_path_s;
-            g_variant_get (params, "(o)", &config_path_s);
-            auto config_path = std::string(config_path_s);
-            g_free(config_path_s);
-
-            // Create session object, which will proxy calls
-            // from the front-end to the backend
-            std::string sesspath = generate_path_uuid(OpenVPN3DBus_rootp_sessions, 's');
-
-            // Create the new object and register it in D-Bus
-            auto callback = [self=Ptr(this), sesspath](void)
-                            {
-                                self->remove_session_object(sesspath);
-                            };
-            SessionObject *session = new SessionObject(conn,
-                                                       callback,
-                                                       creds.GetUID(sender),
-                                                       sesspath,
-                                                       config_path,
-                                                       GetLogLevel());
-            IdleCheck_RefInc();
-            session->IdleCheck_Register(IdleCheck_Get());
-            session->RegisterObject(conn);
-            session_objects[sesspath] = session;
-
-            // Return the path to the new session object object to the caller
-            // The backend object will remind "hidden" for the end-user
-            g_dbus_method_invocation_return_value(invoc, g_variant_new("(o)", sesspath.c_str()));
-        }
-        else if ("FetchAvailableSessions" == method_name)
-        {
-            // Build up an array of object paths to available session objects
-            GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("ao"));
-            for (auto& item : session_objects)
-            {
-                try {
-                    // We check if the caller is allowed to access this
-                    // session object.  If not, an exception is thrown
-                    // and we will just ignore that exception and continue
-                    item.second->CheckACL(sender);
-                    g_variant_builder_add(bld, "o", item.first.c_str());
-                }
-                catch (DBusCredentialsException& excp)
-                {
-                    // Ignore credentials exceptions.  It means the
-                    // caller does not have access this session object
-                }
-            }
-
-            // Wrap up the result into a tuple, which GDBus expects and
-            // put it into the invocation response
-            GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
-            g_variant_builder_add_value(ret, g_variant_builder_end(bld));
-            g_dbus_method_invocation_return_value(invoc,
-                                                  g_variant_builder_end(ret));
-
-            // Clean-up
-            g_variant_builder_unref(bld);
-            g_variant_builder_unref(ret);
-        }
-    };
+        GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.error.job",
+                                                      "Unknown method");
+        g_dbus_method_invocation_return_gerror(invoc, err);
+        g_error_free(err);
+    }
 
 
     /**
-     *  Callback which is used each time a SessionManagerObject D-Bus
-     *  property is being read.
-     *
-     *  For the SessionManagerObject, this method will just return NULL
-     *  with an error set in the GError return pointer.  The
-     *  SessionManagerObject does not use properties at all.
+     *  Callback which is used each time a SessionStartJob D-Bus
+     *  property is being read
      *
      * @param conn           D-Bus connection this event occurred on
      * @param sender         D-Bus bus name of the requester
@@ -1558,8 +2440,9 @@ public:
      * @param property_name  The property name being accessed
      * @param error          A GLib2 GError object if an error occurs
      *
-     * @return  Returns always NULL, as there are no properties in the
-     *          SessionManagerObject.
+     * @return  Returns a GVariant with the property value on success,
+     *          otherwise NULL with the error details set in the GError
+     *          return pointer.
      */
     GVariant * callback_get_property(GDBusConnection *conn,
                                      const std::string sender,
@@ -1568,34 +2451,1117 @@ public:
                                      const std::string property_name,
                                      GError **error)
     {
-        /*
-        std::cout << "[SessionManagerObject] get_property(): "
-                  << "sender=" << sender
-                  << ", object_path=" << obj_path
-                  << ", interface=" << intf_name
-                  << ", property=" << property_name
-                  << std::endl;
-        */
-        g_set_error (error,
-                     G_IO_ERROR,
-                     G_IO_ERROR_FAILED,
-                     "Unknown property");
+        if ("total" == property_name)
+        {
+            return g_variant_new_uint32(total);
+        }
+        else if ("completed" == property_name)
+        {
+            return g_variant_new_uint32(completed);
+        }
+        else if ("failed" == property_name)
+        {
+            return g_variant_new_uint32(failed);
+        }
+        else if ("running" == property_name)
+        {
+            return g_variant_new_uint32(running);
+        }
+        else if ("pending" == property_name)
+        {
+            return g_variant_new_uint32(queue.size());
+        }
+        else if ("done" == property_name)
+        {
+            return g_variant_new_boolean(done);
+        }
+        else if ("session_paths" == property_name)
+        {
+            GVariantBuilder *bld = GVariantBuilderPool::Acquire("ao");
+            for (const auto& sesspath : session_paths)
+            {
+                g_variant_builder_add(bld, "o", sesspath.c_str());
+            }
+            GVariant *ret = g_variant_builder_end(bld);
+            GVariantBuilderPool::Release(bld);
+            return ret;
+        }
+
+        g_set_error(error,
+                    G_IO_ERROR,
+                    G_IO_ERROR_FAILED,
+                    "Unknown property");
         return NULL;
-    };
+    }
+
 
     /**
-     *  Callback method which is used each time a SessionManagerObject
+     *  Callback method which is used each time a SessionStartJob
      *  property is being modified over the D-Bus.
      *
-     *  This will always fail with an exception, as there exists no properties
-     *  which can be modified in a SessionManagerObject.
-     *
-     * @param conn           D-Bus connection this event occurred on
-     * @param sender         D-Bus bus name of the requester
-     * @param obj_path       D-Bus object path to the object being requested
-     * @param intf_name      D-Bus interface of the property being accessed
-     * @param property_name  The property name being accessed
-     * @param value          GVariant object containing the value to be stored
+     *  This will always fail with an exception, as all properties of a
+     *  job object are read-only.
+     */
+    GVariantBuilder * callback_set_property(GDBusConnection *conn,
+                                            const std::string sender,
+                                            const std::string obj_path,
+                                            const std::string intf_name,
+                                            const std::string property_name,
+                                            GVariant *value,
+                                            GError **error)
+    {
+        THROW_DBUSEXCEPTION("SessionStartJob", "set property not implemented");
+    }
+
+
+private:
+    GDBusConnection *dbuscon;
+    std::deque<std::string> queue;
+    std::vector<std::string> session_paths;
+    guint32 total;
+    unsigned int parallelism;
+    guint32 completed = 0;
+    guint32 failed = 0;
+    unsigned int running = 0;
+    bool done = false;
+    SessionFactory factory;
+    std::function<void()> remove_callback;
+
+
+    /**
+     *  Admits queued sessions until the configured number of backend
+     *  registrations are in flight, and completes the job once the
+     *  queue has drained and the last registration has settled
+     */
+    void admit_next()
+    {
+        while (running < parallelism && !queue.empty())
+        {
+            std::string cfgpath = queue.front();
+            queue.pop_front();
+            running++;
+            std::string sesspath =
+                factory(cfgpath,
+                        [self=Ptr(this)](bool success)
+                        {
+                            self->session_settled(success);
+                        });
+            session_paths.push_back(sesspath);
+        }
+
+        if (queue.empty() && 0 == running && !done)
+        {
+            done = true;
+            Send("StartProgress", g_variant_new("(uuu)",
+                                                completed, failed, total));
+
+            // Keep the finished job object around for a little while,
+            // so front-ends can retrieve the final counters, then
+            // remove it from the job registry
+            g_timeout_add_seconds(60, cleanup_job, this);
+        }
+    }
+
+
+    /**
+     *  Called when the backend registration of an admitted session has
+     *  completed or failed.  Updates the counters, announces the
+     *  progress and admits the next queued session.
+     *
+     * @param success  True if the backend registration succeeded
+     */
+    void session_settled(bool success)
+    {
+        running--;
+        if (success)
+        {
+            completed++;
+        }
+        else
+        {
+            failed++;
+        }
+        Send("StartProgress", g_variant_new("(uuu)",
+                                            completed, failed, total));
+        admit_next();
+    }
+
+
+    /**
+     *  GLib2 timer callback removing a finished job object from the
+     *  session manager's job registry
+     *
+     * @param user_data  Pointer to the SessionStartJob to remove
+     *
+     * @return Always returns G_SOURCE_REMOVE, as a one-shot callback
+     */
+    static gboolean cleanup_job(gpointer user_data)
+    {
+        SessionStartJob *self = (SessionStartJob *) user_data;
+        self->remove_callback();
+        return G_SOURCE_REMOVE;
+    }
+};
+
+
+/**
+ *   A SessionManagerObject is the main entry point when starting new
+ *   VPN tunnels.  It should only exist a single SessionManagerObject during
+ *   the life cycle of the openvpn3-service-sessoinmgr process.
+ */
+class SessionManagerObject : public DBusObject,
+                             public SessionManagerSignals,
+                             public RC<mainloop_refcount>
+{
+public:
+    typedef RCPtr<SessionManagerObject> Ptr;
+
+    /**
+     *  Constructor initializing the SessionManagerObject to be registered on
+     *  the D-Bus.
+     *
+     * @param dbuscon  D-Bus this object is tied to
+     * @param objpath  D-Bus object path to this object
+     */
+    SessionManagerObject(GDBusConnection *dbuscon, const std::string objpath,
+                         unsigned int manager_log_level)
+        : DBusObject(objpath),
+          SessionManagerSignals(dbuscon, objpath, manager_log_level),
+          dbuscon(dbuscon),
+          creds(dbuscon)
+    {
+        std::stringstream introspection_xml;
+        introspection_xml << "<node name='" << objpath << "'>"
+                          << "    <interface name='" << OpenVPN3DBus_interf_sessions << "'>"
+                          << "        <method name='NewTunnel'>"
+                          << "          <arg type='o' name='config_path' direction='in'/>"
+                          << "          <arg type='o' name='session_path' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='FetchAvailableSessions'>"
+                          << "          <arg type='ao' name='paths' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='FetchManagedSessions'>"
+                          << "          <arg type='a{oa{sv}}' name='sessions' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='FetchManagedSessionsFiltered'>"
+                          << "          <arg type='a{sv}' name='filters' direction='in'/>"
+                          << "          <arg type='u' name='chunk_size' direction='in'/>"
+                          << "          <arg type='u' name='offset' direction='in'/>"
+                          << "          <arg type='a{oa{sv}}' name='sessions' direction='out'/>"
+                          << "          <arg type='b' name='more' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='GetMetricsSnapshot'>"
+                          << "          <arg type='a{oa{sx}}' name='metrics' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='StartSessions'>"
+                          << "          <arg type='ao' name='config_paths' direction='in'/>"
+                          << "          <arg type='u' name='parallelism' direction='in'/>"
+                          << "          <arg type='o' name='job_path' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='OpenEventStream'>"
+                          << "          <arg type='h' name='socket' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='DisconnectAll'>"
+                          << "          <arg type='a{sv}' name='filters' direction='in'/>"
+                          << "          <arg type='ao' name='sessions' direction='out'/>"
+                          << "          <arg type='u' name='skipped' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='PauseAll'>"
+                          << "          <arg type='a{sv}' name='filters' direction='in'/>"
+                          << "          <arg type='ao' name='sessions' direction='out'/>"
+                          << "          <arg type='u' name='skipped' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='ResumeAll'>"
+                          << "          <arg type='a{sv}' name='filters' direction='in'/>"
+                          << "          <arg type='ao' name='sessions' direction='out'/>"
+                          << "          <arg type='u' name='skipped' direction='out'/>"
+                          << "        </method>"
+                          << GetLogIntrospection()
+                          << "    </interface>"
+                          << "</node>";
+        ParseIntrospectionXML(introspection_xml);
+
+        // Register the method handlers in the dispatch table; each
+        // call is then routed with one hash lookup and one indirect
+        // call instead of a chain of string comparisons
+        RegisterMethodHandler("NewTunnel",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_new_tunnel(conn, sender, params, invoc);
+                              });
+        RegisterMethodHandler("OpenEventStream",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_open_event_stream(conn, sender, params, invoc);
+                              });
+        RegisterMethodHandler("StartSessions",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_start_sessions(conn, sender, params, invoc);
+                              });
+        RegisterMethodHandler("FetchManagedSessions",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_fetch_managed_sessions(conn, sender, params, invoc);
+                              });
+        RegisterMethodHandler("FetchManagedSessionsFiltered",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_fetch_managed_sessions_filtered(conn, sender, params, invoc);
+                              });
+        RegisterMethodHandler("GetMetricsSnapshot",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_get_metrics_snapshot(conn, sender, params, invoc);
+                              });
+        RegisterMethodHandler("FetchAvailableSessions",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_fetch_available_sessions(conn, sender, params, invoc);
+                              });
+        RegisterMethodHandler("DisconnectAll",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_bulk_operation(conn, sender, params,
+                                                        invoc, BulkOp::DISCONNECT);
+                              });
+        RegisterMethodHandler("PauseAll",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_bulk_operation(conn, sender, params,
+                                                        invoc, BulkOp::PAUSE);
+                              });
+        RegisterMethodHandler("ResumeAll",
+                              [this](GDBusConnection *conn,
+                                     const std::string& sender,
+                                     GVariant *params,
+                                     GDBusMethodInvocation *invoc)
+                              {
+                                  method_bulk_operation(conn, sender, params,
+                                                        invoc, BulkOp::RESUME);
+                              });
+
+        Debug("SessionManagerObject registered on '" + OpenVPN3DBus_interf_sessions + "': "
+                      + objpath);
+    }
+
+    ~SessionManagerObject()
+    {
+        LogInfo("Shutting down");
+        RemoveObject(dbuscon);
+    }
+
+    /**
+     * Enables logging to file in addition to the D-Bus Log signal events
+     *
+     * @param filename  String containing the name of the log file
+     */
+    void OpenLogFile(std::string filename)
+    {
+        SessionManagerSignals::OpenLogFile(filename);
+    }
+
+    /**
+     *  Number of session objects currently managed by this service.
+     *  Published via the debug memory object's object_counts property.
+     *
+     * @return Returns the number of registered session objects
+     */
+    std::uint64_t GetSessionObjectCount()
+    {
+        return session_objects.size();
+    }
+
+    /**
+     *  Renders the connection statistics of all managed sessions in
+     *  the Prometheus text exposition format.  This is served by the
+     *  local metrics endpoint, which is only reachable by the user
+     *  owning the socket, so no per-session ACL check is applied.
+     *
+     * @return Returns a string with one openvpn3_session_stat sample
+     *         per statistics counter, labelled with the session path
+     *         and counter key, plus an openvpn3_sessions gauge.
+     */
+    std::string RenderMetrics()
+    {
+        std::stringstream metrics;
+        metrics << "# HELP openvpn3_sessions Number of managed VPN sessions\n"
+                << "# TYPE openvpn3_sessions gauge\n"
+                << "openvpn3_sessions " << session_objects.size() << "\n"
+                << "# HELP openvpn3_session_stat Connection statistics counter for a VPN session\n"
+                << "# TYPE openvpn3_session_stat counter\n";
+        for (auto& item : session_objects)
+        {
+            for (auto& sd : item.second->GetStatistics())
+            {
+                metrics << "openvpn3_session_stat{session=\""
+                        << item.first << "\",key=\""
+                        << sd.key << "\"} " << sd.value << "\n";
+            }
+        }
+        return metrics.str();
+    }
+
+    /**
+     *  Callback method called each time a method in the SessionManagerObject
+     *  is called over the D-Bus.
+     *
+     * @param conn       D-Bus connection where the method call occurred
+     * @param sender     D-Bus bus name of the sender of the method call
+     * @param obj_path   D-Bus object path of the target object.
+     * @param intf_name  D-Bus interface of the method call
+     * @param method_name D-Bus method name to be executed
+     * @param params     GVariant Glib2 object containing the arguments for
+     *                   the method call
+     * @param invoc      GDBusMethodInvocation where the response/result of
+     *                   the method call will be returned.
+     */
+    void callback_method_call(GDBusConnection *conn,
+                              const std::string sender,
+                              const std::string obj_path,
+                              const std::string intf_name,
+                              const std::string method_name,
+                              GVariant *params,
+                              GDBusMethodInvocation *invoc)
+    {
+        // All methods of this object are registered in the dispatch
+        // table, so only unknown method names end up here
+        std::string errmsg = "No method named " + method_name + " is available";
+        GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.sessions.error",
+                                                      errmsg.c_str());
+        g_dbus_method_invocation_return_gerror(invoc, err);
+        g_error_free(err);
+    };
+
+
+    /**
+     *  Dispatch handler for the NewTunnel method call, creating
+     *  a new session object for a configuration profile
+     */
+    void method_new_tunnel(GDBusConnection *conn,
+                        const std::string& sender,
+                        GVariant *params,
+                        GDBusMethodInvocation *invoc)
+    {
+        // Retrieve the configuration path for the tunnel
+        // from the request
+        gchar *config_path_s;
+        g_variant_get (params, "(o)", &config_path_s);
+        auto config_path = std::string(config_path_s);
+        g_free(config_path_s);
+
+        // Create session object, which will proxy calls
+        // from the front-end to the backend
+        std::string sesspath = generate_path_uuid(OpenVPN3DBus_rootp_sessions, 's');
+
+        // Create the new object and register it in D-Bus
+        auto callback = [self=Ptr(this), sesspath](void)
+                        {
+                            self->remove_session_object(sesspath);
+                        };
+        SessionObject *session = new SessionObject(conn,
+                                                   callback,
+                                                   creds.GetUID(sender),
+                                                   sesspath,
+                                                   config_path,
+                                                   GetLogLevel(),
+                                                   &session_dispatch);
+        IdleCheck_RefInc();
+        session->IdleCheck_Register(IdleCheck_Get());
+        session->RegisterObject(conn);
+        session->SetEventStreamHub(&event_stream);
+        session_objects[sesspath] = session;
+
+        // Return the path to the new session object object to the caller
+        // The backend object will remind "hidden" for the end-user
+        g_dbus_method_invocation_return_value(invoc, g_variant_new("(o)", sesspath.c_str()));
+    }
+
+
+    /**
+     *  Dispatch handler for the OpenEventStream method call,
+     *  attaching the caller to the binary event stream
+     */
+    void method_open_event_stream(GDBusConnection *conn,
+                               const std::string& sender,
+                               GVariant *params,
+                               GDBusMethodInvocation *invoc)
+    {
+        // Attach the caller to the binary StatusChange event
+        // stream.  The caller receives one end of a socketpair
+        // over the D-Bus file descriptor passing mechanism and
+        // reads fixed size binary records from it; see
+        // event-stream.hpp for the record layout.  Events are
+        // filtered against the per-session ACLs using the callers
+        // uid, resolved here while the D-Bus sender is available.
+        uid_t uid = creds.GetUID(sender);
+        int client_fd = event_stream.AttachClient(uid);
+        if (client_fd < 0)
+        {
+            GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.error.eventstream",
+                                                          "Could not create event stream socket");
+            g_dbus_method_invocation_return_gerror(invoc, err);
+            g_error_free(err);
+            return;
+        }
+
+        GError *fderr = NULL;
+        GUnixFDList *fdlist = g_unix_fd_list_new();
+        gint fdidx = g_unix_fd_list_append(fdlist, client_fd, &fderr);
+
+        // The fd list keeps its own duplicate of the descriptor
+        close(client_fd);
+
+        if (fdidx < 0)
+        {
+            g_object_unref(fdlist);
+            g_dbus_method_invocation_return_gerror(invoc, fderr);
+            g_error_free(fderr);
+            return;
+        }
+
+        LogVerb1("Event stream opened (caller uid "
+                 + std::to_string(uid) + ")");
+        g_dbus_method_invocation_return_value_with_unix_fd_list(invoc,
+                                                                g_variant_new("(h)", fdidx),
+                                                                fdlist);
+        g_object_unref(fdlist);
+    }
+
+
+    /**
+     *  Dispatch handler for the StartSessions method call, the
+     *  bulk session start entry point
+     */
+    void method_start_sessions(GDBusConnection *conn,
+                            const std::string& sender,
+                            GVariant *params,
+                            GDBusMethodInvocation *invoc)
+    {
+        // Bulk session start.  All provided configuration paths are
+        // queued up in a job object which keeps a bounded number of
+        // backend registrations in flight, instead of the caller
+        // serializing one synchronous NewTunnel call per profile.
+        GVariantIter *cfgpaths_iter = NULL;
+        guint32 parallelism = 0;
+        g_variant_get(params, "(aou)", &cfgpaths_iter, &parallelism);
+
+        std::vector<std::string> cfgpaths;
+        GVariant *cfgpath = NULL;
+        while ((cfgpath = g_variant_iter_next_value(cfgpaths_iter)))
+        {
+            gsize len;
+            cfgpaths.push_back(std::string(g_variant_get_string(cfgpath, &len)));
+            g_variant_unref(cfgpath);
+        }
+        g_variant_iter_free(cfgpaths_iter);
+
+        if (cfgpaths.empty())
+        {
+            GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.error.job",
+                                                          "No configuration paths provided");
+            g_dbus_method_invocation_return_gerror(invoc, err);
+            g_error_free(err);
+            return;
+        }
+        if (0 == parallelism)
+        {
+            parallelism = default_start_parallelism;
+        }
+
+        std::string jobpath = generate_path_uuid(OpenVPN3DBus_rootp_sessions + "/jobs", 'j');
+        uid_t owner = creds.GetUID(sender);
+
+        // The factory creates one session object on behalf of the
+        // job, exactly as a NewTunnel call from the same sender
+        // would, and hooks the job's completion callback up to the
+        // backend registration
+        SessionStartJob::SessionFactory factory =
+            [self=Ptr(this), conn, owner](const std::string config_path,
+                                          std::function<void(bool)> done_cb)
+            {
+                std::string sesspath = generate_path_uuid(OpenVPN3DBus_rootp_sessions, 's');
+                auto rm_callback = [self, sesspath](void)
+                                   {
+                                       self->remove_session_object(sesspath);
+                                   };
+                SessionObject *session = new SessionObject(conn,
+                                                           rm_callback,
+                                                           owner,
+                                                           sesspath,
+                                                           config_path,
+                                                           self->GetLogLevel(),
+                                                           &self->session_dispatch);
+                session->SetRegistrationCompleteCallback(done_cb);
+                session->SetEventStreamHub(&self->event_stream);
+                self->IdleCheck_RefInc();
+                session->IdleCheck_Register(self->IdleCheck_Get());
+                session->RegisterObject(conn);
+                self->session_objects[sesspath] = session;
+                return sesspath;
+            };
+
+        SessionStartJob::Ptr job;
+        job.reset(new SessionStartJob(conn, jobpath, cfgpaths, parallelism,
+                                      factory,
+                                      [self=Ptr(this), jobpath]()
+                                      {
+                                          self->start_jobs.erase(jobpath);
+                                      }));
+        job->RegisterObject(conn);
+        start_jobs[jobpath] = job;
+
+        LogInfo("Bulk session start of " + std::to_string(cfgpaths.size())
+                + " profiles (parallelism "
+                + std::to_string(parallelism) + ", owner uid "
+                + std::to_string(owner) + "): " + jobpath);
+
+        // Return the job path before any session starts, so the
+        // caller can subscribe to the StartProgress signal without
+        // missing events
+        g_dbus_method_invocation_return_value(invoc,
+                                              g_variant_new("(o)", jobpath.c_str()));
+        job->Start();
+    }
+
+
+    /**
+     *  Dispatch handler for the FetchManagedSessions method call
+     */
+    void method_fetch_managed_sessions(GDBusConnection *conn,
+                                    const std::string& sender,
+                                    GVariant *params,
+                                    GDBusMethodInvocation *invoc)
+    {
+        // Return the full property set of every session the caller
+        // has access to, in one reply.  This saves the 6-8 property
+        // round trips per session a front-end otherwise needs when
+        // listing sessions.
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("a{oa{sv}}"));
+        for (auto& item : session_objects)
+        {
+            try {
+                item.second->CheckACL(sender);
+                g_variant_builder_add(bld, "{o@a{sv}}",
+                                      item.first.c_str(),
+                                      item.second->GetSessionSummary());
+            }
+            catch (DBusCredentialsException& excp)
+            {
+                // Ignore credentials exceptions.  It means the
+                // caller does not have access this session object
+            }
+        }
+
+        GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+        g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+        g_dbus_method_invocation_return_value(invoc,
+                                              g_variant_builder_end(ret));
+        g_variant_builder_unref(bld);
+        g_variant_builder_unref(ret);
+    }
+
+
+    /**
+     *  Dispatch handler for the FetchManagedSessionsFiltered
+     *  method call
+     */
+    void method_fetch_managed_sessions_filtered(GDBusConnection *conn,
+                                             const std::string& sender,
+                                             GVariant *params,
+                                             GDBusMethodInvocation *invoc)
+    {
+        // Filtered and chunked variant of FetchManagedSessions.
+        // The filters are evaluated against the session registry
+        // here, so a caller asking for "owner X, not CONNECTED"
+        // receives the handful of matching rows instead of the
+        // property sets of every session.  The chunking arguments
+        // let the caller page through a large result and render
+        // rows while later chunks are still being fetched.
+        GVariantIter *filter_iter = NULL;
+        guint32 chunk_size = 0;
+        guint32 offset = 0;
+        g_variant_get(params, "(a{sv}uu)",
+                      &filter_iter, &chunk_size, &offset);
+
+        bool by_owner = false;
+        uid_t owner_filter = 0;
+        bool by_minor = false;
+        bool minor_negate = false;
+        guint32 minor_filter = 0;
+        std::string cfgname_filter;
+
+        gchar *key = NULL;
+        GVariant *val = NULL;
+        while (g_variant_iter_loop(filter_iter, "{sv}", &key, &val))
+        {
+            std::string k(key);
+            if ("owner" == k
+                && g_variant_is_of_type(val, G_VARIANT_TYPE_UINT32))
+            {
+                by_owner = true;
+                owner_filter = (uid_t) g_variant_get_uint32(val);
+            }
+            else if ("status_minor" == k
+                     && g_variant_is_of_type(val, G_VARIANT_TYPE_UINT32))
+            {
+                by_minor = true;
+                minor_negate = false;
+                minor_filter = g_variant_get_uint32(val);
+            }
+            else if ("status_minor_not" == k
+                     && g_variant_is_of_type(val, G_VARIANT_TYPE_UINT32))
+            {
+                by_minor = true;
+                minor_negate = true;
+                minor_filter = g_variant_get_uint32(val);
+            }
+            else if ("config_name" == k
+                     && g_variant_is_of_type(val, G_VARIANT_TYPE_STRING))
+            {
+                gsize len;
+                cfgname_filter = std::string(g_variant_get_string(val,
+                                                                  &len));
+            }
+        }
+        g_variant_iter_free(filter_iter);
+
+        // A config name filter is resolved to configuration paths
+        // once, via the configuration manager's name index, instead
+        // of one name lookup per session
+        bool by_cfgpath = false;
+        std::vector<std::string> cfgpath_filter;
+        if (!cfgname_filter.empty())
+        {
+            by_cfgpath = true;
+            try
+            {
+                DBusProxy cfgmgr_prx(dbuscon,
+                                     OpenVPN3DBus_name_configuration,
+                                     OpenVPN3DBus_interf_configuration,
+                                     OpenVPN3DBus_rootp_configuration);
+                GVariant *res = cfgmgr_prx.Call("LookupConfigName",
+                                                g_variant_new("(s)", cfgname_filter.c_str()));
+                GVariantIter *cfgpaths = NULL;
+                g_variant_get(res, "(ao)", &cfgpaths);
+                GVariant *cfgp = NULL;
+                while ((cfgp = g_variant_iter_next_value(cfgpaths)))
+                {
+                    gsize len;
+                    cfgpath_filter.push_back(std::string(g_variant_get_string(cfgp, &len)));
+                    g_variant_unref(cfgp);
+                }
+                g_variant_iter_free(cfgpaths);
+                g_variant_unref(res);
+            }
+            catch (DBusException& excp)
+            {
+                // The config manager may be unavailable; an
+                // unresolvable name matches no sessions
+            }
+        }
+
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("a{oa{sv}}"));
+        guint32 matched = 0;
+        guint32 included = 0;
+        bool more = false;
+        for (auto& item : session_objects)
+        {
+            try
+            {
+                item.second->CheckACL(sender);
+            }
+            catch (DBusCredentialsException& excp)
+            {
+                // Ignore credentials exceptions.  It means the
+                // caller does not have access this session object
+                continue;
+            }
+
+            if (by_owner
+                && owner_filter != item.second->GetOwnerUID())
+            {
+                continue;
+            }
+            if (by_minor)
+            {
+                guint32 minor = (guint32) item.second->GetStatusMinor();
+                if (minor_negate ? (minor == minor_filter)
+                                 : (minor != minor_filter))
+                {
+                    continue;
+                }
+            }
+            if (by_cfgpath
+                && cfgpath_filter.end() == std::find(cfgpath_filter.begin(),
+                                                     cfgpath_filter.end(),
+                                                     item.second->GetConfigPath()))
+            {
+                continue;
+            }
+
+            matched++;
+            if (matched <= offset)
+            {
+                // Already delivered in a previous chunk
+                continue;
+            }
+            if (chunk_size > 0 && included >= chunk_size)
+            {
+                more = true;
+                break;
+            }
+            g_variant_builder_add(bld, "{o@a{sv}}",
+                                  item.first.c_str(),
+                                  item.second->GetSessionSummary());
+            included++;
+        }
+
+        GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+        g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+        g_variant_builder_add(ret, "b", more);
+        g_dbus_method_invocation_return_value(invoc,
+                                              g_variant_builder_end(ret));
+        g_variant_builder_unref(bld);
+        g_variant_builder_unref(ret);
+    }
+
+
+    /**
+     *  Dispatch handler for the GetMetricsSnapshot method call
+     */
+    void method_get_metrics_snapshot(GDBusConnection *conn,
+                                  const std::string& sender,
+                                  GVariant *params,
+                                  GDBusMethodInvocation *invoc)
+    {
+        // Return the connection statistics for every session the
+        // caller has access to, in one reply.  A monitoring agent
+        // polling N sessions then needs a single method call
+        // instead of N statistics property reads.
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("a{oa{sx}}"));
+        for (auto& item : session_objects)
+        {
+            try {
+                item.second->CheckACL(sender);
+
+                GVariantBuilder *stats = g_variant_builder_new(G_VARIANT_TYPE("a{sx}"));
+                for (auto& sd : item.second->GetStatistics())
+                {
+                    g_variant_builder_add(stats, "{sx}",
+                                          sd.key.c_str(), sd.value);
+                }
+                g_variant_builder_add(bld, "{o@a{sx}}",
+                                      item.first.c_str(),
+                                      g_variant_builder_end(stats));
+                g_variant_builder_unref(stats);
+            }
+            catch (DBusCredentialsException& excp)
+            {
+                // Ignore credentials exceptions.  It means the
+                // caller does not have access this session object
+            }
+        }
+
+        GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+        g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+        g_dbus_method_invocation_return_value(invoc,
+                                              g_variant_builder_end(ret));
+        g_variant_builder_unref(bld);
+        g_variant_builder_unref(ret);
+    }
+
+
+    /**
+     *  Dispatch handler for the FetchAvailableSessions method call
+     */
+    void method_fetch_available_sessions(GDBusConnection *conn,
+                                      const std::string& sender,
+                                      GVariant *params,
+                                      GDBusMethodInvocation *invoc)
+    {
+        // Build up an array of object paths to available session objects
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("ao"));
+        for (auto& item : session_objects)
+        {
+            try {
+                // We check if the caller is allowed to access this
+                // session object.  If not, an exception is thrown
+                // and we will just ignore that exception and continue
+                item.second->CheckACL(sender);
+                g_variant_builder_add(bld, "o", item.first.c_str());
+            }
+            catch (DBusCredentialsException& excp)
+            {
+                // Ignore credentials exceptions.  It means the
+                // caller does not have access this session object
+            }
+        }
+
+        // Wrap up the result into a tuple, which GDBus expects and
+        // put it into the invocation response
+        GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+        g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+        g_dbus_method_invocation_return_value(invoc,
+                                              g_variant_builder_end(ret));
+
+        // Clean-up
+        g_variant_builder_unref(bld);
+        g_variant_builder_unref(ret);
+    }
+
+
+    /**
+     *  The session wide operation a DisconnectAll, PauseAll or
+     *  ResumeAll method call maps to
+     */
+    enum class BulkOp : std::uint_fast8_t
+    {
+        DISCONNECT,
+        PAUSE,
+        RESUME
+    };
+
+
+    /**
+     *  Dispatch handler shared by the DisconnectAll, PauseAll and
+     *  ResumeAll method calls
+     */
+    void method_bulk_operation(GDBusConnection *conn,
+                               const std::string& sender,
+                               GVariant *params,
+                               GDBusMethodInvocation *invoc,
+                               BulkOp op)
+    {
+        // Applies one operation to every accessible session matching
+        // the provided filters.  The backend calls are sent without
+        // waiting for replies, so tearing down or pausing hundreds of
+        // sessions costs one pass over the session registry instead
+        // of one full method round trip per session; for disconnects,
+        // the per-session shutdown wait is replaced by a single grace
+        // period shared by the whole batch.
+        GVariantIter *filter_iter = NULL;
+        g_variant_get(params, "(a{sv})", &filter_iter);
+
+        bool by_owner = false;
+        uid_t owner_filter = 0;
+        std::string cfgpath_filter;
+        std::string pause_reason = "Paused by user request";
+
+        gchar *key = NULL;
+        GVariant *val = NULL;
+        while (g_variant_iter_loop(filter_iter, "{sv}", &key, &val))
+        {
+            std::string k(key);
+            if ("owner" == k
+                && g_variant_is_of_type(val, G_VARIANT_TYPE_UINT32))
+            {
+                by_owner = true;
+                owner_filter = (uid_t) g_variant_get_uint32(val);
+            }
+            else if ("config_path" == k
+                     && g_variant_is_of_type(val, G_VARIANT_TYPE_STRING))
+            {
+                gsize len;
+                cfgpath_filter = std::string(g_variant_get_string(val,
+                                                                  &len));
+            }
+            else if ("reason" == k
+                     && g_variant_is_of_type(val, G_VARIANT_TYPE_STRING))
+            {
+                gsize len;
+                pause_reason = std::string(g_variant_get_string(val,
+                                                                &len));
+            }
+        }
+        g_variant_iter_free(filter_iter);
+
+        // Select the targets first; for disconnects the session
+        // objects destroy themselves, which must not happen while
+        // still iterating over the registry
+        std::vector<std::pair<std::string, SessionObject *>> targets;
+        guint32 skipped = 0;
+        for (auto& item : session_objects)
+        {
+            try
+            {
+                item.second->CheckACL(sender, true);
+            }
+            catch (DBusCredentialsException& excp)
+            {
+                // Ignore credentials exceptions.  It means the
+                // caller does not have access this session object
+                continue;
+            }
+
+            if (by_owner
+                && owner_filter != item.second->GetOwnerUID())
+            {
+                continue;
+            }
+            if (!cfgpath_filter.empty()
+                && cfgpath_filter != item.second->GetConfigPath())
+            {
+                continue;
+            }
+            targets.push_back(std::make_pair(item.first, item.second));
+        }
+
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("ao"));
+        switch (op)
+        {
+        case BulkOp::DISCONNECT:
+            {
+                // Phase one: tell every backend to disconnect
+                std::vector<std::string> prepared;
+                for (auto& tgt : targets)
+                {
+                    if (tgt.second->BulkPrepareDisconnect())
+                    {
+                        prepared.push_back(tgt.first);
+                    }
+                    else
+                    {
+                        skipped++;
+                    }
+                }
+
+                // One shared grace period for the whole batch,
+                // matching the wait SessionObject::shutdown() gives a
+                // single backend process to exit.  Sleeping here would
+                // stall the main loop and every other D-Bus request
+                // with it, so phase two runs from a timer callback and
+                // the method reply is completed from there; GDBus
+                // allows an invocation to be finished after the
+                // handler has returned.
+                BulkDisconnectFinish *job = new BulkDisconnectFinish;
+                job->manager = Ptr(this);
+                job->invoc = invoc;
+                job->prepared = std::move(prepared);
+                job->skipped = skipped;
+                job->sender = sender;
+                g_timeout_add_seconds(2, bulk_disconnect_finish_cb, job);
+                g_variant_builder_unref(bld);
+                return;
+            }
+
+        case BulkOp::PAUSE:
+        case BulkOp::RESUME:
+            {
+                for (auto& tgt : targets)
+                {
+                    bool done = (BulkOp::PAUSE == op
+                                 ? tgt.second->BulkPause(pause_reason)
+                                 : tgt.second->BulkResume());
+                    if (done)
+                    {
+                        g_variant_builder_add(bld, "o", tgt.first.c_str());
+                    }
+                    else
+                    {
+                        skipped++;
+                    }
+                }
+                LogInfo(std::string(BulkOp::PAUSE == op
+                                    ? "PauseAll: " : "ResumeAll: ")
+                        + std::to_string(targets.size() - skipped)
+                        + " sessions processed, "
+                        + std::to_string(skipped) + " skipped "
+                        + "(caller " + sender + ")");
+            }
+            break;
+        }
+
+        GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+        g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+        g_variant_builder_add(ret, "u", skipped);
+        g_dbus_method_invocation_return_value(invoc,
+                                              g_variant_builder_end(ret));
+        g_variant_builder_unref(bld);
+        g_variant_builder_unref(ret);
+    }
+
+
+    /**
+     *  Callback which is used each time a SessionManagerObject D-Bus
+     *  property is being read.
+     *
+     *  For the SessionManagerObject, this method will just return NULL
+     *  with an error set in the GError return pointer.  The
+     *  SessionManagerObject does not use properties at all.
+     *
+     * @param conn           D-Bus connection this event occurred on
+     * @param sender         D-Bus bus name of the requester
+     * @param obj_path       D-Bus object path to the object being requested
+     * @param intf_name      D-Bus interface of the property being accessed
+     * @param property_name  The property name being accessed
+     * @param error          A GLib2 GError object if an error occurs
+     *
+     * @return  Returns always NULL, as there are no properties in the
+     *          SessionManagerObject.
+     */
+    GVariant * callback_get_property(GDBusConnection *conn,
+                                     const std::string sender,
+                                     const std::string obj_path,
+                                     const std::string intf_name,
+                                     const std::string property_name,
+                                     GError **error)
+    {
+        /*
+        std::cout << "[SessionManagerObject] get_property(): "
+                  << "sender=" << sender
+                  << ", object_path=" << obj_path
+                  << ", interface=" << intf_name
+                  << ", property=" << property_name
+                  << std::endl;
+        */
+        g_set_error (error,
+                     G_IO_ERROR,
+                     G_IO_ERROR_FAILED,
+                     "Unknown property");
+        return NULL;
+    };
+
+    /**
+     *  Callback method which is used each time a SessionManagerObject
+     *  property is being modified over the D-Bus.
+     *
+     *  This will always fail with an exception, as there exists no properties
+     *  which can be modified in a SessionManagerObject.
+     *
+     * @param conn           D-Bus connection this event occurred on
+     * @param sender         D-Bus bus name of the requester
+     * @param obj_path       D-Bus object path to the object being requested
+     * @param intf_name      D-Bus interface of the property being accessed
+     * @param property_name  The property name being accessed
+     * @param value          GVariant object containing the value to be stored
      * @param error          A GLib2 GError object if an error occurs
      *
      * @return Will always throw an execption as there are no properties to
@@ -1614,14 +3580,85 @@ public:
 
 
 private:
+    const unsigned int default_start_parallelism = 5;
     GDBusConnection *dbuscon;
     DBusConnectionCreds creds;
+    // The hub must outlive the session objects holding a pointer to it
+    EventStreamHub event_stream;
+    // Worker pool the session objects route their method calls
+    // through; must also outlive every session object
+    DBusDispatchPool session_dispatch;
     std::map<std::string, SessionObject *> session_objects;
+    std::map<std::string, SessionStartJob::Ptr> start_jobs;
 
     void remove_session_object(const std::string sesspath)
     {
         session_objects.erase(sesspath);
     }
+
+
+    /**
+     *  State carried from phase one of a DisconnectAll operation to
+     *  the timer callback running phase two.  The manager reference
+     *  keeps this object alive across the grace period; the prepared
+     *  sessions are carried by object path only, as a session may
+     *  disappear on its own before the timer fires.
+     */
+    struct BulkDisconnectFinish
+    {
+        SessionManagerObject::Ptr manager;
+        GDBusMethodInvocation *invoc;
+        std::vector<std::string> prepared;
+        guint32 skipped;
+        std::string sender;
+    };
+
+
+    /**
+     *  GLib2 timer callback running phase two of a DisconnectAll
+     *  operation once the shared grace period has passed.  Signals the
+     *  closure of every prepared session still registered and
+     *  completes the deferred method reply.
+     *
+     * @param user_data  Pointer to the BulkDisconnectFinish state
+     *
+     * @return Always returns G_SOURCE_REMOVE, as a one-shot callback
+     */
+    static gboolean bulk_disconnect_finish_cb(gpointer user_data)
+    {
+        BulkDisconnectFinish *job = (BulkDisconnectFinish *) user_data;
+        SessionManagerObject *mgr = job->manager.get();
+
+        GVariantBuilder *bld = g_variant_builder_new(G_VARIANT_TYPE("ao"));
+        for (const auto& path : job->prepared)
+        {
+            g_variant_builder_add(bld, "o", path.c_str());
+
+            // A session which vanished during the grace period has
+            // already closed down completely; its backend was told to
+            // disconnect in phase one, so it still counts as
+            // disconnected in the reply
+            auto it = mgr->session_objects.find(path);
+            if (mgr->session_objects.end() != it)
+            {
+                it->second->BulkFinishDisconnect();
+            }
+        }
+        mgr->LogInfo("DisconnectAll: " + std::to_string(job->prepared.size())
+                     + " sessions disconnected, "
+                     + std::to_string(job->skipped) + " skipped "
+                     + "(caller " + job->sender + ")");
+
+        GVariantBuilder *ret = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
+        g_variant_builder_add_value(ret, g_variant_builder_end(bld));
+        g_variant_builder_add(ret, "u", job->skipped);
+        g_dbus_method_invocation_return_value(job->invoc,
+                                              g_variant_builder_end(ret));
+        g_variant_builder_unref(bld);
+        g_variant_builder_unref(ret);
+        delete job;
+        return G_SOURCE_REMOVE;
+    }
 };
 
 
@@ -1667,6 +3704,20 @@ public:
     }
 
 
+    /**
+     *  Enables the Prometheus metrics endpoint on a Unix socket.  The
+     *  endpoint is created once the D-Bus service is up, as it serves
+     *  data from the SessionManagerObject.
+     *
+     * @param socket_path  File system path of the Unix socket to serve
+     *                     the metrics on
+     */
+    void SetMetricsSocket(std::string socket_path)
+    {
+        metrics_socket = socket_path;
+    }
+
+
     /**
      *  Sets the log level to use for the session manager main object
      *  and individual session objects.  This is essentially just an
@@ -1708,6 +3759,28 @@ public:
                                             "SessionManager");
         procsig->ProcessChange(StatusMinor::PROC_STARTED);
 
+        // Heap and object count introspection; the counter callback
+        // keeps a reference to the manager object
+        memdebug.reset(new DebugMemoryObject());
+        memdebug->AddObjectCounter("session_objects",
+                                   [mobj=managobj]()
+                                   {
+                                       return mobj->GetSessionObjectCount();
+                                   });
+        memdebug->RegisterObject(GetConnection());
+
+        if (!metrics_socket.empty())
+        {
+            // The render callback keeps a reference to the manager
+            // object, so the endpoint cannot outlive it
+            metrics_endpoint.reset(new MetricsEndpoint(
+                    metrics_socket,
+                    [mobj=managobj]()
+                    {
+                        return mobj->RenderMetrics();
+                    }));
+        }
+
         if (nullptr != idle_checker)
         {
             managobj->IdleCheck_Register(idle_checker);
@@ -1748,8 +3821,11 @@ public:
 private:
     unsigned int manager_log_level = 6; // LogCategory::DEBUG
     SessionManagerObject::Ptr managobj;
+    DebugMemoryObject::Ptr memdebug;
     ProcessSignalProducer * procsig;
     std::string logfile;
+    std::string metrics_socket;
+    std::unique_ptr<MetricsEndpoint> metrics_endpoint;
 };
 
 #endif // OPENVPN3_DBUS_SESSIONMGR_HPP
@@ -0,0 +1,311 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN, Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   service-hotpaths.cpp
+ *
+ * @brief  Microbenchmarks (google-benchmark based) of the in-process
+ *         hot paths of the D-Bus services: profile import parsing,
+ *         RequiresQueue fill/fetch cycles, PropertyCollection get/set
+ *         (the serving side of session property polling), GVariant
+ *         builder pooling and log event batching/round-trip over a
+ *         session bus when one is available.
+ *
+ *         Run via `make benchmarks`; pass standard google-benchmark
+ *         options (e.g. --benchmark_repetitions=5) for percentiles.
+ */
+
+#include <iostream>
+#include <sstream>
+
+#include <benchmark/benchmark.h>
+
+#include <openvpn/log/logsimple.hpp>
+#include "common/core-extensions.hpp"
+#include "dbus/core.hpp"
+#include "common/requiresqueue.hpp"
+#include "log/dbus-log.hpp"
+
+using namespace openvpn;
+
+
+//
+//  Profile import parsing - the core of ConfigManagerObject's Import
+//
+static const char *bench_profile =
+    "client\n"
+    "dev tun\n"
+    "proto udp\n"
+    "remote vpn.example.org 1194\n"
+    "resolv-retry infinite\n"
+    "nobind\n"
+    "persist-key\n"
+    "persist-tun\n"
+    "remote-cert-tls server\n"
+    "cipher AES-256-GCM\n"
+    "verb 3\n"
+    "compress lz4\n"
+    "keepalive 10 60\n"
+    "auth-user-pass\n";
+
+static void BM_ProfileImportParse(benchmark::State& state)
+{
+    OptionList::Limits limits("profile is too large",
+                      ProfileParseLimits::MAX_PROFILE_SIZE,
+                      ProfileParseLimits::OPT_OVERHEAD,
+                      ProfileParseLimits::TERM_OVERHEAD,
+                      ProfileParseLimits::MAX_LINE_SIZE,
+                      ProfileParseLimits::MAX_DIRECTIVE_SIZE);
+    std::string profile(bench_profile);
+
+    for (auto _ : state)
+    {
+        OptionListJSON options;
+        options.parse_from_config(profile, &limits);
+        options.update_map();
+        benchmark::DoNotOptimize(options);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProfileImportParse);
+
+
+//
+//  RequiresQueue fill/fetch cycle, as done per user input negotiation
+//
+static void BM_RequiresQueueFillFetch(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        RequiresQueue queue;
+        unsigned int uid = queue.RequireAdd(ClientAttentionType::CREDENTIALS,
+                                            ClientAttentionGroup::USER_PASSWORD,
+                                            "username", "Auth username",
+                                            false);
+        unsigned int pid = queue.RequireAdd(ClientAttentionType::CREDENTIALS,
+                                            ClientAttentionGroup::USER_PASSWORD,
+                                            "password", "Auth password",
+                                            true);
+        queue.UpdateEntry(ClientAttentionType::CREDENTIALS,
+                          ClientAttentionGroup::USER_PASSWORD,
+                          uid, "benchuser");
+        queue.UpdateEntry(ClientAttentionType::CREDENTIALS,
+                          ClientAttentionGroup::USER_PASSWORD,
+                          pid, "benchpass");
+        benchmark::DoNotOptimize(
+            queue.GetResponse(ClientAttentionType::CREDENTIALS,
+                              ClientAttentionGroup::USER_PASSWORD,
+                              "username"));
+        benchmark::DoNotOptimize(
+            queue.QueueAllDone());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RequiresQueueFillFetch);
+
+
+//
+//  PropertyCollection lookups - the serving side of the Get/GetAll
+//  property polling done by front-ends against session and config
+//  objects
+//
+class BenchPropertyObject : public DBusObject
+{
+public:
+    BenchPropertyObject() : DBusObject("/bench/properties")
+    {
+        properties.AddBinding(new PropertyType<bool>(
+                        this, "bool_value", "b", "read", false, &bool_value));
+        properties.AddBinding(new PropertyType<unsigned int>(
+                        this, "uint_value", "u", "readwrite", false, &uint_value));
+        properties.AddBinding(new PropertyType<std::time_t>(
+                        this, "time_value", "t", "read", false, &time_value));
+    }
+
+    void callback_method_call(GDBusConnection *conn,
+                              const std::string sender,
+                              const std::string obj_path,
+                              const std::string intf_name,
+                              const std::string method_name,
+                              GVariant *params,
+                              GDBusMethodInvocation *invoc)
+    {
+    }
+
+    GVariant * callback_get_property(GDBusConnection *conn,
+                                     const std::string sender,
+                                     const std::string obj_path,
+                                     const std::string intf_name,
+                                     const std::string property_name,
+                                     GError **error)
+    {
+        return properties.GetValue(property_name);
+    }
+
+    GVariantBuilder * callback_set_property(GDBusConnection *conn,
+                                            const std::string sender,
+                                            const std::string obj_path,
+                                            const std::string intf_name,
+                                            const std::string property_name,
+                                            GVariant *value,
+                                            GError **error)
+    {
+        return properties.SetValue(property_name, value);
+    }
+
+    PropertyCollection properties;
+
+private:
+    bool bool_value = true;
+    unsigned int uint_value = 42;
+    std::time_t time_value = 1514764800;
+};
+
+
+static void BM_PropertyCollectionGet(benchmark::State& state)
+{
+    BenchPropertyObject obj;
+    for (auto _ : state)
+    {
+        GVariant *v = obj.properties.GetValue("uint_value");
+        g_variant_unref(g_variant_ref_sink(v));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PropertyCollectionGet);
+
+
+static void BM_PropertyCollectionSet(benchmark::State& state)
+{
+    BenchPropertyObject obj;
+    unsigned int counter = 0;
+    for (auto _ : state)
+    {
+        GVariant *v = g_variant_ref_sink(g_variant_new_uint32(counter++));
+        GVariantBuilder *resp = obj.properties.SetValue("uint_value", v);
+        g_variant_builder_unref(resp);
+        g_variant_unref(v);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PropertyCollectionSet);
+
+
+//
+//  GVariantBuilder pooling vs direct allocation, as used by the
+//  status/statistics/log emitters
+//
+static void BM_BuilderAllocate(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE("a{sv}"));
+        g_variant_builder_add(b, "{sv}", "major", g_variant_new_uint32(2));
+        g_variant_builder_add(b, "{sv}", "minor", g_variant_new_uint32(7));
+        g_variant_unref(g_variant_ref_sink(g_variant_builder_end(b)));
+        g_variant_builder_unref(b);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BuilderAllocate);
+
+
+static void BM_BuilderPool(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        GVariantBuilder *b = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a{sv}"));
+        g_variant_builder_add(b, "{sv}", "major", g_variant_new_uint32(2));
+        g_variant_builder_add(b, "{sv}", "minor", g_variant_new_uint32(7));
+        g_variant_unref(g_variant_ref_sink(g_variant_builder_end(b)));
+        GVariantBuilderPool::Release(b);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BuilderPool);
+
+
+//
+//  Log event round trip: LogSender -> bus -> LogConsumer.  Needs a
+//  running session bus; skipped otherwise.  This measures the full
+//  emission, routing and consumption cost of one log event.
+//
+class BenchLogSender : public LogSender
+{
+public:
+    BenchLogSender(GDBusConnection *conn)
+        : LogSender(conn, LogGroup::UNDEFINED,
+                    "net.openvpn.v3.benchmark", "/bench/log")
+    {
+    }
+};
+
+
+class BenchLogConsumer : public LogConsumer
+{
+public:
+    BenchLogConsumer(GDBusConnection *conn)
+        : LogConsumer(conn, "net.openvpn.v3.benchmark", "/bench/log")
+    {
+    }
+
+    void ConsumeLogEvent(const std::string sender,
+                         const std::string interface,
+                         const std::string object_path,
+                         const LogGroup group, const LogCategory catg,
+                         const std::string msg)
+    {
+        received++;
+    }
+
+    unsigned long received = 0;
+};
+
+
+static void BM_LogEventRoundTrip(benchmark::State& state)
+{
+    GError *error = NULL;
+    GDBusConnection *conn = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+    if (NULL == conn)
+    {
+        g_clear_error(&error);
+        state.SkipWithError("No session bus available");
+        return;
+    }
+
+    BenchLogSender sender(conn);
+    BenchLogConsumer consumer(conn);
+
+    for (auto _ : state)
+    {
+        unsigned long wanted = consumer.received + 1;
+        sender.Log(LogGroup::UNDEFINED, LogCategory::INFO,
+                   "benchmark log event");
+        while (consumer.received < wanted)
+        {
+            g_main_context_iteration(NULL, TRUE);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    g_object_unref(conn);
+}
+BENCHMARK(BM_LogEventRoundTrip);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,626 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   mock-backend-client.cpp
+ *
+ * @brief  Mock VPN client backend used for load and soak testing.
+ *
+ *         This program speaks the same D-Bus protocol as
+ *         openvpn3-service-client: it registers with the session
+ *         manager using the session token handed over by the backend
+ *         starter, fetches the configuration profile from the
+ *         configuration manager and emits StatusChange/Log signals
+ *         and synthetic connection statistics - but it never
+ *         establishes a real tunnel and does not link against the
+ *         OpenVPN 3 Core library.  Installed in place of the real
+ *         client binary (or symlinked into LIBEXEC_PATH on a test
+ *         host), it lets the session-churn driver exercise the full
+ *         sessionmgr+configmgr+logger stack at rates no real VPN
+ *         server farm is needed for.
+ *
+ *         Traffic shaping is controlled through environment
+ *         variables, inherited from the backend starter service:
+ *
+ *           OPENVPN3_MOCK_CONNECT_TIME   ms between CONN_CONNECTING
+ *                                        and CONN_CONNECTED (default 50)
+ *           OPENVPN3_MOCK_LOG_INTERVAL   seconds between synthetic
+ *                                        Log lines while connected
+ *                                        (default 0, disabled)
+ *           OPENVPN3_MOCK_STATS_RATE     growth of the synthetic
+ *                                        bytes_in/bytes_out counters,
+ *                                        bytes/second (default 125000)
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include "common/requiresqueue.hpp"
+#include "common/tracepoints.hpp"
+#include "common/utils.hpp"
+#include "configmgr/proxy-configmgr.hpp"
+#include "dbus/core.hpp"
+#include "dbus/path.hpp"
+#include "log/dbus-log.hpp"
+#include "client/backend-signals.hpp"
+
+using namespace openvpn;
+
+
+/**
+ *  Reads an unsigned integer tuning knob from the environment,
+ *  falling back to a default when unset or unparsable
+ */
+static unsigned int mock_env_uint(const char *name, unsigned int defval)
+{
+    const char *val = getenv(name);
+    if (!val || !*val)
+    {
+        return defval;
+    }
+    char *end = nullptr;
+    unsigned long parsed = strtoul(val, &end, 10);
+    return (end && !*end) ? (unsigned int) parsed : defval;
+}
+
+
+/**
+ *  Mock stand-in for BackendClientObject.  Implements the full
+ *  net.openvpn.v3.backends object interface the session manager
+ *  drives, with state transitions happening on configurable timers
+ *  instead of a real VPN connection.
+ */
+class MockBackendObject : public DBusObject,
+                          public RC<thread_unsafe_refcount>
+{
+public:
+    typedef RCPtr<MockBackendObject> Ptr;
+
+    MockBackendObject(GDBusConnection *conn, std::string bus_name,
+                      std::string objpath, std::string session_token)
+        : DBusObject(objpath),
+          dbusconn(conn),
+          signal(conn, LogGroup::CLIENT, objpath),
+          session_token(session_token),
+          connect_time_ms(mock_env_uint("OPENVPN3_MOCK_CONNECT_TIME", 50)),
+          log_interval(mock_env_uint("OPENVPN3_MOCK_LOG_INTERVAL", 0)),
+          stats_rate(mock_env_uint("OPENVPN3_MOCK_STATS_RATE", 125000))
+    {
+        signal.SetLogLevel(default_log_level);
+        signal.SetSessionToken(session_token);
+
+        std::stringstream introspection_xml;
+        introspection_xml << "<node name='" << objpath << "'>"
+                          << "    <interface name='" << OpenVPN3DBus_interf_backends << "'>"
+                          << "        <method name='RegistrationConfirmation'>"
+                          << "            <arg type='s' name='token' direction='in'/>"
+                          << "            <arg type='o' name='config_path' direction='in'/>"
+                          << "            <arg type='b' name='response' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='Ping'>"
+                          << "            <arg type='b' name='alive' direction='out'/>"
+                          << "        </method>"
+                          << "        <method name='Ready'/>"
+                          << "        <method name='Connect'/>"
+                          << "        <method name='Pause'>"
+                          << "            <arg type='s' name='reason' direction='in'/>"
+                          << "        </method>"
+                          << "        <method name='Resume'/>"
+                          << "        <method name='Restart'/>"
+                          << "        <method name='Disconnect'/>"
+                          << "        <method name='ForceShutdown'/>"
+                          << userinputq.IntrospectionMethods("UserInputQueueGetTypeGroup",
+                                                             "UserInputQueueFetch",
+                                                             "UserInputQueueFetchAll",
+                                                             "UserInputQueueCheck",
+                                                             "UserInputProvide",
+                                                             "UserInputProvideAll")
+                          << "        <property name='log_level' type='u' access='readwrite'/>"
+                          << signal.GetStatusChangeIntrospection()
+                          << signal.GetLogIntrospection()
+                          << signal.GetLogWatchIntrospection()
+                          << "        <signal name='AttentionRequired'>"
+                          << "            <arg type='u' name='type' direction='out'/>"
+                          << "            <arg type='u' name='group' direction='out'/>"
+                          << "            <arg type='s' name='message' direction='out'/>"
+                          << "        </signal>"
+                          << "        <signal name='RegistrationRequest'>"
+                          << "            <arg type='s' name='busname' direction='out'/>"
+                          << "            <arg type='s' name='token' direction='out'/>"
+                          << "        </signal>"
+                          << "        <property type='a{sx}' name='statistics' access='read'/>"
+                          << "        <property type='a{sv}' name='status' access='read'/>"
+                          << "    </interface>"
+                          << "</node>";
+        ParseIntrospectionXML(introspection_xml);
+
+        signal.Debug("Sending RegistrationRequest('" + bus_name + "', '"
+                     + session_token + "') signal [mock]");
+        signal.Send(OpenVPN3DBus_name_sessions,
+                    OpenVPN3DBus_interf_backends,
+                    "RegistrationRequest",
+                    g_variant_new("(ss)", bus_name.c_str(), session_token.c_str()));
+    }
+
+    ~MockBackendObject()
+    {
+        if (connect_timer > 0)
+        {
+            g_source_remove(connect_timer);
+        }
+        if (log_timer > 0)
+        {
+            g_source_remove(log_timer);
+        }
+    }
+
+    void SetMainLoop(GMainLoop *ml)
+    {
+        mainloop = ml;
+    }
+
+    void callback_method_call(GDBusConnection *conn,
+                              const std::string sender,
+                              const std::string obj_path,
+                              const std::string intf_name,
+                              const std::string method_name,
+                              GVariant *params,
+                              GDBusMethodInvocation *invoc)
+    {
+        try
+        {
+            if ("RegistrationConfirmation" == method_name)
+            {
+                if (registered)
+                {
+                    THROW_DBUSEXCEPTION("MockBackendObject",
+                                        "Backend service is already registered");
+                }
+
+                gchar *token = NULL;
+                gchar *cfgpath = NULL;
+                g_variant_get(params, "(so)", &token, &cfgpath);
+
+                registered = (session_token == std::string(token));
+                configpath = std::string(cfgpath);
+                g_free(token);
+                g_free(cfgpath);
+
+                if (!registered)
+                {
+                    GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.error.be-registration",
+                                                                  "Invalid registration token");
+                    g_dbus_method_invocation_return_gerror(invoc, err);
+                    g_error_free(err);
+                    return;
+                }
+                g_dbus_method_invocation_return_value(invoc,
+                                                      g_variant_new("(b)", (bool) registered));
+
+                // Exercise the configuration manager read path, just
+                // as the real client does via fetch_configuration()
+                try
+                {
+                    OpenVPN3ConfigurationProxy cfgprx(G_BUS_TYPE_SYSTEM, configpath);
+                    std::string profile = cfgprx.GetConfig();
+                    signal.LogVerb2("Mock backend fetched configuration profile, "
+                                    + std::to_string(profile.size()) + " bytes");
+                }
+                catch (DBusException& excp)
+                {
+                    signal.LogError("Mock backend could not fetch configuration: "
+                                    + std::string(excp.what()));
+                }
+
+                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_INIT);
+                return;
+            }
+            else if ("Ping" == method_name)
+            {
+                g_dbus_method_invocation_return_value(invoc,
+                                                      g_variant_new("(b)", true));
+                return;
+            }
+            else if ("Ready" == method_name)
+            {
+                // The mock never requires credentials, so it is
+                // always ready once registered
+                if (!registered)
+                {
+                    THROW_DBUSEXCEPTION("MockBackendObject",
+                                        "Backend service is not initialized");
+                }
+                g_dbus_method_invocation_return_value(invoc, NULL);
+                return;
+            }
+            else if ("Connect" == method_name)
+            {
+                if (!registered)
+                {
+                    THROW_DBUSEXCEPTION("MockBackendObject",
+                                        "Backend service is not initialized");
+                }
+                signal.LogInfo("Starting [mock] connection: " + obj_path);
+                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_CONNECTING);
+                if (connect_timer > 0)
+                {
+                    g_source_remove(connect_timer);
+                }
+                connect_timer = g_timeout_add(connect_time_ms,
+                                              mock_connected_cb, this);
+                g_dbus_method_invocation_return_value(invoc, NULL);
+                return;
+            }
+            else if ("Pause" == method_name)
+            {
+                gchar *reason = NULL;
+                g_variant_get(params, "(s)", &reason);
+                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_PAUSING,
+                                    std::string(reason));
+                g_free(reason);
+                paused = true;
+                stop_log_timer();
+                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_PAUSED);
+                g_dbus_method_invocation_return_value(invoc, NULL);
+                return;
+            }
+            else if ("Resume" == method_name)
+            {
+                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_RESUMING);
+                paused = false;
+                mark_connected();
+                g_dbus_method_invocation_return_value(invoc, NULL);
+                return;
+            }
+            else if ("Restart" == method_name)
+            {
+                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_RECONNECTING);
+                mark_connected();
+                g_dbus_method_invocation_return_value(invoc, NULL);
+                return;
+            }
+            else if ("Disconnect" == method_name
+                     || "ForceShutdown" == method_name)
+            {
+                signal.LogInfo("Stopping [mock] connection: " + obj_path);
+                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_DISCONNECTING);
+                stop_log_timer();
+                signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_DONE);
+
+                RemoveObject(dbusconn);
+                g_dbus_method_invocation_return_value(invoc, NULL);
+                if (mainloop)
+                {
+                    g_main_loop_quit(mainloop);
+                }
+                else
+                {
+                    kill(getpid(), SIGTERM);
+                }
+                return;
+            }
+            else if ("UserInputQueueGetTypeGroup" == method_name)
+            {
+                userinputq.QueueCheckTypeGroup(invoc);
+                return;
+            }
+            else if ("UserInputQueueFetch" == method_name)
+            {
+                userinputq.QueueFetch(invoc, params);
+                return;
+            }
+            else if ("UserInputQueueFetchAll" == method_name)
+            {
+                userinputq.QueueFetchAll(invoc);
+                return;
+            }
+            else if ("UserInputQueueCheck" == method_name)
+            {
+                userinputq.QueueCheck(invoc, params);
+                return;
+            }
+            else if ("UserInputProvideAll" == method_name)
+            {
+                userinputq.QueueProvideAll(invoc, params);
+                return;
+            }
+            else if ("UserInputProvide" == method_name)
+            {
+                userinputq.UpdateEntry(invoc, params);
+                return;
+            }
+
+            THROW_DBUSEXCEPTION("MockBackendObject",
+                                "No method named " + method_name + " is available");
+        }
+        catch (DBusException& excp)
+        {
+            GError *err = g_dbus_error_new_for_dbus_error("net.openvpn.v3.error.mock",
+                                                          excp.what());
+            g_dbus_method_invocation_return_gerror(invoc, err);
+            g_error_free(err);
+        }
+        catch (RequiresQueueException& excp)
+        {
+            excp.GenerateDBusError(invoc);
+        }
+    }
+
+    GVariant * callback_get_property(GDBusConnection *conn,
+                                     const std::string sender,
+                                     const std::string obj_path,
+                                     const std::string intf_name,
+                                     const std::string property_name,
+                                     GError **error)
+    {
+        if ("log_level" == property_name)
+        {
+            return g_variant_new_uint32(signal.GetLogLevel());
+        }
+        else if ("statistics" == property_name)
+        {
+            return build_mock_statistics();
+        }
+        else if ("status" == property_name)
+        {
+            GVariant *res = signal.GetLastStatusChange();
+            if (NULL == res)
+            {
+                res = g_variant_new("a{sv}", NULL);
+            }
+            return res;
+        }
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                    "Unknown property");
+        return NULL;
+    }
+
+    GVariantBuilder * callback_set_property(GDBusConnection *conn,
+                                            const std::string sender,
+                                            const std::string obj_path,
+                                            const std::string intf_name,
+                                            const std::string property_name,
+                                            GVariant *value,
+                                            GError **error)
+    {
+        if ("log_level" == property_name)
+        {
+            unsigned int log_level = g_variant_get_uint32(value);
+            signal.SetLogLevel(log_level);
+            return build_set_property_response(property_name, log_level);
+        }
+        throw DBusPropertyException(G_IO_ERROR, G_IO_ERROR_FAILED,
+                                    obj_path, intf_name, property_name,
+                                    "Invalid property");
+    }
+
+
+private:
+    GDBusConnection *dbusconn = nullptr;
+    GMainLoop *mainloop = nullptr;
+    BackendSignals signal;
+    RequiresQueue userinputq;
+    std::string session_token;
+    std::string configpath;
+    bool registered = false;
+    bool paused = false;
+    unsigned int connect_time_ms;
+    unsigned int log_interval;
+    unsigned int stats_rate;
+    guint connect_timer = 0;
+    guint log_timer = 0;
+    gint64 connected_since = 0;
+    unsigned int log_lines_sent = 0;
+    const unsigned int default_log_level = 6;
+
+
+    /**
+     *  Marks the mock session connected and starts the synthetic
+     *  log traffic, when enabled
+     */
+    void mark_connected()
+    {
+        connect_timer = 0;
+        if (0 == connected_since)
+        {
+            connected_since = g_get_monotonic_time();
+        }
+        signal.StatusChange(StatusMajor::CONNECTION, StatusMinor::CONN_CONNECTED);
+        if (log_interval > 0 && 0 == log_timer)
+        {
+            log_timer = g_timeout_add_seconds(log_interval,
+                                              mock_log_cb, this);
+        }
+    }
+
+    void stop_log_timer()
+    {
+        if (log_timer > 0)
+        {
+            g_source_remove(log_timer);
+            log_timer = 0;
+        }
+    }
+
+    /**
+     *  Builds the a{sx} statistics dictionary the session manager
+     *  GetStatistics path consumes.  The byte counters grow linearly
+     *  with connected time at the configured synthetic rate.
+     */
+    GVariant * build_mock_statistics()
+    {
+        gint64 secs = 0;
+        if (connected_since > 0)
+        {
+            secs = (g_get_monotonic_time() - connected_since) / G_USEC_PER_SEC;
+        }
+        GVariantBuilder *b = GVariantBuilderPool::Acquire(G_VARIANT_TYPE("a{sx}"));
+        g_variant_builder_add(b, "{sx}", "BYTES_IN", (gint64) (secs * stats_rate));
+        g_variant_builder_add(b, "{sx}", "BYTES_OUT", (gint64) (secs * stats_rate));
+        g_variant_builder_add(b, "{sx}", "PACKETS_IN", (gint64) (secs * stats_rate / 1400));
+        g_variant_builder_add(b, "{sx}", "PACKETS_OUT", (gint64) (secs * stats_rate / 1400));
+        GVariant *ret = g_variant_builder_end(b);
+        GVariantBuilderPool::Release(b);
+        return ret;
+    }
+
+    static gboolean mock_connected_cb(gpointer user_data)
+    {
+        MockBackendObject *obj = static_cast<MockBackendObject *>(user_data);
+        if (!obj->paused)
+        {
+            obj->mark_connected();
+        }
+        return G_SOURCE_REMOVE;
+    }
+
+    static gboolean mock_log_cb(gpointer user_data)
+    {
+        MockBackendObject *obj = static_cast<MockBackendObject *>(user_data);
+        obj->signal.LogVerb1("Mock tunnel traffic report #"
+                             + std::to_string(++obj->log_lines_sent));
+        return G_SOURCE_CONTINUE;
+    }
+};
+
+
+/**
+ *  Main D-Bus service object for the mock backend.  Mirrors
+ *  BackendClientDBus: claims net.openvpn.v3.backends.be${pid} and
+ *  registers a single MockBackendObject once the bus is acquired.
+ */
+class MockBackendDBus : public DBus
+{
+public:
+    MockBackendDBus(GBusType bus_type, std::string token)
+        : DBus(bus_type,
+               OpenVPN3DBus_name_backends_be + std::to_string(getpid()),
+               OpenVPN3DBus_rootp_backends_sessions,
+               OpenVPN3DBus_interf_backends),
+          session_token(token)
+    {
+    }
+
+    void SetMainLoop(GMainLoop *ml)
+    {
+        mainloop = ml;
+        if (be_obj)
+        {
+            be_obj->SetMainLoop(ml);
+        }
+    }
+
+    void callback_bus_acquired()
+    {
+        std::string objpath = generate_path_uuid(OpenVPN3DBus_rootp_backends_sessions, 'z');
+        be_obj.reset(new MockBackendObject(GetConnection(), GetBusName(),
+                                           objpath, session_token));
+        be_obj->RegisterObject(GetConnection());
+        if (mainloop)
+        {
+            be_obj->SetMainLoop(mainloop);
+        }
+    }
+
+    void callback_name_acquired(GDBusConnection *conn, std::string busname)
+    {
+    }
+
+    void callback_name_lost(GDBusConnection *conn, std::string busname)
+    {
+        THROW_DBUSEXCEPTION("MockBackendDBus",
+                            "mock-backend-client could not register '"
+                            + busname + "' on the D-Bus");
+    }
+
+private:
+    std::string session_token;
+    GMainLoop *mainloop = nullptr;
+    MockBackendObject::Ptr be_obj;
+};
+
+
+static gboolean stop_handler(gpointer user_data)
+{
+    g_main_loop_quit((GMainLoop *) user_data);
+    return G_SOURCE_CONTINUE;
+}
+
+
+int main(int argc, char **argv)
+{
+    std::string token_arg;
+    if (4 == argc && "--tun-fd" == std::string(argv[1]))
+    {
+        // The backend starter pre-creates a tun device for the real
+        // client; the mock has no use for it, so just close it
+        int tun_fd = ::atoi(argv[2]);
+        if (tun_fd >= 0)
+        {
+            close(tun_fd);
+        }
+        token_arg = std::string(argv[3]);
+    }
+    else if (2 == argc)
+    {
+        token_arg = std::string(argv[1]);
+    }
+    else
+    {
+        std::cout << "Usage: " << argv[0]
+                  << " [--tun-fd <fd>] <session registration token>" << std::endl;
+        return 1;
+    }
+
+    // Match the real client's double-fork, so the backend starter's
+    // waitpid() on the intermediate child behaves identically
+    if (-1 == setsid())
+    {
+        std::cerr << "** ERROR ** Failed getting a new process session ID:"
+                  << strerror(errno) << std::endl;
+        return 3;
+    }
+    pid_t real_pid = fork();
+    if (real_pid > 0)
+    {
+        std::cout << "Re-initiated mock process from pid " << std::to_string(getpid())
+                  << " to backend process " << std::to_string(real_pid) << std::endl;
+        return 0;
+    }
+    else if (real_pid < 0)
+    {
+        std::cerr << "** ERROR ** Failed forking out mock backend child" << std::endl;
+        return 3;
+    }
+
+    MockBackendDBus backend_service(G_BUS_TYPE_SYSTEM, token_arg);
+    backend_service.Setup();
+
+    GMainLoop *main_loop = g_main_loop_new(NULL, FALSE);
+    g_unix_signal_add(SIGINT, stop_handler, main_loop);
+    g_unix_signal_add(SIGTERM, stop_handler, main_loop);
+    backend_service.SetMainLoop(main_loop);
+    g_main_loop_run(main_loop);
+    g_main_loop_unref(main_loop);
+
+    return 0;
+}
@@ -0,0 +1,378 @@
+//  OpenVPN 3 Linux client -- Next generation OpenVPN client
+//
+//  Copyright (C) 2018         OpenVPN Inc. <sales@openvpn.net>
+//  Copyright (C) 2018         David Sommerseth <davids@openvpn.net>
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as
+//  published by the Free Software Foundation, version 3 of the
+//  License.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+/**
+ * @file   session-churn.cpp
+ *
+ * @brief  Session churn load and soak driver.
+ *
+ *         Creates, connects and disconnects VPN sessions against the
+ *         real configmgr+sessionmgr+logger service stack at a
+ *         configurable rate, and reports per-phase latency
+ *         percentiles plus the resident set size of each service over
+ *         time.  Combine with mock-backend-client installed in place
+ *         of openvpn3-service-client to run thousands of sessions
+ *         without any real VPN servers; this is the "what does this
+ *         host do at 1,000 sessions?" answer before a rollout.
+ *
+ *         Usage: session-churn <config file> [rate] [duration] [report interval]
+ *
+ *         rate is sessions per second (default 1, fractions allowed),
+ *         duration and report interval are in seconds (default 60/10).
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "dbus/core.hpp"
+#include "dbus/connection-creds.hpp"
+#include "common/utils.hpp"
+#include "configmgr/proxy-configmgr.hpp"
+#include "sessionmgr/proxy-sessionmgr.hpp"
+
+using namespace openvpn;
+
+
+/**
+ *  Latency samples for one phase of the session life cycle, with
+ *  simple percentile reporting
+ */
+struct PhaseLatency
+{
+    std::string name;
+    std::vector<double> samples_ms;
+    unsigned int errors = 0;
+
+    PhaseLatency(std::string name) : name(name)
+    {
+    }
+
+    void Add(gint64 start_usec)
+    {
+        samples_ms.push_back((g_get_monotonic_time() - start_usec) / 1000.0);
+    }
+
+    double Percentile(double pct)
+    {
+        if (samples_ms.empty())
+        {
+            return 0.0;
+        }
+        std::vector<double> sorted(samples_ms);
+        std::sort(sorted.begin(), sorted.end());
+        size_t idx = (size_t) (pct / 100.0 * (sorted.size() - 1));
+        return sorted[idx];
+    }
+
+    void Report()
+    {
+        std::cout << std::setw(12) << name << "  "
+                  << "samples=" << std::setw(6) << samples_ms.size()
+                  << "  errors=" << std::setw(4) << errors
+                  << std::fixed << std::setprecision(1)
+                  << "  p50=" << std::setw(8) << Percentile(50) << "ms"
+                  << "  p90=" << std::setw(8) << Percentile(90) << "ms"
+                  << "  p99=" << std::setw(8) << Percentile(99) << "ms"
+                  << "  max=" << std::setw(8) << Percentile(100) << "ms"
+                  << std::endl;
+    }
+};
+
+
+/**
+ *  Reads VmRSS for a process from /proc, in kilobytes.
+ *  Returns 0 when the process is gone or unreadable.
+ */
+static unsigned long read_rss_kb(pid_t pid)
+{
+    if (pid <= 0)
+    {
+        return 0;
+    }
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmRSS:") == 0)
+        {
+            return strtoul(line.c_str() + 6, NULL, 10);
+        }
+    }
+    return 0;
+}
+
+
+/**
+ *  Finds the PID of a process by scanning /proc for a command line
+ *  containing the given substring.  Used for the logger service,
+ *  which does not own a well-known bus name to resolve a PID from.
+ */
+static pid_t pid_of_cmdline(const std::string& needle)
+{
+    DIR *procdir = opendir("/proc");
+    if (!procdir)
+    {
+        return 0;
+    }
+    pid_t found = 0;
+    struct dirent *de;
+    while (0 == found && NULL != (de = readdir(procdir)))
+    {
+        pid_t pid = (pid_t) strtoul(de->d_name, NULL, 10);
+        if (pid <= 0 || pid == getpid())
+        {
+            continue;
+        }
+        std::ifstream cmdf("/proc/" + std::to_string(pid) + "/cmdline");
+        std::string cmdline((std::istreambuf_iterator<char>(cmdf)),
+                            std::istreambuf_iterator<char>());
+        if (cmdline.find(needle) != std::string::npos)
+        {
+            found = pid;
+        }
+    }
+    closedir(procdir);
+    return found;
+}
+
+
+/**
+ *  Waits for the session's backend client process to register with
+ *  the session manager, polling backend_ready.
+ *
+ * @return Returns true once registered, false on timeout
+ */
+static bool wait_backend_ready(OpenVPN3SessionProxy& session,
+                               unsigned int timeout_ms)
+{
+    gint64 deadline = g_get_monotonic_time() + (gint64) timeout_ms * 1000;
+    while (g_get_monotonic_time() < deadline)
+    {
+        try
+        {
+            if (session.GetBackendReady())
+            {
+                return true;
+            }
+        }
+        catch (DBusException&)
+        {
+            // Property not readable yet; keep polling
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 5)
+    {
+        std::cout << "Usage: " << argv[0]
+                  << " <config file> [sessions/second] [duration seconds]"
+                  << " [report interval seconds]" << std::endl;
+        return 1;
+    }
+
+    double rate = (argc > 2 ? atof(argv[2]) : 1.0);
+    unsigned int duration = (argc > 3 ? atoi(argv[3]) : 60);
+    unsigned int report_interval = (argc > 4 ? atoi(argv[4]) : 10);
+    if (rate <= 0.0 || 0 == duration)
+    {
+        std::cout << "** ERROR ** rate and duration must be positive" << std::endl;
+        return 1;
+    }
+
+    std::ifstream cfgfile(argv[1]);
+    if (cfgfile.fail())
+    {
+        std::cout << "** ERROR ** Cannot open configuration file " << argv[1] << std::endl;
+        return 1;
+    }
+    std::string config_blob((std::istreambuf_iterator<char>(cfgfile)),
+                            std::istreambuf_iterator<char>());
+
+    try
+    {
+        DBus dbus(G_BUS_TYPE_SYSTEM);
+        dbus.Connect();
+
+        // Import one shared profile for all churned sessions
+        OpenVPN3ConfigurationProxy cfgmgr(G_BUS_TYPE_SYSTEM,
+                                          OpenVPN3DBus_rootp_configuration);
+        std::string cfgpath = cfgmgr.Import("session-churn", config_blob,
+                                            false, false);
+        std::cout << "Imported configuration: " << cfgpath << std::endl;
+
+        // Resolve the service PIDs up front for RSS sampling
+        DBusConnectionCreds creds(dbus.GetConnection());
+        pid_t pid_cfgmgr = creds.GetPID(OpenVPN3DBus_name_configuration);
+        pid_t pid_sessmgr = creds.GetPID(OpenVPN3DBus_name_sessions);
+        pid_t pid_bestart = 0;
+        try
+        {
+            pid_bestart = creds.GetPID(OpenVPN3DBus_name_backends);
+        }
+        catch (DBusException&)
+        {
+            // Started on demand; resolved again at report time
+        }
+        pid_t pid_logger = pid_of_cmdline("openvpn3-service-logger");
+
+        OpenVPN3SessionProxy manager(G_BUS_TYPE_SYSTEM,
+                                     OpenVPN3DBus_rootp_sessions);
+
+        PhaseLatency lat_create("NewTunnel");
+        PhaseLatency lat_register("Register");
+        PhaseLatency lat_connect("Connect");
+        PhaseLatency lat_disconnect("Disconnect");
+
+        gint64 t_start = g_get_monotonic_time();
+        gint64 t_end = t_start + (gint64) duration * G_USEC_PER_SEC;
+        gint64 t_report = t_start + (gint64) report_interval * G_USEC_PER_SEC;
+        double interval_usec = G_USEC_PER_SEC / rate;
+        unsigned long iteration = 0;
+
+        std::cout << "Churning " << rate << " sessions/second for "
+                  << duration << " seconds" << std::endl;
+        std::cout << "#  elapsed  sessions  cfgmgr-rss  sessmgr-rss"
+                  << "  bestart-rss  logger-rss  (kB)" << std::endl;
+
+        while (g_get_monotonic_time() < t_end)
+        {
+            gint64 t_iter = t_start + (gint64) (iteration * interval_usec);
+            ++iteration;
+
+            std::string sesspath;
+            gint64 t0 = g_get_monotonic_time();
+            try
+            {
+                sesspath = manager.NewTunnel(cfgpath);
+                lat_create.Add(t0);
+            }
+            catch (DBusException& excp)
+            {
+                ++lat_create.errors;
+                std::cerr << "NewTunnel failed: " << excp.what() << std::endl;
+            }
+
+            if (!sesspath.empty())
+            {
+                OpenVPN3SessionProxy session(dbus, sesspath);
+
+                t0 = g_get_monotonic_time();
+                if (wait_backend_ready(session, 10000))
+                {
+                    lat_register.Add(t0);
+
+                    t0 = g_get_monotonic_time();
+                    try
+                    {
+                        session.Ready();
+                        session.Connect();
+                        lat_connect.Add(t0);
+                    }
+                    catch (std::exception& excp)
+                    {
+                        ++lat_connect.errors;
+                        std::cerr << "Connect failed: " << excp.what() << std::endl;
+                    }
+                }
+                else
+                {
+                    ++lat_register.errors;
+                    std::cerr << "Backend registration timed out: "
+                              << sesspath << std::endl;
+                }
+
+                t0 = g_get_monotonic_time();
+                try
+                {
+                    session.Disconnect();
+                    lat_disconnect.Add(t0);
+                }
+                catch (DBusException& excp)
+                {
+                    ++lat_disconnect.errors;
+                    std::cerr << "Disconnect failed: " << excp.what() << std::endl;
+                }
+            }
+
+            gint64 now = g_get_monotonic_time();
+            if (now >= t_report)
+            {
+                if (0 == pid_bestart)
+                {
+                    try
+                    {
+                        pid_bestart = creds.GetPID(OpenVPN3DBus_name_backends);
+                    }
+                    catch (DBusException&)
+                    {
+                    }
+                }
+                if (0 == pid_logger)
+                {
+                    pid_logger = pid_of_cmdline("openvpn3-service-logger");
+                }
+                std::cout << "  " << std::setw(6) << (now - t_start) / G_USEC_PER_SEC << "s"
+                          << "  " << std::setw(8) << iteration
+                          << "  " << std::setw(10) << read_rss_kb(pid_cfgmgr)
+                          << "  " << std::setw(11) << read_rss_kb(pid_sessmgr)
+                          << "  " << std::setw(11) << read_rss_kb(pid_bestart)
+                          << "  " << std::setw(10) << read_rss_kb(pid_logger)
+                          << std::endl;
+                t_report = now + (gint64) report_interval * G_USEC_PER_SEC;
+            }
+
+            // Pace the loop towards the requested rate
+            gint64 t_next = t_iter + (gint64) interval_usec;
+            now = g_get_monotonic_time();
+            if (now < t_next)
+            {
+                usleep((useconds_t) (t_next - now));
+            }
+        }
+
+        std::cout << std::endl << "Latency percentiles:" << std::endl;
+        lat_create.Report();
+        lat_register.Report();
+        lat_connect.Report();
+        lat_disconnect.Report();
+
+        OpenVPN3ConfigurationProxy cfgobj(G_BUS_TYPE_SYSTEM, cfgpath);
+        cfgobj.Remove();
+    }
+    catch (std::exception& excp)
+    {
+        std::cout << "** ERROR ** " << excp.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}